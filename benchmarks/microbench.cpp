@@ -0,0 +1,258 @@
+/*******************************************************************************
+ * benchmarks/microbench.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <cobs/file/classic_index_header.hpp>
+#include <cobs/kmer.hpp>
+#include <cobs/query/classic_index/mmap_search_file.hpp>
+#include <cobs/query/classic_search.hpp>
+#include <cobs/util/misc.hpp>
+#include <cobs/util/query.hpp>
+
+#include <random>
+#include <vector>
+
+// all inputs are generated from this fixed seed so results stay
+// comparable across commits and machines
+static const uint32_t seed = 0x0b5e55ed;
+
+/******************************************************************************/
+// expansion kernels: compute_counts and aggregate_rows
+
+//! which instruction set variant of the kernels to pin via the
+//! classic_search_disable flags
+enum class Variant { scalar_64, sse2_128, dispatch };
+
+namespace {
+
+//! pin a kernel variant for the duration of one benchmark
+struct VariantGuard {
+    bool sse2_, avx2_, avx512_;
+
+    explicit VariantGuard(Variant v)
+        : sse2_(cobs::classic_search_disable_sse2),
+          avx2_(cobs::classic_search_disable_avx2),
+          avx512_(cobs::classic_search_disable_avx512) {
+        cobs::classic_search_disable_sse2 = (v == Variant::scalar_64);
+        cobs::classic_search_disable_avx2 = (v != Variant::dispatch);
+        cobs::classic_search_disable_avx512 = (v != Variant::dispatch);
+    }
+    ~VariantGuard() {
+        cobs::classic_search_disable_sse2 = sse2_;
+        cobs::classic_search_disable_avx2 = avx2_;
+        cobs::classic_search_disable_avx512 = avx512_;
+    }
+};
+
+} // namespace
+
+//! score a batch of terms' rows, row size in bytes taken from the
+//! benchmark argument
+template <typename Score>
+static void compute_counts_bench(benchmark::State& state, Variant v) {
+    const uint64_t num_hashes = 3;
+    const size_t num_terms = 32;
+    const size_t hashes_size = num_hashes * num_terms;
+    const size_t row_size = state.range(0);
+
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> rows(hashes_size * row_size);
+    for (uint8_t& b : rows)
+        b = uint8_t(rng());
+    Score* scores = cobs::allocate_aligned<Score>(8 * row_size, 64);
+
+    VariantGuard guard(v);
+    for (auto _ : state) {
+        cobs::classic_search_compute_counts(
+            num_hashes, hashes_size, scores, rows.data(),
+            row_size, row_size);
+        benchmark::DoNotOptimize(scores[0]);
+    }
+    state.SetBytesProcessed(state.iterations() * num_terms * row_size);
+    cobs::deallocate_aligned(scores);
+}
+
+static void BM_compute_counts_u8_64(benchmark::State& state) {
+    compute_counts_bench<uint8_t>(state, Variant::scalar_64);
+}
+static void BM_compute_counts_u16_64(benchmark::State& state) {
+    compute_counts_bench<uint16_t>(state, Variant::scalar_64);
+}
+static void BM_compute_counts_u32_64(benchmark::State& state) {
+    compute_counts_bench<uint32_t>(state, Variant::scalar_64);
+}
+BENCHMARK(BM_compute_counts_u8_64)->Arg(128)->Arg(1024)->Arg(16384);
+BENCHMARK(BM_compute_counts_u16_64)->Arg(128)->Arg(1024)->Arg(16384);
+BENCHMARK(BM_compute_counts_u32_64)->Arg(128)->Arg(1024)->Arg(16384);
+
+#if __SSE2__
+static void BM_compute_counts_u8_128(benchmark::State& state) {
+    compute_counts_bench<uint8_t>(state, Variant::sse2_128);
+}
+static void BM_compute_counts_u16_128(benchmark::State& state) {
+    compute_counts_bench<uint16_t>(state, Variant::sse2_128);
+}
+static void BM_compute_counts_u32_128(benchmark::State& state) {
+    compute_counts_bench<uint32_t>(state, Variant::sse2_128);
+}
+BENCHMARK(BM_compute_counts_u8_128)->Arg(128)->Arg(1024)->Arg(16384);
+BENCHMARK(BM_compute_counts_u16_128)->Arg(128)->Arg(1024)->Arg(16384);
+BENCHMARK(BM_compute_counts_u32_128)->Arg(128)->Arg(1024)->Arg(16384);
+#endif
+
+//! whatever the cpu dispatch picks on this machine
+static void BM_compute_counts_u16_dispatch(benchmark::State& state) {
+    compute_counts_bench<uint16_t>(state, Variant::dispatch);
+}
+BENCHMARK(BM_compute_counts_u16_dispatch)->Arg(128)->Arg(1024)->Arg(16384);
+
+static void BM_aggregate_rows(benchmark::State& state) {
+    const uint64_t num_hashes = 3;
+    const size_t num_terms = 32;
+    const size_t hashes_size = num_hashes * num_terms;
+    const size_t row_size = state.range(0);
+
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> rows(hashes_size * row_size);
+    for (uint8_t& b : rows)
+        b = uint8_t(rng());
+
+    for (auto _ : state) {
+        cobs::classic_search_aggregate_rows(
+            num_hashes, hashes_size, rows.data(), row_size, row_size);
+        benchmark::DoNotOptimize(rows.data());
+    }
+    state.SetBytesProcessed(
+        state.iterations() * hashes_size * row_size);
+}
+BENCHMARK(BM_aggregate_rows)->Arg(128)->Arg(1024)->Arg(16384);
+
+/******************************************************************************/
+// term hashing and k-mer encoding
+
+//! hash a batch of packed k-mers, hash_mode from the benchmark argument
+static void BM_process_hashes(benchmark::State& state) {
+    const uint8_t hash_mode = uint8_t(state.range(0));
+    const uint64_t signature_size = 0x0fff'fffd;
+    const uint64_t num_hashes = 3;
+
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> kmers(1024);
+    for (uint64_t& k : kmers)
+        k = rng();
+
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        for (const uint64_t& k : kmers) {
+            cobs::process_hashes(
+                &k, sizeof(k), signature_size, num_hashes, hash_mode,
+                [&](uint64_t h) { sum += h; });
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * kmers.size());
+}
+BENCHMARK(BM_process_hashes)->Arg(0)->Arg(1);
+
+static void BM_canonicalize_kmer(benchmark::State& state) {
+    std::string sequence = cobs::random_sequence(1024 + 31, seed);
+    char buffer[32];
+
+    for (auto _ : state) {
+        size_t good = 0;
+        for (size_t i = 0; i + 31 <= sequence.size(); ++i) {
+            good += cobs::canonicalize_kmer(
+                sequence.data() + i, buffer, 31);
+        }
+        benchmark::DoNotOptimize(good);
+    }
+    state.SetItemsProcessed(state.iterations() * 1025);
+}
+BENCHMARK(BM_canonicalize_kmer);
+
+static void BM_kmer_init(benchmark::State& state) {
+    std::string sequence = cobs::random_sequence(1024 + 31, seed);
+    cobs::KMer<31> kmer;
+    char buffer[32];
+    buffer[31] = 0;
+
+    for (auto _ : state) {
+        for (size_t i = 0; i + 31 <= sequence.size(); ++i) {
+            std::copy(sequence.data() + i, sequence.data() + i + 31,
+                      buffer);
+            kmer.init(buffer);
+            benchmark::DoNotOptimize(kmer);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 1025);
+}
+BENCHMARK(BM_kmer_init);
+
+/******************************************************************************/
+// row gather from a synthetic memory-mapped classic index
+
+namespace {
+
+//! read_from_disk() is protected in the search file hierarchy, widen it
+//! for direct benchmarking
+class BenchMMapSearchFile : public cobs::ClassicIndexMMapSearchFile
+{
+public:
+    using cobs::ClassicIndexMMapSearchFile::ClassicIndexMMapSearchFile;
+    using cobs::ClassicIndexMMapSearchFile::read_from_disk;
+    using cobs::ClassicIndexMMapSearchFile::row_size;
+};
+
+} // namespace
+
+static void BM_read_from_disk(benchmark::State& state) {
+    const uint64_t signature_size = 64 * 1024;
+    const size_t num_documents = 2048;
+    const uint64_t num_hashes = 3;
+    const size_t num_terms = 32;
+
+    static cobs::fs::path path;
+    if (path.empty()) {
+        path = cobs::fs::temp_directory_path()
+               / "cobs_microbench.cobs_classic";
+        cobs::ClassicIndexHeader h;
+        h.term_size_ = 31;
+        h.canonicalize_ = 1;
+        h.signature_size_ = signature_size;
+        h.num_hashes_ = num_hashes;
+        h.hash_mode_ = 1;
+        for (size_t i = 0; i < num_documents; ++i)
+            h.file_names_.push_back("document_" + cobs::pad_index(i));
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> data(signature_size * h.row_size());
+        for (uint8_t& b : data)
+            b = uint8_t(rng());
+        h.write_file(path, data);
+    }
+    BenchMMapSearchFile index(path);
+    const size_t row_size = index.row_size();
+
+    std::mt19937_64 rng(seed);
+    std::vector<size_t> hashes(num_hashes * num_terms);
+    for (size_t& h : hashes)
+        h = rng();
+    std::vector<uint8_t> rows(hashes.size() * row_size);
+
+    for (auto _ : state) {
+        index.read_from_disk(hashes, rows.data(), 0, row_size, row_size);
+        benchmark::DoNotOptimize(rows.data());
+    }
+    state.SetBytesProcessed(
+        state.iterations() * hashes.size() * row_size);
+}
+BENCHMARK(BM_read_from_disk);
+
+BENCHMARK_MAIN();
+
+/******************************************************************************/
@@ -7,9 +7,22 @@
  * All rights reserved. Published under the MIT License in the LICENSE file.
  ******************************************************************************/
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include <cobs/construction/classic_index.hpp>
 #include <cobs/document_list.hpp>
@@ -17,10 +30,16 @@
 #include <cobs/kmer.hpp>
 #include <cobs/text_file.hpp>
 #include <cobs/util/calc_signature_size.hpp>
+#include <cobs/util/construction_stats.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
+#include <cobs/util/hyperloglog.hpp>
+#include <cobs/util/minimizer.hpp>
 #include <cobs/util/process_file_batches.hpp>
+#include <cobs/util/query.hpp>
 #include <cobs/util/timer.hpp>
+#include <cobs/util/trace.hpp>
+#include <cobs/util/zstd_block.hpp>
 
 #include <tlx/die.hpp>
 #include <tlx/logger.hpp>
@@ -37,24 +56,89 @@ namespace cobs {
 // Construction of classic index from documents
 
 static inline
-void set_bit(std::vector<uint8_t>& data, const ClassicIndexHeader& cih,
+void set_bit(uint8_t* data, const ClassicIndexHeader& cih,
              uint64_t pos, uint64_t doc_index) {
-    data[cih.row_size() * pos + doc_index / 8] |= 1 << (doc_index % 8);
+    // relaxed atomic OR: term ranges of one document may run on different
+    // threads, so a byte of the row is no longer owned by a single thread
+    __atomic_fetch_or(&data[cih.row_size() * pos + doc_index / 8],
+                      uint8_t(1 << (doc_index % 8)), __ATOMIC_RELAXED);
 }
 
+/*!
+ * Exact set of the k-mers already seen in one construction task, used to
+ * skip re-hashing of repeated terms whose Bloom bits are already set.
+ * K-mers of up to 31 canonical bases pack losslessly into a 64-bit key
+ * held in a linear-probing table. Dedup has to be exact: an approximate
+ * filter would skip k-mers that were never hashed and lose index bits.
+ * A full table is cleared instead of grown, which bounds memory per task
+ * and only costs re-hashing some repeats.
+ */
+class KMerDedupSet
+{
+public:
+    //! k-mers longer than 31 bases do not fit into the packed key
+    static bool packable(size_t term_size) { return term_size <= 31; }
+
+    explicit KMerDedupSet(size_t expected_terms) {
+        size_t capacity = 4096;
+        while (capacity < 2 * expected_terms && capacity < max_capacity)
+            capacity *= 2;
+        table_.resize(capacity);
+        mask_ = capacity - 1;
+    }
+
+    //! insert a canonical ACGT term, false if it was seen before
+    bool insert(const char* term, size_t term_size) {
+        // the leading one bit encodes the term length, so shorter k-mers
+        // and the empty slot value zero cannot collide with a key
+        uint64_t key = 1;
+        for (size_t i = 0; i < term_size; ++i)
+            key = (key << 2) | kmer_base_to_code[uint8_t(term[i])];
+        return insert_key(key);
+    }
+
+    //! insert an already packed key with its length sentinel bit set,
+    //! false if it was seen before
+    bool insert_key(uint64_t key) {
+        if (2 * size_ >= table_.size()) {
+            std::fill(table_.begin(), table_.end(), 0);
+            size_ = 0;
+        }
+
+        size_t i = (key * 0x9E3779B97F4A7C15llu >> 33) & mask_;
+        while (table_[i] != 0) {
+            if (table_[i] == key)
+                return false;
+            i = (i + 1) & mask_;
+        }
+        table_[i] = key;
+        ++size_;
+        return true;
+    }
+
+private:
+    //! capacity bound per task, 32 MiB of key slots
+    static const size_t max_capacity = 1llu << 22;
+
+    std::vector<uint64_t> table_;
+    size_t mask_;
+    size_t size_ = 0;
+};
+
 static inline
-void process_term(const tlx::string_view& term, std::vector<uint8_t>& data,
+void process_term(const tlx::string_view& term, uint8_t* data,
                   size_t doc_index, const std::string& path,
                   bool* shown_canonicalization_warning,
-                  const ClassicIndexHeader& cih, char* canonicalize_buffer) {
+                  const ClassicIndexHeader& cih, char* canonicalize_buffer,
+                  KMerDedupSet* dedup = nullptr) {
     if (cih.canonicalize_ == 0) {
         process_hashes(term.data(), term.size(),
-                       cih.signature_size_, cih.num_hashes_,
+                       cih.signature_size_, cih.num_hashes_, cih.hash_mode_,
                        [&](uint64_t hash) {
                            set_bit(data, cih, hash, doc_index);
                        });
     }
-    else if (cih.canonicalize_ == 1) {
+    else if (cih.canonicalize_ == 1 || cih.canonicalize_ == 2) {
         bool good =
             canonicalize_kmer(term.data(), canonicalize_buffer, term.size());
 
@@ -64,69 +148,501 @@ void process_term(const tlx::string_view& term, std::vector<uint8_t>& data,
             *shown_canonicalization_warning = true;
         }
 
+        // only valid ACGT terms have unique packed keys, so terms with
+        // invalid bases are never skipped
+        if (good && dedup != nullptr &&
+            !dedup->insert(canonicalize_buffer, term.size()))
+            return;
+
+        if (cih.canonicalize_ == 2) {
+            // packed hashing: hash the 2-bit packed canonical k-mer, the
+            // same bytes the query side produces for canonicalize 2
+            char packed[64];
+            die_unless(KMer<31>::data_size(term.size()) <= sizeof(packed));
+            KMer<31>::init(canonicalize_buffer, packed, term.size());
+            process_hashes(packed, KMer<31>::data_size(term.size()),
+                           cih.signature_size_, cih.num_hashes_,
+                           cih.hash_mode_,
+                           [&](uint64_t hash) {
+                               set_bit(data, cih, hash, doc_index);
+                           });
+            return;
+        }
+
         process_hashes(canonicalize_buffer, term.size(),
-                       cih.signature_size_, cih.num_hashes_,
+                       cih.signature_size_, cih.num_hashes_, cih.hash_mode_,
                        [&](uint64_t hash) {
                            set_bit(data, cih, hash, doc_index);
                        });
     }
 }
 
-static inline
-void process_batch(size_t batch_num, size_t num_batches, size_t num_threads,
-                   std::string log_prefix,
-                   const std::vector<DocumentEntry>& paths,
-                   const fs::path& out_file,
-                   ClassicIndexHeader& cih, Timer& t) {
+//! sub-batch checkpoint file magic
+static const uint64_t checkpoint_magic = 0x434F4253434B5054llu;
+//! interval between sub-batch checkpoint flushes
+static const auto checkpoint_interval = std::chrono::minutes(5);
+
+/*!
+ * Builds the Bloom matrix of one construction batch. prepare() allocates
+ * the output matrix and cuts the batch into term-range tasks; run_task()
+ * processes one task, and the worker that finishes the batch's last task
+ * finalizes the output file. Splitting preparation from task execution
+ * lets classic_construct_from_documents() schedule the tasks of all
+ * batches through one shared parallel loop.
+ */
+class ClassicBatchBuilder
+{
+public:
+    ClassicBatchBuilder(size_t batch_num, size_t num_batches,
+                        std::string log_prefix,
+                        std::vector<DocumentEntry> paths,
+                        const fs::path& out_file, ClassicIndexHeader cih,
+                        bool dedup, bool continue_, bool direct_io)
+        : batch_num_(batch_num), num_batches_(num_batches),
+          log_prefix_(std::move(log_prefix)), paths_(std::move(paths)),
+          out_file_(out_file), cih_(std::move(cih)), dedup_(dedup),
+          continue_(continue_), direct_io_(direct_io) { }
+
+    //! allocate the matrix, cut tasks, and load a checkpoint if present;
+    //! num_threads only steers how finely large documents are split
+    void prepare(size_t num_threads) {
+        LOG1 << log_prefix_
+             << pad_index(batch_num_) << '/' << pad_index(num_batches_)
+             << " documents " << paths_.size()
+             << " row_size " << cih_.row_size()
+             << " signature_size " << cih_.signature_size_
+             << " matrix_size " << cih_.signature_size_ * cih_.row_size()
+             << " = "
+             << tlx::format_iec_units(
+            cih_.signature_size_ * cih_.row_size()) << 'B';
+
+        die_unless(paths_.size() <= cih_.row_size() * 8);
+        data_size_ = cih_.signature_size_ * cih_.row_size();
+
+        t_.active("process");
+
+        // One task per document, with documents larger than the target
+        // size split into term ranges, so a giant document next to small
+        // ones does not leave cores idle at batch end. Tasks are ordered
+        // largest first and pulled off a shared atomic counter, which
+        // balances like a work-stealing scheduler with a single queue;
+        // set_bit() uses an atomic OR since byte ownership no longer
+        // holds.
+        size_t total_size = 0;
+        for (const DocumentEntry& de : paths_)
+            total_size += de.size_;
+        size_t target_size = std::max<size_t>(
+            tlx::div_ceil(total_size, 4 * num_threads), 1024 * 1024);
+
+        for (size_t i = 0; i < paths_.size(); ++i) {
+            cih_.file_names_[i] = paths_[i].name_;
+
+            size_t num_terms;
+            // term ranges would chop minimizer windows at their
+            // boundaries, so subsampled construction keeps one task per
+            // document
+            if (num_threads <= 1 || cih_.window_size_ > 1 ||
+                paths_[i].size_ <= target_size ||
+                (num_terms = paths_[i].num_terms(cih_.term_size_)) == 0)
+            {
+                tasks_.push_back(TermRangeTask { i, 0, npos,
+                                                 paths_[i].size_ });
+                continue;
+            }
 
-    LOG1 << log_prefix
-         << pad_index(batch_num) << '/' << pad_index(num_batches)
-         << " documents " << paths.size()
-         << " row_size " << cih.row_size()
-         << " signature_size " << cih.signature_size_
-         << " matrix_size " << cih.signature_size_ * cih.row_size() << " = "
-         << tlx::format_iec_units(cih.signature_size_ * cih.row_size()) << 'B';
+            size_t num_ranges = std::min(
+                tlx::div_ceil(paths_[i].size_, target_size), num_terms);
+            size_t terms_per_range = tlx::div_ceil(num_terms, num_ranges);
+            for (size_t begin = 0; begin < num_terms;
+                 begin += terms_per_range)
+            {
+                tasks_.push_back(
+                    TermRangeTask {
+                        i, begin,
+                        std::min(begin + terms_per_range, num_terms),
+                        paths_[i].size_ / num_ranges
+                    });
+            }
+        }
+        // stable sort keeps the task order deterministic across runs,
+        // which checkpoint resume relies on
+        std::stable_sort(tasks_.begin(), tasks_.end(),
+                         [](const TermRangeTask& a, const TermRangeTask& b) {
+                             return a.size > b.size;
+                         });
+        g_construction_stats.tasks_total += tasks_.size();
+        remaining_ = tasks_.size();
+
+        // The matrix is built directly in a writable shared mapping of
+        // the output file, created sparse with ftruncate: set_bit()
+        // stores go straight to the page cache, rows no document touches
+        // stay unallocated, and the separate serialize-and-write pass at
+        // batch end disappears. The file is built under a .tmp name and
+        // renamed once complete, since an interrupted run must not leave
+        // a half-filled file of the final name that looks finished.
+        // direct_io keeps the heap matrix, as O_DIRECT output and a
+        // shared mapping of the same file contradict each other.
+        // placeholder densities keep the serialized length fixed, so the
+        // header can be rewritten in place once the counts are known
+        cih_.doc_densities_.assign(paths_.size(), 0.0);
+        std::ostringstream header_os;
+        cih_.serialize(header_os);
+        header_str_ = header_os.str();
+
+        tmp_out_file_ = out_file_.string() + ".tmp";
+        if (direct_io_) {
+            heap_data_.resize(data_size_);
+            data_ = heap_data_.data();
+        }
+        else {
+            map_ = create_mmap_file(
+                tmp_out_file_, header_str_.size() + data_size_);
+            std::copy(header_str_.begin(), header_str_.end(), map_.data);
+            data_ = map_.data + header_str_.size();
+        }
 
-    die_unless(paths.size() <= cih.row_size() * 8);
-    std::vector<uint8_t> data(cih.signature_size_* cih.row_size());
+        // guards the per-document warning; races on it only drop or
+        // repeat a log line
+        shown_canonicalization_warning_.reset(new bool[paths_.size()]());
+
+        use_dedup_ =
+            dedup_ && (cih_.canonicalize_ == 1 || cih_.canonicalize_ == 2) &&
+            KMerDedupSet::packable(cih_.term_size_);
+
+        // Sub-batch checkpointing (with continue_): completed tasks and
+        // the partially filled matrix are flushed periodically, so a
+        // crash inside a long batch only loses the tasks in flight. Bits
+        // of unfinished tasks that make it into a snapshot are harmless,
+        // since those tasks are rerun entirely on resume and set a
+        // superset of them.
+        checkpoint_file_ = out_file_.string() + ".checkpoint";
+        task_done_ = std::vector<std::atomic<uint8_t> >(tasks_.size());
+        last_checkpoint_ = std::chrono::steady_clock::now();
+
+        if (continue_ && fs::exists(checkpoint_file_)) {
+            std::ifstream ifs(checkpoint_file_.string(),
+                              std::ios::in | std::ios::binary);
+            uint64_t magic = 0, num_tasks = 0, ckpt_data_size = 0;
+            stream_get(ifs, magic, num_tasks, ckpt_data_size);
+            std::vector<uint8_t> done(tasks_.size());
+            if (ifs.good() && magic == checkpoint_magic &&
+                num_tasks == tasks_.size() && ckpt_data_size == data_size_ &&
+                ifs.read(reinterpret_cast<char*>(done.data()),
+                         done.size()) &&
+                ifs.read(reinterpret_cast<char*>(data_), data_size_))
+            {
+                size_t num_done = 0;
+                for (size_t i = 0; i < tasks_.size(); ++i) {
+                    task_done_[i].store(done[i], std::memory_order_relaxed);
+                    num_done += done[i] != 0;
+                }
+                LOG1 << log_prefix_
+                     << pad_index(batch_num_) << '/'
+                     << pad_index(num_batches_)
+                     << " resuming from checkpoint: " << num_done
+                     << '/' << tasks_.size() << " tasks done";
+            }
+            else {
+                LOG1 << "WARNING: ignoring incompatible checkpoint file "
+                     << checkpoint_file_;
+                std::fill(data_, data_ + data_size_, 0);
+            }
+        }
+    }
 
-    std::atomic<size_t> count = 0;
-    t.active("process");
+    //! number of term-range tasks of this batch
+    size_t num_tasks() const { return tasks_.size(); }
 
-    // parallelize over 8 documents, which fit into one byte, the terms are
-    // random hence only little cache trashing inside a cache line should occur.
-    parallel_for(
-        0, (paths.size() + 7) / 8, num_threads,
-        [&](size_t b) {
-            tlx::simple_vector<char> canonicalize_buffer(cih.term_size_);
-
-            size_t local_count = 0;
-            for (size_t i = 8 * b; i < 8 * (b + 1) && i < paths.size(); ++i) {
-                cih.file_names_[i] = paths[i].name_;
-                bool shown_canonicalization_warning = false;
-
-                paths[i].process_terms(
-                    cih.term_size_,
-                    [&](const tlx::string_view& term) {
-                        process_term(term, data, i, paths[i].path_,
-                                     &shown_canonicalization_warning,
-                                     cih, canonicalize_buffer.data());
-                        ++local_count;
+    //! byte size estimate of one task, for largest-first scheduling
+    size_t task_size(size_t ti) const { return tasks_[ti].size; }
+
+    //! per-batch timer, valid once all tasks have finished
+    const Timer& timer() const { return t_; }
+
+    //! process one term-range task; thread-safe for distinct ti
+    void run_task(size_t ti) {
+        if (task_done_[ti].load(std::memory_order_relaxed)) {
+            g_construction_stats.tasks_done++;
+            task_finished();
+            return;
+        }
+
+        tlx::simple_vector<char> canonicalize_buffer(cih_.term_size_);
+        const TermRangeTask& task = tasks_[ti];
+        const DocumentEntry& de = paths_[task.doc_index];
+
+        // per-task dedup of repeated k-mers; the byte size is an upper
+        // bound on the task's term count
+        std::unique_ptr<KMerDedupSet> dedup_set;
+        if (use_dedup_) {
+            dedup_set = std::make_unique<KMerDedupSet>(
+                task.term_end == npos ? de.size_
+                : task.term_end - task.term_begin);
+        }
+
+        size_t local_count = 0;
+
+        // binary fast path for packed hashing of .cobs_doc inputs: the
+        // stored k-mers are already 2-bit packed, so canonicalize and
+        // hash them directly without the decode-to-text round-trip
+        if (cih_.canonicalize_ == 2 && cih_.window_size_ == 1 &&
+            de.type_ == FileType::KMerBuffer && cih_.term_size_ == 31)
+        {
+            KMerBufferHeader dh;
+            KMerBufferMMap<31> doc(de.path_, dh);
+
+            size_t begin = task.term_end == npos ? 0 : task.term_begin;
+            size_t end = task.term_end == npos ? doc.num_kmers()
+                         : std::min(task.term_end, doc.num_kmers());
+            for (size_t j = begin; j < end; ++j) {
+                KMer<31> m = doc[j];
+                m.canonicalize();
+                ++local_count;
+
+                if (dedup_set) {
+                    uint64_t key = uint64_t(1) << 62;
+                    for (size_t b = 0; b < KMer<31>::size; ++b)
+                        key |= uint64_t(m.data()[b]) << (8 * b);
+                    if (!dedup_set->insert_key(key))
+                        continue;
+                }
+
+                process_hashes(
+                    m.data(), KMer<31>::size,
+                    cih_.signature_size_, cih_.num_hashes_, cih_.hash_mode_,
+                    [&](uint64_t hash) {
+                        set_bit(data_, cih_, hash, task.doc_index);
                     });
             }
-            count += local_count;
-        });
+            count_ += local_count;
+            g_construction_stats.terms_hashed += local_count;
+            finish_task(ti);
+            return;
+        }
 
-    t.active("write");
-    cih.write_file(out_file, data);
+        auto handle_term =
+            [&](const tlx::string_view& term) {
+                process_term(
+                    term, data_, task.doc_index, de.path_,
+                    &shown_canonicalization_warning_[task.doc_index],
+                    cih_, canonicalize_buffer.data(), dedup_set.get());
+                ++local_count;
+            };
+
+        if (cih_.window_size_ <= 1) {
+            if (task.term_end == npos)
+                de.process_terms(cih_.term_size_, handle_term);
+            else
+                de.process_terms(cih_.term_size_, task.term_begin,
+                                 task.term_end, handle_term);
+        }
+        else {
+            // minimizer subsampling: canonicalize each term up front,
+            // feed it through the window filter, and hash only the
+            // selected minimizers; the filter ranks the same canonical
+            // text the query side ranks, so both select identical k-mers
+            tlx::simple_vector<char> filter_buffer(cih_.term_size_);
+            auto select_term =
+                [&](const char* term) {
+                    handle_term(tlx::string_view(term, cih_.term_size_));
+                };
+            MinimizerFilter<decltype(select_term)> filter(
+                cih_.window_size_, cih_.term_size_, select_term);
+
+            de.process_terms(
+                cih_.term_size_,
+                [&](const tlx::string_view& term) {
+                    if (cih_.canonicalize_ == 0) {
+                        filter.push(term.data());
+                        return;
+                    }
+                    if (!canonicalize_kmer(term.data(),
+                                           filter_buffer.data(),
+                                           term.size())) {
+                        // invalid bases are left out of the window
+                        bool* shown = &shown_canonicalization_warning_[
+                            task.doc_index];
+                        if (!*shown) {
+                            LOG1 << "WARNING: Invalid DNA base pair "
+                                "(not ACGT) in document: " << de.path_;
+                            *shown = true;
+                        }
+                        return;
+                    }
+                    filter.push(filter_buffer.data());
+                });
+            filter.finish();
+        }
+        count_ += local_count;
+        g_construction_stats.terms_hashed += local_count;
+        finish_task(ti);
+    }
 
-    size_t bit_count = tlx::popcount(data.data(), data.size());
-    LOG1 << log_prefix
-         << pad_index(batch_num) << '/' << pad_index(num_batches)
-         << " done: terms " << count << " ratio_of_ones "
-         << static_cast<double>(bit_count) / (data.size() * 8);
+private:
+    struct TermRangeTask {
+        size_t doc_index;
+        //! half-open term range, term_end npos = whole document
+        size_t term_begin, term_end;
+        //! byte size estimate for largest-first ordering
+        size_t size;
+    };
+    static constexpr size_t npos = size_t(-1);
+
+    //! mark one task done and maybe flush a checkpoint
+    void finish_task(size_t ti) {
+        task_done_[ti].store(1, std::memory_order_release);
+        g_construction_stats.tasks_done++;
+        g_construction_stats.input_bytes += tasks_[ti].size;
+        if (continue_) {
+            // whichever worker notices the elapsed interval first
+            // flushes the checkpoint, the others keep working
+            if (checkpoint_mutex_.try_lock()) {
+                auto now = std::chrono::steady_clock::now();
+                if (now - last_checkpoint_ >= checkpoint_interval) {
+                    save_checkpoint();
+                    last_checkpoint_ = std::chrono::steady_clock::now();
+                }
+                checkpoint_mutex_.unlock();
+            }
+        }
+        task_finished();
+    }
 
-    t.stop();
+    //! count down outstanding tasks, the last one finalizes the batch
+    void task_finished() {
+        if (--remaining_ == 0)
+            finalize();
+    }
+
+    void save_checkpoint() {
+        // snapshot task_done before the matrix, so every task marked
+        // done has all of its bits in the matrix that follows
+        std::vector<uint8_t> done(tasks_.size());
+        for (size_t i = 0; i < tasks_.size(); ++i)
+            done[i] = task_done_[i].load(std::memory_order_acquire);
+
+        fs::path tmp_file = checkpoint_file_.string() + ".tmp";
+        std::ofstream ofs(tmp_file.string(),
+                          std::ios::out | std::ios::binary);
+        stream_put(ofs, checkpoint_magic,
+                   uint64_t(tasks_.size()), uint64_t(data_size_));
+        ofs.write(reinterpret_cast<const char*>(done.data()), done.size());
+        ofs.write(reinterpret_cast<const char*>(data_), data_size_);
+        ofs.close();
+        if (ofs.good())
+            fs::rename(tmp_file, checkpoint_file_);
+    }
+
+    //! write the finished matrix out, runs on the last task's worker
+    void finalize() {
+        // per-document ones counts in one pass over the matrix, unpacking
+        // each non-zero byte into its documents' counters; the total also
+        // replaces the popcount previously done for the log line
+        size_t row_size = cih_.row_size();
+        std::vector<uint64_t> doc_ones(cih_.row_bits());
+        size_t bit_count = 0;
+        for (size_t p = 0, b = 0; p < data_size_; ++p, ++b) {
+            if (b == row_size)
+                b = 0;
+            uint8_t v = data_[p];
+            if (v == 0)
+                continue;
+            uint64_t* ones = doc_ones.data() + 8 * b;
+            while (v != 0) {
+                ++ones[__builtin_ctz(v)];
+                ++bit_count;
+                v &= uint8_t(v - 1);
+            }
+        }
+        for (size_t i = 0; i < doc_ones.size(); ++i) {
+            cih_.doc_densities_[i] =
+                static_cast<double>(doc_ones[i]) / cih_.signature_size_;
+        }
+
+        // rewrite the header with the densities filled in; the layout is
+        // fixed, so the serialized length cannot have changed
+        std::ostringstream header_os;
+        cih_.serialize(header_os);
+        die_unequal(header_os.str().size(), header_str_.size());
+        header_str_ = header_os.str();
+
+        t_.active("write");
+        if (direct_io_) {
+            // bulk write bypassing the page cache, so this batch's
+            // output does not evict input documents of the batches still
+            // to come
+            BulkWriter writer(out_file_, /* direct */ true);
+            writer.append(header_str_.data(), header_str_.size());
+            writer.append(heap_data_.data(), heap_data_.size());
+            writer.close();
+        }
+        else {
+            // the mapping already is the file's contents; unmapping
+            // hands the remaining dirty pages to the kernel for
+            // writeback. the header is recopied for the densities.
+            std::copy(header_str_.begin(), header_str_.end(), map_.data);
+            destroy_mmap_file(map_);
+            fs::rename(tmp_out_file_, out_file_);
+        }
+
+        g_construction_stats.bits_set += bit_count;
+        g_construction_stats.bytes_written +=
+            header_str_.size() + data_size_;
+
+        // the finished batch file supersedes its checkpoint
+        if (continue_) {
+            std::error_code ec;
+            fs::remove(checkpoint_file_, ec);
+        }
+        LOG1 << log_prefix_
+             << pad_index(batch_num_) << '/' << pad_index(num_batches_)
+             << " done: terms " << count_ << " ratio_of_ones "
+             << static_cast<double>(bit_count) / (data_size_ * 8);
+
+        t_.stop();
+    }
+
+    size_t batch_num_, num_batches_;
+    std::string log_prefix_;
+    std::vector<DocumentEntry> paths_;
+    fs::path out_file_, tmp_out_file_, checkpoint_file_;
+    ClassicIndexHeader cih_;
+    bool dedup_, continue_, direct_io_;
+    bool use_dedup_ = false;
+
+    uint64_t data_size_ = 0;
+    std::string header_str_;
+    std::vector<uint8_t> heap_data_;
+    MMapHandle map_ { -1, nullptr, 0 };
+    uint8_t* data_ = nullptr;
+
+    std::vector<TermRangeTask> tasks_;
+    std::vector<std::atomic<uint8_t> > task_done_;
+    std::atomic<size_t> remaining_ { 0 };
+    std::atomic<size_t> count_ { 0 };
+    std::unique_ptr<bool[]> shown_canonicalization_warning_;
+
+    std::mutex checkpoint_mutex_;
+    std::chrono::steady_clock::time_point last_checkpoint_;
+
+    Timer t_;
+};
+
+static inline
+void process_batch(size_t batch_num, size_t num_batches, size_t num_threads,
+                   std::string log_prefix,
+                   const std::vector<DocumentEntry>& paths,
+                   const fs::path& out_file,
+                   const ClassicIndexHeader& cih, bool dedup, bool continue_,
+                   bool direct_io, Timer& t) {
+    TraceScope trace("process_batch");
+    ClassicBatchBuilder builder(
+        batch_num, num_batches, std::move(log_prefix), paths, out_file,
+        cih, dedup, continue_, direct_io);
+    builder.prepare(num_threads);
+    parallel_for(0, builder.num_tasks(), num_threads,
+                 [&](size_t ti) { builder.run_task(ti); });
+    t += builder.timer();
 }
 
 void classic_construct_from_documents(
@@ -159,11 +675,68 @@ void classic_construct_from_documents(
          << " num_threads=" << num_threads
          << " num_batches=" << num_batches;
 
-    doc_list.process_batches_parallel(
-        batch_size, num_threads,
+    if (params.direct_io) {
+        // O_DIRECT batches hold their matrix on the heap, so batches must
+        // run one after another per thread group to bound memory; keep the
+        // static thread split over concurrent batches here
+        doc_list.process_batches_parallel(
+            batch_size, num_threads,
+            [&](size_t batch_num, const std::vector<DocumentEntry>& paths,
+                std::string out_file) {
+                Timer thr_timer;
+
+                // distributed construction: batches of other partitions
+                // are built by other jobs, batch numbering is
+                // deterministic
+                if (params.partition_count > 1 &&
+                    batch_num % params.partition_count
+                    != params.partition_index)
+                    return;
+
+                LOG1 << params.log_prefix
+                     << "Construct Classic Index " << out_file;
+
+                fs::path out_path =
+                    out_dir / (out_file + ClassicIndexHeader::file_extension);
+                if (fs::exists(out_path))
+                    return;
+
+                ClassicIndexHeader cih;
+                cih.term_size_ = params.term_size;
+                cih.canonicalize_ = params.canonicalize;
+                cih.signature_size_ = params.signature_size;
+                cih.num_hashes_ = params.num_hashes;
+                cih.hash_mode_ = params.hash_mode;
+                cih.window_size_ = params.window_size;
+                cih.file_names_.resize(paths.size());
+                process_batch(batch_num, num_batches,
+                              tlx::div_ceil(num_threads, num_batches),
+                              params.log_prefix, paths, out_path, cih,
+                              params.dedup, params.continue_,
+                              params.direct_io, thr_timer);
+
+                t += thr_timer;
+            });
+        t.print("classic_construct_from_documents");
+        return;
+    }
+
+    // Prepare all batches up front, then run their term-range tasks
+    // through one shared pool, so workers of finished batches drain into
+    // the batches still running instead of idling on a static
+    // div_ceil(num_threads, num_batches) split. The matrices are
+    // file-backed mappings, so keeping all batches open costs address
+    // space, not memory: residency is governed by the page cache.
+    std::vector<std::unique_ptr<ClassicBatchBuilder> > builders;
+    doc_list.process_batches(
+        batch_size,
         [&](size_t batch_num, const std::vector<DocumentEntry>& paths,
             std::string out_file) {
-            Timer thr_timer;
+            // distributed construction: batches of other partitions are
+            // built by other jobs, batch numbering is deterministic
+            if (params.partition_count > 1 &&
+                batch_num % params.partition_count != params.partition_index)
+                return;
 
             LOG1 << params.log_prefix
                  << "Construct Classic Index " << out_file;
@@ -178,13 +751,39 @@ void classic_construct_from_documents(
             cih.canonicalize_ = params.canonicalize;
             cih.signature_size_ = params.signature_size;
             cih.num_hashes_ = params.num_hashes;
+            cih.hash_mode_ = params.hash_mode;
+            cih.window_size_ = params.window_size;
             cih.file_names_.resize(paths.size());
-            process_batch(batch_num, num_batches,
-                          tlx::div_ceil(num_threads, num_batches),
-                          params.log_prefix, paths, out_path, cih, thr_timer);
-
-            t += thr_timer;
+            builders.emplace_back(
+                std::make_unique<ClassicBatchBuilder>(
+                    batch_num, num_batches, params.log_prefix, paths,
+                    out_path, cih, params.dedup, params.continue_,
+                    params.direct_io));
+            builders.back()->prepare(num_threads);
         });
+
+    // global largest-first schedule over the tasks of all batches
+    struct Slot {
+        size_t batch, task, size;
+    };
+    std::vector<Slot> schedule;
+    for (size_t b = 0; b < builders.size(); ++b) {
+        for (size_t ti = 0; ti < builders[b]->num_tasks(); ++ti)
+            schedule.push_back(Slot { b, ti, builders[b]->task_size(ti) });
+    }
+    std::stable_sort(schedule.begin(), schedule.end(),
+                     [](const Slot& a, const Slot& b) {
+                         return a.size > b.size;
+                     });
+
+    parallel_for(0, schedule.size(), num_threads,
+                 [&](size_t si) {
+                     builders[schedule[si].batch]->run_task(
+                         schedule[si].task);
+                 });
+
+    for (const auto& builder : builders)
+        t += builder->timer();
     t.print("classic_construct_from_documents");
 }
 
@@ -194,25 +793,40 @@ void classic_construct_from_documents(
 static inline
 void classic_combine_streams(
     std::vector<std::ifstream>& streams,
+    const std::vector<fs::path>& stream_paths,
     std::vector<uint64_t>& row_bits,
     const fs::path& out_file,
     unsigned term_size, uint8_t canonicalize, uint64_t signature_size,
-    uint64_t new_row_bits, uint64_t num_hash, uint64_t mem_bytes,
-    Timer& t, const std::vector<std::string>& file_names)
+    uint64_t new_row_bits, uint64_t num_hash, uint8_t hash_mode,
+    uint64_t window_size, uint64_t mem_bytes, size_t num_threads,
+    bool direct_io, Timer& t, const std::vector<std::string>& file_names,
+    const std::vector<double>& doc_densities)
 {
     static constexpr bool debug = false;
 
+    TraceScope trace("combine_streams");
+
     if (fs::exists(out_file))
         return;
 
-    std::ofstream ofs;
     ClassicIndexHeader cih;
     cih.term_size_ = term_size;
     cih.canonicalize_ = canonicalize;
     cih.signature_size_ = signature_size;
     cih.num_hashes_ = num_hash;
+    cih.hash_mode_ = hash_mode;
+    cih.window_size_ = window_size;
     cih.file_names_ = file_names;
-    serialize_header(ofs, out_file, cih);
+    cih.doc_densities_ = doc_densities;
+
+    // serialize the header into memory, the file itself is written with
+    // coalesced bulk writes (O_DIRECT when requested)
+    std::ostringstream header_os;
+    cih.serialize(header_os);
+    std::string header_str = header_os.str();
+
+    BulkWriter writer(out_file, direct_io);
+    writer.append(header_str.data(), header_str.size());
 
     die_unequal(streams.size(), row_bits.size());
     die_unequal(new_row_bits, file_names.size());
@@ -246,90 +860,143 @@ void classic_combine_streams(
          << " memory=" << ((new_row_bytes + in_row_bytes) * batch_size);
 
     // read many blocks from each file, interleave them into new block, and
-    // write it out
+    // write it out; input blocks are double buffered so a background
+    // reader can fill the next batch while this batch is interleaved
     std::vector<std::vector<char> > in_blocks(streams.size());
+    std::vector<std::vector<char> > next_blocks(streams.size());
     for (size_t i = 0; i < streams.size(); ++i) {
         in_blocks[i].resize(row_bytes[i] * batch_size);
+        next_blocks[i].resize(row_bytes[i] * batch_size);
     }
 
-    std::vector<size_t> in_pos(streams.size());
+    // current file offset of each stream, for readahead hints
+    std::vector<uint64_t> stream_offset(streams.size());
+    for (size_t i = 0; i < streams.size(); ++i)
+        stream_offset[i] = streams[i].tellg();
+
+    // tell the kernel to prefetch the given row range of every stream
+    auto advise_batch =
+        [&](uint64_t first_row, size_t num_rows) {
+#if defined(__linux__)
+            for (size_t i = 0; i < streams.size(); ++i) {
+                int fd = ::open(stream_paths[i].string().c_str(), O_RDONLY);
+                if (fd < 0)
+                    continue;
+                posix_fadvise(fd, stream_offset[i] + first_row * row_bytes[i],
+                              num_rows * row_bytes[i], POSIX_FADV_WILLNEED);
+                ::close(fd);
+            }
+#else
+            (void)first_row, (void)num_rows;
+#endif
+        };
+
+    auto read_batch =
+        [&](std::vector<std::vector<char> >& blocks, size_t num_rows) {
+            for (size_t i = 0; i < streams.size(); ++i) {
+                streams[i].read(blocks[i].data(), row_bytes[i] * num_rows);
+                LOG << "stream[" << i << "] read " << streams[i].gcount();
+                die_unequal(row_bytes[i] * num_rows,
+                            static_cast<size_t>(streams[i].gcount()));
+                g_construction_stats.bytes_read += row_bytes[i] * num_rows;
+            }
+        };
+
     // output block
     std::vector<char> out_block(new_row_bytes* batch_size);
 
     uint64_t current_row = 0;
-    for (size_t b = 0; b < num_batches; ++b) {
+    if (num_batches != 0) {
         t.active("read");
-        LOG << "read batch " << b << "/" << num_batches;
+        advise_batch(0, std::min(batch_size, signature_size));
+        read_batch(in_blocks, std::min(batch_size, signature_size));
+    }
+
+    for (size_t b = 0; b < num_batches; ++b) {
+        LOG << "batch " << b << "/" << num_batches;
         size_t this_batch =
             std::min(batch_size, signature_size - current_row);
-
-        // read data from streams
-        for (size_t i = 0; i < streams.size(); ++i) {
-            streams[i].read(
-                in_blocks[i].data(), row_bytes[i] * this_batch);
-            LOG << "stream[" << i << "] read " << streams[i].gcount();
-            die_unequal(row_bytes[i] * this_batch,
-                        static_cast<size_t>(streams[i].gcount()));
-        }
         current_row += this_batch;
 
-        std::fill(in_pos.begin(), in_pos.end(), 0);
+        // overlap the next batch's input with this batch's interleaving
+        size_t next_batch = (b + 1 < num_batches)
+                            ? std::min(batch_size, signature_size - current_row)
+                            : 0;
+        std::thread reader;
+        if (next_batch != 0) {
+            advise_batch(current_row, next_batch);
+            reader = std::thread(
+                [&, next_batch]() { read_batch(next_blocks, next_batch); });
+        }
 
-        // interleave rows, two methods: one byte aligned, other can use any bit
-        // combination.
+        // interleave rows, two methods: one byte aligned, other can use any
+        // bit combination; output rows are independent of each other, so
+        // they are split across threads
         t.active("interleave");
-        for (size_t k = 0; k < this_batch; ++k) {
-            std::vector<char>::iterator out =
-                out_block.begin() + k * new_row_bytes;
-
-            if (use_fast_method) {
-                // out_pos is in bytes, copies whole bytes.
-                size_t out_pos = 0;
-                for (size_t s = 0; s < streams.size(); ++s) {
-                    LOG << "in[" << s << "] " << tlx::bitdump_le8(
-                        in_blocks[s].data() + in_pos[s], row_bytes[s]);
-
-                    for (size_t i = 0; i < row_bytes[s]; ++i) {
-                        out[out_pos++] = in_blocks[s][in_pos[s] + i];
+        if (use_fast_method) {
+            // byte aligned: whole input rows are appended with memcpy
+            parallel_for(
+                0, this_batch, num_threads,
+                [&](size_t k) {
+                    char* out = out_block.data() + k * new_row_bytes;
+                    size_t out_pos = 0;
+                    for (size_t s = 0; s < streams.size(); ++s) {
+                        std::memcpy(out + out_pos,
+                                    in_blocks[s].data() + k * row_bytes[s],
+                                    row_bytes[s]);
+                        out_pos += row_bytes[s];
                     }
-                    in_pos[s] += row_bytes[s];
-                }
-            }
-            else {
-                // slower method which can interleave any bit combinations,
-                // out_pos is in bits.
-                size_t out_pos = 0;
-                for (size_t s = 0; s < streams.size(); ++s) {
-                    LOG << "in[" << s << "] " << tlx::bitdump_le8(
-                        in_blocks[s].data() + in_pos[s], row_bytes[s]);
-
-                    size_t j = row_bits[s];
-                    for (size_t i = 0; i < row_bytes[s]; ++i) {
-                        out[out_pos / 8] |=
-                            in_blocks[s][in_pos[s] + i] << (out_pos % 8);
-                        if (j >= (8 - out_pos % 8)) {
-                            out[out_pos / 8 + 1] |=
-                                in_blocks[s][in_pos[s] + i] >> (8 - out_pos % 8);
+                });
+        }
+        else {
+            // slower method which can interleave any bit combinations,
+            // out_pos is in bits.
+            parallel_for(
+                0, this_batch, num_threads,
+                [&](size_t k) {
+                    char* out = out_block.data() + k * new_row_bytes;
+                    // the block is reused between batches, clear the row
+                    // before OR-ing bits into it
+                    std::fill(out, out + new_row_bytes, 0);
+
+                    size_t out_pos = 0;
+                    for (size_t s = 0; s < streams.size(); ++s) {
+                        const char* in = in_blocks[s].data() + k * row_bytes[s];
+
+                        size_t j = row_bits[s];
+                        for (size_t i = 0; i < row_bytes[s]; ++i) {
+                            out[out_pos / 8] |= in[i] << (out_pos % 8);
+                            if (j >= (8 - out_pos % 8)) {
+                                out[out_pos / 8 + 1] |=
+                                    static_cast<unsigned char>(in[i])
+                                    >> (8 - out_pos % 8);
+                            }
+                            out_pos += std::min<size_t>(8, row_bits[s] - 8 * i);
+                            j -= 8;
                         }
-                        out_pos += std::min<size_t>(8, row_bits[s] - 8 * i);
-                        j -= 8;
                     }
-                    in_pos[s] += row_bytes[s];
-                }
-            }
-            LOG << "out[] " << tlx::bitdump_le8(&*out, new_row_bytes);
+                    LOG << "out[] " << tlx::bitdump_le8(out, new_row_bytes);
+                });
         }
 
         t.active("write");
-        ofs.write(out_block.data(), new_row_bytes * this_batch);
+        writer.append(out_block.data(), new_row_bytes * this_batch);
+        g_construction_stats.bytes_written += new_row_bytes * this_batch;
+
+        if (reader.joinable()) {
+            t.active("read");
+            reader.join();
+        }
+        std::swap(in_blocks, next_blocks);
     }
+    writer.close();
     t.stop();
 }
 
 bool classic_combine(const fs::path& in_dir, const fs::path& out_dir,
                      fs::path& result_file,
                      uint64_t mem_bytes, size_t num_threads,
-                     bool keep_temporary)
+                     bool keep_temporary, bool direct_io)
 {
     fs::create_directories(out_dir);
 
@@ -447,10 +1114,14 @@ bool classic_combine(const fs::path& in_dir, const fs::path& out_dir,
             std::vector<std::ifstream> streams;
             std::vector<uint64_t> row_bits;
             std::vector<std::string> file_names;
+            std::vector<double> doc_densities;
+            bool have_densities = true;
             unsigned term_size = 0;
             uint8_t canonicalize = false;
             uint64_t signature_size = 0;
             uint64_t num_hashes = 0;
+            uint8_t hash_mode = 0;
+            uint64_t window_size = 1;
 
             streams.reserve(files.size());
             row_bits.reserve(files.size());
@@ -469,27 +1140,45 @@ bool classic_combine(const fs::path& in_dir, const fs::path& out_dir,
                     canonicalize = cih.canonicalize_;
                     signature_size = cih.signature_size_;
                     num_hashes = cih.num_hashes_;
+                    hash_mode = cih.hash_mode_;
+                    window_size = cih.window_size_;
                 }
                 die_unequal(cih.term_size_, term_size);
                 die_unequal(cih.canonicalize_, canonicalize);
                 die_unequal(cih.signature_size_, signature_size);
                 die_unequal(cih.num_hashes_, num_hashes);
+                die_unequal(cih.hash_mode_, hash_mode);
+                die_unequal(cih.window_size_, window_size);
                 // calculate new row length
                 row_bits.emplace_back(cih.row_bits());
                 new_row_bits += cih.row_bits();
                 // append file names
                 std::copy(cih.file_names_.begin(), cih.file_names_.end(),
                           std::back_inserter(file_names));
+                // bit densities concatenate like the names, but only
+                // when every input index carries them
+                if (cih.doc_densities_.size() == cih.file_names_.size()) {
+                    std::copy(cih.doc_densities_.begin(),
+                              cih.doc_densities_.end(),
+                              std::back_inserter(doc_densities));
+                }
+                else {
+                    have_densities = false;
+                }
             }
+            if (!have_densities)
+                doc_densities.clear();
 
             LOG1 << "Combine Classic " << files.size() << " indices "
                  << "[" << tlx::join(" ", row_bits) << " documents]"
                  << " into " << out_path;
 
             classic_combine_streams(
-                streams, row_bits, out_path, term_size, canonicalize,
-                signature_size, new_row_bits, num_hashes,
-                mem_bytes / num_threads, thr_timer, file_names);
+                streams, files, row_bits, out_path, term_size, canonicalize,
+                signature_size, new_row_bits, num_hashes, hash_mode,
+                window_size, mem_bytes / num_threads,
+                tlx::div_ceil(num_threads, batch_list.size()),
+                direct_io, thr_timer, file_names, doc_densities);
             streams.clear();
             file_names.clear();
 
@@ -562,15 +1251,78 @@ uint64_t get_max_file_size(const DocumentList& doc_list,
     die("Unknown file type");
 }
 
+/*!
+ * Estimates the number of distinct canonical k-mers of each document with
+ * a HyperLogLog sketch and returns the largest estimate, plus a small
+ * safety margin covering the sketch error. This is a full pass over the
+ * inputs, but sizes signatures from real cardinality instead of file
+ * bytes, which shrinks indexes of compressed or repeat-rich documents.
+ */
+static inline
+uint64_t estimate_max_distinct_terms(const DocumentList& doc_list,
+                                     const ClassicIndexParameters& params) {
+    const std::vector<DocumentEntry>& paths = doc_list.list();
+    std::vector<uint64_t> estimates(paths.size());
+
+    parallel_for(
+        0, paths.size(), params.num_threads,
+        [&](size_t i) {
+            HyperLogLog hll;
+            tlx::simple_vector<char> canonicalize_buffer(params.term_size);
+
+            paths[i].process_terms(
+                params.term_size,
+                [&](const tlx::string_view& term) {
+                    const char* t = term.data();
+                    if (params.canonicalize != 0) {
+                        canonicalize_kmer(term.data(),
+                                          canonicalize_buffer.data(),
+                                          term.size());
+                        t = canonicalize_buffer.data();
+                    }
+                    hll.add(XXH64(t, term.size(), 0));
+                });
+            estimates[i] = hll.estimate();
+        });
+
+    uint64_t max_estimate = 0;
+    for (uint64_t e : estimates)
+        max_estimate = std::max(max_estimate, e);
+
+    // 5 % headroom so sketch underestimation cannot push the false
+    // positive rate above the requested one
+    return max_estimate + max_estimate / 20;
+}
+
 void classic_construct(
     const DocumentList& filelist, const fs::path& out_file,
     fs::path tmp_path, ClassicIndexParameters params)
 {
     die_unless(params.num_hashes != 0);
     die_unless(params.signature_size == 0);
+    die_unless(params.partition_index < params.partition_count);
+
+    // periodic throughput reports and a JSON summary at the end
+    ConstructionStats::ScopedReporter stats_reporter;
+    {
+        uint64_t total_input = 0;
+        for (const DocumentEntry& de : filelist.list())
+            total_input += de.size_;
+        g_construction_stats.add_total_input_bytes(total_input);
+    }
 
-    // estimate signature size by finding number of elements in the largest file
-    uint64_t max_doc_size = get_max_file_size(filelist, params.term_size);
+    // estimate signature size by finding number of elements in the largest
+    // file, or from distinct k-mer cardinality if requested
+    uint64_t max_doc_size =
+        params.estimate_cardinality
+        ? estimate_max_distinct_terms(filelist, params)
+        : get_max_file_size(filelist, params.term_size);
+    if (params.window_size > 1) {
+        // minimizer subsampling keeps an expected fraction of
+        // 2 / (window_size + 1) of a random sequence's k-mers
+        max_doc_size = std::max<uint64_t>(
+            2 * max_doc_size / (params.window_size + 1), 1);
+    }
     params.signature_size = calc_signature_size(
         max_doc_size, params.num_hashes, params.false_positive_rate);
 
@@ -594,6 +1346,11 @@ void classic_construct(
          << "  continue_: " << unsigned(params.continue_) << '\n'
          << "  keep_temporary: " << unsigned(params.keep_temporary);
 
+    if (params.partition_count > 1) {
+        LOG1 << "  partition: " << params.partition_index
+             << '/' << params.partition_count;
+    }
+
     // check output and maybe clobber
     if (!tlx::ends_with(out_file, ClassicIndexHeader::file_extension)) {
         die("Error: classic COBS index file must end with "
@@ -613,6 +1370,43 @@ void classic_construct(
         }
     }
 
+    // single-pass fast path: when the complete matrix fits into the
+    // memory budget, build it as one batch directly into the final file,
+    // skipping the temporary batch indexes and the combine rounds, which
+    // otherwise write and re-read the whole index once more
+    uint64_t total_bytes =
+        params.signature_size * (docsize_roundup / 8);
+    if (total_bytes <= params.mem_bytes &&
+        params.partition_count <= 1)
+    {
+        if (fs::exists(out_file)) {
+            // only reachable with continue_, the index is already done
+            return;
+        }
+
+        LOG1 << params.log_prefix
+             << "classic_construct: single-pass in-memory construction, "
+             << tlx::format_iec_units(total_bytes) << "B <= "
+             << tlx::format_iec_units(params.mem_bytes) << "B memory";
+
+        ClassicIndexHeader cih;
+        cih.term_size_ = params.term_size;
+        cih.canonicalize_ = params.canonicalize;
+        cih.signature_size_ = params.signature_size;
+        cih.num_hashes_ = params.num_hashes;
+        cih.hash_mode_ = params.hash_mode;
+        cih.window_size_ = params.window_size;
+        cih.file_names_.resize(filelist.size());
+
+        Timer t;
+        process_batch(/* batch_num */ 1, /* num_batches */ 1,
+                      params.num_threads, params.log_prefix,
+                      filelist.list(), out_file, cih,
+                      params.dedup, params.continue_, params.direct_io, t);
+        t.print("classic_construct");
+        return;
+    }
+
     // if not set, make tmp path, and maybe clobber
     if (tmp_path.empty()) {
         tmp_path = out_file.string() + ".tmp";
@@ -642,7 +1436,8 @@ void classic_construct(
     while (!classic_combine(
                tmp_path / pad_index(i), tmp_path / pad_index(i + 1),
                result_file,
-               params.mem_bytes, params.num_threads, params.keep_temporary)) {
+               params.mem_bytes, params.num_threads, params.keep_temporary,
+               params.direct_io)) {
         i++;
     }
 
@@ -658,10 +1453,465 @@ void classic_construct(
     }
 }
 
+void classic_construct_adaptive(
+    const DocumentList& filelist, const fs::path& out_file,
+    fs::path tmp_path, ClassicIndexParameters params)
+{
+    die_unless(params.num_hashes != 0);
+    die_unless(params.signature_size == 0);
+
+    // group documents of similar size, so a group is never sized for a
+    // document orders of magnitude larger than its members: the sorted
+    // list is cut whenever a document exceeds eight times the byte size
+    // of the first document of its class
+    DocumentList sorted_list = filelist;
+    sorted_list.sort_by_size();
+    const std::vector<DocumentEntry>& docs = sorted_list.list();
+
+    struct SizeClass {
+        size_t begin, end;
+    };
+    std::vector<SizeClass> classes;
+    for (size_t b = 0; b < docs.size(); ) {
+        size_t e = b + 1;
+        while (e < docs.size() &&
+               docs[e].size_ <= 8 * std::max<size_t>(docs[b].size_, 1))
+            ++e;
+        classes.emplace_back(SizeClass { b, e });
+        b = e;
+    }
+
+    LOG1 << "Classic Adaptive Construction: " << classes.size()
+         << " size classes over " << docs.size() << " documents";
+
+    if (tmp_path.empty())
+        tmp_path = out_file.string() + ".tmp";
+
+    for (size_t c = 0; c < classes.size(); ++c) {
+        DocumentList class_list(
+            std::vector<DocumentEntry>(
+                docs.begin() + classes[c].begin,
+                docs.begin() + classes[c].end));
+
+        // a single class keeps the requested output name, otherwise each
+        // class index carries its class number
+        fs::path class_out = out_file;
+        if (classes.size() != 1) {
+            class_out =
+                out_file.parent_path() /
+                (out_file.stem().string() + '_' + pad_index(c) +
+                 ClassicIndexHeader::file_extension);
+        }
+
+        LOG1 << "Size class " << pad_index(c) << ": "
+             << (classes[c].end - classes[c].begin) << " documents, "
+             << "largest "
+             << tlx::format_iec_units(docs[classes[c].end - 1].size_)
+             << "B -> " << class_out;
+
+        classic_construct(
+            class_list, class_out,
+            fs::path(tmp_path.string() + '_' + pad_index(c)), params);
+    }
+}
+
+void classic_append(
+    const DocumentList& filelist, const fs::path& in_file,
+    const fs::path& out_file, fs::path tmp_path,
+    ClassicIndexParameters params)
+{
+    die_unless(params.signature_size == 0);
+    die_unless(filelist.size() != 0);
+
+    // periodic throughput reports and a JSON summary at the end
+    ConstructionStats::ScopedReporter stats_reporter;
+    {
+        uint64_t total_input = 0;
+        for (const DocumentEntry& de : filelist.list())
+            total_input += de.size_;
+        g_construction_stats.add_total_input_bytes(total_input);
+    }
+
+    // adopt the hashing parameters of the existing index, so the new
+    // documents' subindex can be interleaved with it column-wise
+    ClassicIndexHeader eh = deserialize_header<ClassicIndexHeader>(in_file);
+    if (eh.block_rows_ != 0 || eh.sparse_rows_ != 0)
+        die("classic_append: " << in_file << " is not a raw index, "
+            "append to the raw index and re-encode the result");
+    params.term_size = eh.term_size_;
+    params.canonicalize = eh.canonicalize_;
+    params.num_hashes = eh.num_hashes_;
+    params.hash_mode = eh.hash_mode_;
+    params.window_size = eh.window_size_;
+    params.signature_size = eh.signature_size_;
+
+    LOG1 << "Classic Append Parameters:\n"
+         << "  existing documents: " << eh.file_names_.size() << '\n'
+         << "  new documents: " << filelist.size() << '\n'
+         << "  term_size: " << params.term_size << '\n'
+         << "  canonicalize: " << unsigned(params.canonicalize) << '\n'
+         << "  num_hashes: " << params.num_hashes << '\n'
+         << "  signature_size: " << params.signature_size
+         << " = " << tlx::format_iec_units(params.signature_size);
+
+    // check output and maybe clobber; appending in place (out_file equal
+    // to in_file) is fine, the input is only replaced by the final rename
+    if (!tlx::ends_with(out_file, ClassicIndexHeader::file_extension)) {
+        die("Error: classic COBS index file must end with "
+            << ClassicIndexHeader::file_extension);
+    }
+    if (fs::exists(out_file) && out_file != in_file) {
+        if (params.clobber) {
+            fs::remove_all(out_file);
+        }
+        else if (params.continue_) {
+            // fall through
+        }
+        else {
+            die("Output file exists, will not overwrite without --clobber");
+        }
+    }
+
+    // if not set, make tmp path, and maybe clobber
+    if (tmp_path.empty()) {
+        tmp_path = out_file.string() + ".tmp";
+    }
+    if (fs::exists(tmp_path)) {
+        if (params.clobber) {
+            fs::remove_all(tmp_path);
+        }
+        else if (params.continue_) {
+            // fall through
+        }
+        else {
+            die("Temporary directory exists, will not delete without --clobber");
+        }
+    }
+
+    // create temporary directory
+    std::error_code ec;
+    fs::create_directories(tmp_path, ec);
+
+    // construct the subindex of just the new documents with the existing
+    // signature size
+    classic_construct_from_documents(filelist, tmp_path / pad_index(1), params);
+
+    // bring the existing index into the first combine level; a hard link
+    // avoids copying it when the file system allows
+    fs::path existing_link =
+        tmp_path / pad_index(1) /
+        ("existing" + ClassicIndexHeader::file_extension);
+    fs::create_hard_link(in_file, existing_link, ec);
+    if (ec)
+        fs::copy_file(in_file, existing_link);
+
+    // combine batches
+    size_t i = 1;
+    fs::path result_file;
+    while (!classic_combine(
+               tmp_path / pad_index(i), tmp_path / pad_index(i + 1),
+               result_file,
+               params.mem_bytes, params.num_threads, params.keep_temporary,
+               params.direct_io)) {
+        i++;
+    }
+
+    fs::rename(result_file, out_file);
+
+    if (!params.keep_temporary) {
+        fs::remove(tmp_path / pad_index(i + 1));
+    }
+
+    // cleanup: this will fail if not _all_ temporary files are removed
+    if (!params.keep_temporary) {
+        fs::remove(tmp_path);
+    }
+}
+
+void classic_merge(
+    const std::vector<fs::path>& part_files, const fs::path& out_file,
+    fs::path tmp_path, ClassicIndexParameters params)
+{
+    die_unless(part_files.size() != 0);
+
+    // periodic throughput reports and a JSON summary at the end; merging
+    // reads no documents, so the reports carry no input progress
+    ConstructionStats::ScopedReporter stats_reporter;
+
+    // verify part compatibility up front: classic_combine() checks the
+    // same fields, but only after the parts were already linked into the
+    // temporary directory
+    unsigned term_size = 0;
+    uint8_t canonicalize = 0;
+    uint64_t num_hashes = 0;
+    uint8_t hash_mode = 0;
+    uint64_t window_size = 1;
+    uint64_t signature_size = 0;
+    size_t num_documents = 0;
+    for (size_t i = 0; i < part_files.size(); ++i) {
+        die_unless(fs::exists(part_files[i]));
+        ClassicIndexHeader h =
+            deserialize_header<ClassicIndexHeader>(part_files[i]);
+        if (i == 0) {
+            term_size = h.term_size_;
+            canonicalize = h.canonicalize_;
+            num_hashes = h.num_hashes_;
+            hash_mode = h.hash_mode_;
+            window_size = h.window_size_;
+            signature_size = h.signature_size_;
+        }
+        die_unequal(term_size, h.term_size_);
+        die_unequal(canonicalize, h.canonicalize_);
+        die_unequal(num_hashes, h.num_hashes_);
+        die_unequal(hash_mode, h.hash_mode_);
+        die_unequal(window_size, h.window_size_);
+        die_unequal(signature_size, h.signature_size_);
+        if (h.block_rows_ != 0 || h.sparse_rows_ != 0)
+            die("classic_merge: " << part_files[i] << " is not a raw "
+                "index, merge raw indexes and re-encode the result");
+        num_documents += h.file_names_.size();
+    }
+
+    LOG1 << "Classic Merge Parameters:\n"
+         << "  parts: " << part_files.size() << '\n'
+         << "  documents: " << num_documents << '\n'
+         << "  term_size: " << term_size << '\n'
+         << "  canonicalize: " << unsigned(canonicalize) << '\n'
+         << "  num_hashes: " << num_hashes << '\n'
+         << "  signature_size: " << signature_size
+         << " = " << tlx::format_iec_units(signature_size);
+
+    // check output and maybe clobber
+    if (!tlx::ends_with(out_file, ClassicIndexHeader::file_extension)) {
+        die("Error: classic COBS index file must end with "
+            << ClassicIndexHeader::file_extension);
+    }
+    if (fs::exists(out_file)) {
+        if (params.clobber) {
+            fs::remove_all(out_file);
+        }
+        else if (params.continue_) {
+            // fall through
+        }
+        else {
+            die("Output file exists, will not overwrite without --clobber");
+        }
+    }
+
+    // if not set, make tmp path, and maybe clobber
+    if (tmp_path.empty()) {
+        tmp_path = out_file.string() + ".tmp";
+    }
+    if (fs::exists(tmp_path)) {
+        if (params.clobber) {
+            fs::remove_all(tmp_path);
+        }
+        else if (params.continue_) {
+            // fall through
+        }
+        else {
+            die("Temporary directory exists, will not delete without --clobber");
+        }
+    }
+
+    // bring the parts into the first combine level; hard links avoid
+    // copying them when the file system allows
+    std::error_code ec;
+    fs::create_directories(tmp_path / pad_index(1), ec);
+    for (size_t i = 0; i < part_files.size(); ++i) {
+        fs::path part_link =
+            tmp_path / pad_index(1) /
+            (pad_index(i) + ClassicIndexHeader::file_extension);
+        fs::create_hard_link(part_files[i], part_link, ec);
+        if (ec)
+            fs::copy_file(part_files[i], part_link);
+    }
+
+    // combine batches
+    size_t i = 1;
+    fs::path result_file;
+    while (!classic_combine(
+               tmp_path / pad_index(i), tmp_path / pad_index(i + 1),
+               result_file,
+               params.mem_bytes, params.num_threads, params.keep_temporary,
+               params.direct_io)) {
+        i++;
+    }
+
+    fs::rename(result_file, out_file);
+
+    if (!params.keep_temporary) {
+        fs::remove(tmp_path / pad_index(i + 1));
+    }
+
+    // cleanup: this will fail if not _all_ temporary files are removed
+    if (!params.keep_temporary) {
+        fs::remove(tmp_path);
+    }
+}
+
+void classic_compress(const fs::path& in_file, const fs::path& out_file,
+                      uint64_t block_size, int compression_level)
+{
+    Timer t;
+    t.active("compress");
+
+    std::ifstream is;
+    ClassicIndexHeader h = deserialize_header<ClassicIndexHeader>(is, in_file);
+    if (h.block_rows_ != 0)
+        die("classic_compress: " << in_file << " is already compressed");
+    if (h.sparse_rows_ != 0)
+        die("classic_compress: " << in_file << " is sparse-encoded, "
+            "compress the raw index instead");
+
+    uint64_t row_size = h.row_size();
+    uint64_t data_size = h.signature_size_ * row_size;
+    StreamPos sp = get_stream_pos(is);
+    die_unequal(data_size, sp.size());
+
+    // blocks of consecutive rows of about block_size uncompressed bytes
+    uint64_t block_rows = std::max(uint64_t(1), block_size / row_size);
+    uint64_t num_blocks = tlx::div_ceil(h.signature_size_, block_rows);
+    h.block_rows_ = block_rows;
+
+    if (!out_file.parent_path().empty())
+        fs::create_directories(out_file.parent_path());
+    std::ofstream os(out_file.string(), std::ios::out | std::ios::binary);
+    os.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+    h.serialize(os);
+
+    // write a zeroed offset table now and fill it in after the blocks;
+    // offsets are relative to the end of the table
+    std::ostream::pos_type table_pos = os.tellp();
+    std::vector<uint64_t> offsets(num_blocks + 1);
+    os.write(reinterpret_cast<const char*>(offsets.data()),
+             offsets.size() * sizeof(uint64_t));
+
+    std::vector<uint8_t> raw(block_rows * row_size);
+    std::vector<uint8_t> compressed(
+        zstd_block_bound(block_rows * row_size));
+    uint64_t compressed_size = 0;
+
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        uint64_t rows = std::min(block_rows,
+                                 h.signature_size_ - b * block_rows);
+        is.read(reinterpret_cast<char*>(raw.data()), rows * row_size);
+        die_unless(is.good());
+
+        offsets[b] = compressed_size;
+        size_t n = zstd_block_compress(
+            compressed.data(), compressed.size(),
+            raw.data(), rows * row_size, compression_level);
+        os.write(reinterpret_cast<const char*>(compressed.data()), n);
+        compressed_size += n;
+    }
+    offsets[num_blocks] = compressed_size;
+
+    os.seekp(table_pos);
+    os.write(reinterpret_cast<const char*>(offsets.data()),
+             offsets.size() * sizeof(uint64_t));
+    os.close();
+
+    t.stop();
+    LOG1 << "classic_compress: " << num_blocks << " blocks of "
+         << block_rows << " rows, "
+         << tlx::format_iec_units(data_size) << "B -> "
+         << tlx::format_iec_units(compressed_size) << "B ("
+         << static_cast<double>(compressed_size) / data_size * 100.0
+         << "%)";
+    t.print("classic_compress");
+}
+
+void classic_sparsify(const fs::path& in_file, const fs::path& out_file)
+{
+    Timer t;
+    t.active("sparsify");
+
+    std::ifstream is;
+    ClassicIndexHeader h = deserialize_header<ClassicIndexHeader>(is, in_file);
+    if (h.block_rows_ != 0)
+        die("classic_sparsify: " << in_file << " is block-compressed, "
+            "sparsify the raw index instead");
+    if (h.sparse_rows_ != 0)
+        die("classic_sparsify: " << in_file << " is already sparse-encoded");
+
+    uint64_t row_size = h.row_size();
+    uint64_t data_size = h.signature_size_ * row_size;
+    StreamPos sp = get_stream_pos(is);
+    die_unequal(data_size, sp.size());
+
+    h.sparse_rows_ = 1;
+
+    if (!out_file.parent_path().empty())
+        fs::create_directories(out_file.parent_path());
+    std::ofstream os(out_file.string(), std::ios::out | std::ios::binary);
+    os.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+    h.serialize(os);
+
+    // write a zeroed row offset table now and fill it in after the
+    // payload; offsets are relative to the end of the table, with the
+    // top bit marking a sparse-encoded row
+    std::ostream::pos_type table_pos = os.tellp();
+    std::vector<uint64_t> offsets(h.signature_size_ + 1);
+    os.write(reinterpret_cast<const char*>(offsets.data()),
+             offsets.size() * sizeof(uint64_t));
+
+    std::vector<uint8_t> row(row_size);
+    std::vector<uint32_t> positions;
+    uint64_t payload_size = 0, sparse_count = 0;
+
+    for (uint64_t r = 0; r < h.signature_size_; ++r) {
+        is.read(reinterpret_cast<char*>(row.data()), row_size);
+        die_unless(is.good());
+
+        positions.clear();
+        for (uint64_t b = 0; b < row_size; ++b) {
+            uint8_t v = row[b];
+            while (v != 0) {
+                unsigned bit = __builtin_ctz(v);
+                positions.push_back(8 * b + bit);
+                v &= v - 1;
+            }
+        }
+
+        if (positions.size() * sizeof(uint32_t) < row_size) {
+            // sparse pays off: store the set-bit positions
+            offsets[r] = payload_size | ClassicIndexHeader::sparse_row_flag;
+            os.write(reinterpret_cast<const char*>(positions.data()),
+                     positions.size() * sizeof(uint32_t));
+            payload_size += positions.size() * sizeof(uint32_t);
+            sparse_count++;
+        }
+        else {
+            offsets[r] = payload_size;
+            os.write(reinterpret_cast<const char*>(row.data()), row_size);
+            payload_size += row_size;
+        }
+    }
+    offsets[h.signature_size_] = payload_size;
+
+    os.seekp(table_pos);
+    os.write(reinterpret_cast<const char*>(offsets.data()),
+             offsets.size() * sizeof(uint64_t));
+    os.close();
+
+    uint64_t total_size =
+        payload_size + offsets.size() * sizeof(uint64_t);
+    t.stop();
+    LOG1 << "classic_sparsify: " << sparse_count << " of "
+         << h.signature_size_ << " rows sparse, "
+         << tlx::format_iec_units(data_size) << "B -> "
+         << tlx::format_iec_units(total_size) << "B ("
+         << static_cast<double>(total_size) / data_size * 100.0
+         << "%)";
+    t.print("classic_sparsify");
+}
+
 void classic_construct_random(const fs::path& out_file,
                               uint64_t signature_size,
                               uint64_t num_documents, size_t document_size,
-                              uint64_t num_hashes, size_t seed) {
+                              uint64_t num_hashes, size_t seed,
+                              size_t num_threads) {
     Timer t;
 
     std::vector<std::string> file_names;
@@ -684,7 +1934,8 @@ void classic_construct_random(const fs::path& out_file,
     std::mt19937 rng(seed);
     KMerBuffer<31> doc;
 
-    std::vector<char> canonicalize_buffer(term_size);
+    if (num_threads == 0)
+        num_threads = 1;
 
     t.active("generate");
     for (size_t i = 0; i < num_documents; ++i) {
@@ -698,19 +1949,34 @@ void classic_construct_random(const fs::path& out_file,
             doc.data().push_back(m);
         }
 
-        std::string term;
-        term.reserve(32);
-
         bool shown_canonicalization_warning = false;
 
-        // TODO: parallel for over setting of bits of the SAME document
-        for (uint64_t j = 0; j < doc.data().size(); j++) {
-            doc.data()[j].canonicalize();
-            doc.data()[j].to_string(&term);
-            process_term(tlx::string_view(term), data, i, "random",
-                         &shown_canonicalization_warning,
-                         cih, canonicalize_buffer.data());
-        }
+        // parallel over k-mer ranges of the SAME document: generation above
+        // stays serial for rng determinism, while canonicalization, hashing,
+        // and bit setting scale with cores; set_bit() is an atomic OR.
+        size_t num_ranges = std::min<size_t>(
+            8 * num_threads, std::max<size_t>(doc.data().size(), 1));
+        size_t range_size = tlx::div_ceil(doc.data().size(), num_ranges);
+
+        parallel_for(
+            0, num_ranges, num_threads,
+            [&](size_t r) {
+                std::vector<char> canonicalize_buffer(term_size);
+                std::string term;
+                term.reserve(32);
+
+                size_t begin = r * range_size;
+                size_t end = std::min<size_t>(
+                    begin + range_size, doc.data().size());
+                for (uint64_t j = begin; j < end; j++) {
+                    doc.data()[j].canonicalize();
+                    doc.data()[j].to_string(&term);
+                    process_term(tlx::string_view(term), data.data(),
+                                 i, "random",
+                                 &shown_canonicalization_warning,
+                                 cih, canonicalize_buffer.data());
+                }
+            });
     }
 
     size_t bit_count = tlx::popcount(data.data(), data.size());
@@ -33,8 +33,26 @@ struct ClassicIndexParameters {
     uint8_t canonicalize = 1;
     //! number of hash functions, provided by user
     unsigned num_hashes = 1;
+    //! hashing scheme: 0 = one XXH64 evaluation per hash function,
+    //! 1 = double hashing (v2), needing only two evaluations per term
+    uint8_t hash_mode = 0;
+    //! skip hashing of k-mers repeated within the same document, whose
+    //! bits are already set; only effective for canonicalized k-mers of
+    //! up to 31 bases, default: true
+    bool dedup = true;
+    //! minimizer window size: index only the minimizer of every window of
+    //! this many consecutive k-mers, shrinking index size and query work
+    //! by roughly (window_size + 1) / 2 at a small sensitivity cost; the
+    //! window is recorded in the index header so queries subsample
+    //! identically, default: 1 = index every k-mer
+    uint64_t window_size = 1;
     //! false positive rate, provided by user
     double false_positive_rate = 0.3;
+    //! size signatures from the estimated number of distinct k-mers in
+    //! the largest document, found with a HyperLogLog pre-pass over all
+    //! documents, instead of from the byte size of the largest file;
+    //! costs one extra read of the input, default: false
+    bool estimate_cardinality = false;
     //! signature size, either provided by user or calculated from
     //! false_positive_rate if zero.
     uint64_t signature_size = 0;
@@ -46,10 +64,24 @@ struct ClassicIndexParameters {
     std::string log_prefix;
     //! clobber erase output directory if it exists, default: false
     bool clobber = false;
-    //! continue in existing output directory, default: false
+    //! continue in existing output directory; also enables periodic
+    //! sub-batch checkpoints, so an interrupted batch resumes from the
+    //! last flushed state instead of starting over, default: false
     bool continue_ = false;
     //! keep temporary files during construction, default: false
     bool keep_temporary = false;
+    //! distributed construction: build only every partition_count-th
+    //! batch, beginning at batch partition_index. Batch numbering over a
+    //! given input list is deterministic, so jobs on different machines
+    //! running with the same list and distinct partition_index values
+    //! produce disjoint partial indexes, which cobs::classic_merge()
+    //! combines into the final one. Default: a single partition.
+    size_t partition_index = 0;
+    size_t partition_count = 1;
+    //! write index files with O_DIRECT and aligned bulk writes, bypassing
+    //! the page cache so large outputs do not evict input data still
+    //! being read; ignored where O_DIRECT is unavailable, default: false
+    bool direct_io = false;
 };
 
 /*!
@@ -63,6 +95,44 @@ void classic_construct(
     const DocumentList& filelist, const fs::path& out_dir,
     fs::path tmp_path, ClassicIndexParameters index_params);
 
+/*!
+ * Size-adaptive construction: sorts the documents by size, groups
+ * documents of similar size, and runs cobs::classic_construct() per
+ * group with an independently calculated signature size, so a batch
+ * mixing tiny samples with huge ones is not sized for the largest
+ * document. Since classic indexes can only be combined when their
+ * signature sizes match, each size class yields its own index file
+ * (out_file with a class suffix when there is more than one class);
+ * ClassicSearch queries any number of them together.
+ */
+void classic_construct_adaptive(
+    const DocumentList& filelist, const fs::path& out_file,
+    fs::path tmp_path, ClassicIndexParameters index_params);
+
+/*!
+ * Appends new documents to an existing classic index without rebuilding
+ * it: constructs a small index over just filelist, adopting term size,
+ * canonicalization, hashing scheme, window size, and signature size from
+ * the existing index header, and interleaves it with the existing file
+ * via cobs::classic_combine(). The existing index is read only, unless
+ * out_file names the same file, which rewrites it in place.
+ */
+void classic_append(
+    const DocumentList& filelist, const fs::path& in_file,
+    const fs::path& out_file, fs::path tmp_path,
+    ClassicIndexParameters index_params);
+
+/*!
+ * Merges complete classic index files, typically the partial indexes of
+ * a partitioned distributed construction run, into one index via
+ * cobs::classic_combine(). All parts must have been built with the same
+ * term size, canonicalization, hashing scheme, window size, and
+ * signature size; incompatible parts are rejected up front.
+ */
+void classic_merge(
+    const std::vector<fs::path>& part_files, const fs::path& out_file,
+    fs::path tmp_path, ClassicIndexParameters index_params);
+
 /*!
  * Constructs multiple small indices from document files.
  */
@@ -75,7 +145,30 @@ void classic_construct_from_documents(
  */
 bool classic_combine(
     const fs::path& in_dir, const fs::path& out_dir, fs::path& result_file,
-    uint64_t mem_bytes, size_t num_threads, bool keep_temporary);
+    uint64_t mem_bytes, size_t num_threads, bool keep_temporary,
+    bool direct_io = false);
+
+/*!
+ * Rewrites a raw classic index as the compressed row-block variant: the
+ * bit matrix is cut into blocks of consecutive rows whose uncompressed
+ * size is about block_size bytes, each stored as its own zstd frame
+ * behind a block offset table. Queries decompress only the blocks their
+ * hashes touch, trading some CPU for much less read I/O on low-density
+ * matrices. Requires cobs to be built with Zstandard support.
+ */
+void classic_compress(
+    const fs::path& in_file, const fs::path& out_file,
+    uint64_t block_size = 256 * 1024, int compression_level = 3);
+
+/*!
+ * Rewrites a raw classic index with the hybrid sparse row encoding: each
+ * signature row is stored either as its dense row_size() bytes or as an
+ * array of uint32_t set-bit positions, whichever is smaller, behind a
+ * row offset table. Batches sized for their largest document give small
+ * documents rows with very few set bits, which this shrinks roughly
+ * proportionally to their density, with proportionally less query I/O.
+ */
+void classic_sparsify(const fs::path& in_file, const fs::path& out_file);
 
 /*!
  * Constructs a classic index filled with random data.
@@ -83,7 +176,7 @@ bool classic_combine(
 void classic_construct_random(
     const fs::path& out_file, uint64_t signature_size,
     uint64_t num_documents, size_t document_size,
-    uint64_t num_hashes, size_t seed);
+    uint64_t num_hashes, size_t seed, size_t num_threads);
 
 } // namespace cobs
 
@@ -12,9 +12,15 @@
 #include <cobs/file/compact_index_header.hpp>
 #include <cobs/file/kmer_buffer_header.hpp>
 #include <cobs/util/calc_signature_size.hpp>
+#include <cobs/util/construction_stats.hpp>
 #include <cobs/util/file.hpp>
+#include <cobs/util/parallel_for.hpp>
 
+#include <cstring>
+#include <fcntl.h>
 #include <iomanip>
+#include <sstream>
+#include <unistd.h>
 
 #include <tlx/die.hpp>
 #include <tlx/math/div_ceil.hpp>
@@ -27,7 +33,7 @@ namespace cobs {
 static inline
 bool combine_classic_index(const fs::path& in_dir, const fs::path& out_dir,
                            size_t mem_bytes, size_t num_threads,
-                           bool keep_temporary) {
+                           bool keep_temporary, bool direct_io) {
     bool all_combined = true;
     fs::path result_file;
     for (fs::directory_iterator it(in_dir), end; it != end; it++) {
@@ -36,7 +42,7 @@ bool combine_classic_index(const fs::path& in_dir, const fs::path& out_dir,
                 in_dir / it->path().filename(),
                 out_dir / it->path().filename(),
                 result_file,
-                mem_bytes, num_threads, keep_temporary);
+                mem_bytes, num_threads, keep_temporary, direct_io);
             if (!this_combined)
                 all_combined = false;
         }
@@ -48,9 +54,24 @@ bool combine_classic_index(const fs::path& in_dir, const fs::path& out_dir,
     return all_combined;
 }
 
+//! pwrite size bytes at offset, looping over partial writes
+static inline
+void pwrite_all(int fd, const char* data, size_t size, uint64_t offset,
+                const fs::path& path) {
+    while (size > 0) {
+        ssize_t wb = pwrite(fd, data, size, offset);
+        if (wb < 0) {
+            die("Error: could not write to " << path.string()
+                                             << ": " << strerror(errno));
+        }
+        data += wb, size -= wb, offset += wb;
+    }
+}
+
 void compact_combine_into_compact(
     const fs::path& in_dir, const fs::path& out_file,
-    uint64_t page_size, uint64_t memory, bool keep_temporary)
+    uint64_t page_size, uint64_t memory, bool keep_temporary,
+    bool direct_io, size_t num_threads, bool aligned_pages)
 {
     std::vector<fs::path> paths;
     fs::recursive_directory_iterator it(in_dir), end;
@@ -61,6 +82,8 @@ void compact_combine_into_compact(
 
     unsigned term_size = 0;
     uint8_t canonicalize = 0;
+    uint8_t hash_mode = 0;
+    uint64_t window_size = 1;
     std::vector<CompactIndexHeader::parameter> parameters;
     std::vector<std::string> file_names;
 
@@ -75,9 +98,13 @@ void compact_combine_into_compact(
         if (term_size == 0) {
             term_size = h.term_size_;
             canonicalize = h.canonicalize_;
+            hash_mode = h.hash_mode_;
+            window_size = h.window_size_;
         }
         die_unequal(term_size, h.term_size_);
         die_unequal(canonicalize, h.canonicalize_);
+        die_unequal(hash_mode, h.hash_mode_);
+        die_unequal(window_size, h.window_size_);
 
         LOG1 << i << ": " << h.row_bits() << " documents "
              << tlx::format_iec_units(fs::file_size(paths[i])) << 'B'
@@ -97,68 +124,223 @@ void compact_combine_into_compact(
     CompactIndexHeader h;
     h.term_size_ = term_size;
     h.canonicalize_ = canonicalize;
+    h.hash_mode_ = hash_mode;
+    h.window_size_ = window_size;
     h.parameters_ = parameters;
     h.file_names_ = file_names;
     h.page_size_ = page_size;
-    std::ofstream ofs;
-    serialize_header(ofs, out_file, h);
-
-    for (const auto& p : paths) {
-        std::ifstream ifs;
-        uint64_t row_size =
-            deserialize_header<ClassicIndexHeader>(ifs, p).row_size();
-        if (row_size == page_size) {
-            // row_size is page_size -> direct copy
-            t.active("copy");
-            ofs << ifs.rdbuf();
-            t.stop();
-        }
-        else {
-            // row_size needs to be padded to page_size
-            size_t batch_size = memory / 2 / page_size;
-
-            uint64_t data_size = get_stream_size(ifs);
-            batch_size = std::min(
-                batch_size, tlx::div_ceil(data_size, page_size));
-
-            sLOG0 << "batch_size" << batch_size;
-
-            std::vector<char> buffer(batch_size* page_size);
-            die_unless(data_size % row_size == 0);
-
-            while (data_size > 0) {
-                t.active("read");
-                size_t this_batch = std::min(batch_size, data_size / row_size);
-                ifs.read(buffer.data(), this_batch * row_size);
-                die_unequal(this_batch * row_size,
-                            static_cast<size_t>(ifs.gcount()));
-                data_size -= this_batch * row_size;
-
-                t.active("expand");
-                // expand each row_size to page_size, start at the back
-                for (size_t b = this_batch; b != 0; ) {
-                    --b;
-
-                    std::copy_backward(
-                        buffer.begin() + b * row_size,
-                        buffer.begin() + (b + 1) * row_size,
-                        buffer.begin() + b * page_size + row_size);
-                    std::fill(
-                        buffer.begin() + b * page_size + row_size,
-                        buffer.begin() + (b + 1) * page_size,
-                        0);
-                }
 
-                t.active("write");
-                ofs.write(buffer.data(), this_batch * page_size);
+    // aligned page mode: pad the header and every subindex start to OS
+    // page multiples, so no page gather straddles a memory page; when
+    // each subindex is large enough that the padding stays marginal,
+    // align to hugepages instead so the mapping can be hugepage-backed
+    if (aligned_pages) {
+        uint64_t min_bytes = uint64_t(-1);
+        for (const auto& p : parameters)
+            min_bytes = std::min(min_bytes, p.signature_size * page_size);
+        h.payload_alignment_ = get_page_size();
+        if (min_bytes >= 32 * hugepage_size)
+            h.payload_alignment_ = hugepage_size;
+    }
+
+    // serialize the header (including its page alignment padding) into
+    // memory, the file itself is written with coalesced bulk writes
+    std::ostringstream header_os;
+    h.serialize(header_os);
+    std::string header_str = header_os.str();
+
+    if (direct_io) {
+        // O_DIRECT and unaligned pwrite offsets exclude each other, so
+        // direct output keeps the serial coalesced bulk writer
+        BulkWriter writer(out_file, /* direct */ true);
+        writer.append(header_str.data(), header_str.size());
+
+        for (size_t i = 0; i < paths.size(); ++i) {
+            const fs::path& p = paths[i];
+            std::ifstream ifs;
+            uint64_t row_size =
+                deserialize_header<ClassicIndexHeader>(ifs, p).row_size();
+            if (row_size == page_size) {
+                // row_size is page_size -> direct copy
+                t.active("copy");
+                // the header read enabled stream exceptions, which would
+                // fire on the final short read here
+                ifs.exceptions(std::ios::goodbit);
+                std::vector<char> copy_buffer(8 * 1024 * 1024);
+                while (ifs) {
+                    ifs.read(copy_buffer.data(), copy_buffer.size());
+                    writer.append(copy_buffer.data(), ifs.gcount());
+                }
                 t.stop();
             }
+            else {
+                // row_size needs to be padded to page_size
+                size_t batch_size = memory / 2 / page_size;
+
+                uint64_t data_size = get_stream_size(ifs);
+                batch_size = std::min(
+                    batch_size, tlx::div_ceil(data_size, page_size));
+
+                sLOG0 << "batch_size" << batch_size;
+
+                std::vector<char> buffer(batch_size* page_size);
+                die_unless(data_size % row_size == 0);
+
+                while (data_size > 0) {
+                    t.active("read");
+                    size_t this_batch =
+                        std::min(batch_size, data_size / row_size);
+                    ifs.read(buffer.data(), this_batch * row_size);
+                    die_unequal(this_batch * row_size,
+                                static_cast<size_t>(ifs.gcount()));
+                    data_size -= this_batch * row_size;
+
+                    t.active("expand");
+                    // expand each row_size to page_size, start at the back
+                    for (size_t b = this_batch; b != 0; ) {
+                        --b;
+
+                        std::copy_backward(
+                            buffer.begin() + b * row_size,
+                            buffer.begin() + (b + 1) * row_size,
+                            buffer.begin() + b * page_size + row_size);
+                        std::fill(
+                            buffer.begin() + b * page_size + row_size,
+                            buffer.begin() + (b + 1) * page_size,
+                            0);
+                    }
+
+                    t.active("write");
+                    writer.append(buffer.data(), this_batch * page_size);
+                    t.stop();
+                }
+            }
+
+            // zero-fill up to the aligned start of the next subindex
+            uint64_t part_size = parameters[i].signature_size * page_size;
+            if (h.padded_subindex_size(i) != part_size) {
+                std::vector<char> zeros(
+                    h.padded_subindex_size(i) - part_size);
+                writer.append(zeros.data(), zeros.size());
+            }
+
+            ifs.close();
+            if (!keep_temporary) {
+                fs::remove(p);
+                fs::remove(p.parent_path());
+            }
+        }
+
+        writer.close();
+    }
+    else {
+        // Each part's output region starts at a computable offset, the
+        // header plus page_size bytes per signature row of the preceding
+        // parts, so the parts are copied in parallel with pwrite() to
+        // precomputed offsets; only the header is written serially.
+        std::vector<uint64_t> part_offset(paths.size() + 1);
+        part_offset[0] = header_str.size();
+        for (size_t i = 0; i < paths.size(); ++i) {
+            // padded sizes keep every part's start aligned, the padding
+            // itself is zero-filled by the ftruncate() below
+            part_offset[i + 1] = part_offset[i] + h.padded_subindex_size(i);
         }
 
-        ifs.close();
-        if (!keep_temporary) {
-            fs::remove(p);
-            fs::remove(p.parent_path());
+        int fd = open(out_file.string().c_str(),
+                      O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            die("Error: could not open " << out_file.string()
+                                         << ": " << strerror(errno));
+        }
+        if (ftruncate(fd, part_offset.back()) != 0) {
+            die("Error: could not size " << out_file.string()
+                                         << ": " << strerror(errno));
+        }
+        pwrite_all(fd, header_str.data(), header_str.size(),
+                   0, out_file);
+
+        size_t part_threads =
+            std::min<size_t>(std::max<size_t>(num_threads, 1), paths.size());
+
+        parallel_for(
+            0, paths.size(), part_threads,
+            [&](size_t i) {
+                Timer thr_timer;
+                const fs::path& p = paths[i];
+
+                std::ifstream ifs;
+                uint64_t row_size =
+                    deserialize_header<ClassicIndexHeader>(ifs, p).row_size();
+                // the header read enabled stream exceptions, which would
+                // fire on the final short read below
+                ifs.exceptions(std::ios::goodbit);
+                uint64_t data_size = get_stream_size(ifs);
+                die_unless(data_size % row_size == 0);
+                uint64_t offset = part_offset[i];
+
+                if (row_size == page_size) {
+                    // row_size is page_size -> direct copy
+                    thr_timer.active("copy");
+                    std::vector<char> copy_buffer(8 * 1024 * 1024);
+                    while (ifs) {
+                        ifs.read(copy_buffer.data(), copy_buffer.size());
+                        pwrite_all(fd, copy_buffer.data(), ifs.gcount(),
+                                   offset, out_file);
+                        offset += ifs.gcount();
+                    }
+                    thr_timer.stop();
+                }
+                else {
+                    // row_size needs to be padded to page_size
+                    size_t batch_size = std::max<size_t>(
+                        memory / 2 / part_threads / (row_size + page_size), 1);
+                    batch_size = std::min(
+                        batch_size, tlx::div_ceil(data_size, row_size));
+
+                    std::vector<char> in_buffer(batch_size * row_size);
+                    std::vector<char> out_buffer(batch_size * page_size);
+
+                    while (data_size > 0) {
+                        thr_timer.active("read");
+                        size_t this_batch =
+                            std::min(batch_size, data_size / row_size);
+                        ifs.read(in_buffer.data(), this_batch * row_size);
+                        die_unequal(this_batch * row_size,
+                                    static_cast<size_t>(ifs.gcount()));
+                        data_size -= this_batch * row_size;
+
+                        thr_timer.active("expand");
+                        // forward expansion into a second buffer instead
+                        // of the in-place backward shuffle: one memcpy
+                        // and one memset per row, which vectorize
+                        for (size_t b = 0; b < this_batch; ++b) {
+                            std::memcpy(out_buffer.data() + b * page_size,
+                                        in_buffer.data() + b * row_size,
+                                        row_size);
+                            std::memset(
+                                out_buffer.data() + b * page_size + row_size,
+                                0, page_size - row_size);
+                        }
+
+                        thr_timer.active("write");
+                        pwrite_all(fd, out_buffer.data(),
+                                   this_batch * page_size, offset, out_file);
+                        offset += this_batch * page_size;
+                        thr_timer.stop();
+                    }
+                }
+
+                ifs.close();
+                if (!keep_temporary) {
+                    fs::remove(p);
+                    fs::remove(p.parent_path());
+                }
+                t += thr_timer;
+            });
+
+        if (close(fd) != 0) {
+            die("Error: could not close " << out_file.string()
+                                          << ": " << strerror(errno));
         }
     }
 
@@ -172,6 +354,15 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
                        fs::path tmp_path, CompactIndexParameters params) {
     size_t iteration = 1;
 
+    // periodic throughput reports and a JSON summary at the end
+    ConstructionStats::ScopedReporter stats_reporter;
+    {
+        uint64_t total_input = 0;
+        for (const DocumentEntry& de : doc_list.list())
+            total_input += de.size_;
+        g_construction_stats.add_total_input_bytes(total_input);
+    }
+
     // check output file
     if (!tlx::ends_with(index_file, CompactIndexHeader::file_extension)) {
         die("Error: classic COBS index file must end with "
@@ -187,6 +378,13 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
         params.page_size = std::max<uint64_t>(params.page_size, 8);
         params.page_size = std::min<uint64_t>(params.page_size, 4096);
     }
+    if (params.aligned_pages &&
+        params.page_size % get_page_size() != 0 &&
+        get_page_size() % params.page_size != 0) {
+        // a page must either divide the OS page or be a multiple of it,
+        // otherwise page gathers straddle memory page boundaries
+        params.page_size = tlx::round_up_to_power_of_two(params.page_size);
+    }
 
     size_t num_pages = tlx::div_ceil(doc_list.size(), 8 * params.page_size);
 
@@ -237,6 +435,7 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
          << "  false_positive_rate: " << params.false_positive_rate << '\n'
          << "  page_size: " << params.page_size << " bytes"
          << " = " << params.page_size * 8 << " documents" << '\n'
+         << "  aligned_pages: " << unsigned(params.aligned_pages) << '\n'
          << "  num_pages: " << num_pages << '\n'
          << "  mem_bytes: " << params.mem_bytes
          << " = " << tlx::format_iec_units(params.mem_bytes) << 'B' << '\n'
@@ -290,6 +489,10 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
             classic_params.term_size = params.term_size;
             classic_params.canonicalize = params.canonicalize;
             classic_params.num_hashes = params.num_hashes;
+            classic_params.hash_mode = params.hash_mode;
+            classic_params.dedup = params.dedup;
+            classic_params.window_size = params.window_size;
+            classic_params.direct_io = params.direct_io;
             classic_params.false_positive_rate = params.false_positive_rate;
             classic_params.signature_size = signature_size;
             classic_params.mem_bytes = params.mem_bytes / num_threads;
@@ -323,7 +526,8 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
     while (!combine_classic_index(tmp_path / pad_index(iteration),
                                   tmp_path / pad_index(iteration + 1),
                                   params.mem_bytes, params.num_threads,
-                                  params.keep_temporary)) {
+                                  params.keep_temporary,
+                                  params.direct_io)) {
         iteration++;
     }
 
@@ -331,7 +535,8 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
     compact_combine_into_compact(
         tmp_path / pad_index(iteration + 1),
         index_file,
-        params.page_size, params.mem_bytes, params.keep_temporary);
+        params.page_size, params.mem_bytes, params.keep_temporary,
+        params.direct_io, params.num_threads, params.aligned_pages);
 
     // cleanup: this will fail if not _all_ temporary files are removed
     if (!params.keep_temporary) {
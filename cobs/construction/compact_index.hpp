@@ -28,10 +28,29 @@ struct CompactIndexParameters {
     uint8_t canonicalize = 1;
     //! number of hash functions, provided by user
     unsigned num_hashes = 1;
+    //! hashing scheme: 0 = one XXH64 evaluation per hash function,
+    //! 1 = double hashing (v2), needing only two evaluations per term
+    uint8_t hash_mode = 0;
+    //! skip hashing of k-mers repeated within the same document, whose
+    //! bits are already set; only effective for canonicalized k-mers of
+    //! up to 31 bases, default: true
+    bool dedup = true;
+    //! minimizer window size: index only the minimizer of every window of
+    //! this many consecutive k-mers, recorded in the index header so
+    //! queries subsample identically, default: 1 = index every k-mer
+    uint64_t window_size = 1;
+    //! write index files with O_DIRECT and aligned bulk writes, bypassing
+    //! the page cache; ignored where O_DIRECT is unavailable,
+    //! default: false
+    bool direct_io = false;
     //! false positive rate, provided by user
     double false_positive_rate = 0.3;
     //! page or block size of filters with common fpr
     uint64_t page_size = 0;
+    //! pad the header and every subindex start to OS page multiples, so
+    //! page gathers never straddle a memory page and hugepage-sized
+    //! payloads can be mapped with hugepage backing, default: false
+    bool aligned_pages = false;
     //! memory to use bytes to create index
     uint64_t mem_bytes = get_memory_size(80);
     //! number of threads to use
@@ -56,7 +75,10 @@ void compact_combine_into_compact(
     const fs::path& in_dir, const fs::path& out_file,
     uint64_t page_size = get_page_size(),
     uint64_t memory = get_memory_size(80),
-    bool keep_temporary = false);
+    bool keep_temporary = false,
+    bool direct_io = false,
+    size_t num_threads = gopt_threads,
+    bool aligned_pages = false);
 
 } // namespace cobs
 
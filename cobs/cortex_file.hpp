@@ -10,6 +10,7 @@
 #ifndef COBS_CORTEX_FILE_HEADER
 #define COBS_CORTEX_FILE_HEADER
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -63,8 +64,8 @@ public:
         kmer_size_ = cast_advance<uint32_t>(is);
         num_words_per_kmer_ = cast_advance<uint32_t>(is);
         num_colors_ = cast_advance<uint32_t>(is);
-        if (num_colors_ != 1)
-            die("Invalid number of colors (" << num_colors_ << "), must be 1");
+        if (num_colors_ == 0)
+            die("Invalid number of colors (" << num_colors_ << ")");
 
         for (size_t i = 0; i < num_colors_; i++) {
             uint32_t mean_read_length = cast_advance<uint32_t>(is);
@@ -73,9 +74,11 @@ public:
         }
         for (size_t i = 0; i < num_colors_; i++) {
             auto document_name_length = cast_advance<uint32_t>(is);
-            name_.resize(document_name_length);
-            is.read(const_cast<char*>(name_.data()), document_name_length);
+            std::string name(document_name_length, 0);
+            is.read(const_cast<char*>(name.data()), document_name_length);
+            names_.emplace_back(std::move(name));
         }
+        name_ = names_.front();
         is.ignore(16 * num_colors_);
         for (size_t i = 0; i < num_colors_; i++) {
             is.ignore(12);
@@ -101,29 +104,67 @@ public:
     }
 
     template <typename Callback>
-    void process_terms(size_t term_size, Callback callback) {
+    void process_terms(size_t term_size, Callback callback, size_t color = 0) {
+        process_terms(term_size, 0, size_t(-1), color, callback);
+    }
+
+    //! process only the terms with index in the half-open range
+    //! [term_begin, term_end) of the given color. k-mer records have a
+    //! fixed stride, so the reader seeks straight to the first record of
+    //! the range instead of decoding the file from the front; concurrent
+    //! ranged readers on separate CortexFile instances thus parse the
+    //! k-mer section in parallel, each decoding into its own record
+    //! buffer. in multi-color files, records with zero coverage in the
+    //! color are skipped but keep their term indices, so ranges partition
+    //! the file identically for every color.
+    template <typename Callback>
+    void process_terms(size_t term_size, size_t term_begin, size_t term_end,
+                       size_t color, Callback callback) {
+        if (term_size > kmer_size_)
+            return;
         std::string kmer(kmer_size_, 0);
-        static const size_t kmer_packed_size = (kmer_size_ + 3) / 4;
+        size_t kmer_packed_size = (kmer_size_ + 3) / 4;
 
         // bytes per k-mer from 64-bit words per k-mer (<W>)
         size_t bytes_per_kmer = sizeof(uint64_t) * num_words_per_kmer_;
         die_unless(bytes_per_kmer >= kmer_packed_size);
+        size_t record_stride = bytes_per_kmer + 5 * num_colors_;
+
+        // map term indices onto fixed-stride record indices
+        size_t terms_per_kmer = kmer_size_ - term_size + 1;
+        term_end = std::min(term_end, num_kmers() * terms_per_kmer);
+        if (term_begin >= term_end)
+            return;
+        size_t rec_begin = term_begin / terms_per_kmer;
+        size_t rec_end = (term_end + terms_per_kmer - 1) / terms_per_kmer;
+
+        die_unless(color < num_colors_);
 
         std::vector<uint8_t> kmer_data(bytes_per_kmer);
+        std::vector<uint8_t> color_data(5 * num_colors_);
 
         is_.clear();
-        is_.seekg(pos_data_begin_);
+        is_.seekg(pos_data_begin_
+                  + std::streamoff(rec_begin * record_stride));
 
-        size_t r = num_kmers();
-        while (r != 0) {
-            --r;
+        for (size_t r = rec_begin; r != rec_end; ++r) {
             if (!is_.good())
                 die("corrupted .ctx file");
 
             // read k-mer data bytes
             is_.read(reinterpret_cast<char*>(kmer_data.data()), bytes_per_kmer);
-            // skip color information
-            is_.ignore(5 * num_colors_);
+            // read color information: coverage array, then edge bytes
+            is_.read(reinterpret_cast<char*>(color_data.data()),
+                     color_data.size());
+
+            if (num_colors_ != 1) {
+                // skip records the color does not cover
+                uint32_t coverage;
+                std::memcpy(&coverage, color_data.data() + 4 * color,
+                            sizeof(coverage));
+                if (coverage == 0)
+                    continue;
+            }
 
             // from KMer::to_string()
             kmer.clear();
@@ -139,7 +180,12 @@ public:
                 }
             }
 
-            for (size_t i = 0; i + term_size <= kmer_size_; ++i) {
+            // clip the first and last record to the term range
+            size_t w_begin =
+                r == rec_begin ? term_begin - r * terms_per_kmer : 0;
+            size_t w_end = std::min(terms_per_kmer,
+                                    term_end - r * terms_per_kmer);
+            for (size_t i = w_begin; i != w_end; ++i) {
                 callback(tlx::string_view(kmer.data() + i, term_size));
             }
         }
@@ -154,7 +200,10 @@ public:
     //! number of colours (<cols>)
     uint32_t num_colors_;
 
+    //! name of the first color, kept for single-color callers
     std::string name_;
+    //! per-color sample names
+    std::vector<std::string> names_;
 
 private:
     std::ifstream is_;
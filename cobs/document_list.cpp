@@ -28,6 +28,8 @@ FileType StringToFileType(std::string& s) {
         return FileType::Fastq;
     if (s == "list")
         return FileType::List;
+    if (s == "stream")
+        return FileType::Stream;
     die("Unknown file type " << s);
 }
 
@@ -15,6 +15,8 @@
 #include <cobs/fastq_file.hpp>
 #include <cobs/settings.hpp>
 #include <cobs/text_file.hpp>
+#include <cobs/util/fasta_block_parser.hpp>
+#include <cobs/util/fastq_block_parser.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
 #include <cobs/util/parallel_for.hpp>
@@ -22,6 +24,8 @@
 #include <algorithm>
 #include <fstream>
 #include <iomanip>
+#include <iostream>
+#include <map>
 
 #include <tlx/logger.hpp>
 #include <tlx/string/ends_with.hpp>
@@ -49,6 +53,9 @@ enum class FileType {
     FastqMulti,
     //! Special filelist file type (cannot actually be a document)
     List,
+    //! Non-seekable FASTA/FASTQ stream: stdin ("-") or a named pipe,
+    //! read in one forward pass, format detected from the first byte
+    Stream,
 };
 
 FileType StringToFileType(std::string& s);
@@ -105,6 +112,10 @@ struct DocumentEntry {
             FastqFile fastq(path_);
             return fastq.num_terms(k);
         }
+        else if (type_ == FileType::Stream) {
+            // size_ is the configured estimate, the stream cannot be scanned
+            return size_ < k ? 0 : size_ - k + 1;
+        }
         else {
             die("DocumentEntry: unknown file type");
         }
@@ -119,19 +130,18 @@ struct DocumentEntry {
         }
         else if (type_ == FileType::Cortex) {
             CortexFile ctx(path_);
-            ctx.process_terms(term_size, callback);
+            ctx.process_terms(term_size, callback, subdoc_index_);
         }
         else if (type_ == FileType::KMerBuffer) {
             die_unequal(term_size, 31u);
-            KMerBuffer<31> doc;
             KMerBufferHeader dh;
-            doc.deserialize(path_, dh);
+            KMerBufferMMap<31> doc(path_, dh);
 
             std::string term;
             term.reserve(32);
 
-            for (uint64_t j = 0; j < doc.data().size(); j++) {
-                doc.data()[j].to_string(&term);
+            for (uint64_t j = 0; j < doc.num_kmers(); j++) {
+                doc[j].to_string(&term);
                 callback(tlx::string_view(term));
             }
         }
@@ -147,10 +157,73 @@ struct DocumentEntry {
             FastqFile fastq(path_);
             fastq.process_terms(term_size, callback);
         }
+        else if (type_ == FileType::Stream) {
+            process_stream_terms(term_size, callback);
+        }
         else {
             die("DocumentEntry: unknown file type");
         }
     }
+
+    //! read a non-seekable FASTA/FASTQ stream (stdin or a named pipe) in
+    //! one forward pass; the format is detected from the first byte.
+    //! compressed streams are not supported, pipe through zcat instead.
+    template <typename Callback>
+    void process_stream_terms(unsigned term_size, Callback callback) const {
+        std::ifstream ifs;
+        std::istream* is;
+        if (path_ == "-") {
+            is = &std::cin;
+        }
+        else {
+            ifs.open(path_, std::ios::in | std::ios::binary);
+            die_unless(ifs.good());
+            is = &ifs;
+        }
+
+        int first = is->peek();
+        if (first == std::char_traits<char>::eof()) {
+            // empty stream delivers no terms
+            return;
+        }
+        else if (first == '@') {
+            fastq_process_blocks(*is, term_size, path_, callback);
+        }
+        else if (first == '>' || first == ';') {
+            fasta_process_blocks(*is, term_size,
+                                 /* stop_at_header */ false,
+                                 /* restart_on_empty */ true, callback);
+        }
+        else {
+            die("DocumentEntry: stream " << path_
+                                         << " is neither FASTA nor FASTQ");
+        }
+    }
+
+    //! process only the terms with index in the half-open range
+    //! [term_begin, term_end). The file is still parsed from the front,
+    //! but skipped terms never reach the callback, which carries the
+    //! hashing cost; this lets large documents be split across threads.
+    template <typename Callback>
+    void process_terms(unsigned term_size, size_t term_begin, size_t term_end,
+                       Callback callback) const {
+        if (type_ == FileType::Cortex) {
+            // fixed-stride records: seek directly to the range instead of
+            // decoding the whole k-mer section and discarding terms
+            CortexFile ctx(path_);
+            ctx.process_terms(term_size, term_begin, term_end,
+                              subdoc_index_, callback);
+            return;
+        }
+        size_t index = 0;
+        process_terms(
+            term_size,
+            [&](const tlx::string_view& term) {
+                if (index >= term_begin && index < term_end)
+                    callback(term);
+                ++index;
+            });
+    }
 };
 
 /*!
@@ -205,6 +278,8 @@ public:
             return (ft == FileType::FastqMulti);
         case FileType::List:
             return (ft == FileType::List);
+        case FileType::Stream:
+            return (ft == FileType::Stream);
         }
         return false;
     }
@@ -212,6 +287,13 @@ public:
     //! return FileType of path or FileType::Any for others.
     static FileType identify_filetype(const fs::path& path) {
         std::string spath = path.string();
+        if (spath == "-") {
+            return FileType::Stream;
+        }
+        std::error_code ec;
+        if (fs::is_fifo(fs::status(path, ec)) && !ec) {
+            return FileType::Stream;
+        }
         if (tlx::ends_with(spath, ".txt")) {
             return FileType::Text;
         }
@@ -224,22 +306,30 @@ public:
         }
         else if (tlx::ends_with(spath, ".fa") ||
                  tlx::ends_with(spath, ".fa.gz") ||
+                 tlx::ends_with(spath, ".fa.zst") ||
                  tlx::ends_with(spath, ".fasta") ||
                  tlx::ends_with(spath, ".fasta.gz") ||
+                 tlx::ends_with(spath, ".fasta.zst") ||
                  tlx::ends_with(spath, ".fna") ||
                  tlx::ends_with(spath, ".fna.gz") ||
+                 tlx::ends_with(spath, ".fna.zst") ||
                  tlx::ends_with(spath, ".ffn") ||
                  tlx::ends_with(spath, ".ffn.gz") ||
+                 tlx::ends_with(spath, ".ffn.zst") ||
                  tlx::ends_with(spath, ".faa") ||
                  tlx::ends_with(spath, ".faa.gz") ||
+                 tlx::ends_with(spath, ".faa.zst") ||
                  tlx::ends_with(spath, ".frn") ||
-                 tlx::ends_with(spath, ".frn.gz")){
+                 tlx::ends_with(spath, ".frn.gz") ||
+                 tlx::ends_with(spath, ".frn.zst")){
             return FileType::Fasta;
         }
         else if (tlx::ends_with(spath, ".fq") ||
                  tlx::ends_with(spath, ".fq.gz") ||
+                 tlx::ends_with(spath, ".fq.zst") ||
                  tlx::ends_with(spath, ".fastq") ||
-                 tlx::ends_with(spath, ".fastq.gz")) {
+                 tlx::ends_with(spath, ".fastq.gz") ||
+                 tlx::ends_with(spath, ".fastq.zst")) {
             return FileType::Fastq;
         }
         else if (tlx::ends_with(spath, ".mfasta")) {
@@ -269,15 +359,23 @@ public:
             return DocumentEntryList({ de });
         }
         else if (ft == FileType::Cortex) {
+            // multi-color files become one document per color
             CortexFile ctx(path.string());
-            DocumentEntry de;
-            de.path_ = path.string();
-            de.type_ = FileType::Cortex;
-            de.name_ = ctx.name_;
-            de.size_ = fs::file_size(path);
-            de.term_size_ = ctx.kmer_size_;
-            de.term_count_ = ctx.num_kmers();
-            return DocumentEntryList({ de });
+            DocumentEntryList list;
+            for (size_t i = 0; i < ctx.num_colors_; ++i) {
+                DocumentEntry de;
+                de.path_ = path.string();
+                de.type_ = FileType::Cortex;
+                de.name_ = ctx.names_[i];
+                de.size_ = fs::file_size(path);
+                de.subdoc_index_ = i;
+                // term_count_ counts all records and is an upper bound for
+                // colors that do not cover every k-mer
+                de.term_size_ = ctx.kmer_size_;
+                de.term_count_ = ctx.num_kmers();
+                list.emplace_back(de);
+            }
+            return list;
         }
         else if (ft == FileType::KMerBuffer) {
             std::ifstream is;
@@ -328,6 +426,17 @@ public:
             de.term_size_ = 0, de.term_count_ = 0;
             return DocumentEntryList({ de });
         }
+        else if (ft == FileType::Stream) {
+            DocumentEntry de;
+            de.path_ = path.string();
+            de.type_ = FileType::Stream;
+            de.name_ = (path.string() == "-" ? "stdin" : base_name(path));
+            // non-seekable streams cannot be measured up front, use the
+            // configured estimate for signature sizing and scheduling
+            de.size_ = gopt_stream_size_estimate;
+            de.term_size_ = 0, de.term_count_ = 0;
+            return DocumentEntryList({ de });
+        }
         else {
             die("DocumentList: unknown document file to add: " << path);
         }
@@ -339,13 +448,118 @@ public:
         std::move(l.begin(), l.end(), std::back_inserter(list_));
     }
 
+    //! one catalog record: stat info and the document entries of a path
+    struct CatalogRecord {
+        uint64_t mtime = 0;
+        uint64_t file_size = 0;
+        DocumentEntryList entries;
+    };
+
+    //! catalog file magic "COBSCTLG"
+    static constexpr uint64_t catalog_magic = 0x434F425343544C47llu;
+    //! catalog file format version
+    static constexpr uint64_t catalog_version = 1;
+
+    //! stat a path for catalog matching; false if it cannot be stat'ed
+    static bool stat_path(const std::string& path,
+                          uint64_t& mtime, uint64_t& file_size) {
+        std::error_code ec;
+        auto time = fs::last_write_time(path, ec);
+        if (ec)
+            return false;
+        uint64_t size = fs::file_size(path, ec);
+        if (ec)
+            return false;
+        mtime = static_cast<uint64_t>(time.time_since_epoch().count());
+        file_size = size;
+        return true;
+    }
+
+    //! read the scan catalog written by a previous add_recursive()
+    static bool read_catalog(const std::string& path,
+                             std::map<std::string, CatalogRecord>& catalog) {
+        std::ifstream is(path, std::ios::in | std::ios::binary);
+        if (!is.good())
+            return false;
+        uint64_t magic = 0, version = 0, num_paths = 0;
+        stream_get_pod(is, magic);
+        stream_get_pod(is, version);
+        stream_get_pod(is, num_paths);
+        if (!is.good() || magic != catalog_magic ||
+            version != catalog_version)
+            return false;
+        for (uint64_t i = 0; i < num_paths; ++i) {
+            std::string doc_path;
+            std::getline(is, doc_path, '\0');
+            CatalogRecord rec;
+            uint64_t num_entries = 0;
+            stream_get_pod(is, rec.mtime);
+            stream_get_pod(is, rec.file_size);
+            stream_get_pod(is, num_entries);
+            if (!is.good()) {
+                catalog.clear();
+                return false;
+            }
+            for (uint64_t j = 0; j < num_entries; ++j) {
+                DocumentEntry de;
+                de.path_ = doc_path;
+                uint8_t type = 0;
+                stream_get_pod(is, type);
+                de.type_ = static_cast<FileType>(type);
+                std::getline(is, de.name_, '\0');
+                stream_get_pod(is, de.size_);
+                stream_get_pod(is, de.subdoc_index_);
+                stream_get_pod(is, de.term_size_);
+                stream_get_pod(is, de.term_count_);
+                rec.entries.emplace_back(std::move(de));
+            }
+            catalog[doc_path] = std::move(rec);
+        }
+        if (!is.good()) {
+            catalog.clear();
+            return false;
+        }
+        return true;
+    }
+
+    //! write the scan catalog, via .tmp and rename
+    static void write_catalog(
+        const std::string& path,
+        const std::map<std::string, CatalogRecord>& catalog) {
+        std::ofstream os(path + ".tmp", std::ios::out | std::ios::binary);
+        stream_put_pod(os, catalog_magic);
+        stream_put_pod(os, catalog_version);
+        stream_put_pod(os, uint64_t(catalog.size()));
+        for (const auto& p : catalog) {
+            os.write(p.first.data(), p.first.size() + 1);
+            stream_put_pod(os, p.second.mtime);
+            stream_put_pod(os, p.second.file_size);
+            stream_put_pod(os, uint64_t(p.second.entries.size()));
+            for (const DocumentEntry& de : p.second.entries) {
+                stream_put_pod(os, uint8_t(de.type_));
+                os.write(de.name_.data(), de.name_.size() + 1);
+                stream_put_pod(os, de.size_);
+                stream_put_pod(os, de.subdoc_index_);
+                stream_put_pod(os, de.term_size_);
+                stream_put_pod(os, de.term_count_);
+            }
+        }
+        os.close();
+        if (os.good()) {
+            fs::rename(path + ".tmp", path);
+            LOG1 << "DocumentList: saved scan catalog as " << path;
+        }
+    }
+
     //! scan path recursively and add files of given filter type. if the root
     //! path is a .list file, it is read and all files are added to the
     //! DocumentList.
     void add_recursive(const fs::path& root, FileType filter = FileType::Any)
     {
         std::vector<std::string> paths;
+        std::string catalog_file;
         if (fs::is_directory(root)) {
+            catalog_file = (root / ".cobs_catalog").string();
             fs::recursive_directory_iterator it(root), end;
             while (it != end) {
                 if (accept(*it, filter)) {
@@ -357,6 +571,7 @@ public:
         else if (tlx::ends_with(root.string(), ".list") ||
                  filter == FileType::List)
         {
+            catalog_file = root.string() + ".cobs_catalog";
             std::ifstream in(root.string());
             if (!in.good())
                 die("DocumentList: could not open .list file: " << root);
@@ -380,9 +595,24 @@ public:
         else if (fs::is_regular_file(root)) {
             paths.emplace_back(root.string());
         }
+        else if (identify_filetype(root) == FileType::Stream) {
+            // stdin or a named pipe, consumed once by process_terms()
+            paths.emplace_back(root.string());
+        }
 
         std::sort(paths.begin(), paths.end());
 
+        // consult the catalog of the previous scan over this root, so
+        // paths with unchanged mtime and size skip load() -- and with it
+        // the per-file open and header or index read -- entirely
+        bool use_catalog = !catalog_file.empty() && !gopt_disable_cache;
+        std::map<std::string, CatalogRecord> catalog, new_catalog;
+        bool catalog_dirty = false;
+        if (use_catalog && read_catalog(catalog_file, catalog)) {
+            LOG1 << "DocumentList: loaded scan catalog " << catalog_file
+                 << " [" << catalog.size() << " paths]";
+        }
+
         // process files in parallel such that caches files are created in
         // parallel
         std::mutex list_mutex;
@@ -390,10 +620,34 @@ public:
             0, paths.size(), gopt_threads,
             [&](size_t i) {
                 try {
+                    uint64_t mtime = 0, file_size = 0;
+                    bool have_stat =
+                        use_catalog && stat_path(paths[i], mtime, file_size);
+                    if (have_stat) {
+                        auto it = catalog.find(paths[i]);
+                        if (it != catalog.end() &&
+                            it->second.mtime == mtime &&
+                            it->second.file_size == file_size)
+                        {
+                            // unchanged since the last scan
+                            std::unique_lock<std::mutex> lock(list_mutex);
+                            std::copy(it->second.entries.begin(),
+                                      it->second.entries.end(),
+                                      std::back_inserter(list_));
+                            new_catalog[paths[i]] = it->second;
+                            return;
+                        }
+                    }
+
                     DocumentEntryList l = load(fs::path(paths[i]));
 
                     // append the list of documents loaded from the path
                     std::unique_lock<std::mutex> lock(list_mutex);
+                    if (have_stat) {
+                        new_catalog[paths[i]] =
+                            CatalogRecord { mtime, file_size, l };
+                        catalog_dirty = true;
+                    }
                     std::move(l.begin(), l.end(), std::back_inserter(list_));
                 }
                 catch (std::exception& e) {
@@ -401,6 +655,11 @@ public:
                 }
             });
 
+        // rewrite the catalog when paths were loaded anew or vanished
+        if (use_catalog &&
+            (catalog_dirty || new_catalog.size() != catalog.size()))
+            write_catalog(catalog_file, new_catalog);
+
         // sort again due to random thread execution order
         if (gopt_threads > 1)
             std::sort(list_.begin(), list_.end());
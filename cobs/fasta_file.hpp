@@ -14,14 +14,16 @@
 #include <vector>
 
 #include <cobs/settings.hpp>
+#include <cobs/util/fasta_block_parser.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
+#include <cobs/util/query.hpp>
 #include <cobs/util/zip_stream.hpp>
+#include <cobs/util/zstd_stream.hpp>
 
 #include <tlx/container/string_view.hpp>
 #include <tlx/die.hpp>
 #include <tlx/logger.hpp>
-#include <tlx/string/appendline.hpp>
 #include <tlx/string/ends_with.hpp>
 
 #include <map>
@@ -47,11 +49,41 @@ public:
         }
     }
 
+    ~FastaFile() {
+        if (cache_map_.data != nullptr)
+            destroy_mmap(cache_map_);
+    }
+
+    //! non-copyable: holds the cache mapping
+    FastaFile(const FastaFile&) = delete;
+    //! non-copyable: holds the cache mapping
+    FastaFile& operator = (const FastaFile&) = delete;
+
     //! return index cache file path
     std::string cache_path() const {
         return path_ + ".cobs_cache";
     }
 
+    //! fixed-layout header of the binary cache file
+    struct CacheHeader {
+        uint64_t magic;
+        uint64_t version;
+        uint64_t size;
+        uint64_t sequence_count;
+        uint64_t hist_size;
+    };
+
+    //! flat histogram row in the binary cache file
+    struct CacheEntry {
+        uint64_t sequence_size;
+        uint64_t count;
+    };
+
+    //! cache file magic "COBSFAC1"
+    static constexpr uint64_t cache_magic = 0x434F425346414331llu;
+    //! cache file format version
+    static constexpr uint64_t cache_version = 1;
+
     //! read complete FASTA file for sub-documents
     void compute_index(std::istream& is) {
         LOGC(!gopt_disable_cache)
@@ -98,44 +130,70 @@ public:
             zip_istream zis(is_);
             return compute_index(zis);
         }
+        else if (tlx::ends_with(path_, ".zst")) {
+            zstd_istream zis(is_);
+            return compute_index(zis);
+        }
         else {
             return compute_index(is_);
         }
     }
 
-    //! write cache file
+    //! write cache file: header plus flat histogram array
     void write_cache_file() {
-        std::ofstream os(cache_path() + ".tmp");
-        stream_put_pod(os, size_);
-        stream_put_pod(os, sequence_count_);
-        stream_put_pod(os, sequence_size_hist_.size());
-        for (auto it = sequence_size_hist_.begin();
-             it != sequence_size_hist_.end(); ++it) {
-            stream_put_pod(os, it->first);
-            stream_put_pod(os, it->second);
-        }
+        CacheHeader header;
+        header.magic = cache_magic;
+        header.version = cache_version;
+        header.size = size_;
+        header.sequence_count = sequence_count_;
+        header.hist_size = sequence_size_hist_.size();
+
+        std::vector<CacheEntry> entries;
+        entries.reserve(sequence_size_hist_.size());
+        for (const auto& p : sequence_size_hist_)
+            entries.push_back(CacheEntry { p.first, p.second });
+
+        std::ofstream os(cache_path() + ".tmp", std::ios::binary);
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char*>(entries.data()),
+                 entries.size() * sizeof(CacheEntry));
         fs::rename(cache_path() + ".tmp",
                    cache_path());
         LOG1 << "FastaFile: saved index as " << cache_path();
     }
 
-    //! read cache file
+    //! map the cache file and validate it; the histogram is used in
+    //! place from the mapping, so loading is one mmap plus four checks
     bool read_cache_file() {
-        std::ifstream is(cache_path());
-        if (!is.good()) return false;
-        size_t hist_size;
-        stream_get_pod(is, size_);
-        stream_get_pod(is, sequence_count_);
-        stream_get_pod(is, hist_size);
-        LOG1 << "FastaFile: loading index " << cache_path()
-             << " [" << sequence_count_ << " subsequences]";
-        for (size_t i = 0; i < hist_size; ++i) {
-            size_t size, count;
-            stream_get_pod(is, size);
-            stream_get_pod(is, count);
-            sequence_size_hist_[size] = count;
+        std::error_code ec;
+        uint64_t file_size = fs::file_size(cache_path(), ec);
+        if (ec || file_size < sizeof(CacheHeader))
+            return false;
+
+        MMapPolicy policy;
+        policy.random_access = false;
+        cache_map_ = initialize_mmap(cache_path(), policy);
+
+        const CacheHeader* header =
+            reinterpret_cast<const CacheHeader*>(cache_map_.data);
+        if (header->magic != cache_magic ||
+            header->version != cache_version ||
+            cache_map_.size !=
+            sizeof(CacheHeader) + header->hist_size * sizeof(CacheEntry))
+        {
+            destroy_mmap(cache_map_);
+            cache_map_ = MMapHandle { -1, nullptr, 0 };
+            return false;
         }
-        return is.good() && (is.get() == EOF);
+
+        size_ = header->size;
+        sequence_count_ = header->sequence_count;
+        cache_hist_ = reinterpret_cast<const CacheEntry*>(
+            cache_map_.data + sizeof(CacheHeader));
+        cache_hist_size_ = header->hist_size;
+        LOG1 << "FastaFile: mapped index " << cache_path()
+             << " [" << sequence_count_ << " subsequences]";
+        return true;
     }
 
     //! return estimated size of a fasta document
@@ -145,6 +203,15 @@ public:
 
     //! return number of q-grams in document
     size_t num_terms(size_t q) {
+        if (cache_hist_ != nullptr) {
+            size_t total = 0;
+            for (uint64_t i = 0; i < cache_hist_size_; ++i) {
+                total += cache_hist_[i].count *
+                         (cache_hist_[i].sequence_size < q ? 0 :
+                          cache_hist_[i].sequence_size - q + 1);
+            }
+            return total;
+        }
         size_t total = 0;
         for (const auto& p : sequence_size_hist_) {
             total += p.second * (p.first < q ? 0 : p.first - q + 1);
@@ -154,31 +221,11 @@ public:
 
     template <typename Callback>
     void process_terms(std::istream& is, size_t term_size, Callback callback) {
-        std::string line;
-        size_t pos = 0;
-
-        while (tlx::appendline(is, line)) {
-            if (line.size() == pos || line[pos] == '>' || line[pos] == ';') {
-                // comment or empty line restart the term buffer
-                line.clear();
-                continue;
-            }
-
-            // process terms continued on next line
-            for (size_t i = 0; i + term_size <= line.size(); ++i) {
-                callback(tlx::string_view(line.data() + i, term_size));
-            }
-            if (line.size() > term_size - 1) {
-                std::copy(line.data() + line.size() - (term_size - 1),
-                          line.data() + line.size(),
-                          line.data());
-                line.resize(term_size - 1);
-                pos = line.size();
-            }
-            else {
-                pos = 0;
-            }
-        }
+        // block-read and window the sequences in place; comment, header
+        // and empty lines restart the term buffer
+        fasta_process_blocks(is, term_size,
+                             /* stop_at_header */ false,
+                             /* restart_on_empty */ true, callback);
     }
 
     template <typename Callback>
@@ -188,7 +235,12 @@ public:
         die_unless(is_.good());
 
         if (tlx::ends_with(path_, ".gz")) {
-            zip_istream zis(is_);
+            // decompress on a background thread, overlapping with hashing
+            parallel_zip_istream zis(is_);
+            return process_terms(zis, term_size, callback);
+        }
+        else if (tlx::ends_with(path_, ".zst")) {
+            zstd_istream zis(is_);
             return process_terms(zis, term_size, callback);
         }
         else {
@@ -205,8 +257,14 @@ private:
     size_t size_;
     //! number of sub-sequences
     size_t sequence_count_;
-    //! histogram of sub-sequence sizes
+    //! histogram of sub-sequence sizes, filled by compute_index()
     std::map<size_t, size_t> sequence_size_hist_;
+    //! mapping of the binary cache file, if loaded from cache
+    MMapHandle cache_map_ { -1, nullptr, 0 };
+    //! flat histogram inside cache_map_, used in place of the std::map
+    const CacheEntry* cache_hist_ = nullptr;
+    //! number of rows in cache_hist_
+    uint64_t cache_hist_size_ = 0;
 };
 
 } // namespace cobs
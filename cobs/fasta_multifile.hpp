@@ -15,7 +15,9 @@
 #include <vector>
 
 #include <cobs/settings.hpp>
+#include <cobs/util/fasta_block_parser.hpp>
 #include <cobs/util/file.hpp>
+#include <cobs/util/query.hpp>
 #include <cobs/util/fs.hpp>
 #include <cobs/util/serialization.hpp>
 #include <cobs/util/thread_object_array.hpp>
@@ -46,21 +48,11 @@ public:
         is->seekg(pos_begin_);
         die_unless(is->good());
 
-        std::string data, line;
-
-        while (std::getline(*is, line)) {
-            if (line[0] == '>' || line[0] == ';')
-                break;
-
-            data += line;
-            if (data.empty())
-                continue;
-
-            for (size_t i = 0; i + term_size <= data.size(); ++i) {
-                callback(tlx::string_view(data.data() + i, term_size));
-            }
-            data.erase(0, data.size() - term_size + 1);
-        }
+        // block-read the sub-document region and window it in place,
+        // stopping at the next sub-document's header line
+        fasta_process_blocks(*is, term_size,
+                             /* stop_at_header */ true,
+                             /* restart_on_empty */ false, callback);
     }
 
     //! Returns name_
@@ -196,42 +188,106 @@ public:
         return path + ".cobs_cache";
     }
 
-    //! write cache file
+    //! fixed-layout header of the binary cache file
+    struct CacheHeader {
+        uint64_t magic;
+        uint64_t version;
+        uint64_t list_size;
+        uint64_t names_size;
+    };
+
+    //! flat sub-document row in the binary cache file, the name is
+    //! NUL-terminated at name_offset in the name blob behind the table
+    struct CacheEntry {
+        uint64_t size;
+        uint64_t pos_begin;
+        uint64_t name_offset;
+    };
+
+    //! cache file magic "COBSFAM1"
+    static constexpr uint64_t cache_magic = 0x434F425346414D31llu;
+    //! cache file format version
+    static constexpr uint64_t cache_version = 1;
+
+    //! write cache file: header, flat sub-document table, name blob
     void write_cache_file(std::string path) {
-        std::ofstream os(cache_path(path) + ".tmp");
-        stream_put_pod(os, index_->size());
+        std::vector<CacheEntry> entries;
+        entries.reserve(index_->size());
+        std::string names;
         for (size_t i = 0; i < index_->size(); ++i) {
-            stream_put_pod(os, (*index_)[i].size());
-            stream_put_pod(os, (*index_)[i].pos_begin());
-            os << (*index_)[i].name() << '\0';
+            entries.push_back(
+                CacheEntry { (*index_)[i].size(), (*index_)[i].pos_begin(),
+                             names.size() });
+            names += (*index_)[i].name();
+            names += '\0';
         }
+
+        CacheHeader header;
+        header.magic = cache_magic;
+        header.version = cache_version;
+        header.list_size = entries.size();
+        header.names_size = names.size();
+
+        std::ofstream os(cache_path(path) + ".tmp", std::ios::binary);
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char*>(entries.data()),
+                 entries.size() * sizeof(CacheEntry));
+        os.write(names.data(), names.size());
         fs::rename(cache_path(path) + ".tmp",
                    cache_path(path));
         LOG1 << "FastaMultifile: saved index as " << cache_path(path);
     }
 
-    //! read cache file
+    //! map the cache file, validate it, and build the sub-document list
+    //! straight from the flat table -- one mmap instead of three stream
+    //! reads per sub-document
     bool read_cache_file(std::string path) {
-        std::ifstream is(cache_path(path));
-        if (!is.good()) return false;
-        size_t list_size;
-        stream_get_pod(is, list_size);
-        LOG1 << "FastaMultifile: loading index " << cache_path(path)
-             << " [" << list_size << " documents]";
-        index_ = std::make_shared<FastaSubfileList>();
-        for (size_t i = 0; i < list_size; ++i) {
-            size_t size;
-            uint64_t pos_begin;
-            std::string name;
+        std::error_code ec;
+        uint64_t file_size = fs::file_size(cache_path(path), ec);
+        if (ec || file_size < sizeof(CacheHeader))
+            return false;
+
+        MMapPolicy policy;
+        policy.random_access = false;
+        MMapHandle map = initialize_mmap(cache_path(path), policy);
+
+        const CacheHeader* header =
+            reinterpret_cast<const CacheHeader*>(map.data);
+        bool good =
+            header->magic == cache_magic &&
+            header->version == cache_version &&
+            map.size == sizeof(CacheHeader) +
+            header->list_size * sizeof(CacheEntry) + header->names_size &&
+            // names must end on a terminator for in-place use
+            (header->names_size == 0 ||
+             map.data[map.size - 1] == '\0');
+        if (!good) {
+            destroy_mmap(map);
+            return false;
+        }
 
-            stream_get_pod(is, size);
-            stream_get_pod(is, pos_begin);
-            std::getline(is, name, '\0');
+        const CacheEntry* entries = reinterpret_cast<const CacheEntry*>(
+            map.data + sizeof(CacheHeader));
+        const char* names = reinterpret_cast<const char*>(
+            map.data + sizeof(CacheHeader) +
+            header->list_size * sizeof(CacheEntry));
 
-            index_->emplace_back(path, name, pos_begin, size,
+        LOG1 << "FastaMultifile: loading index " << cache_path(path)
+             << " [" << header->list_size << " documents]";
+        index_ = std::make_shared<FastaSubfileList>();
+        index_->reserve(header->list_size);
+        for (uint64_t i = 0; i < header->list_size; ++i) {
+            if (entries[i].name_offset >= header->names_size) {
+                destroy_mmap(map);
+                index_ = std::make_shared<FastaSubfileList>();
+                return false;
+            }
+            index_->emplace_back(path, names + entries[i].name_offset,
+                                 entries[i].pos_begin, entries[i].size,
                                  ifstream_array_);
         }
-        return is.good() && (is.get() == EOF);
+        destroy_mmap(map);
+        return true;
     }
 
     //! return number of sub-documents
@@ -14,9 +14,11 @@
 #include <vector>
 
 #include <cobs/settings.hpp>
+#include <cobs/util/fastq_block_parser.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
 #include <cobs/util/zip_stream.hpp>
+#include <cobs/util/zstd_stream.hpp>
 
 #include <tlx/container/string_view.hpp>
 #include <tlx/die.hpp>
@@ -98,6 +100,10 @@ public:
             zip_istream zis(is_);
             return compute_index(zis);
         }
+        else if (tlx::ends_with(path_, ".zst")) {
+            zstd_istream zis(is_);
+            return compute_index(zis);
+        }
         else {
             return compute_index(is_);
         }
@@ -154,33 +160,8 @@ public:
 
     template <typename Callback>
     void process_terms(std::istream& is, size_t term_size, Callback callback) {
-        std::string line;
-
-        size_t line_num = 0;
-        while (std::getline(is, line)) {
-            if (line_num % 4 == 0) {
-                if (line.size() == 0 || line[0] != '@') {
-                    die("FastqFile: line " << line_num <<
-                        " does not start with @ - " << path_);
-                }
-            }
-            else if (line_num % 4 == 1) {
-                // process terms in sequence/read line.
-                for (size_t i = 0; i + term_size <= line.size(); ++i) {
-                    callback(tlx::string_view(line.data() + i, term_size));
-                }
-            }
-            else if (line_num % 4 == 2) {
-                if (line.size() == 0 || line[0] != '+') {
-                    die("FastqFile: line " << line_num <<
-                        " does not start with + - " << path_);
-                }
-            }
-            else if (line_num % 4 == 3) {
-                // don't care about quality
-            }
-            ++line_num;
-        }
+        // block-read the records and window the sequence lines in place
+        fastq_process_blocks(is, term_size, path_, callback);
     }
 
     template <typename Callback>
@@ -190,7 +171,12 @@ public:
         die_unless(is_.good());
 
         if (tlx::ends_with(path_, ".gz")) {
-            zip_istream zis(is_);
+            // decompress on a background thread, overlapping with hashing
+            parallel_zip_istream zis(is_);
+            return process_terms(zis, term_size, callback);
+        }
+        else if (tlx::ends_with(path_, ".zst")) {
+            zstd_istream zis(is_);
             return process_terms(zis, term_size, callback);
         }
         else {
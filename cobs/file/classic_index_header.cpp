@@ -9,46 +9,125 @@
 #include <cobs/file/classic_index_header.hpp>
 #include <cobs/util/file.hpp>
 
+#include <limits>
+
 namespace cobs {
 
 const std::string ClassicIndexHeader::magic_word = "CLASSIC_INDEX";
-const uint32_t ClassicIndexHeader::version = 1;
+const uint32_t ClassicIndexHeader::version = 7;
 const std::string ClassicIndexHeader::file_extension = ".cobs_classic";
 
 uint64_t ClassicIndexHeader::row_bits() const {
-    return file_names_.size();
+    return file_names_pos_ != 0 ? num_documents_ : file_names_.size();
 }
 
 uint64_t ClassicIndexHeader::row_size() const {
-    return (file_names_.size() + 7) / 8;
+    return (row_bits() + 7) / 8;
 }
 
 void ClassicIndexHeader::serialize(std::ostream& os) const {
+    // a header with a skipped names block is query-only
+    die_unless(file_names_pos_ == 0);
+
     serialize_magic_begin(os, magic_word, version);
 
     stream_put(os, term_size_, canonicalize_,
-               (uint32_t)file_names_.size(), signature_size_, num_hashes_);
+               (uint32_t)file_names_.size(), signature_size_, num_hashes_,
+               hash_mode_, window_size_, block_rows_, sparse_rows_);
     for (const auto& file_name : file_names_) {
         os << file_name << std::endl;
     }
+    die_unless(doc_densities_.empty() ||
+               doc_densities_.size() == file_names_.size());
+    stream_put(os, (uint32_t)doc_densities_.size());
+    for (const double& density : doc_densities_) {
+        stream_put(os, density);
+    }
+
+    // pad so the payload behind the header starts on a page boundary
+    std::vector<char> padding(header_padding_size(os.tellp(), magic_word));
+    os.write(padding.data(), padding.size());
 
     serialize_magic_end(os, magic_word);
 }
 
-void ClassicIndexHeader::deserialize(std::istream& is) {
-    deserialize_magic_begin(is, magic_word, version);
+void ClassicIndexHeader::deserialize(std::istream& is, bool skip_file_names) {
+    uint32_t v = deserialize_magic_begin(is, magic_word, 1, version);
 
     uint32_t file_names_size;
     stream_get(is, term_size_, canonicalize_,
                file_names_size, signature_size_, num_hashes_);
-    file_names_.resize(file_names_size);
-    for (auto& file_name : file_names_) {
-        std::getline(is, file_name);
+    // v1 indexes predate the hash_mode field and use per-seed hashing
+    if (v >= 2)
+        stream_get(is, hash_mode_);
+    else
+        hash_mode_ = 0;
+    // v2 indexes predate minimizer subsampling and contain every k-mer
+    if (v >= 3)
+        stream_get(is, window_size_);
+    else
+        window_size_ = 1;
+    // v3 indexes predate compressed row blocks and store the matrix raw
+    if (v >= 4)
+        stream_get(is, block_rows_);
+    else
+        block_rows_ = 0;
+    // v4 indexes predate the hybrid sparse row encoding
+    if (v >= 5)
+        stream_get(is, sparse_rows_);
+    else
+        sparse_rows_ = 0;
+    num_documents_ = file_names_size;
+    file_names_.clear();
+    file_names_pos_ = 0;
+    if (skip_file_names) {
+        // only count the names: skipping to the next field still scans
+        // the block for newlines, but allocates nothing
+        file_names_pos_ = is.tellg();
+        for (uint32_t i = 0; i < file_names_size; ++i)
+            is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    else {
+        file_names_.resize(file_names_size);
+        for (auto& file_name : file_names_) {
+            std::getline(is, file_name);
+        }
+    }
+    // v6 indexes predate the per-document bit densities
+    doc_densities_.clear();
+    if (v >= 7) {
+        uint32_t densities_size;
+        stream_get(is, densities_size);
+        doc_densities_.resize(densities_size);
+        for (auto& density : doc_densities_) {
+            stream_get(is, density);
+        }
+    }
+
+    // v5 headers predate page-aligned payloads and are unpadded
+    if (v >= 6) {
+        StreamPos sp = get_stream_pos(is);
+        is.seekg(sp.curr_pos + header_padding_size(sp.curr_pos, magic_word),
+                 std::ios::beg);
     }
 
     deserialize_magic_end(is, magic_word);
 }
 
+void ClassicIndexHeader::load_file_names(const fs::path& p) {
+    if (file_names_pos_ == 0)
+        return;
+    std::ifstream ifs(p.string(), std::ios::in | std::ios::binary);
+    ifs.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+    die_unless(ifs.good());
+    ifs.seekg(file_names_pos_, std::ios::beg);
+    file_names_.resize(num_documents_);
+    for (auto& file_name : file_names_) {
+        std::getline(ifs, file_name);
+    }
+    file_names_pos_ = 0;
+}
+
 void ClassicIndexHeader::write_file(std::ostream& os,
                                     const std::vector<uint8_t>& data) {
     os.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
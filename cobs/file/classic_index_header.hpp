@@ -18,14 +18,47 @@ class ClassicIndexHeader
 public:
     //! k-mer or q-gram size = term size
     uint32_t term_size_;
-    //! 0 = don't modify k-mers, 1 = canonicalize
+    //! 0 = don't modify k-mers, 1 = canonicalize, 2 = canonicalize and
+    //! hash the 2-bit packed k-mer instead of its text form (such
+    //! indexes are incompatible with text-hashed ones)
     uint8_t canonicalize_;
     //! size of Bloom filters in bits = number of rows of matrix
     uint64_t signature_size_;
     //! number of hashes per term, usually 1
     uint64_t num_hashes_;
+    //! hashing scheme: 0 = one XXH64 evaluation per hash function,
+    //! 1 = double hashing h_i = h1 + i * h2 from two evaluations (v2)
+    uint8_t hash_mode_ = 0;
+    //! minimizer window size: of every window of this many consecutive
+    //! k-mers only the window minimizer was indexed, and queries must
+    //! subsample the same way; 1 = every k-mer (v3)
+    uint64_t window_size_ = 1;
+    //! rows per zstd-compressed row block, or 0 if the bit matrix is
+    //! stored raw; compressed indexes carry a block offset table of
+    //! num_blocks + 1 uint64_t between the header and the blocks (v4)
+    uint64_t block_rows_ = 0;
+    //! 1 = hybrid sparse row encoding: each row is stored either dense
+    //! or as an array of set-bit positions, whichever is smaller, behind
+    //! a row offset table with the encoding flagged in the offset's top
+    //! bit; 0 = plain dense matrix (v5)
+    uint8_t sparse_rows_ = 0;
+
+    //! flag bit marking a sparse row in the v5 row offset table
+    static constexpr uint64_t sparse_row_flag = uint64_t(1) << 63;
     //! list of document file names
     std::vector<std::string> file_names_;
+    //! number of documents, kept in sync with file_names_ by
+    //! deserialize() and authoritative while the names block is skipped
+    uint32_t num_documents_ = 0;
+    //! stream offset of the skipped file names block, see
+    //! deserialize(is, skip_file_names); 0 once file_names_ is loaded
+    uint64_t file_names_pos_ = 0;
+    //! per-document bit density: fraction of the signature's bits set in
+    //! the document's Bloom filter, one entry per file name. counted in
+    //! one pass during construction and used to correct scores for each
+    //! document's expected false positive count; empty when the index
+    //! predates the field (v7)
+    std::vector<double> doc_densities_;
 
 public:
     static const std::string magic_word;
@@ -40,7 +73,17 @@ public:
     uint64_t row_size() const;
 
     void serialize(std::ostream& os) const;
-    void deserialize(std::istream& is);
+
+    //! deserialize the header; with skip_file_names the document names
+    //! are only counted and skipped over instead of allocating one
+    //! std::string each, so query tools open large indexes without
+    //! paying for a name table they may never format results from --
+    //! load_file_names() reads the block on demand
+    void deserialize(std::istream& is, bool skip_file_names = false);
+
+    //! read a file names block skipped by deserialize(is, true) from the
+    //! index file, no-op when the names are already loaded
+    void load_file_names(const fs::path& p);
 
     void write_file(std::ostream& os, const std::vector<uint8_t>& data);
     void write_file(const fs::path& p, const std::vector<uint8_t>& data);
@@ -8,17 +8,27 @@
 
 #include <cobs/file/compact_index_header.hpp>
 
+#include <tlx/math/round_up.hpp>
+
 namespace cobs {
 
 const std::string CompactIndexHeader::magic_word = "COMPACT_INDEX";
-const uint32_t CompactIndexHeader::version = 1;
+const uint32_t CompactIndexHeader::version = 4;
 const std::string CompactIndexHeader::file_extension = ".cobs_compact";
 
 CompactIndexHeader::CompactIndexHeader(uint64_t page_size)
     : page_size_(page_size) { }
 
 size_t CompactIndexHeader::padding_size(uint64_t curr_stream_pos) const {
-    return (page_size_ - ((curr_stream_pos + CompactIndexHeader::magic_word.size()) % page_size_)) % page_size_;
+    uint64_t align = payload_alignment_ != 0 ? payload_alignment_ : page_size_;
+    return (align - ((curr_stream_pos + CompactIndexHeader::magic_word.size()) % align)) % align;
+}
+
+uint64_t CompactIndexHeader::padded_subindex_size(size_t i) const {
+    uint64_t size = page_size_ * parameters_[i].signature_size;
+    if (payload_alignment_ != 0)
+        size = tlx::round_up(size, payload_alignment_);
+    return size;
 }
 
 void CompactIndexHeader::serialize(std::ostream& os) const {
@@ -26,7 +36,7 @@ void CompactIndexHeader::serialize(std::ostream& os) const {
 
     stream_put(os, term_size_, canonicalize_,
                (uint32_t)parameters_.size(), (uint32_t)file_names_.size(),
-               page_size_);
+               page_size_, hash_mode_, window_size_, payload_alignment_);
     os.flush();
     for (const auto& p : parameters_) {
         cobs::stream_put(os, p.signature_size, p.num_hashes);
@@ -42,12 +52,27 @@ void CompactIndexHeader::serialize(std::ostream& os) const {
 }
 
 void CompactIndexHeader::deserialize(std::istream& is) {
-    deserialize_magic_begin(is, magic_word, version);
+    uint32_t v = deserialize_magic_begin(is, magic_word, 1, version);
 
     uint32_t parameters_size;
     uint32_t file_names_size;
     stream_get(is, term_size_, canonicalize_,
                parameters_size, file_names_size, page_size_);
+    // v1 indexes predate the hash_mode field and use per-seed hashing
+    if (v >= 2)
+        stream_get(is, hash_mode_);
+    else
+        hash_mode_ = 0;
+    // v2 indexes predate minimizer subsampling and contain every k-mer
+    if (v >= 3)
+        stream_get(is, window_size_);
+    else
+        window_size_ = 1;
+    // v3 indexes predate aligned payloads and pad to page_size_ only
+    if (v >= 4)
+        stream_get(is, payload_alignment_);
+    else
+        payload_alignment_ = 0;
     parameters_.resize(parameters_size);
     for (auto& p : parameters_) {
         stream_get(is, p.signature_size, p.num_hashes);
@@ -75,6 +100,9 @@ void CompactIndexHeader::read_file(std::istream& is,
         std::vector<uint8_t> d(data_size);
         is.read(reinterpret_cast<char*>(d.data()), data_size);
         data[i] = std::move(d);
+        // skip the alignment padding behind the subindex
+        if (padded_subindex_size(i) != data_size)
+            is.seekg(padded_subindex_size(i) - data_size, std::ios::cur);
     }
 }
 
@@ -23,16 +23,34 @@ public:
 
     //! k-mer or q-gram size = term size
     uint32_t term_size_;
-    //! 0 = don't modify k-mers, 1 = canonicalize
+    //! 0 = don't modify k-mers, 1 = canonicalize, 2 = canonicalize and
+    //! hash the 2-bit packed k-mer instead of its text form (such
+    //! indexes are incompatible with text-hashed ones)
     uint8_t canonicalize_;
+    //! hashing scheme: 0 = one XXH64 evaluation per hash function,
+    //! 1 = double hashing h_i = h1 + i * h2 from two evaluations (v2)
+    uint8_t hash_mode_ = 0;
+    //! minimizer window size: of every window of this many consecutive
+    //! k-mers only the window minimizer was indexed, and queries must
+    //! subsample the same way; 1 = every k-mer (v3)
+    uint64_t window_size_ = 1;
     //! parameters of subindices
     std::vector<parameter> parameters_;
     //! list of document file names
     std::vector<std::string> file_names_;
     //! size of each subindex in bytes
     uint64_t page_size_;
+    //! alignment of the payload start and of every subindex's start in
+    //! the file: 0 = legacy layout padded to page_size_ only. aligned
+    //! page construction sets this to the OS page or hugepage size so no
+    //! page gather straddles a memory page and large mappings can be
+    //! hugepage-backed (v4)
+    uint64_t payload_alignment_ = 0;
 
     size_t padding_size(uint64_t curr_stream_pos) const;
+    //! bytes of subindex i in the file including its trailing alignment
+    //! padding
+    uint64_t padded_subindex_size(size_t i) const;
 
 public:
     static const std::string magic_word;
@@ -28,6 +28,23 @@ void check_magic_word(std::istream& is, const std::string& magic_word) {
     assert_throw<FileIOException>(is.good(), "input filestream broken");
 }
 
+//! alignment of the index payload behind a padded header: 4 KiB so the
+//! bit matrix starts on a page boundary, giving page-aligned mmap row
+//! addresses, clean O_DIRECT reads, and hugepage-friendly mappings
+static const uint64_t header_page_alignment = 4096;
+
+//! number of zero padding bytes to insert at curr_stream_pos such that
+//! the payload behind the closing magic word starts at a
+//! header_page_alignment boundary
+static inline
+size_t header_padding_size(uint64_t curr_stream_pos,
+                           const std::string& magic_word) {
+    return (header_page_alignment
+            - ((curr_stream_pos + magic_word.size())
+               % header_page_alignment))
+           % header_page_alignment;
+}
+
 static inline
 void serialize_magic_begin(
     std::ostream& os, const std::string& magic_word, const uint32_t& version) {
@@ -52,6 +69,20 @@ void deserialize_magic_begin(
     assert_throw<FileIOException>(v == version, "invalid file version");
 }
 
+//! variant accepting a range of format versions, returns the version read
+static inline
+uint32_t deserialize_magic_begin(
+    std::istream& is, const std::string& magic_word,
+    const uint32_t& min_version, const uint32_t& max_version) {
+    check_magic_word(is, "COBS:");
+    check_magic_word(is, magic_word);
+    uint32_t v;
+    stream_get(is, v);
+    assert_throw<FileIOException>(v >= min_version && v <= max_version,
+                                  "invalid file version");
+    return v;
+}
+
 static inline
 void deserialize_magic_end(
     std::istream& is, const std::string& magic_word) {
@@ -0,0 +1,88 @@
+/*******************************************************************************
+ * cobs/file/shards_header.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/file/classic_index_header.hpp>
+#include <cobs/file/compact_index_header.hpp>
+#include <cobs/file/shards_header.hpp>
+#include <cobs/util/file.hpp>
+
+namespace cobs {
+
+const std::string ShardsHeader::magic_word = "SHARDS";
+const uint32_t ShardsHeader::version = 1;
+const std::string ShardsHeader::file_extension = ".cobs_shards";
+
+ShardsHeader ShardsHeader::scan(const std::vector<fs::path>& members) {
+    ShardsHeader sh;
+    for (const fs::path& p : members) {
+        Shard s;
+        s.path_ = p.string();
+        if (file_has_header<ClassicIndexHeader>(p)) {
+            ClassicIndexHeader h = deserialize_header<ClassicIndexHeader>(p);
+            s.num_documents_ = h.file_names_.size();
+            s.term_size_ = h.term_size_;
+            s.canonicalize_ = h.canonicalize_;
+            s.signature_size_ = h.signature_size_;
+            s.num_hashes_ = h.num_hashes_;
+        }
+        else if (file_has_header<CompactIndexHeader>(p)) {
+            CompactIndexHeader h = deserialize_header<CompactIndexHeader>(p);
+            s.num_documents_ = h.file_names_.size();
+            s.term_size_ = h.term_size_;
+            s.canonicalize_ = h.canonicalize_;
+            // compact subindex batches have individual parameters
+            s.signature_size_ = 0;
+            s.num_hashes_ = 0;
+        }
+        else {
+            die("ShardsHeader: " << p << " is not a classic or compact "
+                "COBS index");
+        }
+        sh.shards_.push_back(s);
+    }
+    return sh;
+}
+
+uint64_t ShardsHeader::num_documents() const {
+    uint64_t total = 0;
+    for (const Shard& s : shards_)
+        total += s.num_documents_;
+    return total;
+}
+
+void ShardsHeader::serialize(std::ostream& os) const {
+    serialize_magic_begin(os, magic_word, version);
+
+    stream_put(os, (uint32_t)shards_.size());
+    for (const Shard& s : shards_) {
+        stream_put(os, s.num_documents_, s.term_size_, s.canonicalize_,
+                   s.signature_size_, s.num_hashes_);
+        os << s.path_ << std::endl;
+    }
+
+    serialize_magic_end(os, magic_word);
+}
+
+void ShardsHeader::deserialize(std::istream& is) {
+    deserialize_magic_begin(is, magic_word, version);
+
+    uint32_t shards_size;
+    stream_get(is, shards_size);
+    shards_.resize(shards_size);
+    for (Shard& s : shards_) {
+        stream_get(is, s.num_documents_, s.term_size_, s.canonicalize_,
+                   s.signature_size_, s.num_hashes_);
+        std::getline(is, s.path_);
+    }
+
+    deserialize_magic_end(is, magic_word);
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * cobs/file/shards_header.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_FILE_SHARDS_HEADER_HEADER
+#define COBS_FILE_SHARDS_HEADER_HEADER
+
+#include <cobs/file/header.hpp>
+
+namespace cobs {
+
+/*!
+ * Manifest describing a set of index shards opened as one logical index.
+ * The file lists the member index files together with metadata cached
+ * from their headers, so tools can report totals and check compatibility
+ * without touching every shard. ClassicSearch(std::string) detects the
+ * manifest by its magic word and constructs all member search files in
+ * parallel, each shard contributing its documents to the combined score
+ * array in manifest order.
+ */
+class ShardsHeader
+{
+public:
+    //! one member index of the sharded logical index
+    struct Shard {
+        //! path to the member index file; relative paths are resolved
+        //! against the manifest's own directory when opening
+        std::string path_;
+        //! number of documents in the member, cached from its header
+        uint32_t num_documents_;
+        //! k-mer size of the member index
+        uint32_t term_size_;
+        //! canonicalization mode of the member index
+        uint8_t canonicalize_;
+        //! Bloom filter rows of the member; 0 for compact members, whose
+        //! signature sizes vary per subindex batch
+        uint64_t signature_size_;
+        //! hashes per term of the member; 0 for compact members
+        uint64_t num_hashes_;
+    };
+
+    //! member indexes in score array order
+    std::vector<Shard> shards_;
+
+public:
+    static const std::string magic_word;
+    static const uint32_t version;
+    static const std::string file_extension;
+
+    ShardsHeader() = default;
+
+    //! build a manifest by reading the header of every member index;
+    //! dies if a member is neither a classic nor a compact index
+    static ShardsHeader scan(const std::vector<fs::path>& members);
+
+    //! total number of documents over all shards
+    uint64_t num_documents() const;
+
+    void serialize(std::ostream& os) const;
+    void deserialize(std::istream& is);
+};
+
+} // namespace cobs
+
+#endif // !COBS_FILE_SHARDS_HEADER_HEADER
+
+/******************************************************************************/
@@ -14,7 +14,6 @@
 #include <cassert>
 #include <ostream>
 #include <string>
-#include <unordered_map>
 
 #include <cobs/util/misc.hpp>
 #include <cobs/util/query.hpp>
@@ -23,15 +22,22 @@
 
 namespace cobs {
 
-static inline
-uint32_t chars_to_int(char c1, char c2, char c3, char c4) {
-    return uint32_t(0) | (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
-}
-
 extern const char* kmer_byte_to_base_pairs[256];
-extern const std::unordered_map<unsigned int, uint8_t> kmer_bps_to_uint8_t;
+extern const uint8_t kmer_base_to_code[256];
 extern uint8_t kmer_mirror_pairs[256];
 
+//! pack four base pair characters into one byte of four 2-bit codes,
+//! chars[0] in the most significant pair. Branchless table lookups
+//! instead of the former unordered_map probe per four bases.
+static inline
+uint8_t kmer_pack_bps(const char* chars) {
+    return uint8_t(
+        (kmer_base_to_code[uint8_t(chars[0])] << 6) |
+        (kmer_base_to_code[uint8_t(chars[1])] << 4) |
+        (kmer_base_to_code[uint8_t(chars[2])] << 2) |
+        kmer_base_to_code[uint8_t(chars[3])]);
+}
+
 template <unsigned int N>
 class KMer : public std::array<uint8_t, (N + 3) / 4>
 {
@@ -54,14 +60,17 @@ public:
     void init(const char* chars) {
         for (int i = N - 4; i >= -3; i -= 4) {
             if (i >= 0) {
-                data()[(N - (i + 4)) / 4] =
-                    kmer_bps_to_uint8_t.at(*((uint32_t*)(chars + i)));
+                data()[(N - (i + 4)) / 4] = kmer_pack_bps(chars + i);
             }
             else {
-                char c2 = i < -1 ? 'A' : chars[i + 1];
-                char c3 = i < -2 ? 'A' : chars[i + 2];
-                data()[size - 1] = kmer_bps_to_uint8_t.at(
-                    chars_to_int(chars[i + 3], c3, c2, 'A'));
+                // partial first byte, 'A' pads the unused high pairs
+                char head[4] = {
+                    'A',
+                    i < -1 ? 'A' : chars[i + 1],
+                    i < -2 ? 'A' : chars[i + 2],
+                    chars[i + 3]
+                };
+                data()[size - 1] = kmer_pack_bps(head);
             }
         }
     }
@@ -106,13 +115,17 @@ public:
         for (int i = kmer_size_int - 4; i >= -3; i -= 4) {
             if (i >= 0) {
                 kmer_data[(kmer_size_int - (i + 4)) / 4] =
-                    kmer_bps_to_uint8_t.at(*((uint32_t*)(chars + i)));
+                    kmer_pack_bps(chars + i);
             }
             else {
-                char c2 = i < -1 ? 'A' : chars[i + 1];
-                char c3 = i < -2 ? 'A' : chars[i + 2];
-                kmer_data[data_size(kmer_size) - 1] =
-                    kmer_bps_to_uint8_t.at(chars_to_int(chars[i + 3], c3, c2, 'A'));
+                // partial first byte, 'A' pads the unused high pairs
+                char head[4] = {
+                    'A',
+                    i < -1 ? 'A' : chars[i + 1],
+                    i < -2 ? 'A' : chars[i + 2],
+                    chars[i + 3]
+                };
+                kmer_data[data_size(kmer_size) - 1] = kmer_pack_bps(head);
             }
         }
     }
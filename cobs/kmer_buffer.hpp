@@ -12,6 +12,7 @@
 
 #include <cobs/file/kmer_buffer_header.hpp>
 #include <cobs/kmer.hpp>
+#include <cobs/util/query.hpp>
 
 #include <algorithm>
 #include <ostream>
@@ -86,6 +87,61 @@ void KMerBuffer<N>::print(std::ostream& ostream) const {
     }
 }
 
+/*!
+ * Read-only mmap view of a serialized KMerBuffer (.cobs_doc) file. The
+ * header is parsed with KMerBufferHeader, then the packed k-mer array is
+ * used in place from the mapping: processing starts without reading or
+ * copying the document, and the OS pages the data in on demand.
+ */
+template <unsigned int N>
+class KMerBufferMMap
+{
+public:
+    KMerBufferMMap(const fs::path& p, KMerBufferHeader& h) {
+        std::ifstream ifs(p.string(), std::ios::in | std::ios::binary);
+        ifs.exceptions(
+            std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+        h.deserialize(ifs);
+        die_unless(N == h.kmer_size());
+        uint64_t offset = ifs.tellg();
+        ifs.close();
+
+        MMapPolicy policy;
+        policy.random_access = false;
+        map_ = initialize_mmap(p, policy);
+        die_unless(map_.size >= offset);
+        data_ = reinterpret_cast<const KMer<N>*>(map_.data + offset);
+        size_ = (map_.size - offset) / KMer<N>::size;
+    }
+
+    ~KMerBufferMMap() {
+        destroy_mmap(map_);
+    }
+
+    //! non-copyable: holds the file mapping
+    KMerBufferMMap(const KMerBufferMMap&) = delete;
+    //! non-copyable: holds the file mapping
+    KMerBufferMMap& operator = (const KMerBufferMMap&) = delete;
+
+    //! pointer to the packed k-mer array inside the mapping
+    const KMer<N> * data() const {
+        return data_;
+    }
+
+    const KMer<N>& operator [] (size_t i) const {
+        return data_[i];
+    }
+
+    size_t num_kmers() const {
+        return size_;
+    }
+
+private:
+    MMapHandle map_ { -1, nullptr, 0 };
+    const KMer<N>* data_ = nullptr;
+    size_t size_ = 0;
+};
+
 } // namespace cobs
 
 #endif // !COBS_KMER_BUFFER_HEADER
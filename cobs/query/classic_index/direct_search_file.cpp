@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * cobs/query/classic_index/direct_search_file.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/query/classic_index/direct_search_file.hpp>
+#include <cobs/util/error_handling.hpp>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <tlx/math/round_up.hpp>
+
+namespace cobs {
+
+ClassicIndexDirectSearchFile::ClassicIndexDirectSearchFile(const fs::path& path)
+    : ClassicIndexSearchFile(path),
+      // one pooled buffer covers the aligned span of any single row read
+      pool_(tlx::round_up(header_.row_size(), get_page_size())
+            + get_page_size())
+{
+    if (header_.block_rows_ != 0)
+        die("ClassicIndexDirectSearchFile: " << path << " is "
+            "block-compressed, open it with the zstd backend");
+    if (header_.sparse_rows_ != 0)
+        die("ClassicIndexDirectSearchFile: " << path << " is "
+            "sparse-encoded, open it with the mmap backend");
+    fd_ = open_file(path, O_RDONLY | O_DIRECT);
+}
+
+ClassicIndexDirectSearchFile::~ClassicIndexDirectSearchFile() {
+    close_file(fd_);
+}
+
+void ClassicIndexDirectSearchFile::read_from_disk(
+    const std::vector<size_t>& hashes, uint8_t* rows,
+    size_t begin, size_t size, size_t buffer_size)
+{
+    die_unless(begin + size <= header_.row_size());
+
+    size_t page_size = get_page_size();
+    uint8_t* bounce = pool_.acquire();
+
+    for (size_t i = 0; i < hashes.size(); i++) {
+        size_t offset =
+            stream_pos_.curr_pos + begin
+            + (hashes[i] % header_.signature_size_) * header_.row_size();
+
+        // O_DIRECT requires sector-aligned offsets and lengths, so read the
+        // aligned span covering the row slice and copy it out
+        size_t aligned_begin = offset - offset % page_size;
+        size_t aligned_end = tlx::round_up(offset + size, page_size);
+
+        ssize_t rd = pread(fd_, bounce, aligned_end - aligned_begin,
+                           aligned_begin);
+        if (rd < 0) {
+            exit_error_errno("O_DIRECT pread error");
+        }
+        // the last aligned block may extend past the end of the file, but
+        // the read must cover the requested row slice
+        die_unless(static_cast<size_t>(rd) >= offset - aligned_begin + size);
+
+        std::copy(bounce + (offset - aligned_begin),
+                  bounce + (offset - aligned_begin) + size,
+                  rows + i * buffer_size);
+    }
+
+    pool_.release(bounce);
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,43 @@
+/*******************************************************************************
+ * cobs/query/classic_index/direct_search_file.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_QUERY_CLASSIC_INDEX_DIRECT_SEARCH_FILE_HEADER
+#define COBS_QUERY_CLASSIC_INDEX_DIRECT_SEARCH_FILE_HEADER
+
+#include <cobs/query/classic_index/search_file.hpp>
+#include <cobs/util/aligned_buffer_pool.hpp>
+
+namespace cobs {
+
+/*!
+ * Classic index search file backend reading rows with O_DIRECT pread calls,
+ * bypassing the page cache. Intended for one-off cold-cache scans of
+ * indexes much larger than RAM, where faulting through an mmap would evict
+ * cached data of co-tenant workloads. Rows are gathered through a pool of
+ * page-aligned bounce buffers since row offsets are not sector-aligned.
+ */
+class ClassicIndexDirectSearchFile : public ClassicIndexSearchFile
+{
+private:
+    int fd_;
+    AlignedBufferPool pool_;
+
+protected:
+    void read_from_disk(const std::vector<size_t>& hashes, uint8_t* rows,
+                        size_t begin, size_t size, size_t buffer_size) override;
+
+public:
+    explicit ClassicIndexDirectSearchFile(const fs::path& path);
+    ~ClassicIndexDirectSearchFile();
+};
+
+} // namespace cobs
+
+#endif // !COBS_QUERY_CLASSIC_INDEX_DIRECT_SEARCH_FILE_HEADER
+
+/******************************************************************************/
@@ -7,36 +7,154 @@
  ******************************************************************************/
 
 #include <cobs/query/classic_index/mmap_search_file.hpp>
+#include <cobs/settings.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
 #include <cobs/util/query.hpp>
 #include <cstring>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 namespace cobs {
 
-ClassicIndexMMapSearchFile::ClassicIndexMMapSearchFile(const fs::path& path)
+ClassicIndexMMapSearchFile::ClassicIndexMMapSearchFile(
+    const fs::path& path, const MMapPolicy& policy)
     : ClassicIndexSearchFile(path) {
-    handle_ = initialize_mmap(path);
+    if (header_.block_rows_ != 0)
+        die("ClassicIndexMMapSearchFile: " << path << " is "
+            "block-compressed, open it with the zstd backend");
+    handle_ = initialize_mmap(path, policy);
     data_ = handle_.data + stream_pos_.curr_pos;
+    // the pager manages a real mapping, not the RAM copy made by
+    // gopt_load_complete_index
+    if (policy.window_budget_bytes != 0 && !gopt_load_complete_index) {
+        pager_ = std::make_unique<MMapPager>(
+            handle_, policy.window_size_bytes, policy.window_budget_bytes);
+    }
 }
 
 ClassicIndexMMapSearchFile::~ClassicIndexMMapSearchFile() {
     destroy_mmap(handle_);
 }
 
+bool ClassicIndexMMapSearchFile::memory_resident() const {
+    // with gopt_load_complete_index the "mapping" is a plain RAM copy, so
+    // the expansion kernels can consume rows in place; sparse-encoded
+    // rows must always be decoded through read_from_disk()
+    return gopt_load_complete_index && !header_.sparse_rows_;
+}
+
+const uint8_t * ClassicIndexMMapSearchFile::row_data(size_t hash) const {
+    return data_ + (hash % header_.signature_size_) * header_.row_size();
+}
+
+//! how many rows ahead of the copy loop to issue software prefetches;
+//! enough to cover a TLB walk plus a memory round trip on current cores
+static const size_t gather_prefetch_distance = 8;
+
+//! copy one row into the gather buffer. the rows buffer is written here
+//! once and read once by the expansion kernels, so bypass the cache with
+//! non-temporal stores when the destination allows it.
+static inline
+void gather_copy_row(const uint8_t* src, uint8_t* dst, size_t size) {
+#if defined(__SSE2__)
+    if (reinterpret_cast<uintptr_t>(dst) % 16 == 0) {
+        size_t k = 0;
+        for ( ; k + 64 <= size; k += 64) {
+            __m128i v0 = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(src + k));
+            __m128i v1 = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(src + k + 16));
+            __m128i v2 = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(src + k + 32));
+            __m128i v3 = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(src + k + 48));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + k), v0);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + k + 16), v1);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + k + 32), v2);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + k + 48), v3);
+        }
+        std::copy(src + k, src + size, dst + k);
+        return;
+    }
+#endif
+    std::copy(src, src + size, dst);
+}
+
 void ClassicIndexMMapSearchFile::read_from_disk(
     const std::vector<size_t>& hashes, uint8_t* rows,
     size_t begin, size_t size, size_t buffer_size)
 {
     die_unless(begin + size <= header_.row_size());
+
+    if (header_.sparse_rows_) {
+        // hybrid encoding: the mapping holds a row offset table followed
+        // by per-row payloads, dense bytes or set-bit position arrays;
+        // sparse rows are decoded straight into the gather buffer
+        const uint64_t* offsets = reinterpret_cast<const uint64_t*>(data_);
+        const uint8_t* payload =
+            data_ + (header_.signature_size_ + 1) * sizeof(uint64_t);
+
+        for (size_t i = 0; i < hashes.size(); i++) {
+            uint64_t row = hashes[i] % header_.signature_size_;
+            uint64_t entry = offsets[row];
+            uint64_t off = entry & ~ClassicIndexHeader::sparse_row_flag;
+            uint64_t end =
+                offsets[row + 1] & ~ClassicIndexHeader::sparse_row_flag;
+            uint8_t* dst = rows + i * buffer_size;
+
+            if (pager_)
+                pager_->access(payload + off - handle_.data);
+
+            if ((entry & ClassicIndexHeader::sparse_row_flag) == 0) {
+                std::copy(payload + off + begin, payload + off + begin + size,
+                          dst);
+                continue;
+            }
+
+            std::memset(dst, 0, size);
+            const uint32_t* pos =
+                reinterpret_cast<const uint32_t*>(payload + off);
+            size_t count = (end - off) / sizeof(uint32_t);
+            for (size_t k = 0; k < count; k++) {
+                size_t byte = pos[k] / 8;
+                if (byte >= begin && byte < begin + size)
+                    dst[byte - begin] |= uint8_t(1) << (pos[k] % 8);
+            }
+        }
+        return;
+    }
+
+    // resolve all row addresses first: the modulo and the page walk of
+    // the first touch are what the naive gather loop stalled on
+    std::vector<const uint8_t*> addr(hashes.size());
     for (size_t i = 0; i < hashes.size(); i++) {
-        auto data_8 =
-            data_ + begin
-            + (hashes[i] % header_.signature_size_) * header_.row_size();
-        auto rows_8 = rows + i * buffer_size;
-        // std::memcpy(rows_8, data_8, size);
-        std::copy(data_8, data_8 + size, rows_8);
+        addr[i] = data_ + begin
+                  + (hashes[i] % header_.signature_size_) * header_.row_size();
+    }
+    if (pager_) {
+        for (size_t i = 0; i < addr.size(); i++)
+            pager_->access(addr[i] - handle_.data);
+    }
+    for (size_t i = 0; i < std::min(gather_prefetch_distance, addr.size());
+         i++) {
+        __builtin_prefetch(addr[i], /* rw */ 0, /* locality */ 0);
+        __builtin_prefetch(addr[i] + 64, 0, 0);
+    }
+
+    for (size_t i = 0; i < addr.size(); i++) {
+        if (i + gather_prefetch_distance < addr.size()) {
+            __builtin_prefetch(addr[i + gather_prefetch_distance], 0, 0);
+            __builtin_prefetch(addr[i + gather_prefetch_distance] + 64, 0, 0);
+        }
+        gather_copy_row(addr[i], rows + i * buffer_size, size);
     }
+#if defined(__SSE2__)
+    // order the streamed rows before the compute stage reads them
+    _mm_sfence();
+#endif
 }
 
 } // namespace cobs
@@ -10,6 +10,9 @@
 #define COBS_QUERY_CLASSIC_INDEX_MMAP_SEARCH_FILE_HEADER
 
 #include <cobs/query/classic_index/search_file.hpp>
+#include <cobs/util/mmap_pager.hpp>
+
+#include <memory>
 
 namespace cobs {
 
@@ -18,13 +21,20 @@ class ClassicIndexMMapSearchFile : public ClassicIndexSearchFile
 private:
     MMapHandle handle_;
     uint8_t* data_;
+    //! optional windowed pager evicting cold index windows explicitly,
+    //! enabled via MMapPolicy::window_budget_bytes
+    std::unique_ptr<MMapPager> pager_;
 
 protected:
     void read_from_disk(const std::vector<size_t>& hashes, uint8_t* rows,
                         size_t begin, size_t size, size_t buffer_size) override;
 
+    bool memory_resident() const final;
+    const uint8_t * row_data(size_t hash) const final;
+
 public:
-    explicit ClassicIndexMMapSearchFile(const fs::path& path);
+    explicit ClassicIndexMMapSearchFile(const fs::path& path,
+                                        const MMapPolicy& policy = MMapPolicy());
     ~ClassicIndexMMapSearchFile();
 };
 
@@ -12,12 +12,25 @@
 
 namespace cobs {
 
-ClassicIndexSearchFile::ClassicIndexSearchFile(const fs::path& path) {
+ClassicIndexSearchFile::ClassicIndexSearchFile(const fs::path& path)
+    : path_(path) {
     std::ifstream ifs;
-    header_ = deserialize_header<ClassicIndexHeader>(ifs, path);
+    ifs.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+    ifs.open(path.string(), std::ios::in | std::ios::binary);
+    die_unless(ifs.good());
+    // skip the document names: queries only need them when formatting
+    // results, so file_names() reads them back on first use
+    header_.deserialize(ifs, /* skip_file_names */ true);
     stream_pos_ = get_stream_pos(ifs);
 }
 
+const std::vector<std::string>& ClassicIndexSearchFile::file_names() const {
+    std::call_once(file_names_once_, [&]() {
+        header_.load_file_names(path_);
+    });
+    return header_.file_names_;
+}
+
 uint64_t ClassicIndexSearchFile::counts_size() const {
     return 8 * header_.row_size();
 }
@@ -12,6 +12,8 @@
 #include <cobs/file/classic_index_header.hpp>
 #include <cobs/query/index_file.hpp>
 
+#include <mutex>
+
 namespace cobs {
 
 class ClassicIndexSearchFile : public IndexSearchFile
@@ -22,14 +24,28 @@ protected:
     uint32_t term_size() const final { return header_.term_size_; }
     uint8_t canonicalize() const final { return header_.canonicalize_; }
     uint64_t num_hashes() const final { return header_.num_hashes_; }
+    uint8_t hash_mode() const final { return header_.hash_mode_; }
+    uint64_t window_size() const final { return header_.window_size_; }
     uint64_t row_size() const final { return header_.row_size(); }
     uint64_t page_size() const final { return 1; }
     uint64_t counts_size() const final;
-    const std::vector<std::string>& file_names() const override {
-        return header_.file_names_;
+    uint64_t num_documents() const final { return header_.row_bits(); }
+
+    //! the document names, read from the index file on first use: the
+    //! constructor skips the name block so opening a large index does
+    //! not deserialize one std::string per document up front
+    const std::vector<std::string>& file_names() const override;
+
+    const std::vector<double>& doc_densities() const final {
+        return header_.doc_densities_;
     }
 
-    ClassicIndexHeader header_;
+    //! mutable only for the lazy name load in file_names() const
+    mutable ClassicIndexHeader header_;
+
+private:
+    fs::path path_;
+    mutable std::once_flag file_names_once_;
 
 public:
     virtual ~ClassicIndexSearchFile() = default;
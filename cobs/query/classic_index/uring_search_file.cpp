@@ -0,0 +1,151 @@
+/*******************************************************************************
+ * cobs/query/classic_index/uring_search_file.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/query/classic_index/uring_search_file.hpp>
+#include <cobs/util/error_handling.hpp>
+#include <cobs/util/file.hpp>
+#include <cobs/util/uring.hpp>
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace cobs {
+
+ClassicIndexUringSearchFile::ClassicIndexUringSearchFile(const fs::path& path)
+    : ClassicIndexSearchFile(path)
+{
+    if (header_.block_rows_ != 0)
+        die("ClassicIndexUringSearchFile: " << path << " is "
+            "block-compressed, open it with the zstd backend");
+    if (header_.sparse_rows_ != 0)
+        die("ClassicIndexUringSearchFile: " << path << " is "
+            "sparse-encoded, open it with the mmap backend");
+    fd_ = open_file(path, O_RDONLY);
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = io_uring_setup(/* entries */ 1024, &params);
+    if (ring_fd_ < 0) {
+        exit_error_errno("io_uring_setup error");
+    }
+    sq_entries_ = params.sq_entries;
+
+    sq_ring_bytes_ =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    sq_ring_ptr_ = mmap(nullptr, sq_ring_bytes_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ptr_ == MAP_FAILED) {
+        exit_error_errno("io_uring sq ring mmap error");
+    }
+
+    cq_ring_bytes_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    cq_ring_ptr_ = mmap(nullptr, cq_ring_bytes_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ptr_ == MAP_FAILED) {
+        exit_error_errno("io_uring cq ring mmap error");
+    }
+
+    sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(
+        mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+        exit_error_errno("io_uring sqes mmap error");
+    }
+
+    uint8_t* sq_ring = static_cast<uint8_t*>(sq_ring_ptr_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+
+    uint8_t* cq_ring = static_cast<uint8_t*>(cq_ring_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+
+    // register the index file so submissions reference it as fixed file 0
+    if (io_uring_register(ring_fd_, IORING_REGISTER_FILES, &fd_, 1) < 0) {
+        exit_error_errno("io_uring_register files error");
+    }
+}
+
+ClassicIndexUringSearchFile::~ClassicIndexUringSearchFile() {
+    munmap(sqes_, sqes_bytes_);
+    munmap(cq_ring_ptr_, cq_ring_bytes_);
+    munmap(sq_ring_ptr_, sq_ring_bytes_);
+    close(ring_fd_);
+    close_file(fd_);
+}
+
+void ClassicIndexUringSearchFile::read_from_disk(
+    const std::vector<size_t>& hashes, uint8_t* rows,
+    size_t begin, size_t size, size_t buffer_size)
+{
+    die_unless(begin + size <= header_.row_size());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    size_t prepared = 0, submitted = 0, completed = 0;
+    while (completed < hashes.size()) {
+        // fill the submission queue with one read per hash row, up to the
+        // ring's capacity
+        unsigned tail = *sq_tail_;
+        while (prepared < hashes.size() &&
+               prepared - completed < sq_entries_)
+        {
+            unsigned index = tail & *sq_mask_;
+            io_uring_sqe* sqe = sqes_ + index;
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_READ;
+            sqe->flags = IOSQE_FIXED_FILE;
+            sqe->fd = 0;
+            sqe->addr = reinterpret_cast<uint64_t>(
+                rows + prepared * buffer_size);
+            sqe->len = size;
+            sqe->off =
+                stream_pos_.curr_pos + begin
+                + (hashes[prepared] % header_.signature_size_)
+                * header_.row_size();
+            sqe->user_data = prepared;
+            sq_array_[index] = index;
+            ++tail, ++prepared;
+        }
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+        // submit the whole batch with one syscall and wait for at least one
+        // completion
+        int ret = io_uring_enter(
+            ring_fd_, prepared - submitted, /* min_complete */ 1,
+            IORING_ENTER_GETEVENTS);
+        if (ret < 0) {
+            exit_error_errno("io_uring_enter error");
+        }
+        submitted += ret;
+
+        // reap all available completions
+        unsigned head = *cq_head_;
+        while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe* cqe = cqes_ + (head & *cq_mask_);
+            if (cqe->res != static_cast<int32_t>(size)) {
+                die("io_uring read error: " <<
+                    (cqe->res < 0 ? std::strerror(-cqe->res) : "short read"));
+            }
+            ++head, ++completed;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * cobs/query/classic_index/uring_search_file.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_QUERY_CLASSIC_INDEX_URING_SEARCH_FILE_HEADER
+#define COBS_QUERY_CLASSIC_INDEX_URING_SEARCH_FILE_HEADER
+
+#include <cobs/query/classic_index/search_file.hpp>
+
+#include <linux/io_uring.h>
+#include <mutex>
+
+namespace cobs {
+
+/*!
+ * Classic index search file backend using io_uring instead of mmap page
+ * faults. All hash rows of a batch are submitted as one batched set of
+ * read requests against the registered index file, so the kernel can keep
+ * many random reads in flight on NVMe devices where faulting through the
+ * mapping serializes.
+ */
+class ClassicIndexUringSearchFile : public ClassicIndexSearchFile
+{
+private:
+    //! index file descriptor, registered with the ring as file 0
+    int fd_;
+    //! io_uring instance file descriptor
+    int ring_fd_;
+    //! number of submission queue entries
+    unsigned sq_entries_;
+
+    //! mapped submission and completion ring memory
+    void* sq_ring_ptr_;
+    size_t sq_ring_bytes_;
+    void* cq_ring_ptr_;
+    size_t cq_ring_bytes_;
+    //! mapped submission queue entry array
+    io_uring_sqe* sqes_;
+    size_t sqes_bytes_;
+
+    //! ring field pointers into the mapped memory
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_mask_;
+    unsigned* sq_array_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned* cq_mask_;
+    io_uring_cqe* cqes_;
+
+    //! serializes ring access, read_from_disk is called concurrently by the
+    //! pipeline's I/O threads
+    std::mutex mutex_;
+
+protected:
+    void read_from_disk(const std::vector<size_t>& hashes, uint8_t* rows,
+                        size_t begin, size_t size, size_t buffer_size) override;
+
+public:
+    explicit ClassicIndexUringSearchFile(const fs::path& path);
+    ~ClassicIndexUringSearchFile();
+};
+
+} // namespace cobs
+
+#endif // !COBS_QUERY_CLASSIC_INDEX_URING_SEARCH_FILE_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * cobs/query/classic_index/zstd_search_file.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/query/classic_index/zstd_search_file.hpp>
+#include <cobs/util/zstd_block.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <tlx/math/div_ceil.hpp>
+
+namespace cobs {
+
+//! total decompressed bytes to keep cached per index; a few dozen blocks
+//! cover the hash locality of a query batch without growing with the
+//! index size
+static const uint64_t block_cache_bytes = 32 * 1024 * 1024;
+
+ClassicIndexZstdSearchFile::ClassicIndexZstdSearchFile(const fs::path& path)
+    : ClassicIndexSearchFile(path)
+{
+    if (header_.block_rows_ == 0)
+        die("ClassicIndexZstdSearchFile: " << path
+                                           << " is not block-compressed");
+    if (header_.sparse_rows_ != 0)
+        die("ClassicIndexZstdSearchFile: " << path << " is "
+            "sparse-encoded, open it with the mmap backend");
+
+    num_blocks_ = tlx::div_ceil(header_.signature_size_,
+                                header_.block_rows_);
+
+    MMapPolicy policy;
+    policy.random_access = true;
+    handle_ = initialize_mmap(path, policy);
+
+    offsets_ = reinterpret_cast<const uint64_t*>(
+        handle_.data + stream_pos_.curr_pos);
+    block_data_ = handle_.data + stream_pos_.curr_pos
+                  + (num_blocks_ + 1) * sizeof(uint64_t);
+
+    die_unless(stream_pos_.curr_pos
+               + (num_blocks_ + 1) * sizeof(uint64_t)
+               + offsets_[num_blocks_] <= handle_.size);
+
+    uint64_t block_bytes = header_.block_rows_ * header_.row_size();
+    cache_capacity_ = std::max<uint64_t>(
+        4, block_cache_bytes / std::max<uint64_t>(1, block_bytes));
+}
+
+ClassicIndexZstdSearchFile::~ClassicIndexZstdSearchFile() {
+    destroy_mmap(handle_);
+}
+
+ClassicIndexZstdSearchFile::BlockPtr
+ClassicIndexZstdSearchFile::load_block(uint64_t block) {
+    {
+        std::unique_lock<std::mutex> lock(cache_mutex_);
+        if (cache_.exists(block))
+            return cache_.get_touch(block);
+    }
+
+    // decompress outside the lock; concurrent misses on the same block
+    // decompress it twice, the first insert wins
+    uint64_t rows = std::min<uint64_t>(
+        header_.block_rows_,
+        header_.signature_size_ - block * header_.block_rows_);
+    BlockPtr data = std::make_shared<std::vector<uint8_t> >(
+        rows * header_.row_size());
+
+    size_t n = zstd_block_decompress(
+        data->data(), data->size(),
+        block_data_ + offsets_[block],
+        offsets_[block + 1] - offsets_[block]);
+    die_unequal(data->size(), n);
+
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    if (cache_.exists(block))
+        return cache_.get_touch(block);
+    cache_.put(block, data);
+    while (cache_.size() > cache_capacity_)
+        cache_.pop();
+    return data;
+}
+
+void ClassicIndexZstdSearchFile::read_from_disk(
+    const std::vector<size_t>& hashes, uint8_t* rows,
+    size_t begin, size_t size, size_t buffer_size)
+{
+    die_unless(begin + size <= header_.row_size());
+
+    for (size_t i = 0; i < hashes.size(); i++) {
+        uint64_t row = hashes[i] % header_.signature_size_;
+        uint64_t block = row / header_.block_rows_;
+        BlockPtr data = load_block(block);
+
+        const uint8_t* src =
+            data->data()
+            + (row - block * header_.block_rows_) * header_.row_size()
+            + begin;
+        std::copy(src, src + size, rows + i * buffer_size);
+    }
+}
+
+} // namespace cobs
+
+/******************************************************************************/
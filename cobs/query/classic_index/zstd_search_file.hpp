@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * cobs/query/classic_index/zstd_search_file.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_QUERY_CLASSIC_INDEX_ZSTD_SEARCH_FILE_HEADER
+#define COBS_QUERY_CLASSIC_INDEX_ZSTD_SEARCH_FILE_HEADER
+
+#include <cobs/query/classic_index/search_file.hpp>
+
+#include <tlx/container/lru_cache.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Classic index search file backend for the compressed row-block format
+ * (block_rows_ != 0 in the header). The compressed file is mapped, and a
+ * query decompresses only the row blocks its hashes touch, so cold
+ * queries read 3-5x less from disk on low-density matrices at the cost
+ * of decompressing the touched blocks. Decompressed blocks are kept in a
+ * small LRU cache shared by all scoring threads.
+ */
+class ClassicIndexZstdSearchFile : public ClassicIndexSearchFile
+{
+public:
+    explicit ClassicIndexZstdSearchFile(const fs::path& path);
+    ~ClassicIndexZstdSearchFile();
+
+    //! decompressed blocks are shared so an evicted block stays alive
+    //! while a reader still holds it
+    using BlockPtr = std::shared_ptr<std::vector<uint8_t> >;
+
+protected:
+    void read_from_disk(const std::vector<size_t>& hashes, uint8_t* rows,
+                        size_t begin, size_t size, size_t buffer_size) override;
+
+private:
+    //! return the decompressed block, from the cache or from disk
+    BlockPtr load_block(uint64_t block);
+
+    //! mapping of the whole compressed index file
+    MMapHandle handle_;
+    //! block offset table, relative to block_data_
+    const uint64_t* offsets_;
+    //! start of the compressed block frames
+    const uint8_t* block_data_;
+    //! number of row blocks
+    uint64_t num_blocks_;
+
+    //! LRU cache of decompressed blocks
+    tlx::LruCacheMap<uint64_t, BlockPtr> cache_;
+    //! maximum number of cached decompressed blocks
+    size_t cache_capacity_;
+    //! lock around cache_
+    std::mutex cache_mutex_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_QUERY_CLASSIC_INDEX_ZSTD_SEARCH_FILE_HEADER
+
+/******************************************************************************/
@@ -11,82 +11,369 @@
 #include <cobs/util/error_handling.hpp>
 
 #include <cobs/kmer.hpp>
+#include <cobs/file/shards_header.hpp>
+#include <cobs/query/classic_index/direct_search_file.hpp>
 #include <cobs/query/classic_index/mmap_search_file.hpp>
+#include <cobs/query/classic_index/uring_search_file.hpp>
+#include <cobs/query/classic_index/zstd_search_file.hpp>
+#include <cobs/query/compact_index/direct_search_file.hpp>
 #include <cobs/query/compact_index/mmap_search_file.hpp>
 #include <cobs/settings.hpp>
 #include <cobs/util/file.hpp>
+#include <cobs/util/minimizer.hpp>
 #include <cobs/util/misc.hpp>
+#include <cobs/query/gpu_score_backend.hpp>
+#include <cobs/util/buffer_arena.hpp>
+#include <cobs/util/numa.hpp>
 #include <cobs/util/parallel_for.hpp>
 #include <cobs/util/query.hpp>
 #include <cobs/util/timer.hpp>
+#include <cobs/util/trace.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <numeric>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <tlx/logger.hpp>
 #include <tlx/math/div_ceil.hpp>
+#include <tlx/math/round_to_power_of_two.hpp>
+#include <tlx/container/lru_cache.hpp>
 #include <tlx/math/round_up.hpp>
+#include <tlx/semaphore.hpp>
 #include <tlx/simple_vector.hpp>
+#include <tlx/unused.hpp>
 
 #include <xxhash.h>
 
-#if __SSE2__
+#if defined(__x86_64__) || defined(__i386__)
 #include <immintrin.h>
 #endif
 
 namespace cobs {
 
+/*!
+ * LRU cache of complete query results. The key fingerprints the query's
+ * canonical k-mer multiset together with threshold and result limit, so
+ * resubmissions of the same gene or contig -- byte-identical or not --
+ * hit as long as their k-mer content matches. Entries hold shared copies
+ * of the result vectors; the doc_name pointers they carry stay valid
+ * because the cache lives and dies with the index file set.
+ */
+class ClassicSearch::ResultCache
+{
+public:
+    explicit ResultCache(size_t max_entries) : max_entries_(max_entries) { }
+
+    bool lookup(uint64_t key, std::vector<SearchResult>& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!lru_.exists(key))
+            return false;
+        out = *lru_.get_touch(key);
+        return true;
+    }
+
+    void put(uint64_t key, const std::vector<SearchResult>& result) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        lru_.put(key, std::make_shared<std::vector<SearchResult> >(result));
+        while (lru_.size() > max_entries_)
+            lru_.pop();
+    }
+
+private:
+    size_t max_entries_;
+    std::mutex mutex_;
+    tlx::LruCacheMap<uint64_t, std::shared_ptr<std::vector<SearchResult> > >
+        lru_;
+};
+
+//! fingerprint the query's canonical k-mer multiset for each distinct
+//! term size of the index files, mixed with threshold and result limit
+static uint64_t result_cache_key(
+    const std::vector<std::shared_ptr<IndexSearchFile> >& index_files,
+    const std::string& query, double threshold, size_t num_results)
+{
+    std::vector<uint64_t> kmer_hashes;
+    std::vector<uint32_t> term_sizes;
+    for (const auto& index_file : index_files) {
+        uint32_t term_size = index_file->term_size();
+        if (std::find(term_sizes.begin(), term_sizes.end(), term_size)
+            != term_sizes.end())
+            continue;
+        term_sizes.push_back(term_size);
+
+        tlx::simple_vector<char> buffer(term_size);
+        for (size_t i = 0; i + term_size <= query.size(); ++i) {
+            if (canonicalize_kmer(query.data() + i, buffer.data(), term_size))
+                kmer_hashes.push_back(XXH64(buffer.data(), term_size, 0));
+        }
+    }
+    std::sort(kmer_hashes.begin(), kmer_hashes.end());
+
+    uint64_t key = XXH64(kmer_hashes.data(),
+                         kmer_hashes.size() * sizeof(uint64_t), 0);
+    key = XXH64(&threshold, sizeof(threshold), key);
+    key = XXH64(&num_results, sizeof(num_results), key);
+    return key;
+}
+
+ClassicSearch::~ClassicSearch() = default;
+
 ClassicSearch::ClassicSearch(std::shared_ptr<IndexSearchFile> index)
     : index_files_(
           std::vector<std::shared_ptr<IndexSearchFile> >{
               std::move(index)
           })
-{ }
+{
+    if (gopt_result_cache_size != 0)
+        result_cache_ = std::make_unique<ResultCache>(gopt_result_cache_size);
+}
 
 ClassicSearch::ClassicSearch(std::vector<std::shared_ptr<IndexSearchFile> > indices)
-    : index_files_(std::move(indices)) { }
+    : index_files_(std::move(indices)) {
+    if (gopt_result_cache_size != 0)
+        result_cache_ = std::make_unique<ResultCache>(gopt_result_cache_size);
+}
 
-ClassicSearch::ClassicSearch(std::string path)
-{
+//! open one index file with the backend selected by the index layout and
+//! the gopt_use_* switches; used for plain paths and for shard manifest
+//! members
+static std::shared_ptr<IndexSearchFile>
+open_index_search_file(const fs::path& path) {
     if (file_has_header<ClassicIndexHeader>(path)) {
-        index_files_.emplace_back(
-            std::make_shared<ClassicIndexMMapSearchFile>(path));
+        ClassicIndexHeader h = deserialize_header<ClassicIndexHeader>(path);
+        // compressed and sparse layouts have dedicated backends
+        if (h.block_rows_ != 0)
+            return std::make_shared<ClassicIndexZstdSearchFile>(path);
+        if (h.sparse_rows_ != 0)
+            return std::make_shared<ClassicIndexMMapSearchFile>(path);
+        if (gopt_use_o_direct)
+            return std::make_shared<ClassicIndexDirectSearchFile>(path);
+        if (gopt_use_io_uring)
+            return std::make_shared<ClassicIndexUringSearchFile>(path);
+        return std::make_shared<ClassicIndexMMapSearchFile>(path);
     }
     else if (file_has_header<CompactIndexHeader>(path)) {
-        index_files_.emplace_back(
-            std::make_shared<CompactIndexMMapSearchFile>(path));
+        if (gopt_use_o_direct)
+            return std::make_shared<CompactIndexDirectSearchFile>(path);
+        return std::make_shared<CompactIndexMMapSearchFile>(path);
+    }
+    die("Could not open index path \"" << path.string() << "\"");
+}
+
+ClassicSearch::ClassicSearch(std::string path)
+{
+    if (gopt_result_cache_size != 0)
+        result_cache_ = std::make_unique<ResultCache>(gopt_result_cache_size);
+    if (file_has_header<ShardsHeader>(path)) {
+        ShardsHeader sh = deserialize_header<ShardsHeader>(path);
+        if (sh.shards_.empty())
+            die("Shard manifest " << path << " lists no shards");
+        // open and validate all member search files in parallel, the
+        // serial header reads dominate open time for many shards
+        fs::path dir = fs::path(path).parent_path();
+        index_files_.resize(sh.shards_.size());
+        parallel_for(
+            0, sh.shards_.size(), gopt_threads,
+            [&](size_t i) {
+                fs::path member = sh.shards_[i].path_;
+                if (member.is_relative() && !dir.empty())
+                    member = dir / member;
+                index_files_[i] = open_index_search_file(member);
+            });
     }
     else {
-        die("Could not open index path \"" << path << "\"");
+        index_files_.emplace_back(open_index_search_file(path));
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+// Runtime CPU dispatch: the kernels below are compiled with per-function
+// target attributes, so one binary contains all variants and picks the widest
+// one the executing CPU supports.
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define COBS_HAVE_X86_DISPATCH 1
+#endif
+
+#if COBS_HAVE_X86_DISPATCH
+
+static inline
+bool cpu_supports_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+static inline
+bool cpu_supports_avx512() {
+    static const bool supported =
+        __builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw");
+    return supported;
+}
+
+#endif  // COBS_HAVE_X86_DISPATCH
+
+/*----------------------------------------------------------------------------*/
+
+//! pack a term of up to 32 ACGT bases into 2 bits per base. returns false
+//! for other characters or longer terms, in which case the term cannot be
+//! keyed in the dedup set.
+static inline
+bool pack_kmer_2bit(const char* term, size_t term_size, uint64_t* packed)
+{
+    if (term_size > 32)
+        return false;
+
+    uint64_t p = 0;
+    for (size_t i = 0; i < term_size; ++i) {
+        switch (term[i]) {
+        case 'A': p = (p << 2) | 0; break;
+        case 'C': p = (p << 2) | 1; break;
+        case 'G': p = (p << 2) | 2; break;
+        case 'T': p = (p << 2) | 3; break;
+        default: return false;
+        }
     }
+    *packed = p;
+    return true;
 }
 
+/*!
+ * Small open-addressing set over packed 2-bit k-mers, used to deduplicate
+ * the canonical terms of a query. Real sequencing reads repeat many terms
+ * (low-complexity regions, homopolymers), and every duplicate would
+ * otherwise cost num_hashes XXH64 calls plus duplicate row gathers in
+ * read_from_disk.
+ */
+class KMerDedupSet
+{
+public:
+    explicit KMerDedupSet(size_t num_terms) {
+        mask_ = tlx::round_up_to_power_of_two(
+            std::max<size_t>(2 * num_terms, 16)) - 1;
+        keys_.resize(mask_ + 1);
+        // term ids are stored off by one so zero marks an empty slot
+        ids_.resize(mask_ + 1);
+    }
+
+    //! insert the packed term, returning its term id and whether it was new
+    std::pair<uint32_t, bool> insert(uint64_t packed, uint32_t next_id) {
+        // Fibonacci multiplicative hash spreads the packed bases
+        size_t pos = (packed * 0x9E3779B97F4A7C15LLU >> 32) & mask_;
+        while (ids_[pos] != 0) {
+            if (keys_[pos] == packed)
+                return std::make_pair(ids_[pos] - 1, false);
+            pos = (pos + 1) & mask_;
+        }
+        keys_[pos] = packed;
+        ids_[pos] = next_id + 1;
+        return std::make_pair(next_id, true);
+    }
+
+private:
+    size_t mask_;
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> ids_;
+};
+
+//! emit the num_hashes hash values of one term according to the index's
+//! hashing scheme, matching process_hashes() used during construction
+static inline
+void emit_term_hashes(const char* term, size_t term_size,
+                      size_t num_hashes, uint8_t hash_mode,
+                      std::vector<uint64_t>& hashes)
+{
+    if (hash_mode == 0) {
+        for (size_t j = 0; j < num_hashes; j++) {
+            hashes.push_back(XXH64(term, term_size, j));
+        }
+    }
+    else {
+        // double hashing (v2): h_i = h1 + i * h2, the modulo by
+        // signature_size is applied in read_from_disk
+        uint64_t h1 = XXH64(term, term_size, 0);
+        uint64_t h2 = XXH64(term, term_size, 1);
+        for (size_t j = 0; j < num_hashes; j++) {
+            hashes.push_back(h1 + j * h2);
+        }
+    }
+}
+
+/*!
+ * Hash the terms of a query, deduplicating identical canonical k-mers: the
+ * num_hashes hash values of each distinct term are emitted exactly once
+ * into hashes, and term_counts receives the term's multiplicity so the
+ * scoring path can weight its row accordingly. Terms that cannot be packed
+ * into 2-bit form (non-ACGT bases without canonicalization, or k > 32) are
+ * emitted unconditionally with multiplicity one.
+ */
 static inline
 void create_hashes(
-    std::vector<uint64_t>& hashes, const std::string& query,
-    char* canonicalize_buffer,
+    std::vector<uint64_t>& hashes, std::vector<uint32_t>& term_counts,
+    const std::string& query, char* canonicalize_buffer,
     const std::shared_ptr<IndexSearchFile>& index_file)
 {
     uint32_t term_size = index_file->term_size();
     size_t num_hashes = index_file->num_hashes();
     uint8_t canonicalize = index_file->canonicalize();
+    uint8_t hash_mode = index_file->hash_mode();
+    uint64_t window_size = index_file->window_size();
 
     size_t num_terms = query.size() - term_size + 1;
-    hashes.resize(num_hashes * num_terms);
+    hashes.clear();
+    hashes.reserve(num_hashes * num_terms);
+    term_counts.clear();
+    term_counts.reserve(num_terms);
 
     const char* query_8 = query.data();
+    KMerDedupSet dedup(num_terms);
+
+    // packed-hashing indexes (canonicalize 2) hash the 2-bit packed k-mer
+    tlx::simple_vector<char> packed_buffer(
+        canonicalize == 2 ? KMer<31>::data_size(term_size) : 0);
+
+    auto select_term =
+        [&](const char* term) {
+            uint64_t packed;
+            if (pack_kmer_2bit(term, term_size, &packed)) {
+                auto it = dedup.insert(packed, uint32_t(term_counts.size()));
+                if (!it.second) {
+                    term_counts[it.first]++;
+                    return;
+                }
+            }
 
-    if (canonicalize == 0) {
-        for (size_t i = 0; i < num_terms; i++) {
-            for (size_t j = 0; j < num_hashes; j++) {
-                hashes[i * num_hashes + j] = XXH64(query_8 + i, term_size, j);
+            if (canonicalize == 2) {
+                KMer<31>::init(term, packed_buffer.data(), term_size);
+                emit_term_hashes(packed_buffer.data(),
+                                 KMer<31>::data_size(term_size),
+                                 num_hashes, hash_mode, hashes);
+            }
+            else {
+                emit_term_hashes(term, term_size,
+                                 num_hashes, hash_mode, hashes);
             }
+            term_counts.push_back(1);
+        };
+
+    // minimizer-subsampled indexes (window_size > 1) contain only window
+    // minimizers, so the query must select the same ones
+    MinimizerFilter<decltype(select_term)> filter(
+        window_size, term_size, select_term);
+
+    for (size_t i = 0; i < num_terms; i++) {
+        const char* term = query_8 + i;
+
+        if (canonicalize == 0) {
+            // keep raw bytes
         }
-    }
-    else if (canonicalize == 1) {
-        for (size_t i = 0; i < num_terms; i++) {
+        else if (canonicalize == 1 || canonicalize == 2) {
             bool good =
                 canonicalize_kmer(query_8 + i, canonicalize_buffer, term_size);
 
@@ -94,50 +381,355 @@ void create_hashes(
                 die("Invalid DNA base pair in query string. "
                     "Only ACGT are allowed.");
             }
+            term = canonicalize_buffer;
+        }
+        else {
+            die("Unknown canonicalize value " << unsigned(canonicalize));
+        }
+
+        if (window_size > 1)
+            filter.push(term);
+        else
+            select_term(term);
+    }
+    if (window_size > 1)
+        filter.finish();
+}
 
-            for (size_t j = 0; j < num_hashes; j++) {
-                hashes[i * num_hashes + j] = XXH64(
-                    canonicalize_buffer, term_size, j);
+/*!
+ * Hash all queries of a batch at once, deduplicating identical canonical
+ * k-mers across queries. Emits the num_hashes hash values of each distinct
+ * term exactly once into hashes, and per query the list of term ids making
+ * up its score.
+ */
+static inline
+void create_batch_hashes(
+    std::vector<uint64_t>& hashes,
+    std::vector<std::vector<uint32_t> >& query_terms,
+    const std::vector<std::string>& queries,
+    char* canonicalize_buffer,
+    const std::shared_ptr<IndexSearchFile>& index_file)
+{
+    uint32_t term_size = index_file->term_size();
+    size_t num_hashes = index_file->num_hashes();
+    uint8_t canonicalize = index_file->canonicalize();
+    uint8_t hash_mode = index_file->hash_mode();
+    uint64_t window_size = index_file->window_size();
+
+    std::unordered_map<std::string, uint32_t> term_ids;
+    std::string term;
+
+    // packed-hashing indexes (canonicalize 2) hash the 2-bit packed k-mer
+    tlx::simple_vector<char> packed_buffer(
+        canonicalize == 2 ? KMer<31>::data_size(term_size) : 0);
+
+    hashes.clear();
+    query_terms.resize(queries.size());
+
+    for (size_t q = 0; q < queries.size(); ++q) {
+        const char* query_8 = queries[q].data();
+        size_t num_terms = queries[q].size() - term_size + 1;
+
+        query_terms[q].clear();
+        query_terms[q].reserve(num_terms);
+
+        auto select_term =
+            [&](const char* cterm) {
+                if (canonicalize == 2) {
+                    KMer<31>::init(cterm, packed_buffer.data(), term_size);
+                    term.assign(packed_buffer.data(),
+                                KMer<31>::data_size(term_size));
+                }
+                else {
+                    term.assign(cterm, term_size);
+                }
+
+                auto it = term_ids.emplace(term, uint32_t(term_ids.size()));
+                if (it.second) {
+                    emit_term_hashes(term.data(), term.size(),
+                                     num_hashes, hash_mode, hashes);
+                }
+                query_terms[q].push_back(it.first->second);
+            };
+
+        // minimizer-subsampled indexes contain only window minimizers, so
+        // the query must select the same ones; windows do not span queries
+        MinimizerFilter<decltype(select_term)> filter(
+            window_size, term_size, select_term);
+
+        for (size_t i = 0; i < num_terms; i++) {
+            const char* cterm = query_8 + i;
+
+            if (canonicalize == 0) {
+                // keep raw bytes
             }
+            else if (canonicalize == 1 || canonicalize == 2) {
+                bool good = canonicalize_kmer(
+                    query_8 + i, canonicalize_buffer, term_size);
+
+                if (!good) {
+                    die("Invalid DNA base pair in query string. "
+                        "Only ACGT are allowed.");
+                }
+                cterm = canonicalize_buffer;
+            }
+            else {
+                die("Unknown canonicalize value " << unsigned(canonicalize));
+            }
+
+            if (window_size > 1)
+                filter.push(cterm);
+            else
+                select_term(cterm);
         }
+        if (window_size > 1)
+            filter.finish();
     }
-    else {
-        die("Unknown canonicalize value " << unsigned(canonicalize));
+}
+
+/******************************************************************************/
+// Threshold Pre-Filter Scan
+
+template <typename Score, typename Callback>
+static inline
+void scan_above_threshold_scalar(
+    const Score* scores, size_t size, Score threshold, Callback&& callback)
+{
+    for (size_t j = 0; j < size; ++j) {
+        if (scores[j] >= threshold)
+            callback(j);
+    }
+}
+
+#if COBS_HAVE_X86_DISPATCH
+
+// the AVX2 scans compare a whole block of scores against the threshold at
+// once, skip blocks without any hit, and visit only the set mask bits
+// otherwise.
+
+template <typename Callback>
+__attribute__ ((target ("avx2"))) static
+void scan_above_threshold_avx2(
+    const uint8_t* scores, size_t size, uint8_t threshold,
+    Callback&& callback)
+{
+    const __m256i t = _mm256_set1_epi8(char(threshold));
+    size_t j = 0;
+    for ( ; j + 32 <= size; j += 32) {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i_u*>(scores + j));
+        // unsigned v >= t  <=>  max(v, t) == v
+        uint32_t m = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_max_epu8(v, t), v));
+        while (m != 0) {
+            callback(j + __builtin_ctz(m));
+            m &= m - 1;
+        }
+    }
+    for ( ; j < size; ++j) {
+        if (scores[j] >= threshold)
+            callback(j);
+    }
+}
+
+template <typename Callback>
+__attribute__ ((target ("avx2"))) static
+void scan_above_threshold_avx2(
+    const uint16_t* scores, size_t size, uint16_t threshold,
+    Callback&& callback)
+{
+    const __m256i t = _mm256_set1_epi16(short(threshold));
+    size_t j = 0;
+    for ( ; j + 16 <= size; j += 16) {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i_u*>(scores + j));
+        // each 16-bit lane yields two equal mask bits, keep the even ones
+        uint32_t m = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi16(_mm256_max_epu16(v, t), v));
+        m &= 0x55555555;
+        while (m != 0) {
+            callback(j + __builtin_ctz(m) / 2);
+            m &= m - 1;
+        }
+    }
+    for ( ; j < size; ++j) {
+        if (scores[j] >= threshold)
+            callback(j);
+    }
+}
+
+template <typename Callback>
+__attribute__ ((target ("avx2"))) static
+void scan_above_threshold_avx2(
+    const uint32_t* scores, size_t size, uint32_t threshold,
+    Callback&& callback)
+{
+    const __m256i t = _mm256_set1_epi32(int32_t(threshold));
+    size_t j = 0;
+    for ( ; j + 8 <= size; j += 8) {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i_u*>(scores + j));
+        uint32_t m = _mm256_movemask_ps(
+            _mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(_mm256_max_epu32(v, t), v)));
+        while (m != 0) {
+            callback(j + __builtin_ctz(m));
+            m &= m - 1;
+        }
+    }
+    for ( ; j < size; ++j) {
+        if (scores[j] >= threshold)
+            callback(j);
+    }
+}
+
+#endif  // COBS_HAVE_X86_DISPATCH
+
+/*!
+ * Call callback(j) for every score with scores[j] >= threshold. Uses a SIMD
+ * block scan that skips over all-below-threshold blocks where available.
+ */
+template <typename Score, typename Callback>
+static inline
+void scan_above_threshold(
+    const Score* scores, size_t size, size_t threshold, Callback&& callback)
+{
+    if (threshold == 0) {
+        // a zero threshold matches every document, skip the compares
+        for (size_t j = 0; j < size; ++j)
+            callback(j);
+        return;
     }
+#if COBS_HAVE_X86_DISPATCH
+    if (!classic_search_disable_avx2 && cpu_supports_avx2()) {
+        return scan_above_threshold_avx2(
+            scores, size, Score(threshold), callback);
+    }
+#endif
+    scan_above_threshold_scalar(scores, size, Score(threshold), callback);
+}
+
+/*!
+ * Apply the standard Bloom filter false positive correction to one raw
+ * score: subtract the document's expected false positive count
+ * num_terms * density^num_hashes and rescale by 1 / (1 - fpr). The
+ * corrected value never exceeds the raw score, so it fits the same type.
+ */
+template <typename Score>
+static inline
+Score calibrate_score(Score raw, double density, double num_hashes,
+                      size_t num_terms)
+{
+    double fpr = std::pow(density, num_hashes);
+    if (fpr >= 1.0)
+        return Score(0);
+    double corrected = (double(raw) - num_terms * fpr) / (1.0 - fpr);
+    return corrected <= 0.0 ? Score(0) : Score(corrected + 0.5);
 }
 
 template <typename Score>
 void counts_to_result(
     const std::vector<std::shared_ptr<IndexSearchFile> >& index_files,
-    const Score* scores,
+    Score* scores,
     std::vector<SearchResult>& result,
     const std::vector<size_t>& thresholds,
     size_t num_results, size_t max_counts,
-    const std::vector<size_t>& sum_doc_counts)
+    const std::vector<size_t>& sum_doc_counts,
+    size_t query_size)
 {
+    // calibrated scoring: replace each document's raw k-mer count by the
+    // Bloom-corrected estimate of its true matches, so densely filled
+    // documents no longer rank above sparse ones on false positives
+    // alone. thresholds then select on the corrected scores. documents
+    // of indexes without stored densities keep their raw scores.
+    if (gopt_calibrate_scores) {
+        for (size_t k = 0; k < index_files.size(); ++k) {
+            const std::vector<double>& densities =
+                index_files[k]->doc_densities();
+            if (densities.size() != index_files[k]->num_documents())
+                continue;
+            double num_hashes = index_files[k]->num_hashes();
+            size_t num_terms =
+                query_size - index_files[k]->term_size() + 1;
+            Score* file_scores = scores + sum_doc_counts[k];
+            for (size_t j = 0; j < densities.size(); ++j) {
+                file_scores[j] = calibrate_score(
+                    file_scores[j], densities[j], num_hashes, num_terms);
+            }
+        }
+    }
+
+    // result ordering: descending score, ties broken by ascending index
+    auto is_better =
+        [](const auto& v1, const auto& v2) {
+            return (std::tie(v2.first, v1.second)
+                    < std::tie(v1.first, v2.second));
+        };
+
+    // bounded top-k selection: with few requested results, a fixed-size
+    // min-heap over the above-threshold scores avoids materializing one
+    // candidate slot per document of the whole collection
+    bool use_top_k =
+        max_counts > 1 && num_results > 0 &&
+        num_results < sum_doc_counts.back() / 8;
+
     if (index_files.size() == 1)
     {
         const std::shared_ptr<IndexSearchFile>& index_file = index_files.front();
 
-        // uninitialized index vector
-        tlx::simple_vector<std::pair<Score, uint32_t> > sorted_indices(
-            sum_doc_counts.back());
+        if (use_top_k)
+        {
+            std::vector<std::pair<Score, uint32_t> > heap;
+            heap.reserve(num_results + 1);
+
+            scan_above_threshold(
+                scores, index_file->num_documents(), thresholds[0],
+                [&](size_t j) {
+                    std::pair<Score, uint32_t> cand(scores[j], j);
+                    if (heap.size() < num_results) {
+                        heap.emplace_back(cand);
+                        std::push_heap(heap.begin(), heap.end(), is_better);
+                    }
+                    else if (is_better(cand, heap.front())) {
+                        // replace the currently worst kept candidate
+                        std::pop_heap(heap.begin(), heap.end(), is_better);
+                        heap.back() = cand;
+                        std::push_heap(heap.begin(), heap.end(), is_better);
+                    }
+                });
+            std::sort_heap(heap.begin(), heap.end(), is_better);
 
-        size_t count_threshold = 0;
-        for (size_t j = 0; j < index_file->file_names().size(); ++j) {
-            if (scores[j] >= thresholds[0]) {
-                sorted_indices[count_threshold++] =
-                    std::make_pair(scores[j], j);
+            result.resize(heap.size());
+            for (size_t i = 0; i < heap.size(); ++i) {
+                result[i] = SearchResult(
+                    index_file->doc_names()[heap[i].second],
+                    heap[i].first);
             }
+            return;
         }
 
+        // uninitialized candidate slots, rented from the thread-local
+        // buffer arena so repeated full-collection rankings reuse one
+        // allocation instead of paying it per call
+        using Candidate = std::pair<Score, uint32_t>;
+        Candidate* sorted_indices = reinterpret_cast<Candidate*>(
+            BufferArena::rent(sum_doc_counts.back() * sizeof(Candidate)));
+
+        size_t count_threshold = 0;
+        scan_above_threshold(
+            scores, index_file->num_documents(), thresholds[0],
+            [&](size_t j) {
+                sorted_indices[count_threshold++] =
+                    std::make_pair(scores[j], uint32_t(j));
+            });
+
         num_results = std::min(num_results, count_threshold);
 
         if (max_counts > 1)
         {
             std::partial_sort(
-                sorted_indices.begin(), sorted_indices.begin() + num_results,
-                sorted_indices.begin() + count_threshold,
+                sorted_indices, sorted_indices + num_results,
+                sorted_indices + count_threshold,
                 [&](auto v1, auto v2) {
                     return (std::tie(v2.first, v1.second)
                             < std::tie(v1.first, v2.second));
@@ -151,27 +743,73 @@ void counts_to_result(
             size_t document_id = sorted_indices[i].second;
 
             result[i] = SearchResult(
-                index_file->file_names()[document_id].c_str(),
+                index_file->doc_names()[document_id],
                 sorted_indices[i].first);
         }
+
+        BufferArena::release(reinterpret_cast<uint8_t*>(sorted_indices));
     }
     else
     {
-        // uninitialized index vector
-        tlx::simple_vector<
-            std::pair<Score, std::pair<uint16_t, uint32_t> >
-            > sorted_indices(sum_doc_counts.back());
+        if (use_top_k)
+        {
+            std::vector<
+                std::pair<Score, std::pair<uint16_t, uint32_t> > > heap;
+            heap.reserve(num_results + 1);
+
+            for (size_t k = 0; k < index_files.size(); ++k) {
+                scan_above_threshold(
+                    scores + sum_doc_counts[k],
+                    index_files[k]->num_documents(), thresholds[k],
+                    [&](size_t i) {
+                        std::pair<Score, std::pair<uint16_t, uint32_t> > cand(
+                            scores[sum_doc_counts[k] + i],
+                            std::make_pair(k, i));
+                        if (heap.size() < num_results) {
+                            heap.emplace_back(cand);
+                            std::push_heap(
+                                heap.begin(), heap.end(), is_better);
+                        }
+                        else if (is_better(cand, heap.front())) {
+                            // replace the currently worst kept candidate
+                            std::pop_heap(heap.begin(), heap.end(), is_better);
+                            heap.back() = cand;
+                            std::push_heap(
+                                heap.begin(), heap.end(), is_better);
+                        }
+                    });
+            }
+            std::sort_heap(heap.begin(), heap.end(), is_better);
+
+            result.resize(heap.size());
+            for (size_t i = 0; i < heap.size(); ++i) {
+                size_t index_id = heap[i].second.first;
+                size_t document_id = heap[i].second.second;
+
+                result[i] = SearchResult(
+                    index_files[index_id]->doc_names()[document_id],
+                    heap[i].first);
+            }
+            return;
+        }
+
+        // uninitialized candidate slots, rented from the thread-local
+        // buffer arena, see the single index case above
+        using Candidate = std::pair<Score, std::pair<uint16_t, uint32_t> >;
+        Candidate* sorted_indices = reinterpret_cast<Candidate*>(
+            BufferArena::rent(sum_doc_counts.back() * sizeof(Candidate)));
 
         size_t count_threshold = 0;
         for (size_t k = 0; k < index_files.size(); ++k) {
-            for (size_t i = 0; i < index_files[k]->file_names().size(); ++i) {
-                size_t index = sum_doc_counts[k] + i;
-
-                if (scores[index] >= thresholds[k]) {
+            scan_above_threshold(
+                scores + sum_doc_counts[k],
+                index_files[k]->num_documents(), thresholds[k],
+                [&](size_t i) {
                     sorted_indices[count_threshold++] =
-                        std::make_pair(scores[index], std::make_pair(k, i));
-                }
-            }
+                        std::make_pair(scores[sum_doc_counts[k] + i],
+                                       std::make_pair(uint16_t(k),
+                                                      uint32_t(i)));
+                });
         }
 
         num_results = std::min(num_results, count_threshold);
@@ -179,8 +817,8 @@ void counts_to_result(
         if (max_counts > 1)
         {
             std::partial_sort(
-                sorted_indices.begin(), sorted_indices.begin() + num_results,
-                sorted_indices.begin() + count_threshold,
+                sorted_indices, sorted_indices + num_results,
+                sorted_indices + count_threshold,
                 [&](auto v1, auto v2) {
                     return (std::tie(v2.first, v1.second)
                             < std::tie(v1.first, v2.second));
@@ -195,9 +833,11 @@ void counts_to_result(
             size_t document_id = sorted_indices[i].second.second;
 
             result[i] = SearchResult(
-                index_files[index_id]->file_names()[document_id].c_str(),
+                index_files[index_id]->doc_names()[document_id],
                 sorted_indices[i].first);
         }
+
+        BufferArena::release(reinterpret_cast<uint8_t*>(sorted_indices));
     }
 }
 
@@ -210,16 +850,54 @@ bool classic_search_disable_32bit = false;
 
 bool classic_search_disable_sse2 = false;
 
+bool classic_search_disable_avx2 = false;
+bool classic_search_disable_avx512 = false;
+
 static inline
 void compute_counts_u8_64(
     uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
     const uint8_t* rows, size_t size, size_t buffer_size);
 
+static inline
+void compute_counts_u8_128(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+
+#if COBS_HAVE_X86_DISPATCH
+
+__attribute__ ((target ("avx2"))) static
+void compute_counts_u8_256(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+
+__attribute__ ((target ("avx512f,avx512bw"))) static
+void compute_counts_u8_512(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+
+#endif  // COBS_HAVE_X86_DISPATCH
+
 static inline
 void compute_counts(
     uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
     const uint8_t* rows, size_t size, size_t buffer_size)
 {
+#if COBS_HAVE_X86_DISPATCH
+    if (!classic_search_disable_avx512 && cpu_supports_avx512()) {
+        return compute_counts_u8_512(
+            num_hashes, hashes_size, scores, rows, size, buffer_size);
+    }
+    if (!classic_search_disable_avx2 && cpu_supports_avx2()) {
+        return compute_counts_u8_256(
+            num_hashes, hashes_size, scores, rows, size, buffer_size);
+    }
+#endif
+#if __SSE2__
+    if (!classic_search_disable_sse2) {
+        return compute_counts_u8_128(
+            num_hashes, hashes_size, scores, rows, size, buffer_size);
+    }
+#endif
     return compute_counts_u8_64(
         num_hashes, hashes_size, scores, rows, size, buffer_size);
 }
@@ -234,11 +912,35 @@ void compute_counts_u16_128(
     uint64_t num_hashes, size_t hashes_size, uint16_t* scores,
     const uint8_t* rows, size_t size, size_t buffer_size);
 
+#if COBS_HAVE_X86_DISPATCH
+
+__attribute__ ((target ("avx2"))) static
+void compute_counts_u16_256(
+    uint64_t num_hashes, size_t hashes_size, uint16_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+
+__attribute__ ((target ("avx512f,avx512bw"))) static
+void compute_counts_u16_512(
+    uint64_t num_hashes, size_t hashes_size, uint16_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+
+#endif  // COBS_HAVE_X86_DISPATCH
+
 static inline
 void compute_counts(
     uint64_t num_hashes, size_t hashes_size, uint16_t* scores,
     const uint8_t* rows, size_t size, size_t buffer_size)
 {
+#if COBS_HAVE_X86_DISPATCH
+    if (!classic_search_disable_avx512 && cpu_supports_avx512()) {
+        return compute_counts_u16_512(
+            num_hashes, hashes_size, scores, rows, size, buffer_size);
+    }
+    if (!classic_search_disable_avx2 && cpu_supports_avx2()) {
+        return compute_counts_u16_256(
+            num_hashes, hashes_size, scores, rows, size, buffer_size);
+    }
+#endif
 #if __SSE2__
     if (!classic_search_disable_sse2) {
         return compute_counts_u16_128(
@@ -259,58 +961,1027 @@ void compute_counts_u32_128(
     uint64_t num_hashes, size_t hashes_size, uint32_t* scores,
     const uint8_t* rows, size_t size, size_t buffer_size);
 
+#if COBS_HAVE_X86_DISPATCH
+
+__attribute__ ((target ("avx2"))) static
+void compute_counts_u32_256(
+    uint64_t num_hashes, size_t hashes_size, uint32_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+
+__attribute__ ((target ("avx512f,avx512bw"))) static
+void compute_counts_u32_512(
+    uint64_t num_hashes, size_t hashes_size, uint32_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+
+#endif  // COBS_HAVE_X86_DISPATCH
+
 static inline
 void compute_counts(
     uint64_t num_hashes, size_t hashes_size, uint32_t* scores,
     const uint8_t* rows, size_t size, size_t buffer_size)
 {
-#if __SSE2__
-    if (!classic_search_disable_sse2) {
-        return compute_counts_u32_128(
-            num_hashes, hashes_size, scores, rows, size, buffer_size);
+#if COBS_HAVE_X86_DISPATCH
+    if (!classic_search_disable_avx512 && cpu_supports_avx512()) {
+        return compute_counts_u32_512(
+            num_hashes, hashes_size, scores, rows, size, buffer_size);
+    }
+    if (!classic_search_disable_avx2 && cpu_supports_avx2()) {
+        return compute_counts_u32_256(
+            num_hashes, hashes_size, scores, rows, size, buffer_size);
+    }
+#endif
+#if __SSE2__
+    if (!classic_search_disable_sse2) {
+        return compute_counts_u32_128(
+            num_hashes, hashes_size, scores, rows, size, buffer_size);
+    }
+#endif
+    return compute_counts_u32_64(
+        num_hashes, hashes_size, scores, rows, size, buffer_size);
+}
+
+/******************************************************************************/
+
+static inline
+void aggregate_rows(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* rows,
+    const size_t size, size_t buffer_size)
+{
+    for (uint64_t i = 0; i < hashes_size; i += num_hashes) {
+        uint8_t* rows_8 = rows + i * buffer_size;
+        uint64_t* rows_64 = reinterpret_cast<uint64_t*>(rows_8);
+        for (size_t j = 1; j < num_hashes; ++j) {
+            uint8_t* rows_8_j = rows_8 + j * buffer_size;
+            uint64_t* rows_64_j = reinterpret_cast<uint64_t*>(rows_8_j);
+
+            assert((i * buffer_size + j * buffer_size) % 8 == 0);
+            for (size_t k = 0; k < size / 8; ++k) {
+                sLOG0 << i << hashes_size
+                      << j << num_hashes << size
+                      << reinterpret_cast<uint8_t*>(rows_64 + k) - rows
+                      << reinterpret_cast<uint8_t*>(rows_64_j + k) - rows
+                      << size * hashes_size;
+                rows_64[k] &= rows_64_j[k];
+            }
+            size_t k = (size / 8) * 8;
+            while (k < size) {
+                rows_8[k] &= rows_8_j[k];
+                k++;
+            }
+        }
+    }
+}
+
+/*!
+ * Fused variant of aggregate_rows() followed by compute_counts(): processes
+ * the rows buffer in cache-sized tiles so the expansion pass reads each tile
+ * while the AND pass still has it cache-resident, instead of sweeping the
+ * whole multi-megabyte buffer twice from memory.
+ */
+template <typename Score>
+static inline
+void aggregate_rows_and_compute_counts(
+    uint64_t num_hashes, size_t hashes_size, Score* scores,
+    uint8_t* rows, size_t size, size_t buffer_size)
+{
+    // per row byte, a tile touches num_hashes row bytes plus eight expanded
+    // score counters; size the tile so that stays within a typical L2
+    static constexpr size_t tile_target = 256 * 1024;
+    size_t tile_size = tlx::round_up(
+        std::max<size_t>(
+            tile_target / (num_hashes + 8 * sizeof(Score)), 4096), 8);
+
+    for (size_t k = 0; k < size; k += tile_size) {
+        size_t tile = std::min(size - k, tile_size);
+        aggregate_rows(num_hashes, hashes_size, rows + k,
+                       tile, buffer_size);
+        compute_counts(num_hashes, hashes_size, scores + 8 * k,
+                       rows + k, tile, buffer_size);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+// kernel entry points for the microbenchmarks
+
+void classic_search_compute_counts(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size) {
+    compute_counts(num_hashes, hashes_size, scores, rows, size,
+                   buffer_size);
+}
+
+void classic_search_compute_counts(
+    uint64_t num_hashes, size_t hashes_size, uint16_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size) {
+    compute_counts(num_hashes, hashes_size, scores, rows, size,
+                   buffer_size);
+}
+
+void classic_search_compute_counts(
+    uint64_t num_hashes, size_t hashes_size, uint32_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size) {
+    compute_counts(num_hashes, hashes_size, scores, rows, size,
+                   buffer_size);
+}
+
+void classic_search_aggregate_rows(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* rows,
+    size_t size, size_t buffer_size) {
+    aggregate_rows(num_hashes, hashes_size, rows, size, buffer_size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*!
+ * Zero-copy scoring loop for memory-resident indexes: the expansion
+ * kernels consume the hash rows directly from the loaded index data
+ * instead of gathering them into a rows buffer first. With num_hashes == 1
+ * no row bytes are copied at all; otherwise the hash rows of each term are
+ * ANDed into one scratch row per batch, still saving the full gather.
+ */
+template <typename Score>
+void search_index_file_resident(
+    const std::shared_ptr<IndexSearchFile>& index_file,
+    const std::vector<uint64_t>& hashes,
+    const std::vector<uint32_t>& term_counts,
+    Score* score_start, size_t num_threads, Timer& timer)
+{
+    uint32_t num_hashes = index_file->num_hashes();
+    size_t score_total_size = index_file->counts_size();
+
+    size_t score_batch_size = 128;
+    score_batch_size = std::max(score_batch_size,
+                                8 * index_file->page_size());
+    score_batch_size = std::min(score_batch_size, score_total_size);
+    size_t score_batch_num = tlx::div_ceil(score_total_size, score_batch_size);
+
+    parallel_for(
+        0, score_batch_num, num_threads,
+        [&](size_t b) {
+            size_t score_begin = b * score_batch_size;
+            size_t score_end = std::min(
+                (b + 1) * score_batch_size, score_total_size);
+            size_t score_size = score_end - score_begin;
+
+            die_unless(score_begin % 8 == 0);
+            score_begin = tlx::div_ceil(score_begin, 8);
+            score_size = tlx::div_ceil(score_size, 8);
+            size_t score_buffer_size = tlx::round_up(score_size, 8);
+
+            tlx::simple_vector<uint8_t> scratch(
+                num_hashes != 1 ? score_buffer_size : 0);
+
+            Timer thr_timer;
+            thr_timer.active(num_hashes != 1 ? "and+add rows" : "add rows");
+
+            for (size_t t = 0; t < term_counts.size(); ++t) {
+                const uint8_t* row;
+                if (num_hashes == 1) {
+                    row = index_file->row_data(hashes[t]) + score_begin;
+                }
+                else {
+                    // AND the term's hash rows into the scratch row
+                    const uint8_t* first =
+                        index_file->row_data(hashes[t * num_hashes])
+                        + score_begin;
+                    std::copy(first, first + score_size, scratch.data());
+                    for (size_t j = 1; j < num_hashes; ++j) {
+                        const uint8_t* next =
+                            index_file->row_data(hashes[t * num_hashes + j])
+                            + score_begin;
+                        uint64_t* scratch_64 =
+                            reinterpret_cast<uint64_t*>(scratch.data());
+                        size_t k = 0;
+                        for ( ; k + 8 <= score_size; k += 8) {
+                            scratch_64[k / 8] &=
+                                *reinterpret_cast<const uint64_t*>(next + k);
+                        }
+                        for ( ; k < score_size; ++k) {
+                            scratch[k] &= next[k];
+                        }
+                    }
+                    row = scratch.data();
+                }
+                // expand once per occurrence of the term in the query
+                for (uint32_t c = 0; c < term_counts[t]; ++c) {
+                    compute_counts(1, 1, score_start + 8 * score_begin,
+                                   row, score_size, score_buffer_size);
+                }
+            }
+
+            thr_timer.stop();
+            timer += thr_timer;
+        });
+}
+
+
+/*!
+ * Core scoring loop: gathers the rows of the given hashes batch by batch
+ * through the double-buffered I/O pipeline and accumulates them into the
+ * score array, including the extra passes for repeated terms. Used for a
+ * whole query's terms or, by the chunked 8-bit path, one term window at a
+ * time.
+ */
+template <typename Score>
+void score_term_rows(
+    const std::shared_ptr<IndexSearchFile>& index_file,
+    const std::vector<uint64_t>& hashes,
+    const std::vector<std::pair<uint32_t, uint32_t> >& repeated_terms,
+    Score* score_start, size_t num_threads, Timer& timer)
+{
+    static constexpr bool debug = false;
+
+    uint32_t num_hashes = index_file->num_hashes();
+    uint64_t page_size = index_file->page_size();
+    size_t score_total_size = index_file->counts_size();
+
+    size_t score_batch_size = 128;
+    score_batch_size = std::max(score_batch_size, 8 * page_size);
+    score_batch_size = std::min(score_batch_size, score_total_size);
+    size_t target_batches = tlx::div_ceil(score_total_size, score_batch_size);
+
+    // weight-balanced batch boundaries: granules of one index page
+    // (8 * page_size score columns) weighted by the page's gather cost,
+    // so the variably sized sub-indexes of a compact index yield batches
+    // of roughly equal gather work instead of equal column count, and
+    // workers finish together. classic indexes have uniform cost and get
+    // the previous equal-width batches.
+    size_t granule = 8 * page_size;
+    size_t num_granules = tlx::div_ceil(score_total_size, granule);
+
+    uint64_t total_weight = 0;
+    std::vector<uint64_t> granule_weights(num_granules);
+    for (size_t g = 0; g < num_granules; ++g) {
+        granule_weights[g] = index_file->gather_cost(g);
+        total_weight += granule_weights[g];
+    }
+    uint64_t target_weight = tlx::div_ceil(total_weight, target_batches);
+
+    std::vector<size_t> batch_bounds;
+    batch_bounds.push_back(0);
+    uint64_t weight = 0;
+    for (size_t g = 0; g < num_granules; ++g) {
+        weight += granule_weights[g];
+        if (weight >= target_weight && (g + 1) * granule < score_total_size) {
+            batch_bounds.push_back((g + 1) * granule);
+            weight = 0;
+        }
+    }
+    batch_bounds.push_back(score_total_size);
+    size_t score_batch_num = batch_bounds.size() - 1;
+
+    size_t max_batch_width = 0;
+    for (size_t b = 0; b < score_batch_num; ++b)
+        max_batch_width = std::max(max_batch_width,
+                                   batch_bounds[b + 1] - batch_bounds[b]);
+
+    LOG << "score_term_rows()"
+        << " num_hashes=" << num_hashes
+        << " page_size=" << page_size
+        << " score_total_size=" << score_total_size
+        << " score_batch_num=" << score_batch_num
+        << " max_batch_width=" << max_batch_width
+        << " hashes.size=" << hashes.size();
+
+    // maximum rows buffer of one batch, for preallocation of both pipeline
+    // buffers
+    size_t max_buffer_size =
+        tlx::round_up(tlx::div_ceil(max_batch_width, 8), 8) * hashes.size();
+
+    size_t num_workers = std::max<size_t>(
+        size_t(1), std::min<size_t>(num_threads, score_batch_num));
+
+    // NUMA mode: give each node one contiguous span of score batches and
+    // its share of the workers, so row gathers and score updates stay on
+    // the node owning the pages. with one node this degenerates to the
+    // usual single shared batch counter.
+    size_t num_nodes = 1;
+    if (gopt_numa_aware) {
+        num_nodes = std::max<size_t>(numa_topology().node_cpus.size(), 1);
+        num_nodes = std::min(num_nodes, num_workers);
+    }
+    struct alignas(64) NodeRange {
+        size_t batch_begin, batch_end;
+        std::atomic<size_t> counter { 0 };
+    };
+    std::vector<NodeRange> node_ranges(num_nodes);
+    for (size_t n = 0; n < num_nodes; ++n) {
+        node_ranges[n].batch_begin = n * score_batch_num / num_nodes;
+        node_ranges[n].batch_end = (n + 1) * score_batch_num / num_nodes;
+    }
+
+    parallel_for(
+        0, num_workers, num_threads,
+        [&](size_t worker) {
+            size_t node = worker * num_nodes / num_workers;
+            NodeRange& node_range = node_ranges[node];
+            if (num_nodes > 1) {
+                numa_pin_thread(node);
+                // the node's first worker migrates the score segment of
+                // its batch span; the index rows themselves interleave
+                // nodes below page granularity and are left in place
+                if (worker == 0
+                    || (worker - 1) * num_nodes / num_workers != node) {
+                    size_t col_begin = batch_bounds[node_range.batch_begin];
+                    size_t col_end = batch_bounds[node_range.batch_end];
+                    if (col_end > col_begin) {
+                        numa_move_memory(
+                            score_start + col_begin,
+                            (col_end - col_begin) * sizeof(Score), node);
+                    }
+                }
+            }
+
+            //! batch handed from the I/O stage to the compute stage
+            struct Slot {
+                size_t score_begin, score_size, score_buffer_size;
+                bool last;
+            };
+
+            // two-stage pipeline: a dedicated I/O thread gathers the next
+            // batch into one rows buffer while this thread expands the
+            // other, so disk reads overlap score accumulation. the
+            // buffers are rented from the thread's arena: read_from_disk
+            // overwrites them completely, so no zeroing is needed and the
+            // memory is reused across batches and queries
+            uint8_t* rows[2] = {
+                BufferArena::rent(max_buffer_size),
+                BufferArena::rent(max_buffer_size)
+            };
+            Slot slots[2];
+            tlx::Semaphore slots_free(2), slots_full(0);
+
+            Timer io_timer;
+            std::thread io_thread(
+                [&]() {
+                    size_t w = 0, b;
+                    while ((b = node_range.batch_begin + node_range.counter++)
+                           < node_range.batch_end) {
+                        size_t score_begin = batch_bounds[b];
+                        size_t score_end = batch_bounds[b + 1];
+                        size_t score_size = score_end - score_begin;
+                        LOG << "search()"
+                            << " score_begin=" << score_begin
+                            << " score_end=" << score_end
+                            << " score_size=" << score_size
+                            << " rows buffer=" << score_size * hashes.size();
+
+                        die_unless(score_begin % 8 == 0);
+                        score_begin = tlx::div_ceil(score_begin, 8);
+                        score_size = tlx::div_ceil(score_size, 8);
+                        size_t score_buffer_size = tlx::round_up(score_size, 8);
+
+                        slots_free.wait();
+
+                        LOG << "read_from_disk";
+                        io_timer.active("io");
+                        index_file->read_from_disk(
+                            hashes, rows[w],
+                            score_begin, score_size, score_buffer_size);
+                        index_file->bytes_gathered_ +=
+                            hashes.size() * score_size;
+                        io_timer.stop();
+
+                        slots[w] = Slot {
+                            score_begin, score_size, score_buffer_size, false
+                        };
+                        slots_full.signal();
+                        w ^= 1;
+                    }
+                    // sentinel slot terminates the compute stage
+                    slots_free.wait();
+                    slots[w].last = true;
+                    slots_full.signal();
+                });
+
+            Timer thr_timer;
+            size_t w = 0;
+            while (true) {
+                slots_full.wait();
+                if (slots[w].last)
+                    break;
+
+                size_t score_begin = slots[w].score_begin;
+                size_t score_size = slots[w].score_size;
+                size_t score_buffer_size = slots[w].score_buffer_size;
+
+                bool scored_on_gpu = false;
+#if defined(COBS_HAVE_CUDA)
+                if (gopt_use_gpu) {
+                    // AND + expansion + accumulate on the device; falls
+                    // back to the CPU kernels on any CUDA error
+                    LOG << "gpu_score_rows";
+                    thr_timer.active("gpu rows");
+                    scored_on_gpu = gpu_score_rows(
+                        num_hashes, hashes.size(),
+                        score_start + 8 * score_begin, rows[w],
+                        score_size, score_buffer_size);
+                }
+#endif
+                if (scored_on_gpu) {
+                    // repeated term weighting below stays on the CPU and
+                    // needs the term groups' AND rows, which the CPU path
+                    // produces as a side effect of the fused kernel
+                    if (num_hashes != 1 && !repeated_terms.empty()) {
+                        for (const auto& rt : repeated_terms) {
+                            aggregate_rows(
+                                num_hashes, num_hashes,
+                                rows[w] + rt.first * num_hashes
+                                * score_buffer_size,
+                                score_size, score_buffer_size);
+                        }
+                    }
+                }
+                else if (num_hashes != 1) {
+                    LOG << "aggregate_rows_and_compute_counts";
+                    thr_timer.active("and+add rows");
+                    aggregate_rows_and_compute_counts(
+                        num_hashes, hashes.size(),
+                        score_start + 8 * score_begin, rows[w],
+                        score_size, score_buffer_size);
+                }
+                else {
+                    LOG << "compute_counts";
+                    thr_timer.active("add rows");
+                    compute_counts(num_hashes, hashes.size(),
+                                   score_start + 8 * score_begin, rows[w],
+                                   score_size, score_buffer_size);
+                }
+                // weight duplicated terms: the first row of each term
+                // group now holds the AND of its hash rows, expand it once
+                // more per extra occurrence
+                for (const auto& rt : repeated_terms) {
+                    const uint8_t* term_row =
+                        rows[w] + rt.first * num_hashes * score_buffer_size;
+                    for (uint32_t e = 0; e < rt.second; ++e) {
+                        compute_counts(1, 1,
+                                       score_start + 8 * score_begin,
+                                       term_row,
+                                       score_size, score_buffer_size);
+                    }
+                }
+                thr_timer.stop();
+
+                slots_free.signal();
+                w ^= 1;
+            }
+
+            io_thread.join();
+
+            BufferArena::release(rows[0]);
+            BufferArena::release(rows[1]);
+
+            if (num_nodes > 1)
+                numa_unpin_thread();
+
+            timer += io_timer;
+            timer += thr_timer;
+        });
+}
+
+
+/*!
+ * Early-exit scoring path: processes the terms of each score batch in
+ * chunks and checks after every chunk whether any document of the batch
+ * can still reach the threshold given the remaining term multiplicity.
+ * Eliminated batches keep their partial scores, which stay below the
+ * threshold and are filtered by counts_to_result as usual, so only
+ * passing documents ever need their full row scans. Trades the gather
+ * pipeline's I/O overlap for skipped work, which wins for selective
+ * thresholds.
+ */
+template <typename Score>
+void search_index_file_early_exit(
+    const std::shared_ptr<IndexSearchFile>& index_file,
+    const std::vector<uint64_t>& hashes,
+    const std::vector<uint32_t>& term_counts,
+    const std::vector<std::pair<uint32_t, uint32_t> >& repeated_terms,
+    size_t threshold_count, Score* score_start,
+    size_t num_threads, Timer& timer)
+{
+    static constexpr bool debug = false;
+
+    uint32_t num_hashes = index_file->num_hashes();
+    uint64_t page_size = index_file->page_size();
+    size_t score_total_size = index_file->counts_size();
+    size_t num_terms = hashes.size() / num_hashes;
+
+    //! terms gathered and scored between two elimination checks
+    static const size_t chunk_terms = 32;
+
+    // achievable score from term t onward, counting multiplicities
+    std::vector<size_t> remaining_counts(num_terms + 1);
+    for (size_t t = num_terms; t != 0; --t)
+        remaining_counts[t - 1] = remaining_counts[t] + term_counts[t - 1];
+
+    size_t score_batch_size = 128;
+    score_batch_size = std::max(score_batch_size, 8 * page_size);
+    score_batch_size = std::min(score_batch_size, score_total_size);
+    size_t score_batch_num = tlx::div_ceil(score_total_size, score_batch_size);
+
+    size_t max_buffer_size =
+        tlx::round_up(tlx::div_ceil(score_batch_size, 8), 8)
+        * num_hashes * chunk_terms;
+
+    size_t num_workers = std::max<size_t>(
+        size_t(1), std::min<size_t>(num_threads, score_batch_num));
+    std::atomic<size_t> batch_counter { 0 };
+
+    parallel_for(
+        0, num_workers, num_threads,
+        [&](size_t) {
+            uint8_t* rows = BufferArena::rent(max_buffer_size);
+            std::vector<uint64_t> chunk_hashes;
+
+            Timer thr_timer;
+            size_t b;
+            while ((b = batch_counter++) < score_batch_num) {
+                size_t score_begin = b * score_batch_size;
+                size_t score_end = std::min(
+                    (b + 1) * score_batch_size, score_total_size);
+                size_t score_size = score_end - score_begin;
+
+                die_unless(score_begin % 8 == 0);
+                score_begin = tlx::div_ceil(score_begin, 8);
+                score_size = tlx::div_ceil(score_size, 8);
+                size_t score_buffer_size = tlx::round_up(score_size, 8);
+                Score* scores = score_start + 8 * score_begin;
+
+                size_t terms_done = 0;
+                while (terms_done < num_terms) {
+                    size_t n = std::min(chunk_terms, num_terms - terms_done);
+                    chunk_hashes.assign(
+                        hashes.begin() + terms_done * num_hashes,
+                        hashes.begin() + (terms_done + n) * num_hashes);
+
+                    thr_timer.active("io");
+                    index_file->read_from_disk(
+                        chunk_hashes, rows,
+                        score_begin, score_size, score_buffer_size);
+                    index_file->bytes_gathered_ +=
+                        chunk_hashes.size() * score_size;
+
+                    if (num_hashes != 1) {
+                        thr_timer.active("and+add rows");
+                        aggregate_rows_and_compute_counts(
+                            num_hashes, chunk_hashes.size(), scores, rows,
+                            score_size, score_buffer_size);
+                    }
+                    else {
+                        thr_timer.active("add rows");
+                        compute_counts(
+                            num_hashes, chunk_hashes.size(), scores, rows,
+                            score_size, score_buffer_size);
+                    }
+                    for (const auto& rt : repeated_terms) {
+                        if (rt.first < terms_done || rt.first >= terms_done + n)
+                            continue;
+                        const uint8_t* term_row =
+                            rows + (rt.first - terms_done)
+                            * num_hashes * score_buffer_size;
+                        for (uint32_t e = 0; e < rt.second; ++e) {
+                            compute_counts(1, 1, scores, term_row,
+                                           score_size, score_buffer_size);
+                        }
+                    }
+                    thr_timer.stop();
+                    terms_done += n;
+
+                    if (terms_done >= num_terms)
+                        break;
+
+                    // can any document of this batch still pass?
+                    Score max_score = 0;
+                    for (size_t j = 0; j < 8 * score_size; ++j)
+                        max_score = std::max(max_score, scores[j]);
+                    if (max_score + remaining_counts[terms_done]
+                        < threshold_count) {
+                        LOG << "early exit"
+                            << " batch=" << b
+                            << " terms_done=" << terms_done
+                            << " max_score=" << size_t(max_score);
+                        break;
+                    }
+                }
+            }
+
+            BufferArena::release(rows);
+            timer += thr_timer;
+        });
+}
+
+template <typename Score>
+void search_index_file(
+    size_t file_num, const std::shared_ptr<IndexSearchFile>& index_file,
+    const std::string& query, Score* score_list, size_t num_threads,
+    std::atomic<size_t>& total_hashes,
+    const std::vector<size_t>& sum_doc_counts,
+    size_t threshold_count,
+    Timer& timer)
+{
+    TraceScope trace("search_index_file");
+
+    uint32_t num_hashes = index_file->num_hashes();
+    uint32_t term_size = index_file->term_size();
+
+    assert_exit(query.size() - term_size < std::numeric_limits<Score>::max(),
+                "query too long, can not be longer than "
+                + std::to_string(
+                    std::numeric_limits<Score>::max() + term_size - 1)
+                + " characters");
+
+    Timer hash_timer;
+    hash_timer.active("hashes");
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> term_counts;
+
+    tlx::simple_vector<char> canonicalize_buffer(term_size);
+    create_hashes(hashes, term_counts, query,
+                  canonicalize_buffer.data(), index_file);
+
+    // terms with duplicates in the query: their aggregated row gets
+    // (multiplicity - 1) extra expansion passes after the main kernel
+    std::vector<std::pair<uint32_t, uint32_t> > repeated_terms;
+    for (size_t t = 0; t < term_counts.size(); ++t) {
+        if (term_counts[t] > 1)
+            repeated_terms.emplace_back(t, term_counts[t] - 1);
+    }
+
+    total_hashes += num_hashes * (query.size() - term_size + 1);
+    hash_timer.stop();
+    timer += hash_timer;
+
+    if (index_file->memory_resident()) {
+        // score straight from the loaded index data, no row gather
+        return search_index_file_resident(
+            index_file, hashes, term_counts,
+            score_list + sum_doc_counts[file_num], num_threads, timer);
+    }
+
+    if (gopt_early_exit && threshold_count > 0) {
+        return search_index_file_early_exit(
+            index_file, hashes, term_counts, repeated_terms, threshold_count,
+            score_list + sum_doc_counts[file_num], num_threads, timer);
+    }
+
+    score_term_rows(index_file, hashes, repeated_terms,
+                    score_list + sum_doc_counts[file_num], num_threads, timer);
+}
+
+/*!
+ * Chunked 8-bit scoring for long queries: the terms are split into
+ * windows of at most 255 k-mer occurrences, each window is scored into a
+ * per-file uint8_t array with the fast 8-bit kernels, and the partial
+ * counts are flushed into the wide uint32_t accumulator between windows.
+ * Whole-genome queries thus keep 8-bit SIMD throughput instead of
+ * dropping to the 16/32-bit kernels, and the previous hard length cap of
+ * the 32-bit path disappears (scores beyond UINT32_MAX cannot be
+ * represented in SearchResult anyway). Terms repeated more than 255
+ * times are split across windows.
+ */
+void search_index_file_chunked(
+    size_t file_num, const std::shared_ptr<IndexSearchFile>& index_file,
+    const std::string& query, uint32_t* score_list, size_t num_threads,
+    std::atomic<size_t>& total_hashes,
+    const std::vector<size_t>& sum_doc_counts,
+    Timer& timer)
+{
+    uint32_t num_hashes = index_file->num_hashes();
+    uint32_t term_size = index_file->term_size();
+    size_t score_total_size = index_file->counts_size();
+
+    Timer hash_timer;
+    hash_timer.active("hashes");
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> term_counts;
+
+    tlx::simple_vector<char> canonicalize_buffer(term_size);
+    create_hashes(hashes, term_counts, query,
+                  canonicalize_buffer.data(), index_file);
+
+    total_hashes += num_hashes * (query.size() - term_size + 1);
+    hash_timer.stop();
+    timer += hash_timer;
+
+    size_t num_terms = term_counts.size();
+    uint32_t* accumulator = score_list + sum_doc_counts[file_num];
+
+    uint8_t* partial = BufferArena::rent(score_total_size * sizeof(uint8_t));
+
+    size_t t = 0;
+    uint32_t count_left = num_terms != 0 ? term_counts[0] : 0;
+    while (t < num_terms) {
+        // fill the next window up to 255 occurrences, splitting the
+        // multiplicity of heavily repeated terms when necessary
+        size_t window_begin = t;
+        std::vector<uint32_t> window_counts;
+        size_t capacity = std::numeric_limits<uint8_t>::max();
+        while (t < num_terms && capacity != 0) {
+            uint32_t take = std::min<uint32_t>(count_left, capacity);
+            window_counts.push_back(take);
+            capacity -= take;
+            count_left -= take;
+            if (count_left != 0)
+                break;
+            if (++t < num_terms)
+                count_left = term_counts[t];
+        }
+
+        std::vector<uint64_t> window_hashes(
+            hashes.begin() + window_begin * num_hashes,
+            hashes.begin() + (window_begin + window_counts.size())
+            * num_hashes);
+
+        std::fill(partial, partial + score_total_size, 0);
+
+        if (index_file->memory_resident()) {
+            search_index_file_resident(
+                index_file, window_hashes, window_counts,
+                partial, num_threads, timer);
+        }
+        else {
+            std::vector<std::pair<uint32_t, uint32_t> > window_repeated;
+            for (size_t i = 0; i < window_counts.size(); ++i) {
+                if (window_counts[i] > 1)
+                    window_repeated.emplace_back(i, window_counts[i] - 1);
+            }
+            score_term_rows(index_file, window_hashes, window_repeated,
+                            partial, num_threads, timer);
+        }
+
+        Timer flush_timer;
+        flush_timer.active("flush counts");
+        for (size_t j = 0; j < score_total_size; ++j)
+            accumulator[j] += partial[j];
+        flush_timer.stop();
+        timer += flush_timer;
+    }
+
+    BufferArena::release(partial);
+}
+
+/*!
+ * Subset scoring path: gathers only the row bytes covering a sorted set of
+ * document ids of one index file. A document's bit occupies the same byte
+ * offset (id / 8) in every signature row, so the subset is first coalesced
+ * into covering byte ranges -- aligned to the index's page size and
+ * bridging small gaps, since a few spare bytes are cheaper than another
+ * gather pass -- and each range is then scored like an ordinary score
+ * batch into its segment of the subset-sized score array.
+ */
+template <typename Score>
+static void search_index_file_subset(
+    const std::shared_ptr<IndexSearchFile>& index_file,
+    const std::string& query,
+    const std::vector<uint32_t>& doc_ids,
+    std::vector<std::pair<size_t, size_t> >& ranges,
+    std::vector<size_t>& range_offsets,
+    std::vector<Score>& scores,
+    size_t num_threads,
+    std::atomic<size_t>& total_hashes, Timer& timer)
+{
+    uint32_t num_hashes = index_file->num_hashes();
+    uint32_t term_size = index_file->term_size();
+    uint64_t row_size = index_file->row_size();
+
+    Timer hash_timer;
+    hash_timer.active("hashes");
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> term_counts;
+
+    tlx::simple_vector<char> canonicalize_buffer(term_size);
+    create_hashes(hashes, term_counts, query,
+                  canonicalize_buffer.data(), index_file);
+
+    std::vector<std::pair<uint32_t, uint32_t> > repeated_terms;
+    for (size_t t = 0; t < term_counts.size(); ++t) {
+        if (term_counts[t] > 1)
+            repeated_terms.emplace_back(t, term_counts[t] - 1);
+    }
+
+    total_hashes += num_hashes * (query.size() - term_size + 1);
+    hash_timer.stop();
+    timer += hash_timer;
+
+    // covering byte ranges of the subset; compact backends gather whole
+    // pages, so the granule is the index's page size
+    size_t granule = index_file->page_size();
+    size_t coalesce_gap = std::max<size_t>(granule, 64);
+    for (const uint32_t& d : doc_ids) {
+        size_t byte = d / 8;
+        size_t range_begin = byte - byte % granule;
+        size_t range_end = std::min<size_t>(
+            row_size, tlx::round_up(byte + 1, granule));
+        if (!ranges.empty() &&
+            range_begin <= ranges.back().second + coalesce_gap) {
+            ranges.back().second = std::max(ranges.back().second, range_end);
+        }
+        else {
+            ranges.emplace_back(range_begin, range_end);
+        }
+    }
+
+    // score segment offsets, padded to the kernels' 8-byte granularity
+    range_offsets.resize(ranges.size() + 1);
+    range_offsets[0] = 0;
+    for (size_t r = 0; r < ranges.size(); ++r) {
+        range_offsets[r + 1] = range_offsets[r]
+                               + tlx::round_up(
+            ranges[r].second - ranges[r].first, 8);
+    }
+    scores.assign(8 * range_offsets.back(), 0);
+
+    size_t num_terms = term_counts.size();
+
+    //! terms gathered per read_from_disk call, bounding the rows buffer
+    static const size_t chunk_terms = 32;
+
+    parallel_for(
+        0, ranges.size(), num_threads,
+        [&](size_t r) {
+            size_t score_begin = ranges[r].first;
+            size_t score_size = ranges[r].second - ranges[r].first;
+            size_t score_buffer_size = tlx::round_up(score_size, 8);
+            Score* score_start = scores.data() + 8 * range_offsets[r];
+
+            uint8_t* rows = BufferArena::rent(
+                chunk_terms * num_hashes * score_buffer_size);
+            std::vector<uint64_t> chunk_hashes;
+
+            Timer thr_timer;
+            for (size_t terms_done = 0; terms_done < num_terms; ) {
+                size_t n = std::min(chunk_terms, num_terms - terms_done);
+                chunk_hashes.assign(
+                    hashes.begin() + terms_done * num_hashes,
+                    hashes.begin() + (terms_done + n) * num_hashes);
+
+                thr_timer.active("io");
+                index_file->read_from_disk(
+                    chunk_hashes, rows,
+                    score_begin, score_size, score_buffer_size);
+                index_file->bytes_gathered_ +=
+                    chunk_hashes.size() * score_size;
+
+                if (num_hashes != 1) {
+                    thr_timer.active("and+add rows");
+                    aggregate_rows_and_compute_counts(
+                        num_hashes, chunk_hashes.size(), score_start, rows,
+                        score_size, score_buffer_size);
+                }
+                else {
+                    thr_timer.active("add rows");
+                    compute_counts(
+                        num_hashes, chunk_hashes.size(), score_start, rows,
+                        score_size, score_buffer_size);
+                }
+                for (const auto& rt : repeated_terms) {
+                    if (rt.first < terms_done || rt.first >= terms_done + n)
+                        continue;
+                    const uint8_t* term_row =
+                        rows + (rt.first - terms_done)
+                        * num_hashes * score_buffer_size;
+                    for (uint32_t e = 0; e < rt.second; ++e) {
+                        compute_counts(1, 1, score_start, term_row,
+                                       score_size, score_buffer_size);
+                    }
+                }
+                thr_timer.stop();
+                terms_done += n;
+            }
+
+            BufferArena::release(rows);
+            timer += thr_timer;
+        });
+}
+
+/*!
+ * Score the subset's documents over all index files and emit the results,
+ * ordered like counts_to_result: descending score, ties by ascending id.
+ */
+template <typename Score>
+static void search_subset_scores(
+    const std::vector<std::shared_ptr<IndexSearchFile> >& index_files,
+    const std::string& query,
+    const std::vector<uint32_t>& sorted_ids,
+    const std::vector<size_t>& sum_docs,
+    const std::vector<size_t>& thresholds,
+    std::vector<SearchResult>& result, size_t num_results,
+    std::atomic<size_t>& total_hashes, Timer& timer)
+{
+    std::vector<std::pair<Score, std::pair<uint16_t, uint32_t> > > candidates;
+    candidates.reserve(sorted_ids.size());
+
+    auto id_begin = sorted_ids.begin();
+    for (size_t k = 0; k < index_files.size(); ++k) {
+        auto id_end = std::lower_bound(
+            id_begin, sorted_ids.end(), uint32_t(sum_docs[k + 1]));
+        if (id_begin == id_end)
+            continue;
+
+        std::vector<uint32_t> local_ids(id_end - id_begin);
+        for (size_t i = 0; i < local_ids.size(); ++i)
+            local_ids[i] = uint32_t(*(id_begin + i) - sum_docs[k]);
+        id_begin = id_end;
+
+        std::vector<std::pair<size_t, size_t> > ranges;
+        std::vector<size_t> range_offsets;
+        std::vector<Score> scores;
+        search_index_file_subset(
+            index_files[k], query, local_ids, ranges, range_offsets, scores,
+            std::max<size_t>(gopt_threads, 1), total_hashes, timer);
+
+        // pick the subset's score slots out of the range segments,
+        // applying the same calibration as counts_to_result
+        const std::vector<double>& densities =
+            index_files[k]->doc_densities();
+        bool calibrate = gopt_calibrate_scores &&
+                         densities.size() ==
+                         index_files[k]->num_documents();
+        size_t num_terms = query.size() - index_files[k]->term_size() + 1;
+
+        size_t r = 0;
+        for (const uint32_t& d : local_ids) {
+            while (size_t(d) / 8 >= ranges[r].second)
+                ++r;
+            Score s = scores[8 * range_offsets[r] + (d - 8 * ranges[r].first)];
+            if (calibrate) {
+                s = calibrate_score(s, densities[d],
+                                    double(index_files[k]->num_hashes()),
+                                    num_terms);
+            }
+            if (s >= thresholds[k])
+                candidates.emplace_back(s, std::make_pair(uint16_t(k), d));
+        }
     }
-#endif
-    return compute_counts_u32_64(
-        num_hashes, hashes_size, scores, rows, size, buffer_size);
-}
 
-/******************************************************************************/
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto& v1, const auto& v2) {
+                  return (std::tie(v2.first, v1.second)
+                          < std::tie(v1.first, v2.second));
+              });
+
+    num_results = std::min(num_results, candidates.size());
+    result.resize(num_results);
+    for (size_t i = 0; i < num_results; ++i) {
+        size_t index_id = candidates[i].second.first;
+        size_t document_id = candidates[i].second.second;
+
+        result[i] = SearchResult(
+            index_files[index_id]->doc_names()[document_id],
+            candidates[i].first);
+    }
+}
 
-static inline
-void aggregate_rows(
-    uint64_t num_hashes, size_t hashes_size, uint8_t* rows,
-    const size_t size, size_t buffer_size)
+/*!
+ * Run functor(file_num) for all index shards, concurrently on dedicated
+ * threads when several shards and threads are available. The shards' batch
+ * pipelines share the global thread pool underneath.
+ */
+template <typename Functor>
+static void parallel_for_index_files(size_t num_files, Functor&& functor)
 {
-    for (uint64_t i = 0; i < hashes_size; i += num_hashes) {
-        uint8_t* rows_8 = rows + i * buffer_size;
-        uint64_t* rows_64 = reinterpret_cast<uint64_t*>(rows_8);
-        for (size_t j = 1; j < num_hashes; ++j) {
-            uint8_t* rows_8_j = rows_8 + j * buffer_size;
-            uint64_t* rows_64_j = reinterpret_cast<uint64_t*>(rows_8_j);
+    if (num_files == 1 || gopt_threads <= 1) {
+        for (size_t f = 0; f < num_files; ++f)
+            functor(f);
+        return;
+    }
 
-            assert((i * buffer_size + j * buffer_size) % 8 == 0);
-            for (size_t k = 0; k < size / 8; ++k) {
-                sLOG0 << i << hashes_size
-                      << j << num_hashes << size
-                      << reinterpret_cast<uint8_t*>(rows_64 + k) - rows
-                      << reinterpret_cast<uint8_t*>(rows_64_j + k) - rows
-                      << size * hashes_size;
-                rows_64[k] &= rows_64_j[k];
-            }
-            size_t k = (size / 8) * 8;
-            while (k < size) {
-                rows_8[k] &= rows_8_j[k];
-                k++;
-            }
-        }
+    std::atomic<size_t> file_counter { 0 };
+    std::exception_ptr eptr;
+    std::vector<std::thread> threads;
+    size_t num_shard_threads = std::min(num_files, gopt_threads);
+
+    for (size_t t = 0; t < num_shard_threads; ++t) {
+        threads.emplace_back(
+            [&]() {
+                try {
+                    size_t f;
+                    while ((f = file_counter++) < num_files)
+                        functor(f);
+                }
+                catch (...) {
+                    eptr = std::current_exception();
+                }
+            });
     }
+    for (std::thread& t : threads)
+        t.join();
+    if (eptr)
+        std::rethrow_exception(eptr);
 }
 
+/*!
+ * Batch counterpart of search_index_file(): gathers each distinct term's
+ * rows once per score batch and scatters the aggregated rows into every
+ * querying score array.
+ */
 template <typename Score>
-void search_index_file(
+void search_index_file_batch(
     size_t file_num, const std::shared_ptr<IndexSearchFile>& index_file,
-    const std::string& query, Score* score_list,
-    size_t& total_hashes, const std::vector<size_t>& sum_doc_counts,
+    const std::vector<std::string>& queries,
+    const std::vector<Score*>& score_lists, size_t num_threads,
+    std::atomic<size_t>& total_hashes,
+    const std::vector<size_t>& sum_doc_counts,
     Timer& timer)
 {
     static constexpr bool debug = false;
@@ -320,66 +1991,69 @@ void search_index_file(
     uint64_t page_size = index_file->page_size();
     size_t score_total_size = index_file->counts_size();
 
-    assert_exit(query.size() - term_size < std::numeric_limits<Score>::max(),
-                "query too long, can not be longer than "
-                + std::to_string(
-                    std::numeric_limits<Score>::max() + term_size - 1)
-                + " characters");
+    for (const std::string& query : queries) {
+        assert_exit(
+            query.size() - term_size < std::numeric_limits<Score>::max(),
+            "query too long, can not be longer than "
+            + std::to_string(
+                std::numeric_limits<Score>::max() + term_size - 1)
+            + " characters");
+    }
 
-    timer.active("hashes");
+    Timer hash_timer;
+    hash_timer.active("hashes");
     std::vector<uint64_t> hashes;
+    std::vector<std::vector<uint32_t> > query_terms;
 
     tlx::simple_vector<char> canonicalize_buffer(term_size);
-    create_hashes(hashes, query, canonicalize_buffer.data(), index_file);
+    create_batch_hashes(hashes, query_terms, queries,
+                        canonicalize_buffer.data(), index_file);
 
     total_hashes += hashes.size();
-    timer.stop();
+    hash_timer.stop();
+    timer += hash_timer;
 
     size_t score_batch_size = 128;
     score_batch_size = std::max(score_batch_size, 8 * page_size);
     score_batch_size = std::min(score_batch_size, score_total_size);
     size_t score_batch_num = tlx::div_ceil(score_total_size, score_batch_size);
-    Score* score_start = score_list + sum_doc_counts[file_num];
 
-    LOG << "ClassicSearch::search()"
+    LOG << "ClassicSearch::search_batch()"
         << " file_num=" << file_num
         << " num_hashes=" << num_hashes
         << " term_size=" << term_size
         << " page_size=" << page_size
-        << " score_start=" << sum_doc_counts[file_num]
         << " score_total_size=" << score_total_size
         << " score_batch_size=" << score_batch_size
         << " score_batch_num=" << score_batch_num
+        << " queries.size=" << queries.size()
         << " hashes.size=" << hashes.size();
 
     parallel_for(
-        0, score_batch_num, gopt_threads,
+        0, score_batch_num, num_threads,
         [&](size_t b) {
             Timer thr_timer;
             size_t score_begin = b * score_batch_size;
             size_t score_end =
                 std::min((b + 1) * score_batch_size, score_total_size);
             size_t score_size = score_end - score_begin;
-            LOG << "search()"
-                << " score_begin=" << score_begin
-                << " score_end=" << score_end
-                << " score_size=" << score_size
-                << " rows buffer=" << score_size * hashes.size();
 
             die_unless(score_begin % 8 == 0);
             score_begin = tlx::div_ceil(score_begin, 8);
             score_size = tlx::div_ceil(score_size, 8);
             size_t score_buffer_size = tlx::round_up(score_size, 8);
 
-            // rows array: interleaved as
-            // [ hash0[doc0, doc1, ..., doc(score_size)], hash1[doc0, ...], ...]
-            uint8_t* rows = allocate_aligned<uint8_t>(
-                score_buffer_size * hashes.size(), get_page_size());
+            // rows array of the distinct terms, interleaved as in
+            // search_index_file(), rented unzeroed since read_from_disk
+            // overwrites it
+            uint8_t* rows =
+                BufferArena::rent(score_buffer_size * hashes.size());
 
             LOG << "read_from_disk";
             thr_timer.active("io");
             index_file->read_from_disk(
                 hashes, rows, score_begin, score_size, score_buffer_size);
+            index_file->bytes_gathered_ += hashes.size() * score_size;
 
             if (num_hashes != 1) {
                 LOG << "aggregate_rows";
@@ -390,11 +2064,18 @@ void search_index_file(
 
             LOG << "compute_counts";
             thr_timer.active("add rows");
-            compute_counts(num_hashes, hashes.size(),
-                           score_start + 8 * score_begin, rows,
-                           score_size, score_buffer_size);
+            for (size_t q = 0; q < queries.size(); ++q) {
+                Score* scores = score_lists[q]
+                                + sum_doc_counts[file_num] + 8 * score_begin;
+                for (const uint32_t& term : query_terms[q]) {
+                    compute_counts(
+                        num_hashes, num_hashes, scores,
+                        rows + term * num_hashes * score_buffer_size,
+                        score_size, score_buffer_size);
+                }
+            }
 
-            deallocate_aligned(rows);
+            BufferArena::release(rows);
 
             timer += thr_timer;
         });
@@ -432,6 +2113,14 @@ void ClassicSearch::search(
                 "query too short, needs to be at least "
                 + std::to_string(max_term_size) + " characters long");
 
+    uint64_t cache_key = 0;
+    if (result_cache_) {
+        cache_key = result_cache_key(
+            index_files_, query, threshold, num_results);
+        if (result_cache_->lookup(cache_key, result))
+            return;
+    }
+
     const size_t total_documents = sum_doc_counts[index_files_.size()];
 
     LOG << "ClassicSearch::search()"
@@ -439,7 +2128,23 @@ void ClassicSearch::search(
         << " sum_doc_counts=" << sum_doc_counts
         << " total_documents=" << total_documents;
 
-    size_t total_hashes = 0;
+    std::atomic<size_t> total_hashes { 0 };
+
+    // per-call timer: search() must stay re-entrant, so worker threads
+    // aggregate into this local instance and only the final merge below
+    // touches the shared timer_ (Timer::operator+= is internally locked)
+    Timer call_timer;
+
+    // distribute the thread budget over the index shards and process the
+    // shards concurrently; the score_list segments of different shards are
+    // disjoint via sum_doc_counts
+    size_t threads_per_file = tlx::div_ceil(
+        std::max<size_t>(gopt_threads, 1), index_files_.size());
+
+    auto for_each_index_file =
+        [&](auto&& functor) {
+            parallel_for_index_files(index_files_.size(), functor);
+        };
 
     std::vector<size_t> thresholds(index_files_.size());
     for (size_t i = 0; i < index_files_.size(); ++i) {
@@ -455,53 +2160,308 @@ void ClassicSearch::search(
     {
         uint8_t* score_list = allocate_aligned<uint8_t>(total_documents, 16);
 
-        for (size_t file_num = 0; file_num < index_files_.size(); ++file_num)
-        {
-            search_index_file(
-                file_num, index_files_[file_num],
-                query, score_list,
-                total_hashes, sum_doc_counts, timer_);
-        }
+        for_each_index_file(
+            [&](size_t file_num) {
+                search_index_file(
+                    file_num, index_files_[file_num],
+                    query, score_list, threads_per_file,
+                    total_hashes, sum_doc_counts,
+                    thresholds[file_num], call_timer);
+            });
+
+        counts_to_result(index_files_, score_list, result, thresholds,
+                         num_results, total_hashes.load(), sum_doc_counts,
+                         query.size());
+    }
+    else if (!classic_search_disable_8bit && !gopt_early_exit)
+    {
+        // long query: chunked scoring keeps the 8-bit kernels and flushes
+        // window counts into a wide accumulator (early exit needs running
+        // totals per document and uses the wide kernels instead)
+        uint32_t* score_list = allocate_aligned<uint32_t>(total_documents, 16);
+
+        for_each_index_file(
+            [&](size_t file_num) {
+                search_index_file_chunked(
+                    file_num, index_files_[file_num],
+                    query, score_list, threads_per_file,
+                    total_hashes, sum_doc_counts, call_timer);
+            });
 
         counts_to_result(index_files_, score_list, result, thresholds,
-                         num_results, total_hashes, sum_doc_counts);
+                         num_results, total_hashes.load(), sum_doc_counts,
+                         query.size());
     }
     else if (!classic_search_disable_16bit &&
              query.size() - max_term_size < UINT16_MAX)
     {
         uint16_t* score_list = allocate_aligned<uint16_t>(total_documents, 16);
 
-        for (size_t file_num = 0; file_num < index_files_.size(); ++file_num)
-        {
-            search_index_file(
-                file_num, index_files_[file_num],
-                query, score_list,
-                total_hashes, sum_doc_counts, timer_);
-        }
+        for_each_index_file(
+            [&](size_t file_num) {
+                search_index_file(
+                    file_num, index_files_[file_num],
+                    query, score_list, threads_per_file,
+                    total_hashes, sum_doc_counts,
+                    thresholds[file_num], call_timer);
+            });
 
         counts_to_result(index_files_, score_list, result, thresholds,
-                         num_results, total_hashes, sum_doc_counts);
+                         num_results, total_hashes.load(), sum_doc_counts,
+                         query.size());
     }
     else if (!classic_search_disable_32bit &&
              query.size() - max_term_size < UINT32_MAX)
     {
         uint32_t* score_list = allocate_aligned<uint32_t>(total_documents, 16);
 
-        for (size_t file_num = 0; file_num < index_files_.size(); ++file_num)
-        {
-            search_index_file(
-                file_num, index_files_[file_num],
-                query, score_list,
-                total_hashes, sum_doc_counts, timer_);
-        }
+        for_each_index_file(
+            [&](size_t file_num) {
+                search_index_file(
+                    file_num, index_files_[file_num],
+                    query, score_list, threads_per_file,
+                    total_hashes, sum_doc_counts,
+                    thresholds[file_num], call_timer);
+            });
 
         counts_to_result(index_files_, score_list, result, thresholds,
-                         num_results, total_hashes, sum_doc_counts);
+                         num_results, total_hashes.load(), sum_doc_counts,
+                         query.size());
+    }
+    else
+    {
+        assert_exit(false, "query too long");
+    }
+
+    if (result_cache_)
+        result_cache_->put(cache_key, result);
+
+    timer_ += call_timer;
+}
+
+void ClassicSearch::search_subset(
+    const std::string& query,
+    const std::vector<uint32_t>& doc_ids,
+    std::vector<SearchResult>& result,
+    double threshold, size_t num_results)
+{
+    result.clear();
+    if (index_files_.empty() || doc_ids.empty())
+        return;
+
+    // the id space is the concatenation of the index files' document
+    // lists, in index file order
+    std::vector<size_t> sum_docs(index_files_.size() + 1);
+    uint32_t max_term_size = 0;
+    for (size_t i = 0; i < index_files_.size(); ++i) {
+        sum_docs[i + 1] = sum_docs[i] + index_files_[i]->num_documents();
+        max_term_size = std::max(max_term_size,
+                                 index_files_[i]->term_size());
+    }
+
+    assert_exit(query.size() >= max_term_size,
+                "query too short, needs to be at least "
+                + std::to_string(max_term_size) + " characters long");
+
+    std::vector<uint32_t> sorted_ids(doc_ids);
+    std::sort(sorted_ids.begin(), sorted_ids.end());
+    sorted_ids.erase(std::unique(sorted_ids.begin(), sorted_ids.end()),
+                     sorted_ids.end());
+    if (sorted_ids.back() >= sum_docs.back())
+        die("search_subset: document id " << sorted_ids.back()
+            << " out of range, collection has " << sum_docs.back()
+            << " documents");
+
+    std::vector<size_t> thresholds(index_files_.size());
+    for (size_t i = 0; i < index_files_.size(); ++i) {
+        thresholds[i] = std::ceil(
+            threshold
+            * (query.size() - index_files_[i]->term_size() + 1));
+    }
+    num_results = num_results == 0 ? sorted_ids.size()
+                  : std::min(num_results, sorted_ids.size());
+
+    std::atomic<size_t> total_hashes { 0 };
+    Timer call_timer;
+
+    // subset queries bypass the result cache, its key does not cover the
+    // id set. no chunked long-query path either: subsets are small, so
+    // the wide kernels' extra cost is negligible.
+    if (!classic_search_disable_8bit &&
+        query.size() - max_term_size < UINT8_MAX)
+    {
+        search_subset_scores<uint8_t>(
+            index_files_, query, sorted_ids, sum_docs, thresholds,
+            result, num_results, total_hashes, call_timer);
+    }
+    else if (!classic_search_disable_16bit &&
+             query.size() - max_term_size < UINT16_MAX)
+    {
+        search_subset_scores<uint16_t>(
+            index_files_, query, sorted_ids, sum_docs, thresholds,
+            result, num_results, total_hashes, call_timer);
+    }
+    else if (!classic_search_disable_32bit &&
+             query.size() - max_term_size < UINT32_MAX)
+    {
+        search_subset_scores<uint32_t>(
+            index_files_, query, sorted_ids, sum_docs, thresholds,
+            result, num_results, total_hashes, call_timer);
+    }
+    else
+    {
+        assert_exit(false, "query too long");
+    }
+
+    timer_ += call_timer;
+}
+
+void ClassicSearch::search_batch(
+    const std::vector<std::string>& queries,
+    std::vector<std::vector<SearchResult> >& results,
+    double threshold, size_t num_results)
+{
+    static constexpr bool debug = false;
+
+    results.resize(queries.size());
+
+    if (index_files_.empty() || queries.empty())
+        return;
+
+    std::vector<size_t> sum_doc_counts(index_files_.size() + 1);
+
+    uint32_t max_term_size = 0;
+
+    // sum_doc_counts[i] - always rounded up to the next multiple of 8, see
+    // ClassicSearch::search()
+    sum_doc_counts[0] = 0;
+    for (size_t i = 1; i <= index_files_.size(); ++i) {
+        size_t counts_size = index_files_[i - 1]->counts_size();
+        die_unless(counts_size % 8 == 0);
+        sum_doc_counts[i] += sum_doc_counts[i - 1] + counts_size;
+
+        uint32_t term_size = index_files_[i - 1]->term_size();
+        max_term_size = std::max(max_term_size, term_size);
+    }
+
+    // the score width is selected for the longest query of the batch
+    size_t max_query_size = 0;
+    for (const std::string& query : queries) {
+        assert_exit(query.size() >= max_term_size,
+                    "query too short, needs to be at least "
+                    + std::to_string(max_term_size) + " characters long");
+        max_query_size = std::max(max_query_size, query.size());
+    }
+
+    const size_t total_documents = sum_doc_counts[index_files_.size()];
+
+    LOG << "ClassicSearch::search_batch()"
+        << " index_files_.size=" << index_files_.size()
+        << " queries.size=" << queries.size()
+        << " total_documents=" << total_documents;
+
+    std::atomic<size_t> total_hashes { 0 };
+
+    // per-call timer, merged into the shared timer_ once at the end as
+    // in search()
+    Timer call_timer;
+
+    size_t threads_per_file = tlx::div_ceil(
+        std::max<size_t>(gopt_threads, 1), index_files_.size());
+
+    num_results = num_results == 0 ? total_documents
+                  : std::min(num_results, total_documents);
+
+    // per-query thresholds depend on the query's own term count
+    auto make_thresholds =
+        [&](const std::string& query) {
+            std::vector<size_t> thresholds(index_files_.size());
+            for (size_t i = 0; i < index_files_.size(); ++i) {
+                thresholds[i] = std::ceil(
+                    threshold
+                    * (query.size() - index_files_[i]->term_size() + 1));
+            }
+            return thresholds;
+        };
+
+    if (!classic_search_disable_8bit &&
+        max_query_size - max_term_size < UINT8_MAX)
+    {
+        std::vector<uint8_t*> score_lists(queries.size());
+        for (size_t q = 0; q < queries.size(); ++q)
+            score_lists[q] = allocate_aligned<uint8_t>(total_documents, 16);
+
+        parallel_for_index_files(
+            index_files_.size(),
+            [&](size_t file_num) {
+                search_index_file_batch(
+                    file_num, index_files_[file_num],
+                    queries, score_lists, threads_per_file,
+                    total_hashes, sum_doc_counts, call_timer);
+            });
+
+        for (size_t q = 0; q < queries.size(); ++q) {
+            counts_to_result(index_files_, score_lists[q], results[q],
+                             make_thresholds(queries[q]),
+                             num_results, total_hashes.load(),
+                             sum_doc_counts, queries[q].size());
+            deallocate_aligned(score_lists[q]);
+        }
+    }
+    else if (!classic_search_disable_16bit &&
+             max_query_size - max_term_size < UINT16_MAX)
+    {
+        std::vector<uint16_t*> score_lists(queries.size());
+        for (size_t q = 0; q < queries.size(); ++q)
+            score_lists[q] = allocate_aligned<uint16_t>(total_documents, 16);
+
+        parallel_for_index_files(
+            index_files_.size(),
+            [&](size_t file_num) {
+                search_index_file_batch(
+                    file_num, index_files_[file_num],
+                    queries, score_lists, threads_per_file,
+                    total_hashes, sum_doc_counts, call_timer);
+            });
+
+        for (size_t q = 0; q < queries.size(); ++q) {
+            counts_to_result(index_files_, score_lists[q], results[q],
+                             make_thresholds(queries[q]),
+                             num_results, total_hashes.load(),
+                             sum_doc_counts, queries[q].size());
+            deallocate_aligned(score_lists[q]);
+        }
+    }
+    else if (!classic_search_disable_32bit &&
+             max_query_size - max_term_size < UINT32_MAX)
+    {
+        std::vector<uint32_t*> score_lists(queries.size());
+        for (size_t q = 0; q < queries.size(); ++q)
+            score_lists[q] = allocate_aligned<uint32_t>(total_documents, 16);
+
+        parallel_for_index_files(
+            index_files_.size(),
+            [&](size_t file_num) {
+                search_index_file_batch(
+                    file_num, index_files_[file_num],
+                    queries, score_lists, threads_per_file,
+                    total_hashes, sum_doc_counts, call_timer);
+            });
+
+        for (size_t q = 0; q < queries.size(); ++q) {
+            counts_to_result(index_files_, score_lists[q], results[q],
+                             make_thresholds(queries[q]),
+                             num_results, total_hashes.load(),
+                             sum_doc_counts, queries[q].size());
+            deallocate_aligned(score_lists[q]);
+        }
     }
     else
     {
         assert_exit(false, "query too long");
     }
+
+    timer_ += call_timer;
 }
 
 /******************************************************************************/
@@ -654,6 +2614,104 @@ void compute_counts_u8_64(
     }
 }
 
+static inline
+void compute_counts_u8_128(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size)
+{
+#if __SSE2__
+    auto counts_64 = reinterpret_cast<uint64_t*>(scores);
+    auto counts_128 = reinterpret_cast<__m128i_u*>(scores);
+    for (uint64_t i = 0; i < hashes_size; i += num_hashes) {
+        const uint8_t* rows_8 = rows + i * buffer_size;
+        size_t k = 0;
+        for ( ; k + 2 <= size; k += 2) {
+            // pair two 64-bit expansion table entries per saturating byte add
+            __m128i expansion = _mm_set_epi64x(
+                s_expansion_u8_64[rows_8[k + 1]],
+                s_expansion_u8_64[rows_8[k]]);
+            counts_128[k / 2] = _mm_adds_epu8(counts_128[k / 2], expansion);
+        }
+        if (k < size) {
+            counts_64[k] += s_expansion_u8_64[rows_8[k]];
+        }
+    }
+#else
+    tlx::unused(num_hashes, hashes_size, scores, rows, size, buffer_size);
+#endif
+}
+
+#if COBS_HAVE_X86_DISPATCH
+
+//! in-register score expansion: every uint8_t lane tests one bit of a row
+//! byte against a per-lane bit mask, so no expansion table lookup is needed.
+__attribute__ ((target ("avx2"))) static
+void compute_counts_u8_256(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size)
+{
+    // distribute four row bytes over the byte lanes, eight lanes each
+    const __m256i spread = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+        2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bit_mask = _mm256_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i ones = _mm256_set1_epi8(1);
+    auto counts_64 = reinterpret_cast<uint64_t*>(scores);
+    auto counts_256 = reinterpret_cast<__m256i_u*>(scores);
+    for (uint64_t i = 0; i < hashes_size; i += num_hashes) {
+        const uint8_t* rows_8 = rows + i * buffer_size;
+        size_t k = 0;
+        for ( ; k + 4 <= size; k += 4) {
+            __m256i v = _mm256_shuffle_epi8(
+                _mm256_set1_epi32(
+                    *reinterpret_cast<const uint32_t*>(rows_8 + k)),
+                spread);
+            __m256i ind = _mm256_cmpeq_epi8(
+                _mm256_and_si256(v, bit_mask), bit_mask);
+            counts_256[k / 4] = _mm256_adds_epu8(
+                counts_256[k / 4], _mm256_and_si256(ind, ones));
+        }
+        for ( ; k < size; k++) {
+            counts_64[k] += s_expansion_u8_64[rows_8[k]];
+        }
+    }
+}
+
+//! score expansion via AVX-512 mask registers: eight row bytes form a
+//! 64-lane write mask that adds one to exactly the indicated counters.
+__attribute__ ((target ("avx512f,avx512bw"))) static
+void compute_counts_u8_512(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size)
+{
+    const __m512i ones = _mm512_set1_epi8(1);
+    for (uint64_t i = 0; i < hashes_size; i += num_hashes) {
+        const uint8_t* rows_8 = rows + i * buffer_size;
+        size_t k = 0;
+        for ( ; k + 8 <= size; k += 8) {
+            __mmask64 m = *reinterpret_cast<const uint64_t*>(rows_8 + k);
+            __m512i v = _mm512_loadu_si512(scores + 8 * k);
+            _mm512_storeu_si512(scores + 8 * k,
+                                _mm512_mask_adds_epu8(v, m, v, ones));
+        }
+        if (k < size) {
+            // partial tail: masked load/store never touches lanes past the
+            // end of the score array
+            __mmask64 tail = (__mmask64(1) << (8 * (size - k))) - 1;
+            uint64_t m = 0;
+            std::memcpy(&m, rows_8 + k, size - k);
+            __m512i v = _mm512_maskz_loadu_epi8(tail, scores + 8 * k);
+            _mm512_mask_storeu_epi8(
+                scores + 8 * k, tail,
+                _mm512_mask_adds_epu8(v, __mmask64(m), v, ones));
+        }
+    }
+}
+
+#endif  // COBS_HAVE_X86_DISPATCH
+
 //! expansion table from an 4-bit value (nibble) and expanding it into one
 //! 64-bit word containing 4x uint16_t indicators.
 static const uint64_t s_expansion_u16_64[16] = {
@@ -956,6 +3014,75 @@ void compute_counts_u16_128(
 #endif
 }
 
+#if COBS_HAVE_X86_DISPATCH
+
+//! in-register score expansion: every uint16_t lane tests one bit of a row
+//! byte against a per-lane bit mask, so no expansion table lookup is needed.
+__attribute__ ((target ("avx2"))) static
+void compute_counts_u16_256(
+    uint64_t num_hashes, size_t hashes_size, uint16_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size)
+{
+    // lanes 0-7 test the bits of the even row byte, lanes 8-15 those of the
+    // odd row byte
+    const __m256i bit_mask = _mm256_setr_epi16(
+        0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+        0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, -0x8000);
+    auto expansion_128 = reinterpret_cast<const __m128i_u*>(s_expansion_u16_128);
+    auto counts_128 = reinterpret_cast<__m128i_u*>(scores);
+    auto counts_256 = reinterpret_cast<__m256i_u*>(scores);
+    for (uint64_t i = 0; i < hashes_size; i += num_hashes) {
+        const uint8_t* rows_8 = rows + i * buffer_size;
+        size_t k = 0;
+        for ( ; k + 2 <= size; k += 2) {
+            __m256i v = _mm256_set1_epi16(
+                *reinterpret_cast<const uint16_t*>(rows_8 + k));
+            __m256i ind = _mm256_cmpeq_epi16(
+                _mm256_and_si256(v, bit_mask), bit_mask);
+            counts_256[k / 2] = _mm256_adds_epu16(
+                counts_256[k / 2], _mm256_srli_epi16(ind, 15));
+        }
+        if (k < size) {
+            // odd tail byte: fall back to the 128-bit expansion table
+            counts_128[k] = _mm_adds_epu16(
+                counts_128[k], expansion_128[rows_8[k]]);
+        }
+    }
+}
+
+//! score expansion via AVX-512 mask registers: four row bytes form a
+//! 32-lane write mask that adds one to exactly the indicated counters.
+__attribute__ ((target ("avx512f,avx512bw"))) static
+void compute_counts_u16_512(
+    uint64_t num_hashes, size_t hashes_size, uint16_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size)
+{
+    const __m512i ones = _mm512_set1_epi16(1);
+    for (uint64_t i = 0; i < hashes_size; i += num_hashes) {
+        const uint8_t* rows_8 = rows + i * buffer_size;
+        size_t k = 0;
+        for ( ; k + 4 <= size; k += 4) {
+            __mmask32 m = *reinterpret_cast<const uint32_t*>(rows_8 + k);
+            __m512i v = _mm512_loadu_si512(scores + 8 * k);
+            _mm512_storeu_si512(scores + 8 * k,
+                                _mm512_mask_adds_epu16(v, m, v, ones));
+        }
+        if (k < size) {
+            // partial tail: masked load/store never touches lanes past the
+            // end of the score array
+            __mmask32 tail = (__mmask32(1) << (8 * (size - k))) - 1;
+            uint32_t m = 0;
+            std::memcpy(&m, rows_8 + k, size - k);
+            __m512i v = _mm512_maskz_loadu_epi16(tail, scores + 8 * k);
+            _mm512_mask_storeu_epi16(
+                scores + 8 * k, tail,
+                _mm512_mask_adds_epu16(v, __mmask32(m), v, ones));
+        }
+    }
+}
+
+#endif  // COBS_HAVE_X86_DISPATCH
+
 //! expansion table from an 2-bit value and expanding it into one 64-bit word
 //! containing 2x uint32_t indicators.
 static const uint64_t s_expansion_u32_64[4] = {
@@ -1021,6 +3148,61 @@ void compute_counts_u32_128(
 #endif
 }
 
+#if COBS_HAVE_X86_DISPATCH
+
+//! in-register score expansion: every uint32_t lane tests one bit of a row
+//! byte against a per-lane bit mask, so no expansion table lookup is needed.
+__attribute__ ((target ("avx2"))) static
+void compute_counts_u32_256(
+    uint64_t num_hashes, size_t hashes_size, uint32_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size)
+{
+    const __m256i bit_mask = _mm256_setr_epi32(
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+    auto counts_256 = reinterpret_cast<__m256i_u*>(scores);
+    for (uint64_t i = 0; i < hashes_size; i += num_hashes) {
+        const uint8_t* rows_8 = rows + i * buffer_size;
+        for (size_t k = 0; k < size; k++) {
+            __m256i v = _mm256_set1_epi32(rows_8[k]);
+            __m256i ind = _mm256_cmpeq_epi32(
+                _mm256_and_si256(v, bit_mask), bit_mask);
+            // cmpeq yields -1 per set bit, so subtract to add one
+            counts_256[k] = _mm256_sub_epi32(counts_256[k], ind);
+        }
+    }
+}
+
+//! score expansion via AVX-512 mask registers: two row bytes form a 16-lane
+//! write mask that adds one to exactly the indicated counters.
+__attribute__ ((target ("avx512f,avx512bw"))) static
+void compute_counts_u32_512(
+    uint64_t num_hashes, size_t hashes_size, uint32_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size)
+{
+    const __m512i ones = _mm512_set1_epi32(1);
+    for (uint64_t i = 0; i < hashes_size; i += num_hashes) {
+        const uint8_t* rows_8 = rows + i * buffer_size;
+        size_t k = 0;
+        for ( ; k + 2 <= size; k += 2) {
+            __mmask16 m = *reinterpret_cast<const uint16_t*>(rows_8 + k);
+            __m512i v = _mm512_loadu_si512(scores + 8 * k);
+            _mm512_storeu_si512(scores + 8 * k,
+                                _mm512_mask_add_epi32(v, m, v, ones));
+        }
+        if (k < size) {
+            // partial tail: masked load/store never touches lanes past the
+            // end of the score array
+            __mmask16 tail = 0x00FF;
+            __mmask16 m = rows_8[k];
+            __m512i v = _mm512_maskz_loadu_epi32(tail, scores + 8 * k);
+            _mm512_mask_storeu_epi32(
+                scores + 8 * k, tail, _mm512_mask_add_epi32(v, m, v, ones));
+        }
+    }
+}
+
+#endif  // COBS_HAVE_X86_DISPATCH
+
 } // namespace cobs
 
 /******************************************************************************/
@@ -14,8 +14,18 @@
 #include <cobs/query/search.hpp>
 #include <cobs/util/query.hpp>
 
+#include <memory>
+
 namespace cobs {
 
+/*!
+ * Query engine over classic and compact index files. Thread-safe for
+ * concurrent search() / search_batch() calls on one instance: queries
+ * aggregate their phase timings locally and merge them into timer_ once
+ * at the end, and the search file backends either read statelessly
+ * (mmap) or serialize their shared descriptors internally (aio,
+ * io_uring, O_DIRECT buffer pools).
+ */
 class ClassicSearch : public Search
 {
 public:
@@ -26,14 +36,48 @@ public:
 
     ClassicSearch(std::vector<std::shared_ptr<IndexSearchFile> > indices);
 
+    ~ClassicSearch();
+
     void search(
         const std::string& query,
         std::vector<SearchResult>& result,
         double threshold = 0.0, size_t num_results = 0) final;
 
+    //! search a batch of queries at once. the canonical k-mers of all
+    //! queries are deduplicated up front so each distinct signature row is
+    //! gathered from the index only once and then scattered into the
+    //! per-query score arrays.
+    void search_batch(
+        const std::vector<std::string>& queries,
+        std::vector<std::vector<SearchResult> >& results,
+        double threshold = 0.0, size_t num_results = 0) final;
+
+    //! search only the given documents, identified by their position in
+    //! the concatenation of the index files' document lists. a document's
+    //! bit sits at the same byte offset in every signature row, so only
+    //! the row bytes covering the subset are gathered and scored: a query
+    //! against a few thousand documents of a large collection reads a
+    //! correspondingly small fraction of the index.
+    void search_subset(
+        const std::string& query,
+        const std::vector<uint32_t>& doc_ids,
+        std::vector<SearchResult>& result,
+        double threshold = 0.0, size_t num_results = 0);
+
+    //! the index files this instance queries, in score array order
+    const std::vector<std::shared_ptr<IndexSearchFile> >&
+    index_files() const { return index_files_; }
+
 protected:
     //! reference to index file query object to retrieve data
     std::vector<std::shared_ptr<IndexSearchFile> > index_files_;
+
+    //! optional LRU cache of complete query results, keyed by the
+    //! fingerprint of the query's canonical k-mer multiset. tied to this
+    //! instance and thus to its fixed index file set; enabled via
+    //! gopt_result_cache_size.
+    class ResultCache;
+    std::unique_ptr<ResultCache> result_cache_;
 };
 
 /*----------------------------------------------------------------------------*/
@@ -49,6 +93,32 @@ extern bool classic_search_disable_32bit;
 //! disable SSE2 versions of expansion
 extern bool classic_search_disable_sse2;
 
+//! disable AVX2 versions of expansion
+extern bool classic_search_disable_avx2;
+//! disable AVX-512 versions of expansion
+extern bool classic_search_disable_avx512;
+
+/*----------------------------------------------------------------------------*/
+// entry points into the scoring kernels, used by the microbenchmarks.
+// the disable flags above select between the instruction set variants.
+
+//! expand the rows of hashes_size/num_hashes terms and add them to the
+//! per-document counts, 8/16/32-bit depending on the scores type
+void classic_search_compute_counts(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+void classic_search_compute_counts(
+    uint64_t num_hashes, size_t hashes_size, uint16_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+void classic_search_compute_counts(
+    uint64_t num_hashes, size_t hashes_size, uint32_t* scores,
+    const uint8_t* rows, size_t size, size_t buffer_size);
+
+//! AND-combine each term's num_hashes rows in place
+void classic_search_aggregate_rows(
+    uint64_t num_hashes, size_t hashes_size, uint8_t* rows,
+    size_t size, size_t buffer_size);
+
 /*----------------------------------------------------------------------------*/
 
 } // namespace cobs
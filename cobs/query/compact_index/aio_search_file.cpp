@@ -20,9 +20,11 @@
 
 namespace cobs {
 
+//! maximum number of in-flight requests passed to io_setup
+static constexpr unsigned max_nr_ios = 65536;
+
 CompactIndexAioSearchFile::CompactIndexAioSearchFile(const fs::path& path)
-    : CompactIndexSearchFile(path), m_max_nr_ios(65536 * header_.parameters_.size()),
-      m_iocbs(m_max_nr_ios), m_iocbpp(m_max_nr_ios), m_io_events(m_max_nr_ios)
+    : CompactIndexSearchFile(path)
 {
     // todo use sysctl to check max-nr-io
     assert_exit(header_.page_size_ % cobs::get_page_size() == 0,
@@ -32,18 +34,33 @@ CompactIndexAioSearchFile::CompactIndexAioSearchFile(const fs::path& path)
     m_offsets.resize(header_.parameters_.size());
     m_offsets[0] = stream_pos_.curr_pos;
     for (size_t i = 1; i < header_.parameters_.size(); i++) {
-        m_offsets[i] = m_offsets[i - 1] + header_.page_size_ * header_.parameters_[i - 1].signature_size;
+        m_offsets[i] = m_offsets[i - 1] + header_.padded_subindex_size(i - 1);
     }
 
     m_fd = open_file(path, O_RDONLY | O_DIRECT);
-    if (io_setup(m_max_nr_ios, &m_ctx) < 0) {
+    if (io_setup(max_nr_ios, &m_ctx) < 0) {
         exit_error_errno("io_setup error");
     }
+}
+
+//! grow the request descriptor arrays to the batch size actually used,
+//! initializing the constant iocb fields exactly once per slot
+void CompactIndexAioSearchFile::ensure_capacity(size_t num_requests) {
+    if (m_iocbs.size() >= num_requests)
+        return;
 
-    for (size_t i = 0; i < m_iocbs.size(); i++) {
+    size_t old_size = m_iocbs.size();
+    m_iocbs.resize(num_requests);
+    m_iocbpp.resize(num_requests);
+    m_io_events.resize(num_requests);
+
+    for (size_t i = old_size; i < num_requests; i++) {
         m_iocbs[i].aio_fildes = m_fd;
         m_iocbs[i].aio_lio_opcode = IOCB_CMD_PREAD;
         m_iocbs[i].aio_nbytes = header_.page_size_;
+    }
+    // resizing may have relocated the iocb array
+    for (size_t i = 0; i < num_requests; i++) {
         m_iocbpp[i] = m_iocbs.data() + i;
     }
 }
@@ -61,14 +78,20 @@ void CompactIndexAioSearchFile::read_from_disk(
 {
     tlx::unused(begin, size, buffer_size);
 
+    std::unique_lock<std::mutex> lock(m_mutex);
+
     int64_t num_requests = header_.parameters_.size() * hashes.size();
+    ensure_capacity(num_requests);
 
-#pragma omp parallel for collapse(2)
+    // only the target address and file offset change per request; the
+    // remaining iocb fields were initialized in ensure_capacity. this loop
+    // is a short memory-bound sweep, and it must not borrow the thread
+    // pool: it runs on the query pipeline's I/O threads, which the pool's
+    // compute workers are waiting on.
     for (size_t i = 0; i < header_.parameters_.size(); i++) {
         for (size_t j = 0; j < hashes.size(); j++) {
             uint64_t index = i + j * header_.parameters_.size();
             uint64_t hash = hashes[j] % header_.parameters_[i].signature_size;
-            // todo rows does not need to be reallocated each time
             m_iocbs[index].aio_buf = (uint64_t)rows + index * header_.page_size_;
             m_iocbs[index].aio_offset = m_offsets[i] + hash * header_.page_size_;
         }
@@ -12,19 +12,25 @@
 #include <cobs/query/compact_index/search_file.hpp>
 #include <linux/aio_abi.h>
 
+#include <mutex>
+
 namespace cobs {
 
 class CompactIndexAioSearchFile : public CompactIndexSearchFile
 {
 private:
-    uint64_t m_max_nr_ios;
     int m_fd;
     aio_context_t m_ctx = 0;
+    //! serializes concurrent read_from_disk() calls, which share the
+    //! request descriptor and event arrays below
+    std::mutex m_mutex;
     std::vector<uint64_t> m_offsets;
     std::vector<iocb> m_iocbs;
     std::vector<iocb*> m_iocbpp;
     std::vector<io_event> m_io_events;
 
+    void ensure_capacity(size_t num_requests);
+
 protected:
     void read_from_disk(const std::vector<size_t>& hashes, uint8_t* rows,
                         size_t begin, size_t size, size_t buffer_size) override;
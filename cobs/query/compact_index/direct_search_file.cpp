@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * cobs/query/compact_index/direct_search_file.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/query/compact_index/direct_search_file.hpp>
+#include <cobs/util/error_handling.hpp>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <tlx/math/div_ceil.hpp>
+
+namespace cobs {
+
+CompactIndexDirectSearchFile::CompactIndexDirectSearchFile(const fs::path& path)
+    : CompactIndexSearchFile(path), pool_(header_.page_size_)
+{
+    assert_exit(header_.page_size_ % cobs::get_page_size() == 0,
+                "page size needs to be divisible by 4096 "
+                "so the index can be opened with O_DIRECT");
+
+    offsets_.resize(header_.parameters_.size());
+    offsets_[0] = stream_pos_.curr_pos;
+    for (size_t i = 1; i < header_.parameters_.size(); i++) {
+        offsets_[i] = offsets_[i - 1] + header_.padded_subindex_size(i - 1);
+    }
+
+    fd_ = open_file(path, O_RDONLY | O_DIRECT);
+}
+
+CompactIndexDirectSearchFile::~CompactIndexDirectSearchFile() {
+    close_file(fd_);
+}
+
+void CompactIndexDirectSearchFile::read_from_disk(
+    const std::vector<size_t>& hashes, uint8_t* rows,
+    size_t begin, size_t size, size_t buffer_size)
+{
+    size_t page_size = header_.page_size_;
+
+    die_unless(begin + size <= row_size());
+    die_unless(begin % page_size == 0);
+    size_t begin_page = begin / page_size;
+    size_t end_page = tlx::div_ceil(begin + size, page_size);
+    die_unless(end_page <= header_.parameters_.size());
+
+    uint8_t* bounce = pool_.acquire();
+
+    for (size_t i = 0; i < hashes.size(); i++) {
+        size_t j = 0;
+        for (size_t p = begin_page; p < end_page; ++p, ++j) {
+            uint64_t hash = hashes[i] % header_.parameters_[p].signature_size;
+            // page offsets are aligned due to the padded header, but the
+            // rows buffer is not in general, so bounce through the pool
+            ssize_t rd = pread(fd_, bounce, page_size,
+                               offsets_[p] + hash * page_size);
+            if (rd < 0) {
+                exit_error_errno("O_DIRECT pread error");
+            }
+            die_unequal(static_cast<size_t>(rd), page_size);
+
+            uint8_t* rows_8 = rows + i * buffer_size + j * page_size;
+            std::copy(bounce, bounce + page_size, rows_8);
+        }
+    }
+
+    pool_.release(bounce);
+}
+
+} // namespace cobs
+
+/******************************************************************************/
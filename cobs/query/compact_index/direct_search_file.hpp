@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * cobs/query/compact_index/direct_search_file.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_QUERY_COMPACT_INDEX_DIRECT_SEARCH_FILE_HEADER
+#define COBS_QUERY_COMPACT_INDEX_DIRECT_SEARCH_FILE_HEADER
+
+#include <cobs/query/compact_index/search_file.hpp>
+#include <cobs/util/aligned_buffer_pool.hpp>
+
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Compact index search file backend reading row pages with O_DIRECT pread
+ * calls, bypassing the page cache. Intended for one-off cold-cache scans
+ * of indexes much larger than RAM, where faulting through an mmap would
+ * evict cached data of co-tenant workloads.
+ */
+class CompactIndexDirectSearchFile : public CompactIndexSearchFile
+{
+private:
+    int fd_;
+    AlignedBufferPool pool_;
+    //! file offset of each subindex
+    std::vector<uint64_t> offsets_;
+
+protected:
+    void read_from_disk(const std::vector<size_t>& hashes, uint8_t* rows,
+                        size_t begin, size_t size, size_t buffer_size) override;
+
+public:
+    explicit CompactIndexDirectSearchFile(const fs::path& path);
+    ~CompactIndexDirectSearchFile();
+};
+
+} // namespace cobs
+
+#endif // !COBS_QUERY_COMPACT_INDEX_DIRECT_SEARCH_FILE_HEADER
+
+/******************************************************************************/
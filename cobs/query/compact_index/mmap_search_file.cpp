@@ -7,6 +7,8 @@
  ******************************************************************************/
 
 #include <cobs/query/compact_index/mmap_search_file.hpp>
+#include <cobs/settings.hpp>
+#include <cobs/util/misc.hpp>
 #include <cobs/util/query.hpp>
 
 #include <tlx/logger.hpp>
@@ -14,16 +16,30 @@
 
 namespace cobs {
 
-CompactIndexMMapSearchFile::CompactIndexMMapSearchFile(const fs::path& path)
+CompactIndexMMapSearchFile::CompactIndexMMapSearchFile(
+    const fs::path& path, const MMapPolicy& policy,
+    uint64_t page_cache_bytes)
     : CompactIndexSearchFile(path)
 {
+    if (page_cache_bytes != 0) {
+        page_cache_ = std::make_unique<CompactPageCache>(
+            header_.page_size_, page_cache_bytes);
+    }
     data_.resize(header_.parameters_.size());
-    handle_ = initialize_mmap(path);
+    MMapPolicy pol = policy;
+    // hugepage-aligned payloads are laid out for THP backing
+    if (header_.payload_alignment_ >= hugepage_size)
+        pol.hugepages = true;
+    handle_ = initialize_mmap(path, pol);
     data_[0] = handle_.data + stream_pos_.curr_pos;
     for (size_t i = 1; i < header_.parameters_.size(); i++) {
-        data_[i] =
-            data_[i - 1]
-            + header_.page_size_ * header_.parameters_[i - 1].signature_size;
+        data_[i] = data_[i - 1] + header_.padded_subindex_size(i - 1);
+    }
+    // the pager manages a real mapping, not the RAM copy made by
+    // gopt_load_complete_index
+    if (policy.window_budget_bytes != 0 && !gopt_load_complete_index) {
+        pager_ = std::make_unique<MMapPager>(
+            handle_, policy.window_size_bytes, policy.window_budget_bytes);
     }
 }
 
@@ -56,9 +72,29 @@ void CompactIndexMMapSearchFile::read_from_disk(
         size_t j = 0;
         for (size_t p = begin_page; p < end_page; ++p, ++j) {
             uint64_t hash = hashes[i] % header_.parameters_[p].signature_size;
-            uint8_t* data_8 = data_[p] + hash * page_size;
             uint8_t* rows_8 =
                 reinterpret_cast<uint8_t*>(rows) + i * buffer_size + j * page_size;
+
+            if (page_cache_) {
+                CompactPageCache::Page page;
+                if (page_cache_->lookup(p, hash, page)) {
+                    // hot row: serve the page without touching the mapping
+                    std::copy(page->begin(), page->end(), rows_8);
+                    continue;
+                }
+                uint8_t* data_8 = data_[p] + hash * page_size;
+                if (pager_)
+                    pager_->access(data_8 - handle_.data);
+                std::copy(data_8, data_8 + page_size, rows_8);
+                page_cache_->put(
+                    p, hash, std::make_shared<std::vector<uint8_t> >(
+                        data_8, data_8 + page_size));
+                continue;
+            }
+
+            uint8_t* data_8 = data_[p] + hash * page_size;
+            if (pager_)
+                pager_->access(data_8 - handle_.data);
             // die_unless(rows_8 + page_size <= rows + size * hashes.size());
             // std::memcpy(rows_8, data_8, page_size);
             std::copy(data_8, data_8 + page_size, rows_8);
@@ -9,7 +9,11 @@
 #ifndef COBS_QUERY_COMPACT_INDEX_MMAP_SEARCH_FILE_HEADER
 #define COBS_QUERY_COMPACT_INDEX_MMAP_SEARCH_FILE_HEADER
 
+#include <cobs/query/compact_index/page_cache.hpp>
 #include <cobs/query/compact_index/search_file.hpp>
+#include <cobs/util/mmap_pager.hpp>
+
+#include <memory>
 
 namespace cobs {
 
@@ -18,13 +22,20 @@ class CompactIndexMMapSearchFile : public CompactIndexSearchFile
 private:
     MMapHandle handle_;
     std::vector<uint8_t*> data_;
+    //! optional LRU cache of hot row pages, enabled by a non-zero budget
+    std::unique_ptr<CompactPageCache> page_cache_;
+    //! optional windowed pager evicting cold index windows explicitly,
+    //! enabled via MMapPolicy::window_budget_bytes
+    std::unique_ptr<MMapPager> pager_;
 
 protected:
     void read_from_disk(const std::vector<size_t>& hashes, uint8_t* rows,
                         size_t begin, size_t size, size_t buffer_size) override;
 
 public:
-    explicit CompactIndexMMapSearchFile(const fs::path& path);
+    explicit CompactIndexMMapSearchFile(const fs::path& path,
+                                        const MMapPolicy& policy = MMapPolicy(),
+                                        uint64_t page_cache_bytes = 0);
     ~CompactIndexMMapSearchFile();
 };
 
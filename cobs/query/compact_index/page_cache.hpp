@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * cobs/query/compact_index/page_cache.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_QUERY_COMPACT_INDEX_PAGE_CACHE_HEADER
+#define COBS_QUERY_COMPACT_INDEX_PAGE_CACHE_HEADER
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <tlx/container/lru_cache.hpp>
+
+namespace cobs {
+
+/*!
+ * Sharded LRU cache of copied compact index row pages, keyed by (subindex
+ * page, row hash). K-mer popularity in query streams is highly skewed
+ * (adapters, conserved genes), so the hottest rows are served from the
+ * cache without touching the index mapping at all. Sized by a byte budget
+ * and sharded by hash to keep lock contention low, similar in spirit to
+ * the FastaIndexCache in cobs/fasta_multifile.hpp.
+ */
+class CompactPageCache
+{
+public:
+    //! one cached row page
+    using Page = std::shared_ptr<std::vector<uint8_t> >;
+
+    CompactPageCache(uint64_t page_size, uint64_t mem_bytes)
+        : max_pages_per_shard_(
+              std::max<uint64_t>(mem_bytes / page_size / num_shards_, 1)) { }
+
+    //! look up the page of (subindex page, row hash), true if cached
+    bool lookup(size_t page, uint64_t hash, Page& out) {
+        Shard& shard = shards_[hash % num_shards_];
+        std::unique_lock<std::mutex> lock(shard.mutex_);
+        if (!shard.lru_.exists(Key(page, hash)))
+            return false;
+        out = shard.lru_.get_touch(Key(page, hash));
+        return true;
+    }
+
+    //! insert the page of (subindex page, row hash), evicting the least
+    //! recently used pages beyond the shard's budget
+    void put(size_t page, uint64_t hash, const Page& data) {
+        Shard& shard = shards_[hash % num_shards_];
+        std::unique_lock<std::mutex> lock(shard.mutex_);
+        shard.lru_.put(Key(page, hash), data);
+        while (shard.lru_.size() > max_pages_per_shard_)
+            shard.lru_.pop();
+    }
+
+private:
+    using Key = std::pair<size_t, uint64_t>;
+
+    static constexpr size_t num_shards_ = 16;
+
+    struct Shard {
+        tlx::LruCacheMap<Key, Page> lru_;
+        std::mutex mutex_;
+    };
+
+    uint64_t max_pages_per_shard_;
+    Shard shards_[num_shards_];
+};
+
+} // namespace cobs
+
+#endif // !COBS_QUERY_COMPACT_INDEX_PAGE_CACHE_HEADER
+
+/******************************************************************************/
@@ -24,9 +24,16 @@ protected:
     uint32_t term_size() const final { return header_.term_size_; }
     uint8_t canonicalize() const final { return header_.canonicalize_; }
     uint64_t num_hashes() const final { return num_hashes_; }
+    uint8_t hash_mode() const final { return header_.hash_mode_; }
+    uint64_t window_size() const final { return header_.window_size_; }
     uint64_t page_size() const final { return header_.page_size_; }
     uint64_t row_size() const final { return row_size_; }
     uint64_t counts_size() const final;
+    //! pages with larger signatures scatter their rows over more memory
+    //! and gather correspondingly slower
+    uint64_t gather_cost(size_t page) const final {
+        return header_.parameters_[page].signature_size;
+    }
 
     const std::vector<std::string>& file_names() const final {
         return header_.file_names_;
@@ -0,0 +1,145 @@
+/*******************************************************************************
+ * cobs/query/gpu_score_backend.cu
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/query/gpu_score_backend.hpp>
+
+#include <cuda_runtime.h>
+
+#include <mutex>
+
+namespace cobs {
+
+/*
+ * One thread per document: AND the term's num_hashes row bits for the
+ * document, count the surviving terms, and add the count to the score.
+ * The rows buffer layout matches the CPU kernels, num_hashes rows of
+ * buffer_size bytes per term.
+ */
+template <typename Score>
+__global__
+void score_rows_kernel(uint64_t num_hashes, uint64_t num_terms,
+                       Score* scores, const uint8_t* rows,
+                       uint64_t size, uint64_t buffer_size)
+{
+    uint64_t j = blockIdx.x * uint64_t(blockDim.x) + threadIdx.x;
+    if (j >= 8 * size)
+        return;
+
+    uint64_t byte = j >> 3;
+    uint8_t bit = 1u << (j & 7u);
+
+    uint32_t count = 0;
+    const uint8_t* row = rows + byte;
+    for (uint64_t t = 0; t < num_terms; ++t) {
+        uint8_t v = bit;
+        for (uint64_t h = 0; h < num_hashes; ++h, row += buffer_size)
+            v &= *row;
+        count += (v != 0);
+    }
+    scores[j] += count;
+}
+
+//! per-process device scratch buffers, grown lazily and reused across
+//! batches; guarded because score batches run on concurrent workers
+struct GpuScratch {
+    std::mutex mutex;
+    uint8_t* rows = nullptr;
+    uint8_t* scores = nullptr;
+    size_t rows_capacity = 0;
+    size_t scores_capacity = 0;
+
+    bool reserve(size_t rows_bytes, size_t scores_bytes) {
+        if (rows_capacity < rows_bytes) {
+            cudaFree(rows);
+            rows = nullptr, rows_capacity = 0;
+            if (cudaMalloc(&rows, rows_bytes) != cudaSuccess)
+                return false;
+            rows_capacity = rows_bytes;
+        }
+        if (scores_capacity < scores_bytes) {
+            cudaFree(scores);
+            scores = nullptr, scores_capacity = 0;
+            if (cudaMalloc(&scores, scores_bytes) != cudaSuccess)
+                return false;
+            scores_capacity = scores_bytes;
+        }
+        return true;
+    }
+};
+
+static GpuScratch s_gpu_scratch;
+
+bool gpu_score_available() {
+    static const bool available = []() {
+        int count = 0;
+        return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+    }();
+    return available;
+}
+
+template <typename Score>
+static bool gpu_score_rows_impl(
+    uint64_t num_hashes, uint64_t hashes_size,
+    Score* scores, const uint8_t* rows,
+    uint64_t size, uint64_t buffer_size)
+{
+    if (!gpu_score_available())
+        return false;
+
+    uint64_t num_terms = hashes_size / num_hashes;
+    size_t rows_bytes = hashes_size * buffer_size;
+    size_t scores_bytes = 8 * size * sizeof(Score);
+
+    std::unique_lock<std::mutex> lock(s_gpu_scratch.mutex);
+    if (!s_gpu_scratch.reserve(rows_bytes, scores_bytes))
+        return false;
+
+    if (cudaMemcpy(s_gpu_scratch.rows, rows, rows_bytes,
+                   cudaMemcpyHostToDevice) != cudaSuccess)
+        return false;
+    if (cudaMemcpy(s_gpu_scratch.scores, scores, scores_bytes,
+                   cudaMemcpyHostToDevice) != cudaSuccess)
+        return false;
+
+    unsigned threads = 256;
+    unsigned blocks = (8 * size + threads - 1) / threads;
+    score_rows_kernel<Score><<<blocks, threads>>>(
+        num_hashes, num_terms,
+        reinterpret_cast<Score*>(s_gpu_scratch.scores),
+        s_gpu_scratch.rows, size, buffer_size);
+
+    if (cudaMemcpy(scores, s_gpu_scratch.scores, scores_bytes,
+                   cudaMemcpyDeviceToHost) != cudaSuccess)
+        return false;
+    return cudaGetLastError() == cudaSuccess;
+}
+
+bool gpu_score_rows(uint64_t num_hashes, uint64_t hashes_size,
+                    uint8_t* scores, const uint8_t* rows,
+                    uint64_t size, uint64_t buffer_size) {
+    return gpu_score_rows_impl(
+        num_hashes, hashes_size, scores, rows, size, buffer_size);
+}
+
+bool gpu_score_rows(uint64_t num_hashes, uint64_t hashes_size,
+                    uint16_t* scores, const uint8_t* rows,
+                    uint64_t size, uint64_t buffer_size) {
+    return gpu_score_rows_impl(
+        num_hashes, hashes_size, scores, rows, size, buffer_size);
+}
+
+bool gpu_score_rows(uint64_t num_hashes, uint64_t hashes_size,
+                    uint32_t* scores, const uint8_t* rows,
+                    uint64_t size, uint64_t buffer_size) {
+    return gpu_score_rows_impl(
+        num_hashes, hashes_size, scores, rows, size, buffer_size);
+}
+
+} // namespace cobs
+
+/******************************************************************************/
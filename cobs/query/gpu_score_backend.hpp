@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * cobs/query/gpu_score_backend.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_QUERY_GPU_SCORE_BACKEND_HEADER
+#define COBS_QUERY_GPU_SCORE_BACKEND_HEADER
+
+#include <cstdint>
+
+namespace cobs {
+
+/*
+ * Optional CUDA scoring backend, built when CMake is configured with
+ * -DCOBS_USE_CUDA=ON (see cobs/query/gpu_score_backend.cu). The header
+ * itself has no CUDA dependencies; callers must guard calls with
+ * COBS_HAVE_CUDA and fall back to the CPU kernels in classic_search.cpp.
+ */
+
+//! true if a usable CUDA device is present, probed once
+bool gpu_score_available();
+
+/*
+ * Run the AND + bit-expansion + accumulate phase for one gathered rows
+ * buffer on the GPU: uploads the rows and the current score segment,
+ * ANDs the num_hashes rows of each term, adds each document's surviving
+ * bits to its score, and downloads the updated scores. Returns false on
+ * any CUDA error so the caller can fall back to the CPU kernels.
+ */
+bool gpu_score_rows(uint64_t num_hashes, uint64_t hashes_size,
+                    uint8_t* scores, const uint8_t* rows,
+                    uint64_t size, uint64_t buffer_size);
+bool gpu_score_rows(uint64_t num_hashes, uint64_t hashes_size,
+                    uint16_t* scores, const uint8_t* rows,
+                    uint64_t size, uint64_t buffer_size);
+bool gpu_score_rows(uint64_t num_hashes, uint64_t hashes_size,
+                    uint32_t* scores, const uint8_t* rows,
+                    uint64_t size, uint64_t buffer_size);
+
+} // namespace cobs
+
+#endif // !COBS_QUERY_GPU_SCORE_BACKEND_HEADER
+
+/******************************************************************************/
@@ -14,6 +14,9 @@
 
 #include <immintrin.h>
 
+#include <atomic>
+#include <mutex>
+
 namespace cobs {
 
 class IndexSearchFile
@@ -21,17 +24,72 @@ class IndexSearchFile
 public:
     StreamPos stream_pos_;
 
+    //! cumulative bytes of hash rows gathered via read_from_disk(),
+    //! reported by the benchmark-query subtool
+    std::atomic<uint64_t> bytes_gathered_ { 0 };
+
     virtual void read_from_disk(
         const std::vector<size_t>& hashes, uint8_t* rows,
         size_t begin, size_t size, size_t buffer_size) = 0;
 
+    //! whether the whole index resides in memory, so hash rows can be
+    //! scored in place via row_data() without gathering them first
+    virtual bool memory_resident() const { return false; }
+
+    //! pointer to the memory-resident row of a hash value, only valid if
+    //! memory_resident() returns true
+    virtual const uint8_t * row_data(size_t hash) const {
+        (void)hash;
+        return nullptr;
+    }
+
     virtual uint32_t term_size() const = 0;
     virtual uint8_t canonicalize() const = 0;
     virtual uint64_t row_size() const = 0;
     virtual uint64_t page_size() const = 0;
     virtual uint64_t num_hashes() const = 0;
+    virtual uint8_t hash_mode() const = 0;
+    virtual uint64_t window_size() const = 0;
     virtual uint64_t counts_size() const = 0;
+
+    //! relative cost of gathering rows from the index page covering this
+    //! page-sized slice of the row, used to balance score batches between
+    //! workers; uniform by default
+    virtual uint64_t gather_cost(size_t page) const {
+        (void)page;
+        return 1;
+    }
     virtual const std::vector<std::string>& file_names() const = 0;
+
+    //! number of documents in the index; query setup uses this instead
+    //! of file_names().size() so backends that defer loading the name
+    //! table keep it unloaded until results are formatted
+    virtual uint64_t num_documents() const { return file_names().size(); }
+
+    //! per-document fraction of signature bits set, counted during
+    //! construction and used for calibrated score correction; empty when
+    //! the index does not carry densities
+    virtual const std::vector<double>& doc_densities() const {
+        static const std::vector<double> empty;
+        return empty;
+    }
+
+    //! interned flat table of document name pointers into file_names(),
+    //! built once on first use so result construction dereferences a
+    //! plain pointer array instead of indexing std::strings per result
+    const std::vector<const char*>& doc_names() const {
+        std::call_once(doc_names_once_, [&]() {
+            const std::vector<std::string>& names = file_names();
+            doc_names_.reserve(names.size());
+            for (const std::string& name : names)
+                doc_names_.push_back(name.c_str());
+        });
+        return doc_names_;
+    }
+
+private:
+    mutable std::once_flag doc_names_once_;
+    mutable std::vector<const char*> doc_names_;
 };
 
 } // namespace cobs
@@ -12,6 +12,9 @@
 
 #include <cobs/util/timer.hpp>
 
+#include <string>
+#include <vector>
+
 namespace cobs {
 
 struct SearchResult {
@@ -26,12 +29,19 @@ struct SearchResult {
         : doc_name(doc_name), score(score) { }
 };
 
+/*!
+ * Base class of query engines. search() and search_batch() are
+ * re-entrant: all scratch state is per call or per thread, and the shared
+ * phase timer is only merged into under its internal lock, so several
+ * service threads may query one instance concurrently.
+ */
 class Search
 {
 public:
     virtual ~Search() = default;
 
-    //! Returns timer_
+    //! Returns timer_. reading or resetting it while other threads are
+    //! inside search() races with their final merge; quiesce first.
     Timer& timer() { return timer_; }
     //! Returns timer_
     const Timer& timer() const { return timer_; }
@@ -41,6 +51,18 @@ public:
         std::vector<SearchResult>& result,
         double threshold = 0.0, size_t num_results = 0) = 0;
 
+    //! search a batch of queries. the default implementation simply
+    //! processes the queries one after another.
+    virtual void search_batch(
+        const std::vector<std::string>& queries,
+        std::vector<std::vector<SearchResult> >& results,
+        double threshold = 0.0, size_t num_results = 0) {
+        results.resize(queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            search(queries[i], results[i], threshold, num_results);
+        }
+    }
+
 public:
     //! timer of different query phases
     Timer timer_;
@@ -18,6 +18,30 @@ bool gopt_load_complete_index = false;
 
 bool gopt_disable_cache = false;
 
+bool gopt_use_io_uring = false;
+
+bool gopt_use_o_direct = false;
+
+bool gopt_numa_aware = false;
+
+size_t gopt_result_cache_size = 0;
+
+bool gopt_early_exit = false;
+
+bool gopt_use_gpu = false;
+
+bool gopt_calibrate_scores = false;
+
+bool gopt_perf_counters = false;
+
+bool gopt_timing_json = false;
+
+bool gopt_pin_threads = false;
+
+std::string gopt_trace_file;
+
+size_t gopt_stream_size_estimate = 1024 * 1024 * 1024llu;
+
 } // namespace cobs
 
 /******************************************************************************/
@@ -10,6 +10,7 @@
 #define COBS_SETTINGS_HEADER
 
 #include <cstdlib>
+#include <string>
 
 namespace cobs {
 
@@ -22,6 +23,53 @@ extern bool gopt_load_complete_index;
 //! whether to disable FastA/FastQ cache files globally.
 extern bool gopt_disable_cache;
 
+//! whether to use io_uring instead of mmap for classic index queries.
+extern bool gopt_use_io_uring;
+
+//! whether to read index rows with O_DIRECT, bypassing the page cache.
+extern bool gopt_use_o_direct;
+
+//! whether to pin query workers to NUMA nodes and migrate their score
+//! segments node-locally.
+extern bool gopt_numa_aware;
+
+//! number of query results to keep in ClassicSearch's LRU result cache,
+//! 0 to disable caching.
+extern size_t gopt_result_cache_size;
+
+//! whether to score in term chunks and stop gathering rows for document
+//! blocks that can no longer reach the query threshold.
+extern bool gopt_early_exit;
+
+//! whether to run the AND/expansion/accumulate phase on the GPU backend
+//! (requires a build with COBS_USE_CUDA).
+extern bool gopt_use_gpu;
+
+//! whether to correct raw k-mer counts by each document's expected Bloom
+//! false positive count, using the bit densities stored in the index.
+extern bool gopt_calibrate_scores;
+
+//! whether to sample hardware performance counters (cycles, LLC misses,
+//! dTLB misses, stalled cycles) per timer phase; needs a build with
+//! COBS_HAVE_PERF_EVENTS.
+extern bool gopt_perf_counters;
+
+//! whether to print query phase timings as a JSON object instead of the
+//! human-readable TIMER log line.
+extern bool gopt_timing_json;
+
+//! whether to pin the worker threads of the parallel_for pool to CPU
+//! cores, one core per worker.
+extern bool gopt_pin_threads;
+
+//! path to write a chrome://tracing JSON timeline of timer scopes to,
+//! empty to disable tracing; needs a build with COBS_HAVE_TRACING.
+extern std::string gopt_trace_file;
+
+//! assumed byte size of non-seekable streaming inputs (stdin, FIFOs),
+//! used for signature sizing and batch scheduling.
+extern size_t gopt_stream_size_estimate;
+
 } // namespace cobs
 
 #endif // !COBS_SETTINGS_HEADER
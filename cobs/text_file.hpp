@@ -9,6 +9,7 @@
 #ifndef COBS_TEXT_FILE_HEADER
 #define COBS_TEXT_FILE_HEADER
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -16,8 +17,12 @@
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <tlx/container/string_view.hpp>
 #include <tlx/die.hpp>
+#include <tlx/simple_vector.hpp>
 
 namespace cobs {
 
@@ -42,31 +47,46 @@ public:
         return n < q ? 0 : n - q + 1;
     }
 
+    //! process the text as one contiguous symbol stream, reading it in
+    //! fixed-size chunks with a (term_size - 1) byte overlap carried
+    //! between them: memory stays O(chunk_size_) regardless of the
+    //! document size, and the kernel is advised to run full readahead.
     template <typename Callback>
     void process_terms(size_t term_size, Callback callback) {
-        is_.clear();
-        is_.seekg(0);
-
-        char buffer[64 * 1024];
-        size_t pos = 0;
-
-        while (!is_.eof()) {
-            is_.read(buffer + pos, sizeof(buffer) - pos);
-            size_t wb = is_.gcount();
-
-            for (size_t i = 0; i + term_size <= pos + wb; ++i) {
-                callback(tlx::string_view(buffer + i, term_size));
+        int fd = ::open(path_.c_str(), O_RDONLY);
+        die_unless(fd >= 0);
+#if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+        tlx::simple_vector<char> buffer(chunk_size_ + term_size);
+        // number of overlap bytes carried at the buffer front
+        size_t carry = 0;
+
+        while (true) {
+            ssize_t rb = ::read(fd, buffer.data() + carry, chunk_size_);
+            if (rb < 0) {
+                ::close(fd);
+                die("TextFile: read error on " << path_);
             }
-
-            if (wb + 1 < term_size)
+            if (rb == 0)
                 break;
+            size_t fill = carry + rb;
+
+            for (size_t i = 0; i + term_size <= fill; ++i) {
+                callback(tlx::string_view(buffer.data() + i, term_size));
+            }
 
-            std::copy(buffer + wb - term_size + 1, buffer + wb,
-                      buffer);
-            pos = term_size - 1;
+            // move the window tail to the front for the next chunk
+            carry = std::min(fill, term_size - 1);
+            std::memmove(buffer.data(), buffer.data() + fill - carry, carry);
         }
+        ::close(fd);
     }
 
+    //! chunk size of process_terms() reads, public for tests
+    size_t chunk_size_ = 2 * 1024 * 1024;
+
 private:
     //! file stream
     std::ifstream is_;
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * cobs/util/aligned_buffer_pool.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_ALIGNED_BUFFER_POOL_HEADER
+#define COBS_UTIL_ALIGNED_BUFFER_POOL_HEADER
+
+#include <cobs/util/misc.hpp>
+
+#include <mutex>
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Pool of equally sized page-aligned scratch buffers, as needed for O_DIRECT
+ * reads. Buffers are handed out to concurrent readers and returned to a free
+ * list instead of being reallocated per call.
+ */
+class AlignedBufferPool
+{
+public:
+    explicit AlignedBufferPool(size_t buffer_size)
+        : buffer_size_(buffer_size) { }
+
+    //! non-copyable: the pool owns its buffers
+    AlignedBufferPool(const AlignedBufferPool&) = delete;
+    AlignedBufferPool& operator = (const AlignedBufferPool&) = delete;
+
+    ~AlignedBufferPool() {
+        for (uint8_t* buffer : free_list_)
+            deallocate_aligned(buffer);
+    }
+
+    //! fetch a buffer of buffer_size() bytes from the free list, or allocate
+    //! a new one if the pool is drained
+    uint8_t * acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!free_list_.empty()) {
+            uint8_t* buffer = free_list_.back();
+            free_list_.pop_back();
+            return buffer;
+        }
+        lock.unlock();
+        return allocate_aligned<uint8_t>(buffer_size_, get_page_size());
+    }
+
+    //! return a buffer acquired from this pool
+    void release(uint8_t* buffer) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        free_list_.push_back(buffer);
+    }
+
+    //! size of each pooled buffer in bytes
+    size_t buffer_size() const { return buffer_size_; }
+
+private:
+    size_t buffer_size_;
+    std::mutex mutex_;
+    std::vector<uint8_t*> free_list_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_ALIGNED_BUFFER_POOL_HEADER
+
+/******************************************************************************/
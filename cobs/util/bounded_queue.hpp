@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * cobs/util/bounded_queue.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_BOUNDED_QUEUE_HEADER
+#define COBS_UTIL_BOUNDED_QUEUE_HEADER
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace cobs {
+
+/*!
+ * Bounded multi-producer multi-consumer queue connecting pipeline stages:
+ * push() blocks while the queue is at its limit, so a fast producer is
+ * throttled instead of buffering unboundedly, and pop() blocks until an
+ * item arrives or the queue is closed and drained.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t limit) : limit_(limit) { }
+
+    //! enqueue an item, blocking while the queue is full
+    void push(T&& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [&]() { return queue_.size() < limit_; });
+        queue_.emplace_back(std::move(item));
+        not_empty_.notify_one();
+    }
+
+    //! dequeue an item into out; false once the queue is closed and empty
+    bool pop(T& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [&]() { return !queue_.empty() || closed_; });
+        if (queue_.empty())
+            return false;
+        out = std::move(queue_.front());
+        queue_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    //! signal that no further items will be pushed
+    void close() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable not_full_, not_empty_;
+    std::deque<T> queue_;
+    size_t limit_;
+    bool closed_ = false;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_BOUNDED_QUEUE_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * cobs/util/buffer_arena.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_BUFFER_ARENA_HEADER
+#define COBS_UTIL_BUFFER_ARENA_HEADER
+
+#include <cobs/util/misc.hpp>
+
+#include <tlx/die.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace cobs {
+
+/*!
+ * Grow-only arena of page-aligned scratch buffers, one arena per thread.
+ * The query pipeline rents a rows buffer per score batch; with a plain
+ * allocate_aligned that is a posix_memalign plus a multi-megabyte zero
+ * fill on every batch of every query. Rented buffers come back with
+ * unspecified contents -- every user overwrites them completely -- and
+ * stay cached in the owning thread's arena until the thread exits, so
+ * steady-state queries allocate nothing.
+ */
+class BufferArena
+{
+public:
+    //! rent a page-aligned buffer of at least size bytes with unspecified
+    //! contents, to be returned via release() on the same thread
+    static uint8_t * rent(size_t size) {
+        Arena& arena = thread_arena();
+        // smallest cached buffer that fits, so one oversized rental does
+        // not pin the largest buffer for every small one thereafter
+        size_t best = arena.free_.size();
+        for (size_t i = 0; i < arena.free_.size(); ++i) {
+            if (arena.free_[i].second < size)
+                continue;
+            if (best == arena.free_.size()
+                || arena.free_[i].second < arena.free_[best].second)
+                best = i;
+        }
+        if (best < arena.free_.size()) {
+            uint8_t* ptr = arena.free_[best].first;
+            arena.free_[best] = arena.free_.back();
+            arena.free_.pop_back();
+            return ptr;
+        }
+
+        uint8_t* ptr;
+        int r = posix_memalign(reinterpret_cast<void**>(&ptr),
+                               get_page_size(), size);
+        if (r != 0)
+            throw std::runtime_error("Out of memory");
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        // large long-lived buffers profit from fewer TLB entries
+        if (size >= 2 * 1024 * 1024)
+            madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+        arena.buffers_.emplace_back(ptr, size);
+        return ptr;
+    }
+
+    //! return a rented buffer to the calling thread's arena
+    static void release(uint8_t* ptr) {
+        Arena& arena = thread_arena();
+        for (const std::pair<uint8_t*, size_t>& b : arena.buffers_) {
+            if (b.first == ptr) {
+                arena.free_.emplace_back(b);
+                return;
+            }
+        }
+        die("BufferArena::release(): unknown buffer");
+    }
+
+private:
+    struct Arena {
+        //! every buffer this thread ever allocated, with its capacity
+        std::vector<std::pair<uint8_t*, size_t> > buffers_;
+        //! the subset currently not rented out
+        std::vector<std::pair<uint8_t*, size_t> > free_;
+
+        ~Arena() {
+            for (const std::pair<uint8_t*, size_t>& b : buffers_)
+                free(b.first);
+        }
+    };
+
+    static Arena& thread_arena() {
+        static thread_local Arena arena;
+        return arena;
+    }
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_BUFFER_ARENA_HEADER
+
+/******************************************************************************/
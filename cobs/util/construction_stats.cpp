@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * cobs/util/construction_stats.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/util/construction_stats.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include <tlx/logger.hpp>
+#include <tlx/string/format_iec_units.hpp>
+
+namespace cobs {
+
+ConstructionStats g_construction_stats;
+
+void ConstructionStats::add_total_input_bytes(uint64_t total) {
+    total_input_bytes_.fetch_add(total, std::memory_order_relaxed);
+}
+
+//! format a duration in seconds as h:mm:ss
+static std::string format_eta(double seconds) {
+    uint64_t s = static_cast<uint64_t>(seconds + 0.5);
+    std::ostringstream os;
+    os << s / 3600 << ':'
+       << std::setw(2) << std::setfill('0') << s / 60 % 60 << ':'
+       << std::setw(2) << std::setfill('0') << s % 60;
+    return os.str();
+}
+
+void ConstructionStats::report() {
+    auto now = std::chrono::steady_clock::now();
+    double interval =
+        std::chrono::duration<double>(now - last_time_).count();
+    if (interval <= 0)
+        return;
+
+    uint64_t terms = terms_hashed.load(std::memory_order_relaxed);
+    uint64_t read = bytes_read.load(std::memory_order_relaxed);
+    uint64_t written = bytes_written.load(std::memory_order_relaxed);
+    uint64_t input = input_bytes.load(std::memory_order_relaxed);
+    uint64_t total = total_input_bytes_.load(std::memory_order_relaxed);
+
+    std::ostringstream os;
+    os << "progress:"
+       << " terms/s " << tlx::format_iec_units(
+        static_cast<uint64_t>((terms - last_terms_) / interval))
+       << " read " << tlx::format_iec_units(
+        static_cast<uint64_t>((read - last_read_) / interval)) << "B/s"
+       << " write " << tlx::format_iec_units(
+        static_cast<uint64_t>((written - last_written_) / interval)) << "B/s"
+       << " tasks " << tasks_done.load(std::memory_order_relaxed)
+       << '/' << tasks_total.load(std::memory_order_relaxed);
+
+    if (total != 0 && input != 0) {
+        double done = std::min(
+            1.0, static_cast<double>(input) / static_cast<double>(total));
+        double elapsed =
+            std::chrono::duration<double>(now - start_time_).count();
+        os << " input " << static_cast<uint64_t>(100 * done) << '%';
+        if (done < 1.0)
+            os << " eta " << format_eta(elapsed * (1 - done) / done);
+    }
+    LOG1 << os.str();
+
+    last_terms_ = terms, last_read_ = read, last_written_ = written;
+    last_time_ = now;
+}
+
+void ConstructionStats::print_json(std::ostream& os) {
+    double elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_time_).count();
+    os << "{\"elapsed\":" << elapsed
+       << ",\"terms_hashed\":" << terms_hashed.load(std::memory_order_relaxed)
+       << ",\"bits_set\":" << bits_set.load(std::memory_order_relaxed)
+       << ",\"input_bytes\":" << input_bytes.load(std::memory_order_relaxed)
+       << ",\"bytes_read\":" << bytes_read.load(std::memory_order_relaxed)
+       << ",\"bytes_written\":"
+       << bytes_written.load(std::memory_order_relaxed)
+       << ",\"tasks_done\":" << tasks_done.load(std::memory_order_relaxed)
+       << ",\"tasks_total\":" << tasks_total.load(std::memory_order_relaxed)
+       << '}';
+}
+
+void ConstructionStats::start_reporter(double interval) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (depth_++ != 0)
+        return;
+
+    // each outermost construction gets a self-contained set of counters
+    terms_hashed = bits_set = input_bytes = 0;
+    bytes_read = bytes_written = 0;
+    tasks_done = tasks_total = 0;
+    total_input_bytes_ = 0;
+
+    start_time_ = last_time_ = std::chrono::steady_clock::now();
+    last_terms_ = last_read_ = last_written_ = 0;
+    stop_ = false;
+    thread_ = std::thread(
+        [this, interval]() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!cv_.wait_for(
+                       lock, std::chrono::duration<double>(interval),
+                       [this]() { return stop_; }))
+            {
+                report();
+            }
+        });
+}
+
+void ConstructionStats::stop_reporter() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (--depth_ != 0)
+            return;
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+
+    std::ostringstream os;
+    print_json(os);
+    LOG1 << "construction_stats " << os.str();
+}
+
+ConstructionStats::ScopedReporter::ScopedReporter(double interval) {
+    g_construction_stats.start_reporter(interval);
+}
+
+ConstructionStats::ScopedReporter::~ScopedReporter() {
+    g_construction_stats.stop_reporter();
+}
+
+} // namespace cobs
+
+/******************************************************************************/
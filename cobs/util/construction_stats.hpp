@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * cobs/util/construction_stats.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_CONSTRUCTION_STATS_HEADER
+#define COBS_UTIL_CONSTRUCTION_STATS_HEADER
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+namespace cobs {
+
+/*!
+ * Global throughput counters for index construction, bumped with relaxed
+ * atomics from the worker threads. A reporter thread samples them
+ * periodically and prints per-stage rates, overall progress, and an ETA
+ * derived from the fraction of input bytes processed; when construction
+ * finishes, a machine-readable JSON summary line is printed, so a slow
+ * build can be diagnosed as hash-bound, I/O-bound, or skew-bound even
+ * after the fact.
+ */
+class ConstructionStats
+{
+public:
+    //! k-mers run through hashing
+    std::atomic<uint64_t> terms_hashed { 0 };
+    //! one bits in finished batch matrices
+    std::atomic<uint64_t> bits_set { 0 };
+    //! bytes of input documents fully processed
+    std::atomic<uint64_t> input_bytes { 0 };
+    //! bytes read back from temporary indexes while combining
+    std::atomic<uint64_t> bytes_read { 0 };
+    //! bytes of index data written
+    std::atomic<uint64_t> bytes_written { 0 };
+    //! construction tasks finished
+    std::atomic<uint64_t> tasks_done { 0 };
+    //! construction tasks scheduled
+    std::atomic<uint64_t> tasks_total { 0 };
+
+    //! announce input volume still to be processed, enables progress and
+    //! ETA; additive, so nested construction scopes each announce theirs
+    void add_total_input_bytes(uint64_t total);
+
+    //! print rates since the previous report, plus progress and ETA
+    void report();
+
+    //! print a machine-readable summary of all counters as one JSON line
+    void print_json(std::ostream& os);
+
+    /*!
+     * Runs the reporter thread for the enclosing scope: started by the
+     * outermost construction entry point, prints a report every
+     * interval, and dumps the JSON summary when that scope ends. Nested
+     * scopes (classic construction inside compact construction) only
+     * bump a depth counter.
+     */
+    class ScopedReporter
+    {
+    public:
+        explicit ScopedReporter(double interval = 10.0);
+        ~ScopedReporter();
+
+        //! non-copyable: holds a share of the reporter thread
+        ScopedReporter(const ScopedReporter&) = delete;
+        //! non-copyable: holds a share of the reporter thread
+        ScopedReporter& operator = (const ScopedReporter&) = delete;
+    };
+
+private:
+    //! total input volume for progress and ETA, zero = unknown
+    std::atomic<uint64_t> total_input_bytes_ { 0 };
+
+    //! nesting depth of ScopedReporter scopes
+    size_t depth_ = 0;
+    //! reporter thread, runs while the outermost scope is alive
+    std::thread thread_;
+    //! guards depth_ and stop signaling
+    std::mutex mutex_;
+    //! wakes the reporter thread up for termination
+    std::condition_variable cv_;
+    //! set to terminate the reporter thread
+    bool stop_ = false;
+
+    //! start of the outermost scope
+    std::chrono::steady_clock::time_point start_time_;
+    //! counter values at the previous report, for rate computation
+    uint64_t last_terms_ = 0, last_read_ = 0, last_written_ = 0;
+    std::chrono::steady_clock::time_point last_time_;
+
+    void start_reporter(double interval);
+    void stop_reporter();
+};
+
+//! global construction statistics
+extern ConstructionStats g_construction_stats;
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_CONSTRUCTION_STATS_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,169 @@
+/*******************************************************************************
+ * cobs/util/fasta_block_parser.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_FASTA_BLOCK_PARSER_HEADER
+#define COBS_UTIL_FASTA_BLOCK_PARSER_HEADER
+
+#include <cstring>
+#include <istream>
+
+#include <tlx/container/string_view.hpp>
+#include <tlx/simple_vector.hpp>
+
+namespace cobs {
+
+/*!
+ * Rolling k-mer windower over a sequence delivered as contiguous pieces.
+ * Windows lying entirely inside one piece are emitted as string_views
+ * pointing directly into the caller's buffer; only windows straddling a
+ * piece boundary go through a small carry buffer holding the previous
+ * piece's term_size - 1 tail bytes. The sequence itself is never copied
+ * or reassembled.
+ */
+template <typename Callback>
+class KMerWindower
+{
+public:
+    KMerWindower(size_t term_size, Callback& callback)
+        : term_size_(term_size), callback_(callback),
+          carry_(2 * (term_size - 1)) { }
+
+    //! append the next piece of the sequence and emit its k-mer windows
+    void push(const char* data, size_t size) {
+        if (carry_size_ != 0) {
+            // complete windows straddling the piece boundary: the carry
+            // holds less than term_size bytes, so every window starting
+            // in it reaches into the new piece
+            size_t take = std::min(size, term_size_ - 1);
+            std::memcpy(carry_.data() + carry_size_, data, take);
+            size_t total = carry_size_ + take;
+            for (size_t i = 0; i < carry_size_ && i + term_size_ <= total;
+                 ++i) {
+                callback_(tlx::string_view(carry_.data() + i, term_size_));
+            }
+            if (size < term_size_) {
+                // piece too short to refill the carry from its own tail
+                if (total > term_size_ - 1) {
+                    std::memmove(carry_.data(),
+                                 carry_.data() + total - (term_size_ - 1),
+                                 term_size_ - 1);
+                    total = term_size_ - 1;
+                }
+                carry_size_ = total;
+                return;
+            }
+        }
+        else if (size < term_size_) {
+            std::memcpy(carry_.data() + carry_size_, data, size);
+            carry_size_ += size;
+            return;
+        }
+
+        // windows entirely inside the piece, straight from the buffer
+        for (size_t i = 0; i + term_size_ <= size; ++i) {
+            callback_(tlx::string_view(data + i, term_size_));
+        }
+        carry_size_ = term_size_ - 1;
+        std::memcpy(carry_.data(), data + size - carry_size_, carry_size_);
+    }
+
+    //! forget the carried tail, the next piece starts a new sequence
+    void restart() { carry_size_ = 0; }
+
+private:
+    //! window length
+    size_t term_size_;
+    //! window consumer
+    Callback& callback_;
+    //! tail of the previous piece plus the head of the next one
+    tlx::simple_vector<char> carry_;
+    //! valid prefix of carry_, always less than term_size_
+    size_t carry_size_ = 0;
+};
+
+/*!
+ * Reads FASTA sequence data from is in large blocks, scans line breaks
+ * with memchr, and feeds the sequence line pieces through a KMerWindower
+ * -- replacing the per-line getline/append/erase loop that copied every
+ * sequence byte several times. A trailing carriage return is stripped
+ * from each line. With stop_at_header the parser returns at the first
+ * header or comment line (sub-document extraction); otherwise such lines
+ * restart the window. With restart_on_empty, empty lines restart the
+ * window as well.
+ */
+template <typename Callback>
+void fasta_process_blocks(std::istream& is, size_t term_size,
+                          bool stop_at_header, bool restart_on_empty,
+                          Callback callback) {
+    static const size_t block_size = 1024 * 1024;
+    tlx::simple_vector<char> block(block_size);
+    KMerWindower<Callback> windower(term_size, callback);
+
+    // parser state carried across block boundaries
+    bool at_line_start = true;
+    bool skip_line = false;
+
+    while (is) {
+        is.read(block.data(), block_size);
+        size_t avail = is.gcount();
+        if (avail == 0)
+            break;
+
+        const char* pos = block.data();
+        const char* end = block.data() + avail;
+        while (pos != end) {
+            if (skip_line) {
+                // inside a header or comment line, drop it
+                const char* nl = static_cast<const char*>(
+                    std::memchr(pos, '\n', end - pos));
+                if (nl == nullptr) {
+                    pos = end;
+                    break;
+                }
+                pos = nl + 1;
+                skip_line = false;
+                at_line_start = true;
+                continue;
+            }
+            if (at_line_start && (*pos == '>' || *pos == ';')) {
+                if (stop_at_header)
+                    return;
+                windower.restart();
+                skip_line = true;
+                continue;
+            }
+
+            const char* nl = static_cast<const char*>(
+                std::memchr(pos, '\n', end - pos));
+            const char* piece_end = (nl != nullptr) ? nl : end;
+            if (piece_end != pos && piece_end[-1] == '\r' && nl != nullptr)
+                --piece_end;
+
+            if (piece_end != pos)
+                windower.push(pos, piece_end - pos);
+            else if (at_line_start && nl != nullptr && restart_on_empty)
+                windower.restart();
+
+            if (nl == nullptr) {
+                // line continues in the next block
+                at_line_start = false;
+                pos = end;
+            }
+            else {
+                at_line_start = true;
+                pos = nl + 1;
+            }
+        }
+    }
+}
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_FASTA_BLOCK_PARSER_HEADER
+
+/******************************************************************************/
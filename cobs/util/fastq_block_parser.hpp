@@ -0,0 +1,184 @@
+/*******************************************************************************
+ * cobs/util/fastq_block_parser.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_FASTQ_BLOCK_PARSER_HEADER
+#define COBS_UTIL_FASTQ_BLOCK_PARSER_HEADER
+
+#include <cstring>
+#include <istream>
+
+#include <cobs/util/fasta_block_parser.hpp>
+
+#include <tlx/die.hpp>
+#include <tlx/simple_vector.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace cobs {
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define COBS_FASTQ_X86_DISPATCH 1
+#endif
+
+/*!
+ * Scans a buffer for newlines and calls piece(begin, end, complete) for
+ * each line, where complete is false for a line cut off at the buffer
+ * end. The AVX2 variant below compares 32 bytes at a time and walks the
+ * movemask bits, so line splitting keeps up with NVMe read rates.
+ */
+template <typename LinePiece>
+void fastq_scan_lines_plain(const char* data, size_t size,
+                            LinePiece& piece) {
+    const char* pos = data;
+    const char* end = data + size;
+    while (pos != end) {
+        const char* nl = static_cast<const char*>(
+            std::memchr(pos, '\n', end - pos));
+        if (nl == nullptr) {
+            piece(pos, end, false);
+            return;
+        }
+        piece(pos, nl, true);
+        pos = nl + 1;
+    }
+}
+
+#if COBS_FASTQ_X86_DISPATCH
+
+template <typename LinePiece>
+__attribute__ ((target ("avx2")))
+void fastq_scan_lines_avx2(const char* data, size_t size,
+                           LinePiece& piece) {
+    const __m256i newlines = _mm256_set1_epi8('\n');
+    const char* line_begin = data;
+    size_t j = 0;
+    for ( ; j + 32 <= size; j += 32) {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i_u*>(data + j));
+        uint32_t m = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(v, newlines));
+        while (m != 0) {
+            const char* nl = data + j + __builtin_ctz(m);
+            piece(line_begin, nl, true);
+            line_begin = nl + 1;
+            m &= m - 1;
+        }
+    }
+    // scalar tail of less than 32 bytes
+    const char* pos = line_begin;
+    const char* end = data + size;
+    while (pos != end) {
+        const char* nl = static_cast<const char*>(
+            std::memchr(pos, '\n', end - pos));
+        if (nl == nullptr)
+            break;
+        piece(line_begin, nl, true);
+        line_begin = nl + 1;
+        pos = nl + 1;
+    }
+    if (line_begin != end)
+        piece(line_begin, end, false);
+}
+
+static inline
+bool fastq_cpu_supports_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#endif  // COBS_FASTQ_X86_DISPATCH
+
+template <typename LinePiece>
+void fastq_scan_lines(const char* data, size_t size, LinePiece& piece) {
+#if COBS_FASTQ_X86_DISPATCH
+    if (fastq_cpu_supports_avx2())
+        return fastq_scan_lines_avx2(data, size, piece);
+#endif
+    return fastq_scan_lines_plain(data, size, piece);
+}
+
+/*!
+ * Reads FASTQ data from is in large blocks and walks the 4-line record
+ * structure with the vectorized line scanner: the '@' and '+' sentinel
+ * lines are validated by their first byte only, quality lines are
+ * skipped, and sequence lines are windowed in place through a
+ * KMerWindower -- no intermediate std::string per line. The path is only
+ * used for error messages.
+ */
+template <typename Callback>
+void fastq_process_blocks(std::istream& is, size_t term_size,
+                          const std::string& path, Callback callback) {
+    static const size_t block_size = 1024 * 1024;
+    tlx::simple_vector<char> block(block_size);
+    KMerWindower<Callback> windower(term_size, callback);
+
+    // record state carried across line pieces and blocks
+    size_t line_num = 0;
+    size_t phase = 0;
+    bool line_empty = true;
+
+    auto piece =
+        [&](const char* begin, const char* end, bool complete) {
+            if (begin != end && line_empty) {
+                // first byte of the line carries the record sentinel
+                if (phase == 0 && *begin != '@') {
+                    die("FastqFile: line " << line_num <<
+                        " does not start with @ - " << path);
+                }
+                if (phase == 2 && *begin != '+') {
+                    die("FastqFile: line " << line_num <<
+                        " does not start with + - " << path);
+                }
+                line_empty = false;
+            }
+            if (phase == 1 && begin != end) {
+                const char* piece_end = end;
+                if (complete && piece_end[-1] == '\r')
+                    --piece_end;
+                if (piece_end != begin)
+                    windower.push(begin, piece_end - begin);
+            }
+            if (complete) {
+                if (line_empty) {
+                    if (phase == 0) {
+                        die("FastqFile: line " << line_num <<
+                            " does not start with @ - " << path);
+                    }
+                    if (phase == 2) {
+                        die("FastqFile: line " << line_num <<
+                            " does not start with + - " << path);
+                    }
+                }
+                if (phase == 1)
+                    windower.restart();
+                line_empty = true;
+                phase = (phase + 1) % 4;
+                ++line_num;
+            }
+        };
+
+    while (is) {
+        is.read(block.data(), block_size);
+        size_t avail = is.gcount();
+        if (avail == 0)
+            break;
+        fastq_scan_lines(block.data(), avail, piece);
+    }
+    // final line without trailing newline
+    if (!line_empty)
+        piece(nullptr, nullptr, true);
+}
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_FASTQ_BLOCK_PARSER_HEADER
+
+/******************************************************************************/
@@ -10,9 +10,15 @@
 #define COBS_UTIL_FILE_HEADER
 
 #include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <cobs/util/fs.hpp>
 
 #include <tlx/die.hpp>
@@ -75,6 +81,121 @@ std::string base_name(const fs::path& p) {
     return result.substr(0, pos);
 }
 
+/*!
+ * Bulk file writer for large index outputs. Coalesces append() calls into
+ * an aligned staging buffer and issues large writes; with direct = true
+ * the file is opened O_DIRECT where available, bypassing the page cache
+ * so writing out a huge index does not evict the input blocks that are
+ * still being read. The final partial block is padded to the required
+ * alignment for the direct write and the file truncated to its true size
+ * on close().
+ */
+class BulkWriter
+{
+public:
+    //! alignment required by O_DIRECT, also used for the staging buffer
+    static const size_t alignment = 4096;
+    //! size of the staging buffer, writes are issued in this unit
+    static const size_t buffer_capacity = 4 * 1024 * 1024;
+
+    explicit BulkWriter(const fs::path& path, bool direct = false)
+        : path_(path), direct_(direct) {
+        if (!path.parent_path().empty())
+            fs::create_directories(path.parent_path());
+
+        int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#if defined(O_DIRECT)
+        if (direct_)
+            flags |= O_DIRECT;
+#else
+        direct_ = false;
+#endif
+        fd_ = ::open(path.string().c_str(), flags, 0644);
+        if (fd_ < 0 && direct_) {
+            // file system without O_DIRECT support: fall back to buffered
+            direct_ = false;
+            fd_ = ::open(path.string().c_str(),
+                         O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        die_unless(fd_ >= 0);
+
+        void* buffer = nullptr;
+        die_unequal(0, posix_memalign(&buffer, alignment, buffer_capacity));
+        buffer_ = static_cast<uint8_t*>(buffer);
+    }
+
+    //! non-copyable: a BulkWriter owns its file descriptor
+    BulkWriter(const BulkWriter&) = delete;
+    BulkWriter& operator = (const BulkWriter&) = delete;
+
+    ~BulkWriter() {
+        close();
+    }
+
+    //! append size bytes, coalesced into full staging buffers
+    void append(const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        appended_ += size;
+        while (size != 0) {
+            size_t n = std::min(size, buffer_capacity - buffer_fill_);
+            std::memcpy(buffer_ + buffer_fill_, p, n);
+            buffer_fill_ += n, p += n, size -= n;
+            if (buffer_fill_ == buffer_capacity)
+                flush_block(buffer_capacity);
+        }
+    }
+
+    //! flush the remaining bytes and close the file
+    void close() {
+        if (fd_ < 0)
+            return;
+        if (buffer_fill_ != 0) {
+            size_t fill = buffer_fill_;
+            if (direct_) {
+                // pad the final block to the O_DIRECT alignment, the file
+                // is truncated to its true size below
+                size_t padded =
+                    (fill + alignment - 1) / alignment * alignment;
+                std::memset(buffer_ + fill, 0, padded - fill);
+                flush_block(padded);
+            }
+            else {
+                flush_block(fill);
+            }
+        }
+        if (direct_ && appended_ % alignment != 0) {
+            die_unless(::ftruncate(fd_, appended_) == 0);
+        }
+        ::close(fd_);
+        fd_ = -1;
+        free(buffer_);
+        buffer_ = nullptr;
+    }
+
+private:
+    void flush_block(size_t size) {
+        size_t pos = 0;
+        while (pos < size) {
+            ssize_t w = ::write(fd_, buffer_ + pos, size - pos);
+            if (w <= 0) {
+                die("BulkWriter: error writing to " << path_.string()
+                                                    << ": " << strerror(errno));
+            }
+            pos += w;
+        }
+        buffer_fill_ = 0;
+    }
+
+    fs::path path_;
+    bool direct_;
+    int fd_ = -1;
+
+    uint8_t* buffer_ = nullptr;
+    size_t buffer_fill_ = 0;
+    //! total bytes appended = true output file size
+    uint64_t appended_ = 0;
+};
+
 } // namespace cobs
 
 #endif // !COBS_UTIL_FILE_HEADER
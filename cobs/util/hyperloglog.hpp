@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * cobs/util/hyperloglog.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_HYPERLOGLOG_HEADER
+#define COBS_UTIL_HYPERLOGLOG_HEADER
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Plain HyperLogLog cardinality sketch over 64-bit hash values, used to
+ * estimate the number of distinct k-mers in a document without storing
+ * them. With the default precision of 12 the sketch holds 4096 one-byte
+ * registers and estimates within about 1.6 % relative error, which is
+ * plenty for sizing Bloom filter rows.
+ */
+class HyperLogLog
+{
+public:
+    explicit HyperLogLog(unsigned precision = 12)
+        : precision_(precision),
+          registers_(size_t(1) << precision) { }
+
+    //! add one 64-bit hash value of an element
+    void add(uint64_t hash) {
+        size_t index = hash >> (64 - precision_);
+        // rank = position of the first one bit in the remaining bits
+        uint64_t rest = (hash << precision_) | (uint64_t(1) << (precision_ - 1));
+        uint8_t rank = uint8_t(__builtin_clzll(rest) + 1);
+        if (rank > registers_[index])
+            registers_[index] = rank;
+    }
+
+    //! combine with another sketch of the same precision
+    void merge(const HyperLogLog& other) {
+        for (size_t i = 0; i < registers_.size(); ++i) {
+            if (other.registers_[i] > registers_[i])
+                registers_[i] = other.registers_[i];
+        }
+    }
+
+    //! estimate the number of distinct elements added
+    uint64_t estimate() const {
+        double m = double(registers_.size());
+        double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (uint8_t r : registers_) {
+            sum += std::ldexp(1.0, -r);
+            if (r == 0)
+                ++zeros;
+        }
+        double estimate = alpha * m * m / sum;
+
+        // small range correction: linear counting over empty registers
+        if (estimate <= 2.5 * m && zeros != 0)
+            estimate = m * std::log(m / double(zeros));
+
+        return uint64_t(estimate + 0.5);
+    }
+
+private:
+    unsigned precision_;
+    std::vector<uint8_t> registers_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_HYPERLOGLOG_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ * cobs/util/minimizer.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_MINIMIZER_HEADER
+#define COBS_UTIL_MINIMIZER_HEADER
+
+#include <xxhash.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace cobs {
+
+//! seed of the minimizer ordering hash; distinct from the seeds used for
+//! Bloom filter positions so selection and signature bits are independent
+static const uint64_t minimizer_hash_seed = 0x8F0F51B3E4C92A75LLU;
+
+/*!
+ * Sliding-window minimizer filter over a document's or query's term
+ * stream: of every window of window_size consecutive terms only the term
+ * with the smallest ordering hash is kept, and each selected position is
+ * emitted to the callback exactly once. Terms are ranked by XXH64 of
+ * their (canonical) text with a dedicated seed, with the term bytes as
+ * tie-break, so construction and query running the same filter over the
+ * same sequence select identical k-mers regardless of stream offsets.
+ */
+template <typename Callback>
+class MinimizerFilter
+{
+public:
+    MinimizerFilter(uint64_t window_size, uint32_t term_size,
+                    Callback callback)
+        : window_(window_size), term_size_(term_size), callback_(callback),
+          terms_(window_size * term_size),
+          ranks_(window_size), positions_(window_size) { }
+
+    //! feed the next term of the stream, term_size bytes
+    void push(const char* term) {
+        size_t slot = pos_ % window_;
+        std::memcpy(terms_.data() + slot * term_size_, term, term_size_);
+        ranks_[slot] = XXH64(term, term_size_, minimizer_hash_seed);
+        positions_[slot] = pos_;
+        ++pos_;
+        if (pos_ >= window_)
+            emit_window_minimum(window_);
+    }
+
+    //! flush a stream shorter than one window: emit the minimizer of the
+    //! terms seen, so short queries and documents are not dropped entirely
+    void finish() {
+        if (pos_ > 0 && pos_ < window_)
+            emit_window_minimum(pos_);
+    }
+
+private:
+    //! emit the minimum of the last num_slots terms, once per position
+    void emit_window_minimum(size_t num_slots) {
+        size_t best = 0;
+        for (size_t s = 1; s < num_slots; ++s) {
+            if (ranks_[s] < ranks_[best] ||
+                (ranks_[s] == ranks_[best] &&
+                 std::memcmp(terms_.data() + s * term_size_,
+                             terms_.data() + best * term_size_,
+                             term_size_) < 0))
+                best = s;
+        }
+        if (positions_[best] != last_emitted_) {
+            last_emitted_ = positions_[best];
+            callback_(terms_.data() + best * term_size_);
+        }
+    }
+
+    uint64_t window_;
+    uint32_t term_size_;
+    Callback callback_;
+
+    //! ring buffer of the last window_ terms and their ordering hashes
+    std::vector<char> terms_;
+    std::vector<uint64_t> ranks_;
+    std::vector<uint64_t> positions_;
+
+    uint64_t pos_ = 0;
+    uint64_t last_emitted_ = uint64_t(-1);
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_MINIMIZER_HEADER
+
+/******************************************************************************/
@@ -23,6 +23,9 @@ namespace cobs {
 
 uint64_t get_page_size();
 
+//! size of a transparent hugepage on the architectures cobs runs on
+static const uint64_t hugepage_size = 2 * 1024 * 1024;
+
 uint64_t get_memory_size();
 
 uint64_t get_memory_size(size_t percentage);
@@ -60,15 +63,35 @@ std::string pad_index(unsigned index, int size = 6) {
 }
 
 /*!
- * Constructs the hash used by the signatures.
+ * Constructs the hashes used by the signatures. hash_mode 0 evaluates XXH64
+ * once per hash function with seed i; hash_mode 1 uses the double hashing
+ * scheme h_i = h1 + i * h2, which needs only two XXH64 evaluations
+ * regardless of num_hashes (v2 index format).
  */
 template <typename Callback>
 void process_hashes(const void* input, size_t size, uint64_t signature_size,
-                    uint64_t num_hashes, Callback callback) {
-    for (unsigned int i = 0; i < num_hashes; i++) {
-        uint64_t hash = XXH64(input, size, i);
-        callback(hash % signature_size);
+                    uint64_t num_hashes, uint8_t hash_mode,
+                    Callback callback) {
+    if (hash_mode == 0) {
+        for (unsigned int i = 0; i < num_hashes; i++) {
+            uint64_t hash = XXH64(input, size, i);
+            callback(hash % signature_size);
+        }
     }
+    else {
+        uint64_t h1 = XXH64(input, size, 0);
+        uint64_t h2 = XXH64(input, size, 1);
+        for (unsigned int i = 0; i < num_hashes; i++) {
+            callback((h1 + i * h2) % signature_size);
+        }
+    }
+}
+
+template <typename Callback>
+void process_hashes(const void* input, size_t size, uint64_t signature_size,
+                    uint64_t num_hashes, Callback callback) {
+    return process_hashes(input, size, signature_size, num_hashes,
+                          /* hash_mode */ 0, callback);
 }
 
 } // namespace cobs
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * cobs/util/mmap_pager.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/util/error_handling.hpp>
+#include <cobs/util/misc.hpp>
+#include <cobs/util/mmap_pager.hpp>
+
+#include <algorithm>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <tlx/die.hpp>
+#include <tlx/math/div_ceil.hpp>
+#include <tlx/math/round_up.hpp>
+
+namespace cobs {
+
+MMapPager::MMapPager(const MMapHandle& handle,
+                     uint64_t window_size, uint64_t budget_bytes)
+    : data_(handle.data), size_(handle.size), fd_(handle.fd)
+{
+    die_unless(window_size != 0);
+    // windows are dropped with madvise, which works on page granularity
+    window_size_ = tlx::round_up(window_size, get_page_size());
+    num_windows_ = tlx::div_ceil(size_, window_size_);
+    budget_windows_ = std::max<uint64_t>(1, budget_bytes / window_size_);
+
+    hits_ = std::vector<std::atomic<uint64_t> >(num_windows_);
+    touched_ = std::vector<std::atomic<uint8_t> >(num_windows_);
+}
+
+void MMapPager::access(uint64_t offset) {
+    size_t w = offset / window_size_;
+    hits_[w].fetch_add(1, std::memory_order_relaxed);
+    if (touched_[w].exchange(1, std::memory_order_relaxed) == 0) {
+        if (touched_count_.fetch_add(1, std::memory_order_relaxed) + 1
+            > budget_windows_) {
+            evict_cold();
+        }
+    }
+}
+
+void MMapPager::evict_cold() {
+    // one thread evicts while the others keep querying; a skipped pass
+    // is retriggered by the next first touch of a window
+    std::unique_lock<std::mutex> lock(evict_mutex_, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    // order the touched windows by access count, coldest first
+    std::vector<std::pair<uint64_t, size_t> > order;
+    for (size_t w = 0; w < num_windows_; ++w) {
+        if (touched_[w].load(std::memory_order_relaxed) != 0)
+            order.emplace_back(hits_[w].load(std::memory_order_relaxed), w);
+    }
+    // drop down to 3/4 of the budget, so evictions run as occasional
+    // batches instead of once per newly touched window
+    uint64_t keep = budget_windows_ - budget_windows_ / 4;
+    if (order.size() <= keep)
+        return;
+    std::sort(order.begin(), order.end());
+
+    for (size_t i = 0; i + keep < order.size(); ++i) {
+        size_t w = order[i].second;
+        uint64_t begin = w * window_size_;
+        uint64_t length = std::min(window_size_, size_ - begin);
+        if (madvise(data_ + begin, length, MADV_DONTNEED)) {
+            print_errno("MMapPager: madvise(MADV_DONTNEED) failed");
+        }
+        // also drop the window from the page cache, otherwise the bytes
+        // only move from the mapping into the file cache
+        posix_fadvise(fd_, begin, length, POSIX_FADV_DONTNEED);
+        touched_[w].store(0, std::memory_order_relaxed);
+        touched_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // age all access counts so windows that cool down can be displaced
+    // by newly hot ones in later passes
+    for (size_t w = 0; w < num_windows_; ++w) {
+        hits_[w].store(hits_[w].load(std::memory_order_relaxed) / 2,
+                       std::memory_order_relaxed);
+    }
+}
+
+} // namespace cobs
+
+/******************************************************************************/
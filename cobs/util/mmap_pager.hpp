@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * cobs/util/mmap_pager.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_MMAP_PAGER_HEADER
+#define COBS_UTIL_MMAP_PAGER_HEADER
+
+#include <cobs/util/query.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Application-level replacement policy for an index mapping larger than
+ * RAM. The file stays mapped flat -- address space is plentiful -- but
+ * the pager divides the mapping into fixed-size windows, counts row
+ * accesses per window, and once more windows were touched than fit the
+ * byte budget drops the coldest ones with madvise(MADV_DONTNEED) plus
+ * posix_fadvise(POSIX_FADV_DONTNEED). This matches the row skew of the
+ * query stream instead of the kernel's generic page reclaim, which
+ * thrashes under random row access. Dropping a window races benignly
+ * with concurrent readers: a touch after the drop simply refaults the
+ * page from disk and delivers the same bytes.
+ */
+class MMapPager
+{
+public:
+    //! track the mapping of handle in windows of window_size bytes,
+    //! keeping at most budget_bytes of touched windows resident
+    MMapPager(const MMapHandle& handle,
+              uint64_t window_size, uint64_t budget_bytes);
+
+    //! non-copyable: windows reference one fixed mapping
+    MMapPager(const MMapPager&) = delete;
+    MMapPager& operator = (const MMapPager&) = delete;
+
+    //! count a row access at the given mapping offset; triggers an
+    //! eviction pass when the touched windows outgrow the budget
+    void access(uint64_t offset);
+
+    //! number of windows currently counted against the budget
+    uint64_t touched_windows() const {
+        return touched_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    //! drop the coldest touched windows down to the budget hysteresis
+    void evict_cold();
+
+    //! base and length of the tracked mapping
+    uint8_t* data_;
+    uint64_t size_;
+    //! descriptor of the mapped file, for dropping its cached pages
+    int fd_;
+
+    uint64_t window_size_;
+    uint64_t num_windows_;
+    //! budget in windows, at least one
+    uint64_t budget_windows_;
+
+    //! per-window access counts since the last aging pass
+    std::vector<std::atomic<uint64_t> > hits_;
+    //! per-window flag: counted against the budget since the last drop
+    std::vector<std::atomic<uint8_t> > touched_;
+    std::atomic<uint64_t> touched_count_ { 0 };
+
+    //! serializes eviction passes; contenders skip instead of waiting
+    std::mutex evict_mutex_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_MMAP_PAGER_HEADER
+
+/******************************************************************************/
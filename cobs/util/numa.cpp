@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * cobs/util/numa.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/util/misc.hpp>
+#include <cobs/util/numa.hpp>
+
+#include <fstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cobs {
+
+#if defined(__linux__)
+
+//! parse a sysfs cpulist such as "0-3,8-11" into cpu ids
+static void parse_cpulist(const std::string& list,
+                          std::vector<unsigned>& cpus) {
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end;
+        unsigned first = std::stoul(list.substr(pos), &end);
+        pos += end;
+        unsigned last = first;
+        if (pos < list.size() && list[pos] == '-') {
+            ++pos;
+            last = std::stoul(list.substr(pos), &end);
+            pos += end;
+        }
+        for (unsigned c = first; c <= last; ++c)
+            cpus.push_back(c);
+        if (pos < list.size() && list[pos] == ',')
+            ++pos;
+    }
+}
+
+static NumaTopology detect_numa_topology() {
+    NumaTopology topo;
+    for (size_t node = 0; ; ++node) {
+        std::ifstream is("/sys/devices/system/node/node"
+                         + std::to_string(node) + "/cpulist");
+        if (!is.good())
+            break;
+        std::string list;
+        std::getline(is, list);
+        std::vector<unsigned> cpus;
+        parse_cpulist(list, cpus);
+        if (cpus.empty())
+            break;
+        topo.node_cpus.emplace_back(std::move(cpus));
+    }
+    return topo;
+}
+
+const NumaTopology& numa_topology() {
+    static NumaTopology topo = detect_numa_topology();
+    return topo;
+}
+
+void numa_pin_thread(size_t node) {
+    const NumaTopology& topo = numa_topology();
+    if (node >= topo.node_cpus.size())
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : topo.node_cpus[node])
+        CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+void numa_unpin_thread() {
+    const NumaTopology& topo = numa_topology();
+    if (topo.node_cpus.empty())
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const std::vector<unsigned>& cpus : topo.node_cpus) {
+        for (unsigned cpu : cpus)
+            CPU_SET(cpu, &set);
+    }
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+// mbind() constants, copied from linux/mempolicy.h as there is no libc
+// wrapper, in the style of the raw syscalls in aio.cpp
+static const int MPOL_PREFERRED_ = 1;
+static const unsigned MPOL_MF_MOVE_ = 1 << 1;
+
+void numa_move_memory(void* ptr, size_t size, size_t node) {
+    const NumaTopology& topo = numa_topology();
+    if (node >= topo.node_cpus.size())
+        return;
+
+    // shrink to the pages fully contained in the range, so pages shared
+    // with a neighboring node's segment stay where their owner put them
+    uint64_t page_size = get_page_size();
+    uint64_t begin = reinterpret_cast<uint64_t>(ptr);
+    uint64_t end = begin + size;
+    begin = (begin + page_size - 1) / page_size * page_size;
+    end = end / page_size * page_size;
+    if (end <= begin)
+        return;
+
+    unsigned long nodemask = 1UL << node;
+    syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED_,
+            &nodemask, sizeof(nodemask) * 8 + 1, MPOL_MF_MOVE_);
+}
+
+#else // !defined(__linux__)
+
+const NumaTopology& numa_topology() {
+    static NumaTopology topo;
+    return topo;
+}
+
+void numa_pin_thread(size_t) { }
+
+void numa_unpin_thread() { }
+
+void numa_move_memory(void*, size_t, size_t) { }
+
+#endif // !defined(__linux__)
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,40 @@
+/*******************************************************************************
+ * cobs/util/numa.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_NUMA_HEADER
+#define COBS_UTIL_NUMA_HEADER
+
+#include <cstddef>
+#include <vector>
+
+namespace cobs {
+
+//! CPU ids grouped by NUMA node, read from sysfs. Empty on non-Linux
+//! systems and on machines without NUMA information.
+struct NumaTopology {
+    std::vector<std::vector<unsigned> > node_cpus;
+};
+
+//! the machine's NUMA topology, detected once and cached
+const NumaTopology& numa_topology();
+
+//! restrict the calling thread to the CPUs of one node
+void numa_pin_thread(size_t node);
+
+//! undo numa_pin_thread(), allowing the calling thread on all known CPUs
+void numa_unpin_thread();
+
+//! best-effort migration of the pages fully inside [ptr, ptr + size) to
+//! the given node via mbind(), ignoring failures
+void numa_move_memory(void* ptr, size_t size, size_t node);
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_NUMA_HEADER
+
+/******************************************************************************/
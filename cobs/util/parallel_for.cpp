@@ -6,13 +6,269 @@
  * All rights reserved. Published under the MIT License in the LICENSE file.
  ******************************************************************************/
 
+#include <cobs/settings.hpp>
 #include <cobs/util/parallel_for.hpp>
 
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace cobs {
+namespace parallel {
+
+namespace {
+
+//! ratio of chunks to threads: enough pieces for stealing to balance
+//! skewed iteration costs, few enough to keep scheduling overhead low
+static const size_t chunks_per_thread = 8;
+
+//! a contiguous piece [begin, end) of one loop's index range
+struct Chunk {
+    ForLoop* loop;
+    size_t begin, end;
+};
+
+//! take one worker concurrency ticket of the chunk's loop, or refuse
+static bool try_acquire_slot(ForLoop* loop) {
+    size_t s = loop->worker_slots.load(std::memory_order_relaxed);
+    while (s != 0) {
+        if (loop->worker_slots.compare_exchange_weak(s, s - 1))
+            return true;
+    }
+    return false;
+}
+
+/*!
+ * Work-stealing pool singleton behind parallel_for(). Every worker owns
+ * a deque of chunks: it pops its own newest chunk and steals the oldest
+ * chunk of a victim when it runs dry. The deques are guarded by plain
+ * per-worker mutexes -- with chunked loops the queue operations are so
+ * infrequent that a lock-free deque would buy nothing. Each loop caps
+ * its concurrency with worker slot tickets, so nested parallel_for()
+ * calls keep the caller's thread budget (classic_combine sizes its row
+ * buffers by it).
+ */
+class WorkStealingPool
+{
+public:
+    //! return the process-wide pool, started on first use
+    static WorkStealingPool& get() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+    //! split [begin, end) into chunks, queue them, and help executing
+    //! this loop's chunks until all are finished
+    void run_loop(ForLoop& loop, size_t begin, size_t end,
+                  size_t num_threads);
+
+private:
+    WorkStealingPool();
+    ~WorkStealingPool();
+
+    //! main loop of pool thread `index`
+    void worker(size_t index);
+
+    //! pop the newest own chunk or steal the oldest chunk of another
+    //! worker, taking a worker slot of its loop; false if nothing runnable
+    bool take_chunk(size_t self, Chunk& out);
+
+    //! take any queued chunk of the given loop without a slot, used by
+    //! the calling thread to help its own loop
+    bool take_chunk_of(ForLoop* loop, Chunk& out);
+
+    //! run the chunk, catching the first exception into its loop, and
+    //! signal the loop's caller when the last chunk finishes; workers
+    //! hand back their concurrency slot, the helping caller holds none
+    void execute(const Chunk& c, bool release_slot);
+
+    //! bump the wake epoch and wake sleeping workers
+    void notify_workers();
+
+    struct Worker {
+        std::deque<Chunk> chunks;
+        std::mutex mutex;
+    };
+
+    std::deque<Worker> workers_;
+    std::vector<std::thread> threads_;
+
+    //! epoch counter for worker wakeups: bumped when chunks are queued
+    //! or a worker slot frees up, so a worker that found nothing
+    //! runnable sleeps until the situation changed
+    size_t wake_epoch_ = 0;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stopping_ = false;
+
+    //! round-robin target for queueing new chunks
+    std::atomic<size_t> next_worker_ { 0 };
+};
+
+WorkStealingPool::WorkStealingPool()
+    : workers_(std::max<size_t>(std::thread::hardware_concurrency(), 1)) {
+    for (size_t t = 0; t < workers_.size(); ++t) {
+        threads_.emplace_back([this, t]() { worker(t); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+        ++wake_epoch_;
+    }
+    wake_cv_.notify_all();
+    for (std::thread& t : threads_)
+        t.join();
+}
+
+void WorkStealingPool::notify_workers() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        ++wake_epoch_;
+    }
+    wake_cv_.notify_all();
+}
+
+void WorkStealingPool::worker(size_t index) {
+#if defined(__linux__)
+    if (gopt_pin_threads) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(index % workers_.size(), &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    }
+#endif
+    for ( ; ; ) {
+        // remember the epoch before scanning: an event arriving between
+        // a failed scan and the wait below bumps it and prevents sleeping
+        size_t epoch;
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            epoch = wake_epoch_;
+        }
+        Chunk c;
+        if (take_chunk(index, c)) {
+            execute(c, /* release_slot */ true);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait(lock, [&]() {
+                          return wake_epoch_ != epoch || stopping_;
+                      });
+        if (stopping_)
+            return;
+    }
+}
+
+bool WorkStealingPool::take_chunk(size_t self, Chunk& out) {
+    for (size_t k = 0; k < workers_.size(); ++k) {
+        size_t i = (self + k) % workers_.size();
+        Worker& w = workers_[i];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        // own deque: newest first for locality; victims: oldest first
+        for (size_t p = 0; p < w.chunks.size(); ++p) {
+            size_t q = (i == self ? w.chunks.size() - 1 - p : p);
+            if (try_acquire_slot(w.chunks[q].loop)) {
+                out = w.chunks[q];
+                w.chunks.erase(w.chunks.begin() + q);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool WorkStealingPool::take_chunk_of(ForLoop* loop, Chunk& out) {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        Worker& w = workers_[i];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        for (size_t q = 0; q < w.chunks.size(); ++q) {
+            if (w.chunks[q].loop == loop) {
+                out = w.chunks[q];
+                w.chunks.erase(w.chunks.begin() + q);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::execute(const Chunk& c, bool release_slot) {
+    try {
+        c.loop->run_range(c.loop->functor, c.begin, c.end);
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(c.loop->mutex);
+        if (!c.loop->eptr)
+            c.loop->eptr = std::current_exception();
+    }
+    if (release_slot) {
+        c.loop->worker_slots.fetch_add(1);
+        notify_workers();
+    }
+    // the final decrement happens under the loop mutex and is the last
+    // access: the caller observes zero only under the same mutex, so the
+    // stack-allocated ForLoop cannot be destroyed underneath us
+    std::lock_guard<std::mutex> lock(c.loop->mutex);
+    if (c.loop->remaining_chunks.fetch_sub(1) == 1)
+        c.loop->done_cv.notify_all();
+}
+
+void WorkStealingPool::run_loop(ForLoop& loop, size_t begin, size_t end,
+                                size_t num_threads) {
+    size_t size = end - begin;
+    size_t num_chunks = std::min(size, num_threads * chunks_per_thread);
+    size_t chunk_size = (size + num_chunks - 1) / num_chunks;
+
+    std::vector<Chunk> chunks;
+    chunks.reserve(num_chunks);
+    for (size_t b = begin; b < end; b += chunk_size) {
+        chunks.push_back(Chunk { &loop, b, std::min(b + chunk_size, end) });
+    }
+    loop.remaining_chunks.store(chunks.size());
+    loop.worker_slots.store(num_threads - 1);
+
+    for (const Chunk& c : chunks) {
+        Worker& w = workers_[
+            next_worker_.fetch_add(1, std::memory_order_relaxed)
+            % workers_.size()];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.chunks.push_back(c);
+    }
+    notify_workers();
+
+    // help with our own loop's chunks, then wait for stolen stragglers
+    Chunk c;
+    while (take_chunk_of(&loop, c)) {
+        execute(c, /* release_slot */ false);
+    }
+    {
+        std::unique_lock<std::mutex> lock(loop.mutex);
+        loop.done_cv.wait(lock, [&]() {
+                              return loop.remaining_chunks.load() == 0;
+                          });
+    }
+
+    if (loop.eptr)
+        std::rethrow_exception(loop.eptr);
+}
+
+} // namespace
 
-//! thread pool singleton
-std::unique_ptr<tlx::ThreadPool> g_thread_pool;
+void run_for_loop(ForLoop& loop, size_t begin, size_t end,
+                  size_t num_threads) {
+    WorkStealingPool::get().run_loop(loop, begin, end, num_threads);
+}
 
+} // namespace parallel
 } // namespace cobs
 
 /******************************************************************************/
@@ -10,56 +10,74 @@
 #define COBS_UTIL_PARALLEL_FOR_HEADER
 
 #include <atomic>
+#include <condition_variable>
 #include <exception>
-
-#include <tlx/semaphore.hpp>
-#include <tlx/thread_pool.hpp>
+#include <mutex>
 
 namespace cobs {
 
-//! thread pool singleton
-extern std::unique_ptr<tlx::ThreadPool> g_thread_pool;
+namespace parallel {
+
+/*!
+ * One running parallel_for() call. The descriptor lives on the calling
+ * thread's stack until the loop is joined, so the chunks queued in the
+ * pool may reference it freely.
+ */
+struct ForLoop {
+    //! pointer to the caller's typed functor
+    void* functor;
+    //! type-erased trampoline running functor(i) over a chunk of indexes
+    void (* run_range)(void* functor, size_t begin, size_t end);
+
+    //! chunks not yet finished; the caller waits until this hits zero
+    std::atomic<size_t> remaining_chunks { 0 };
+    //! concurrency tickets left for pool workers; the calling thread is
+    //! the loop's num_threads-th executor and needs no ticket
+    std::atomic<size_t> worker_slots { 0 };
+
+    //! first exception thrown by the functor, rethrown by the caller
+    std::exception_ptr eptr;
+    //! guards eptr and done_cv
+    std::mutex mutex;
+    std::condition_variable done_cv;
+};
 
-//! run a functor in parallel
+//! distribute the loop's chunks over the work-stealing pool and help
+//! executing them until all are finished, defined in parallel_for.cpp
+void run_for_loop(ForLoop& loop, size_t begin, size_t end,
+                  size_t num_threads);
+
+} // namespace parallel
+
+/*!
+ * Run functor(i) for all i in [begin, end) on up to num_threads threads.
+ * The range is split into chunks distributed over the per-worker deques
+ * of a global work-stealing pool: each worker pops its own newest chunk
+ * and steals the oldest chunk of a victim when it runs dry, so fine
+ * grained loops neither serialize on one shared counter nor leave
+ * threads idle behind skewed chunks. The calling thread executes chunks
+ * too, which makes nested calls safe: a worker whose functor itself
+ * calls parallel_for() drives the inner loop to completion by helping.
+ */
 template <typename Functor>
 void parallel_for(size_t begin, size_t end, size_t num_threads,
                   Functor functor) {
-    if (num_threads <= 1) {
+    if (num_threads <= 1 || end - begin <= 1) {
         for (size_t i = begin; i < end; ++i) {
             functor(i);
         }
+        return;
     }
-    else {
-        if (!g_thread_pool)
-            g_thread_pool = std::make_unique<tlx::ThreadPool>();
 
-        tlx::Semaphore sem;
-        std::atomic<size_t> counter { begin };
-        std::exception_ptr eptr;
-        // enqueue threads for work
-        for (size_t t = 0; t < num_threads; ++t) {
-            g_thread_pool->enqueue(
-                [&]() {
-                    try {
-                        size_t i;
-                        while ((i = counter++) < end) {
-                            functor(i);
-                        }
-                    }
-                    catch (...) {
-                        // capture exception
-                        eptr = std::current_exception();
-                    }
-                    // done, raise semaphore
-                    sem.signal();
-                });
-        }
-        // wait for all num_threads to finish
-        sem.wait(num_threads);
-        // rethrow exception
-        if (eptr)
-            std::rethrow_exception(eptr);
-    }
+    parallel::ForLoop loop;
+    loop.functor = &functor;
+    loop.run_range =
+        [](void* f, size_t b, size_t e) {
+            for (size_t i = b; i < e; ++i) {
+                (*static_cast<Functor*>(f))(i);
+            }
+        };
+    parallel::run_for_loop(loop, begin, end, num_threads);
 }
 
 } // namespace cobs
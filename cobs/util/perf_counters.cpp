@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * cobs/util/perf_counters.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/settings.hpp>
+#include <cobs/util/perf_counters.hpp>
+
+#include <tlx/logger.hpp>
+
+#if defined(COBS_HAVE_PERF_EVENTS)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cobs {
+
+const char * PerfCounters::event_name(size_t i) {
+    static const char* names[num_events] = {
+        "cycles", "llc_misses", "dtlb_misses", "stalled_cycles"
+    };
+    return names[i];
+}
+
+#if defined(COBS_HAVE_PERF_EVENTS)
+
+//! open one counter for the calling thread, -1 on failure
+static int perf_open(uint32_t type, uint64_t config) {
+    struct perf_event_attr pe;
+    memset(&pe, 0, sizeof(pe));
+    pe.size = sizeof(pe);
+    pe.type = type;
+    pe.config = config;
+    pe.exclude_kernel = 1;
+    pe.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &pe, /* pid */ 0, /* cpu */ -1,
+                   /* group_fd */ -1, /* flags */ 0);
+}
+
+PerfCounters::PerfCounters() {
+    // the counters are opened individually, not as one group, so that a
+    // missing event (stalled cycles is often unimplemented) costs only
+    // its own column
+    static const struct { uint32_t type; uint64_t config; }
+    events[num_events] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HW_CACHE,
+          PERF_COUNT_HW_CACHE_DTLB |
+          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND },
+    };
+    for (size_t i = 0; i < num_events; ++i) {
+        fds_[i] = perf_open(events[i].type, events[i].config);
+    }
+    valid_ = (fds_[0] >= 0);
+    if (!valid_) {
+        LOG1 << "PerfCounters: perf_event_open failed, "
+             << "hardware counters disabled for this thread";
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (size_t i = 0; i < num_events; ++i) {
+        if (fds_[i] >= 0)
+            close(fds_[i]);
+    }
+}
+
+void PerfCounters::read(uint64_t values[num_events]) const {
+    for (size_t i = 0; i < num_events; ++i) {
+        values[i] = 0;
+        if (fds_[i] >= 0 &&
+            ::read(fds_[i], &values[i], sizeof(values[i]))
+            != sizeof(values[i])) {
+            values[i] = 0;
+        }
+    }
+}
+
+#else // !defined(COBS_HAVE_PERF_EVENTS)
+
+PerfCounters::PerfCounters() {
+    for (size_t i = 0; i < num_events; ++i)
+        fds_[i] = -1;
+    if (gopt_perf_counters) {
+        LOG1 << "PerfCounters: cobs was built without COBS_HAVE_PERF_EVENTS, "
+             << "hardware counters unavailable";
+    }
+}
+
+PerfCounters::~PerfCounters() { }
+
+void PerfCounters::read(uint64_t values[num_events]) const {
+    for (size_t i = 0; i < num_events; ++i)
+        values[i] = 0;
+}
+
+#endif // !defined(COBS_HAVE_PERF_EVENTS)
+
+PerfCounters& PerfCounters::thread_instance() {
+    static thread_local PerfCounters instance;
+    return instance;
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * cobs/util/perf_counters.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_PERF_COUNTERS_HEADER
+#define COBS_UTIL_PERF_COUNTERS_HEADER
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cobs {
+
+/*!
+ * Per-thread set of Linux perf_event hardware counters sampled by Timer
+ * at phase boundaries: cycles, last-level cache misses, dTLB read
+ * misses, and backend-stalled cycles. Counting requires a build with
+ * COBS_HAVE_PERF_EVENTS and a kernel that grants perf_event_open;
+ * otherwise the counters read as zero and valid() is false. Events the
+ * hardware does not offer are skipped individually.
+ */
+class PerfCounters
+{
+public:
+    //! number of hardware events sampled per phase
+    static const size_t num_events = 4;
+
+    //! short name of event i, used as JSON key and log field suffix
+    static const char * event_name(size_t i);
+
+    //! true when at least the cycle counter is open for this thread
+    bool valid() const { return valid_; }
+
+    //! read the current counter values, zero for unavailable events
+    void read(uint64_t values[num_events]) const;
+
+    //! the calling thread's counters, opened on first use
+    static PerfCounters& thread_instance();
+
+private:
+    PerfCounters();
+    ~PerfCounters();
+
+    //! event file descriptors, -1 when the event could not be opened
+    int fds_[num_events];
+    bool valid_ = false;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_PERF_COUNTERS_HEADER
+
+/******************************************************************************/
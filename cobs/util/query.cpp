@@ -14,6 +14,7 @@
 #include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <thread>
 #include <unistd.h>
 
 #include <tlx/logger.hpp>
@@ -35,7 +36,38 @@ void close_file(int fd) {
     }
 }
 
-MMapHandle initialize_mmap(const fs::path& path)
+/*!
+ * Warm the page cache for a file from a detached background thread. Uses a
+ * private mapping of its own, so it has no lifetime coupling with the
+ * query mapping; the page cache is shared per file either way.
+ */
+static void background_prefetch(const fs::path& path)
+{
+    std::thread(
+        [path]() {
+            int fd = open(path.string().data(), O_RDONLY, 0);
+            if (fd == -1)
+                return;
+            off_t size = lseek(fd, 0, SEEK_END);
+            void* ptr = mmap(nullptr, size, PROT_READ,
+                             MAP_PRIVATE, fd, /* offset */ 0);
+            if (ptr != MAP_FAILED) {
+                // issue MADV_WILLNEED in chunks so readahead starts
+                // immediately instead of after one huge request
+                static constexpr size_t chunk = 64 * 1024 * 1024;
+                uint8_t* data = reinterpret_cast<uint8_t*>(ptr);
+                for (uint64_t pos = 0; pos < uint64_t(size); pos += chunk) {
+                    madvise(data + pos,
+                            std::min<uint64_t>(chunk, size - pos),
+                            MADV_WILLNEED);
+                }
+                munmap(ptr, size);
+            }
+            close(fd);
+        }).detach();
+}
+
+MMapHandle initialize_mmap(const fs::path& path, const MMapPolicy& policy)
 {
     int fd = open_file(path, O_RDONLY);
     off_t size = lseek(fd, 0, SEEK_END);
@@ -46,9 +78,19 @@ MMapHandle initialize_mmap(const fs::path& path)
         if (mmap_ptr == MAP_FAILED) {
             exit_error_errno("mmap failed");
         }
-        if (madvise(mmap_ptr, size, MADV_RANDOM)) {
+        if (policy.random_access &&
+            madvise(mmap_ptr, size, MADV_RANDOM)) {
             print_errno("madvise failed for MADV_RANDOM");
         }
+#if defined(MADV_HUGEPAGE)
+        if (policy.hugepages &&
+            madvise(mmap_ptr, size, MADV_HUGEPAGE)) {
+            print_errno("madvise failed for MADV_HUGEPAGE");
+        }
+#endif
+        if (policy.prefetch) {
+            background_prefetch(path);
+        }
         return MMapHandle {
                    fd, reinterpret_cast<uint8_t*>(mmap_ptr), uint64_t(size)
         };
@@ -100,6 +142,33 @@ void destroy_mmap(MMapHandle& handle)
     close_file(handle.fd);
 }
 
+MMapHandle create_mmap_file(const fs::path& path, uint64_t size)
+{
+    int fd = open(path.string().data(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1) {
+        exit_error_errno("could not create output file " + path.string());
+    }
+    if (ftruncate(fd, size)) {
+        exit_error_errno("could not size output file " + path.string());
+    }
+    void* mmap_ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, /* offset */ 0);
+    if (mmap_ptr == MAP_FAILED) {
+        exit_error_errno("mmap failed");
+    }
+    return MMapHandle {
+               fd, reinterpret_cast<uint8_t*>(mmap_ptr), size
+    };
+}
+
+void destroy_mmap_file(MMapHandle& handle)
+{
+    if (munmap(handle.data, handle.size)) {
+        print_errno("could not unmap output file");
+    }
+    close_file(handle.fd);
+}
+
 //! forward character map. A -> A, C -> C, G -> G, T -> T. rest maps to zero.
 static const char canonicalize_basepair_forward_map[256] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
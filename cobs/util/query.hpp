@@ -29,9 +29,39 @@ struct MMapHandle {
     uint64_t size;
 };
 
-MMapHandle initialize_mmap(const fs::path& path);
+//! madvise policy applied to a freshly mapped index file
+struct MMapPolicy {
+    //! advise MADV_RANDOM, query access is random at row granularity
+    bool random_access = true;
+    //! advise MADV_HUGEPAGE for TLB relief on very large mappings
+    bool hugepages = false;
+    //! warm the file from a background thread via MADV_WILLNEED instead of
+    //! blocking the first queries on page faults
+    bool prefetch = false;
+    //! nonzero byte budget enables the windowed MMapPager: per-window
+    //! access counts with explicit MADV_DONTNEED eviction of cold
+    //! windows, for indexes larger than RAM; 0 = kernel paging
+    uint64_t window_budget_bytes = 0;
+    //! window granularity of the MMapPager
+    uint64_t window_size_bytes = 64 * 1024 * 1024;
+};
+
+MMapHandle initialize_mmap(const fs::path& path,
+                           const MMapPolicy& policy = MMapPolicy());
 void destroy_mmap(MMapHandle& handle);
 
+/*!
+ * Create path as a sparse file of exactly size bytes and return a
+ * writable shared mapping of it. Stores through the mapping go straight
+ * to the page cache and are written back by the kernel; pages that are
+ * never touched stay unallocated in the sparse file. Used to build index
+ * matrices in place without a separate serialization pass.
+ */
+MMapHandle create_mmap_file(const fs::path& path, uint64_t size);
+//! unmap and close a writable mapping from create_mmap_file(), flushing
+//! any remaining dirty pages
+void destroy_mmap_file(MMapHandle& handle);
+
 //! Canonicalize a k-mer. Given an input k-mer of length size, checks if should
 //! be canonicalized into its reverse complement. If any letter other than ACGT
 //! occurs, the letter is replaced with a binary zero, and the function returns
@@ -6,11 +6,16 @@
  * All rights reserved. Published under the MIT License in the LICENSE file.
  ******************************************************************************/
 
+#include <cobs/settings.hpp>
 #include <cobs/util/timer.hpp>
+#include <cobs/util/trace.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <iomanip>
 #include <iostream>
-#include <mutex>
+#include <thread>
 
 #include <tlx/die.hpp>
 #include <tlx/logger.hpp>
@@ -18,7 +23,126 @@
 
 namespace cobs {
 
-static std::mutex s_timer_add_mutex;
+/*!
+ * Fixed-size table of atomic phase accumulators. Merging threads index a
+ * shard by their thread id and add durations with relaxed atomic
+ * additions, so operator+= is wait-free apart from the one-time slot name
+ * claims. Keeping the shards separate also preserves a per-thread
+ * breakdown for print_json(). Phase names are string literals, so slots
+ * store the pointers and match by hash and content.
+ */
+struct Timer::ShardTable {
+    static const size_t num_shards = 32;
+    static const size_t num_slots = 32;
+
+    struct Slot {
+        std::atomic<const char*> name { nullptr };
+        std::atomic<int64_t> nanos { 0 };
+        std::atomic<uint64_t> count { 0 };
+        std::atomic<uint64_t> events[PerfCounters::num_events];
+
+        Slot() {
+            for (size_t i = 0; i < PerfCounters::num_events; ++i)
+                events[i].store(0, std::memory_order_relaxed);
+        }
+    };
+
+    struct Shard {
+        //! std::hash of the last thread id that merged into this shard
+        std::atomic<size_t> thread_id { 0 };
+        //! number of merges into this shard
+        std::atomic<uint64_t> merges { 0 };
+        Slot slots[num_slots];
+    };
+
+    Shard shards[num_shards];
+    std::atomic<int64_t> total_nanos { 0 };
+
+    //! add a duration and hardware counters to the shard's slot for
+    //! name, claiming a free slot on first use
+    static void add(Shard& shard, const char* name, int64_t nanos,
+                    uint64_t count,
+                    const uint64_t events[PerfCounters::num_events]) {
+        uint32_t h = tlx::hash_djb2(name);
+        for (size_t p = 0; p < num_slots; ++p) {
+            Slot& slot = shard.slots[(h + p) % num_slots];
+            const char* n = slot.name.load(std::memory_order_acquire);
+            if (n == nullptr) {
+                if (!slot.name.compare_exchange_strong(n, name))
+                    ; // n now holds the concurrent claimer, fall through
+                else
+                    n = name;
+            }
+            if (n == name || strcmp(n, name) == 0) {
+                slot.nanos.fetch_add(nanos, std::memory_order_relaxed);
+                slot.count.fetch_add(count, std::memory_order_relaxed);
+                for (size_t i = 0; i < PerfCounters::num_events; ++i) {
+                    if (events[i] != 0)
+                        slot.events[i].fetch_add(
+                            events[i], std::memory_order_relaxed);
+                }
+                return;
+            }
+        }
+        die("Timer: too many distinct timer names");
+    }
+};
+
+static inline int64_t to_nanos(std::chrono::duration<double> d) {
+    return int64_t(d.count() * 1e9);
+}
+
+Timer::~Timer() {
+    delete shards_.load();
+}
+
+Timer::Timer(const Timer& b) {
+    *this = b;
+}
+
+Timer& Timer::operator = (const Timer& b) {
+    if (this == &b)
+        return *this;
+    timers_ = b.timers_;
+    total_duration_ = b.total_duration_;
+    running_ = b.running_;
+    time_point_ = b.time_point_;
+    ShardTable* bst = b.shards_.load();
+    delete shards_.exchange(nullptr);
+    if (bst) {
+        ShardTable& st = ensure_shards();
+        for (size_t i = 0; i < ShardTable::num_shards; ++i) {
+            st.shards[i].thread_id = bst->shards[i].thread_id.load();
+            st.shards[i].merges = bst->shards[i].merges.load();
+            for (size_t s = 0; s < ShardTable::num_slots; ++s) {
+                st.shards[i].slots[s].name =
+                    bst->shards[i].slots[s].name.load();
+                st.shards[i].slots[s].nanos =
+                    bst->shards[i].slots[s].nanos.load();
+                st.shards[i].slots[s].count =
+                    bst->shards[i].slots[s].count.load();
+                for (size_t e = 0; e < PerfCounters::num_events; ++e) {
+                    st.shards[i].slots[s].events[e] =
+                        bst->shards[i].slots[s].events[e].load();
+                }
+            }
+        }
+        st.total_nanos = bst->total_nanos.load();
+    }
+    return *this;
+}
+
+Timer::ShardTable& Timer::ensure_shards() {
+    ShardTable* st = shards_.load(std::memory_order_acquire);
+    if (!st) {
+        ShardTable* fresh = new ShardTable();
+        if (shards_.compare_exchange_strong(st, fresh))
+            st = fresh;
+        else
+            delete fresh;
+    }
+    return *st;
+}
 
 Timer::Entry& Timer::find_or_create(const char* name) {
     uint32_t h = tlx::hash_djb2(name);
@@ -30,6 +154,9 @@ Timer::Entry& Timer::find_or_create(const char* name) {
     new_entry.hash = h;
     new_entry.name = name;
     new_entry.duration = std::chrono::duration<double>::zero();
+    new_entry.count = 0;
+    for (size_t i = 0; i < PerfCounters::num_events; ++i)
+        new_entry.events[i] = 0;
     timers_.emplace_back(new_entry);
     return timers_.back();
 }
@@ -42,6 +169,8 @@ void Timer::active(const char* timer) {
     }
     stop();
     running_ = timer;
+    if (gopt_perf_counters)
+        PerfCounters::thread_instance().read(event_start_);
 }
 
 void Timer::stop() {
@@ -49,7 +178,15 @@ void Timer::stop() {
     if (running_) {
         Entry& e = find_or_create(running_);
         e.duration += new_time_point - time_point_;
+        e.count++;
         total_duration_ += new_time_point - time_point_;
+        if (gopt_perf_counters) {
+            uint64_t now[PerfCounters::num_events];
+            PerfCounters::thread_instance().read(now);
+            for (size_t i = 0; i < PerfCounters::num_events; ++i)
+                e.events[i] += now[i] - event_start_[i];
+        }
+        trace_event(running_, time_point_, new_time_point);
     }
     time_point_ = new_time_point;
     running_ = nullptr;
@@ -58,36 +195,234 @@ void Timer::stop() {
 void Timer::reset() {
     timers_.clear();
     total_duration_ = std::chrono::duration<double>::zero();
+    delete shards_.exchange(nullptr);
 }
 
 double Timer::get(const char* name) {
-    return find_or_create(name).duration.count();
+    double result = find_or_create(name).duration.count();
+    ShardTable* st = shards_.load(std::memory_order_acquire);
+    if (st) {
+        uint32_t h = tlx::hash_djb2(name);
+        for (size_t i = 0; i < ShardTable::num_shards; ++i) {
+            for (size_t s = 0; s < ShardTable::num_slots; ++s) {
+                const char* n = st->shards[i].slots[s].name.load();
+                if (n && tlx::hash_djb2(n) == h && strcmp(n, name) == 0)
+                    result += st->shards[i].slots[s].nanos.load() * 1e-9;
+            }
+        }
+    }
+    return result;
 }
 
 Timer& Timer::operator += (const Timer& b) {
-    std::unique_lock<std::mutex> lock(s_timer_add_mutex);
+    ShardTable& st = ensure_shards();
+    size_t tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+    ShardTable::Shard& shard = st.shards[tid % ShardTable::num_shards];
+    shard.thread_id.store(tid, std::memory_order_relaxed);
+    shard.merges.fetch_add(1, std::memory_order_relaxed);
     for (const Entry& t : b.timers_) {
-        Entry& e = find_or_create(t.name);
-        e.duration += t.duration;
+        ShardTable::add(shard, t.name, to_nanos(t.duration), t.count,
+                        t.events);
+    }
+    st.total_nanos.fetch_add(to_nanos(b.total_duration_),
+                             std::memory_order_relaxed);
+    // merging an already merged-into timer: keep its shard breakdown
+    ShardTable* bst = b.shards_.load(std::memory_order_acquire);
+    if (bst) {
+        for (size_t i = 0; i < ShardTable::num_shards; ++i) {
+            for (size_t s = 0; s < ShardTable::num_slots; ++s) {
+                const char* n = bst->shards[i].slots[s].name.load();
+                if (!n)
+                    continue;
+                uint64_t events[PerfCounters::num_events];
+                for (size_t e = 0; e < PerfCounters::num_events; ++e)
+                    events[e] = bst->shards[i].slots[s].events[e].load();
+                ShardTable::add(st.shards[i], n,
+                                bst->shards[i].slots[s].nanos.load(),
+                                bst->shards[i].slots[s].count.load(),
+                                events);
+            }
+            uint64_t merges = bst->shards[i].merges.load();
+            if (merges != 0) {
+                st.shards[i].thread_id.store(
+                    bst->shards[i].thread_id.load(),
+                    std::memory_order_relaxed);
+                st.shards[i].merges.fetch_add(
+                    merges, std::memory_order_relaxed);
+            }
+        }
+        st.total_nanos.fetch_add(bst->total_nanos.load(),
+                                 std::memory_order_relaxed);
     }
-    total_duration_ += b.total_duration_;
     return *this;
 }
 
+//! one aggregated phase: seconds, calls, and hardware counter sums
+struct TimerPhaseSum {
+    const char* name;
+    double seconds;
+    uint64_t count;
+    uint64_t events[PerfCounters::num_events];
+};
+
+//! aggregate local entries and all merge shards into one phase list,
+//! keeping the recording order of the local entries
+void Timer::collect_phases(
+    std::vector<TimerPhaseSum>& phases, double& total) const {
+    for (const Entry& timer : timers_) {
+        TimerPhaseSum p;
+        p.name = timer.name;
+        p.seconds = timer.duration.count();
+        p.count = timer.count;
+        for (size_t e = 0; e < PerfCounters::num_events; ++e)
+            p.events[e] = timer.events[e];
+        phases.emplace_back(p);
+    }
+    total = total_duration_.count();
+    ShardTable* st = shards_.load(std::memory_order_acquire);
+    if (!st)
+        return;
+    for (size_t i = 0; i < ShardTable::num_shards; ++i) {
+        for (size_t s = 0; s < ShardTable::num_slots; ++s) {
+            const ShardTable::Slot& slot = st->shards[i].slots[s];
+            const char* n = slot.name.load();
+            if (!n)
+                continue;
+            auto it = std::find_if(
+                phases.begin(), phases.end(),
+                [&](const TimerPhaseSum& p) {
+                    return p.name == n || strcmp(p.name, n) == 0;
+                });
+            if (it == phases.end()) {
+                TimerPhaseSum p;
+                p.name = n;
+                p.seconds = 0;
+                p.count = 0;
+                for (size_t e = 0; e < PerfCounters::num_events; ++e)
+                    p.events[e] = 0;
+                phases.emplace_back(p);
+                it = phases.end() - 1;
+            }
+            it->seconds += slot.nanos.load() * 1e-9;
+            it->count += slot.count.load();
+            for (size_t e = 0; e < PerfCounters::num_events; ++e)
+                it->events[e] += slot.events[e].load();
+        }
+    }
+    total += st->total_nanos.load() * 1e-9;
+}
+
 void Timer::print(const char* info, std::ostream& os) const {
     die_unless(!running_);
 
+    std::vector<TimerPhaseSum> phases;
+    double total;
+    collect_phases(phases, total);
+
     os << "TIMER info=" << info;
-    for (const Entry& timer : timers_) {
-        os << ' ' << timer.name << '=' << timer.duration.count();
+    for (const TimerPhaseSum& phase : phases) {
+        os << ' ' << phase.name << '=' << phase.seconds;
+    }
+    // hardware counters, appended so the classic fields keep their place
+    for (const TimerPhaseSum& phase : phases) {
+        for (size_t e = 0; e < PerfCounters::num_events; ++e) {
+            if (phase.events[e] != 0) {
+                os << ' ' << phase.name << '.'
+                   << PerfCounters::event_name(e) << '='
+                   << phase.events[e];
+            }
+        }
     }
-    os << " total=" << total_duration_.count() << std::endl;
+    os << " total=" << total << std::endl;
 }
 
 void Timer::print(const char* info) const {
     return print(info, std::cerr);
 }
 
+//! print the hardware counter sums of one phase as a JSON "events"
+//! member, omitted when all counters are zero
+static void print_json_events(
+    std::ostream& os, const uint64_t events[PerfCounters::num_events]) {
+    bool any = false;
+    for (size_t e = 0; e < PerfCounters::num_events; ++e)
+        any |= (events[e] != 0);
+    if (!any)
+        return;
+    os << ",\"events\":{";
+    bool first = true;
+    for (size_t e = 0; e < PerfCounters::num_events; ++e) {
+        os << (first ? "" : ",")
+           << "\"" << PerfCounters::event_name(e) << "\":" << events[e];
+        first = false;
+    }
+    os << "}";
+}
+
+void Timer::print_json(const char* info, std::ostream& os) const {
+    die_unless(!running_);
+
+    std::streamsize precision = os.precision(9);
+    os << "{\"timer\":\"" << info << "\"";
+
+    // per-phase totals: local entries plus sums over all merge shards
+    std::vector<TimerPhaseSum> phases;
+    double total;
+    collect_phases(phases, total);
+    os << ",\"phases\":[";
+    bool first = true;
+    for (const TimerPhaseSum& phase : phases) {
+        os << (first ? "" : ",")
+           << "{\"name\":\"" << phase.name
+           << "\",\"seconds\":" << phase.seconds
+           << ",\"count\":" << phase.count;
+        print_json_events(os, phase.events);
+        os << "}";
+        first = false;
+    }
+    os << "]";
+
+    // per-thread breakdown: one object per merge shard with data. thread
+    // ids hashing to the same shard are summed together, which the
+    // merges counter makes visible
+    os << ",\"threads\":[";
+    first = true;
+    ShardTable* st = shards_.load(std::memory_order_acquire);
+    if (st) {
+        for (size_t i = 0; i < ShardTable::num_shards; ++i) {
+            if (st->shards[i].merges.load() == 0)
+                continue;
+            os << (first ? "" : ",")
+               << "{\"thread\":" << st->shards[i].thread_id.load()
+               << ",\"merges\":" << st->shards[i].merges.load()
+               << ",\"phases\":[";
+            bool first_slot = true;
+            for (size_t s = 0; s < ShardTable::num_slots; ++s) {
+                const ShardTable::Slot& slot = st->shards[i].slots[s];
+                const char* n = slot.name.load();
+                if (!n)
+                    continue;
+                os << (first_slot ? "" : ",")
+                   << "{\"name\":\"" << n << "\",\"seconds\":"
+                   << slot.nanos.load() * 1e-9
+                   << ",\"count\":" << slot.count.load();
+                uint64_t events[PerfCounters::num_events];
+                for (size_t e = 0; e < PerfCounters::num_events; ++e)
+                    events[e] = slot.events[e].load();
+                print_json_events(os, events);
+                os << "}";
+                first_slot = false;
+            }
+            os << "]}";
+            first = false;
+        }
+    }
+    os << "]";
+
+    os << ",\"total\":" << total << "}" << std::endl;
+    os.precision(precision);
+}
+
 } // namespace cobs
 
 /******************************************************************************/
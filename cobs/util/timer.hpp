@@ -9,13 +9,18 @@
 #ifndef COBS_UTIL_TIMER_HEADER
 #define COBS_UTIL_TIMER_HEADER
 
+#include <atomic>
 #include <chrono>
 #include <ostream>
 #include <string>
 #include <vector>
 
+#include <cobs/util/perf_counters.hpp>
+
 namespace cobs {
 
+struct TimerPhaseSum;
+
 class Timer
 {
 private:
@@ -24,24 +29,52 @@ private:
         uint32_t hash;
         const char* name;
         std::chrono::duration<double> duration;
+        //! number of times this phase was stopped
+        uint64_t count;
+        //! hardware counter sums of this phase, filled when
+        //! gopt_perf_counters is set and the build has perf_event support
+        uint64_t events[PerfCounters::num_events];
     };
 
-    //! array of timers
+    //! sharded atomic accumulators for cross-thread merges, see timer.cpp
+    struct ShardTable;
+
+    //! array of timers recorded by this thread via active()/stop()
     std::vector<Entry> timers_;
 
     //! total duration
     std::chrono::duration<double> total_duration_ =
         std::chrono::duration<double>::zero();
 
+    //! accumulators filled by operator+=: merging threads add into the
+    //! shard indexed by their thread id with plain atomic additions, so
+    //! worker threads never contend on a lock. allocated on first merge.
+    std::atomic<ShardTable*> shards_ { nullptr };
+
     //! currently running timer name
     const char* running_ = nullptr;
     //! start of currently running timer name
     std::chrono::time_point<std::chrono::high_resolution_clock> time_point_;
+    //! hardware counter values at the start of the running phase
+    uint64_t event_start_[PerfCounters::num_events];
 
     Entry& find_or_create(const char* name);
 
+    //! return the shard table, allocating it on first use
+    ShardTable& ensure_shards();
+
+    //! aggregate local entries and merge shards into one phase list
+    void collect_phases(std::vector<TimerPhaseSum>& phases,
+                        double& total) const;
+
 public:
     Timer() = default;
+    ~Timer();
+
+    //! copyable: copies take a plain snapshot of the atomic accumulators
+    Timer(const Timer& b);
+    Timer& operator = (const Timer& b);
+
     void active(const char* timer);
     void stop();
     void reset();
@@ -49,8 +82,13 @@ public:
     void print(const char* info, std::ostream& os) const;
     void print(const char* info) const;
 
-    //! add all timers from another, internally holds a global lock, because
-    //! this is used to add thread values
+    //! print all phases as one JSON object: per-phase total seconds and
+    //! call counts plus the per-thread-shard breakdown of merged timers
+    void print_json(const char* info, std::ostream& os) const;
+
+    //! add all timers from another, wait-free: the calling thread adds
+    //! into its own shard of atomic accumulators, because this is used by
+    //! worker threads to merge their batch timers into the shared one
     Timer& operator += (const Timer& b);
 };
 
@@ -0,0 +1,161 @@
+/*******************************************************************************
+ * cobs/util/trace.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/util/trace.hpp>
+
+#include <cobs/settings.hpp>
+
+#include <tlx/logger.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace cobs {
+
+#if defined(COBS_HAVE_TRACING)
+
+using trace_clock = std::chrono::high_resolution_clock;
+
+namespace {
+
+//! one completed scope
+struct TraceEvent {
+    const char* name;
+    trace_clock::time_point begin, end;
+};
+
+//! per-thread ring buffer of the newest events, written without locks
+struct TraceRing {
+    //! events per thread; at ~100 ns per Timer phase switch this holds
+    //! the last few seconds of the busiest threads
+    static constexpr size_t ring_size = 64 * 1024;
+
+    std::vector<TraceEvent> events { ring_size };
+    //! total number of events pushed, ring index is pos % ring_size
+    size_t pos = 0;
+    //! small stable thread number used as "tid" in the output
+    size_t thread_num;
+
+    void push(const char* name,
+              trace_clock::time_point begin, trace_clock::time_point end) {
+        events[pos % ring_size] = TraceEvent { name, begin, end };
+        ++pos;
+    }
+};
+
+//! owns the rings of all threads that ever traced; rings outlive their
+//! threads so trace_write() can run after workers exited
+class TraceRegistry
+{
+public:
+    static TraceRegistry& get() {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    TraceRing& register_thread() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        rings_.emplace_back();
+        rings_.back().thread_num = rings_.size();
+        return rings_.back();
+    }
+
+    void write(std::ostream& os) {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // time zero of the trace is the earliest recorded event
+        trace_clock::time_point epoch = trace_clock::time_point::max();
+        size_t dropped = 0;
+        for (TraceRing& ring : rings_) {
+            size_t have = std::min(ring.pos, TraceRing::ring_size);
+            dropped += ring.pos - have;
+            for (size_t i = ring.pos - have; i != ring.pos; ++i)
+                epoch = std::min(
+                    epoch, ring.events[i % TraceRing::ring_size].begin);
+        }
+
+        auto micros = [&](trace_clock::time_point tp) {
+            return std::chrono::duration<double, std::micro>(
+                tp - epoch).count();
+        };
+
+        os << "{\"traceEvents\":[";
+        os.precision(3);
+        os << std::fixed;
+        bool first = true;
+        for (TraceRing& ring : rings_) {
+            size_t have = std::min(ring.pos, TraceRing::ring_size);
+            for (size_t i = ring.pos - have; i != ring.pos; ++i) {
+                const TraceEvent& e =
+                    ring.events[i % TraceRing::ring_size];
+                if (!first)
+                    os << ',';
+                first = false;
+                os << "{\"name\":\"" << e.name << "\","
+                   << "\"ph\":\"X\",\"pid\":1,"
+                   << "\"tid\":" << ring.thread_num << ","
+                   << "\"ts\":" << micros(e.begin) << ","
+                   << "\"dur\":"
+                   << std::chrono::duration<double, std::micro>(
+                    e.end - e.begin).count() << "}";
+            }
+            ring.pos = 0;
+        }
+        os << "]}" << std::endl;
+
+        if (dropped != 0) {
+            LOG1 << "trace: ring buffers overflowed, dropped "
+                 << dropped << " oldest events";
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<TraceRing> rings_;
+};
+
+TraceRing& thread_ring() {
+    static thread_local TraceRing& ring =
+        TraceRegistry::get().register_thread();
+    return ring;
+}
+
+} // namespace
+
+bool trace_enabled() {
+    return !gopt_trace_file.empty();
+}
+
+void trace_event(const char* name,
+                 trace_clock::time_point begin,
+                 trace_clock::time_point end) {
+    if (!trace_enabled())
+        return;
+    thread_ring().push(name, begin, end);
+}
+
+void trace_write() {
+    if (!trace_enabled())
+        return;
+    std::ofstream os(gopt_trace_file);
+    if (!os.good()) {
+        LOG1 << "trace: could not open " << gopt_trace_file;
+        return;
+    }
+    TraceRegistry::get().write(os);
+    LOG1 << "trace: wrote " << gopt_trace_file;
+}
+
+#endif // defined(COBS_HAVE_TRACING)
+
+} // namespace cobs
+
+/******************************************************************************/
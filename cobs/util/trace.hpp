@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * cobs/util/trace.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_TRACE_HEADER
+#define COBS_UTIL_TRACE_HEADER
+
+#include <chrono>
+
+namespace cobs {
+
+/*!
+ * Lightweight trace-event recording for timeline profiling.
+ *
+ * While Timer reports per-phase totals, the tracer records when each
+ * scope ran on which thread, so pipeline bubbles -- all threads blocked
+ * in I/O while compute sits idle, combine read/interleave/write phases
+ * failing to overlap -- become visible. Every Timer::active()/stop()
+ * pair is recorded automatically, plus explicit TraceScope markers
+ * around whole pipeline stages.
+ *
+ * Events go into fixed-size per-thread ring buffers (newest events win
+ * on overflow) and are written as chrome://tracing JSON, viewable in
+ * chrome://tracing or https://ui.perfetto.dev. The facility is a
+ * compile-time opt-in via COBS_HAVE_TRACING (cmake -DCOBS_USE_TRACING)
+ * and a runtime opt-in via gopt_trace_file (--trace FILE); without both
+ * it compiles to nothing.
+ */
+
+#if defined(COBS_HAVE_TRACING)
+
+//! whether a trace file was requested via gopt_trace_file
+bool trace_enabled();
+
+//! record one completed scope on this thread's ring buffer
+void trace_event(const char* name,
+                 std::chrono::high_resolution_clock::time_point begin,
+                 std::chrono::high_resolution_clock::time_point end);
+
+//! write all recorded events to gopt_trace_file as chrome://tracing
+//! JSON and clear the ring buffers; no-op when tracing is disabled
+void trace_write();
+
+//! RAII marker recording its own lifetime as one trace event
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name) : name_(name) {
+        if (trace_enabled())
+            begin_ = std::chrono::high_resolution_clock::now();
+    }
+    ~TraceScope() {
+        if (trace_enabled())
+            trace_event(name_, begin_,
+                        std::chrono::high_resolution_clock::now());
+    }
+
+private:
+    const char* name_;
+    std::chrono::high_resolution_clock::time_point begin_;
+};
+
+#else // !defined(COBS_HAVE_TRACING)
+
+inline bool trace_enabled() { return false; }
+
+inline void trace_event(const char*,
+                        std::chrono::high_resolution_clock::time_point,
+                        std::chrono::high_resolution_clock::time_point) { }
+
+inline void trace_write() { }
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char*) { }
+};
+
+#endif // !defined(COBS_HAVE_TRACING)
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_TRACE_HEADER
+
+/******************************************************************************/
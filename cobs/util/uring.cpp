@@ -0,0 +1,35 @@
+/*******************************************************************************
+ * cobs/util/uring.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#define _GNU_SOURCE   /* syscall() is not POSIX */
+
+#include <cobs/util/uring.hpp>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace cobs {
+
+int io_uring_setup(unsigned entries, io_uring_params* p) {
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags) {
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+                   flags, nullptr, 0);
+}
+
+int io_uring_register(int ring_fd, unsigned opcode, const void* arg,
+                      unsigned nr_args) {
+    return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,26 @@
+/*******************************************************************************
+ * cobs/util/uring.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_URING_HEADER
+#define COBS_UTIL_URING_HEADER
+
+#include <linux/io_uring.h>
+
+namespace cobs {
+
+int io_uring_setup(unsigned entries, io_uring_params* p);
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags);
+int io_uring_register(int ring_fd, unsigned opcode, const void* arg,
+                      unsigned nr_args);
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_URING_HEADER
+
+/******************************************************************************/
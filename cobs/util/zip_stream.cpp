@@ -650,6 +650,50 @@ basic_zip_istream<CharT, Traits>::read_footer() {
     }
 }
 
+/******************************************************************************/
+// parallel_zip_istream
+
+parallel_zip_istream::parallel_zip_istream(
+    std::istream& istream, size_t block_size, size_t queue_limit)
+    : std::istream(this), queue_(queue_limit)
+{
+    thread_ = std::thread(
+        [this, &istream, block_size]() {
+            zip_istream zis(istream);
+            while (zis.good() && !stop_.load(std::memory_order_relaxed)) {
+                std::vector<char> block(block_size);
+                zis.read(block.data(), block_size);
+                size_t size = zis.gcount();
+                if (size == 0)
+                    break;
+                block.resize(size);
+                queue_.push(std::move(block));
+            }
+            queue_.close();
+        });
+}
+
+parallel_zip_istream::~parallel_zip_istream() {
+    // unblock the decode thread if the consumer stopped reading early:
+    // after stop_ is seen it pushes at most one more block, and draining
+    // keeps the queue from filling up meanwhile
+    stop_.store(true, std::memory_order_relaxed);
+    std::vector<char> block;
+    while (queue_.pop(block)) { }
+    thread_.join();
+}
+
+parallel_zip_istream::int_type parallel_zip_istream::underflow() {
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    if (!queue_.pop(block_))
+        return traits_type::eof();
+
+    setg(block_.data(), block_.data(), block_.data() + block_.size());
+    return traits_type::to_int_type(*gptr());
+}
+
 /******************************************************************************/
 
 //! Helper function to check whether stream is compressed or not.
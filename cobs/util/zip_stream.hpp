@@ -64,13 +64,16 @@ zran.c
   So I might after all be able to implement seeking :)
 */
 
+#include <cobs/util/bounded_queue.hpp>
 #include <cobs/util/zip_stream_fwd.hpp>
 
 #include <zlib.h>
 
+#include <atomic>
 #include <istream>
 #include <ostream>
 #include <streambuf>
+#include <thread>
 #include <vector>
 
 namespace cobs {
@@ -319,6 +322,46 @@ protected:
     uint32_t gzip_data_size_;
 };
 
+/******************************************************************************/
+// parallel_zip_istream
+
+/**
+ * \brief An istream decompressing gzip input on a background thread.
+ *
+ * A decode thread runs the zlib inflater and hands finished blocks of
+ * uncompressed data through a small bounded queue to the consumer, so
+ * parsing and hashing overlap with decompression instead of alternating
+ * with it on one core. Drop-in for zip_istream wherever the stream is
+ * only read forward; the putback area and the crc/footer accessors are
+ * not available.
+ */
+class parallel_zip_istream final
+    : public std::streambuf, public std::istream
+{
+public:
+    typedef std::streambuf::int_type int_type;
+    typedef std::streambuf::traits_type traits_type;
+
+    explicit parallel_zip_istream(
+        std::istream& istream,
+        size_t block_size = 1024 * 1024,
+        size_t queue_limit = 4);
+
+    ~parallel_zip_istream();
+
+    int_type underflow() final;
+
+private:
+    //! queue of decompressed blocks from the decode thread
+    BoundedQueue<std::vector<char> > queue_;
+    //! block currently exposed as the get area
+    std::vector<char> block_;
+    //! signals the decode thread to wind down early
+    std::atomic<bool> stop_ { false };
+    //! decode thread running the inflater
+    std::thread thread_;
+};
+
 /******************************************************************************/
 
 //! Helper function to check whether stream is compressed or not.
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * cobs/util/zstd_block.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/util/zstd_block.hpp>
+
+#include <tlx/die.hpp>
+
+#if defined(COBS_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace cobs {
+
+#if defined(COBS_HAVE_ZSTD)
+
+size_t zstd_block_bound(size_t size) {
+    return ZSTD_compressBound(size);
+}
+
+size_t zstd_block_compress(void* out, size_t out_capacity,
+                           const void* in, size_t in_size, int level) {
+    size_t ret = ZSTD_compress(out, out_capacity, in, in_size, level);
+    if (ZSTD_isError(ret)) {
+        die("zstd_block_compress: " << ZSTD_getErrorName(ret));
+    }
+    return ret;
+}
+
+size_t zstd_block_decompress(void* out, size_t out_capacity,
+                             const void* in, size_t in_size) {
+    size_t ret = ZSTD_decompress(out, out_capacity, in, in_size);
+    if (ZSTD_isError(ret)) {
+        die("zstd_block_decompress: " << ZSTD_getErrorName(ret));
+    }
+    return ret;
+}
+
+#else  // !defined(COBS_HAVE_ZSTD)
+
+size_t zstd_block_bound(size_t size) {
+    return size;
+}
+
+size_t zstd_block_compress(void*, size_t, const void*, size_t, int) {
+    die("zstd_block_compress: cobs was built without Zstandard support, "
+        "cannot write compressed indexes");
+}
+
+size_t zstd_block_decompress(void*, size_t, const void*, size_t) {
+    die("zstd_block_decompress: cobs was built without Zstandard support, "
+        "cannot read compressed indexes");
+}
+
+#endif  // !defined(COBS_HAVE_ZSTD)
+
+} // namespace cobs
+
+/******************************************************************************/
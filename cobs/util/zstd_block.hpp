@@ -0,0 +1,38 @@
+/*******************************************************************************
+ * cobs/util/zstd_block.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_ZSTD_BLOCK_HEADER
+#define COBS_UTIL_ZSTD_BLOCK_HEADER
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cobs {
+
+/******************************************************************************/
+// One-shot zstd block compression, used by the compressed row-block index
+// format. Each block is a self-contained zstd frame. Without Zstandard
+// support the functions die with a clear message.
+
+//! worst-case compressed size of a block of the given size
+size_t zstd_block_bound(size_t size);
+
+//! compress one block into out, which must hold zstd_block_bound(in_size)
+//! bytes; returns the compressed size
+size_t zstd_block_compress(void* out, size_t out_capacity,
+                           const void* in, size_t in_size, int level);
+
+//! decompress one block into out; returns the decompressed size
+size_t zstd_block_decompress(void* out, size_t out_capacity,
+                             const void* in, size_t in_size);
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_ZSTD_BLOCK_HEADER
+
+/******************************************************************************/
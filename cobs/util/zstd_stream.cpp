@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * cobs/util/zstd_stream.cpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/util/zstd_stream.hpp>
+
+#include <tlx/die.hpp>
+
+#if defined(COBS_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace cobs {
+
+#if defined(COBS_HAVE_ZSTD)
+
+zstd_istream::zstd_istream(std::istream& istream)
+    : std::istream(this), istream_(istream)
+{
+    ZSTD_DCtx* dctx = ZSTD_createDCtx();
+    die_unless(dctx != nullptr);
+    // accept frames compressed with long-range matching windows
+    ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, 31);
+    dctx_ = dctx;
+
+    in_buffer_.resize(ZSTD_DStreamInSize());
+    // several recommended output chunks per refill amortize the
+    // underflow round trips
+    out_buffer_.resize(4 * ZSTD_DStreamOutSize());
+}
+
+zstd_istream::~zstd_istream() {
+    ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(dctx_));
+}
+
+zstd_istream::int_type zstd_istream::underflow() {
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    ZSTD_outBuffer out = { out_buffer_.data(), out_buffer_.size(), 0 };
+    while (out.pos == 0) {
+        if (in_pos_ == in_size_) {
+            istream_.read(in_buffer_.data(), in_buffer_.size());
+            in_size_ = istream_.gcount();
+            in_pos_ = 0;
+            if (in_size_ == 0)
+                return traits_type::eof();
+        }
+        ZSTD_inBuffer in = { in_buffer_.data(), in_size_, in_pos_ };
+        size_t ret = ZSTD_decompressStream(
+            static_cast<ZSTD_DCtx*>(dctx_), &out, &in);
+        if (ZSTD_isError(ret)) {
+            die("zstd_istream: decompression error: "
+                << ZSTD_getErrorName(ret));
+        }
+        in_pos_ = in.pos;
+    }
+
+    setg(out_buffer_.data(), out_buffer_.data(),
+         out_buffer_.data() + out.pos);
+    return traits_type::to_int_type(*gptr());
+}
+
+#else  // !defined(COBS_HAVE_ZSTD)
+
+zstd_istream::zstd_istream(std::istream& istream)
+    : std::istream(this), istream_(istream)
+{
+    die("zstd_istream: cobs was built without Zstandard support, "
+        "cannot read .zst input");
+}
+
+zstd_istream::~zstd_istream() = default;
+
+zstd_istream::int_type zstd_istream::underflow() {
+    return traits_type::eof();
+}
+
+#endif  // !defined(COBS_HAVE_ZSTD)
+
+} // namespace cobs
+
+/******************************************************************************/
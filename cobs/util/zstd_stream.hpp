@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * cobs/util/zstd_stream.hpp
+ *
+ * Copyright (c) 2026 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_ZSTD_STREAM_HEADER
+#define COBS_UTIL_ZSTD_STREAM_HEADER
+
+#include <istream>
+#include <streambuf>
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * An istream decompressing Zstandard input, the zstd counterpart of
+ * zip_istream. Wraps ZSTD's streaming decompression API with large input
+ * and output buffers and accepts frames up to the maximum window size,
+ * so archives compressed with long-range matching decode as well.
+ * Read-forward only. If cobs was built without libzstd (COBS_HAVE_ZSTD
+ * unset), construction dies with a message saying so.
+ */
+class zstd_istream final
+    : public std::streambuf, public std::istream
+{
+public:
+    typedef std::streambuf::int_type int_type;
+    typedef std::streambuf::traits_type traits_type;
+
+    explicit zstd_istream(std::istream& istream);
+
+    ~zstd_istream();
+
+    int_type underflow() final;
+
+private:
+    //! compressed input stream
+    std::istream& istream_;
+    //! ZSTD_DCtx*, opaque so zstd.h stays out of this header
+    void* dctx_ = nullptr;
+    //! compressed input buffer
+    std::vector<char> in_buffer_;
+    //! decompressed output buffer, exposed as the get area
+    std::vector<char> out_buffer_;
+    //! consumed prefix and valid size of in_buffer_
+    size_t in_pos_ = 0, in_size_ = 0;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_ZSTD_STREAM_HEADER
+
+/******************************************************************************/
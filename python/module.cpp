@@ -8,6 +8,7 @@
 
 #include <pybind11/pybind11.h>
 
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 
 #include <cobs/construction/classic_index.hpp>
@@ -20,6 +21,8 @@
 
 #include <tlx/string.hpp>
 
+#include <unordered_map>
+
 /******************************************************************************/
 
 void classic_construct(
@@ -377,12 +380,92 @@ Construct a COBS Compact Index from a pre-populated DocumentList object.
         {
             // lambda to allocate and return vector
             std::vector<cobs::SearchResult> result;
-            s.search(query, result, threshold, num_results);
+            {
+                // the C++ side is re-entrant, let Python threads run
+                py::gil_scoped_release release;
+                s.search(query, result, threshold, num_results);
+            }
             return result;
         },
         "search index for query returning vector of matches",
         py::arg("query"),
         py::arg("threshold") = 0.0,
+        py::arg("num_results") = 0)
+    .def(
+        "doc_names",
+        [](Search& s)
+        {
+            // all document names in score array order, for resolving the
+            // document indices returned by search_batch
+            std::vector<std::string> names;
+            for (const auto& index_file : s.index_files()) {
+                const std::vector<std::string>& fn = index_file->file_names();
+                names.insert(names.end(), fn.begin(), fn.end());
+            }
+            return names;
+        },
+        "list of all document names, indexed by search_batch results")
+    .def(
+        "search_batch",
+        [](Search& s, const std::vector<std::string>& queries,
+           double threshold, size_t num_results)
+        {
+            std::vector<std::vector<cobs::SearchResult> > results;
+            {
+                // run the batch on the internal thread pool without
+                // blocking Python-side threads
+                py::gil_scoped_release release;
+                s.search_batch(queries, results, threshold, num_results);
+            }
+
+            // map result doc_name pointers (which point into the index
+            // files' name tables) back to global document indices
+            std::unordered_map<const char*, int32_t> doc_index;
+            int32_t next_index = 0;
+            for (const auto& index_file : s.index_files()) {
+                for (const std::string& name : index_file->file_names())
+                    doc_index[name.c_str()] = next_index++;
+            }
+
+            size_t total = 0;
+            for (const auto& r : results)
+                total += r.size();
+
+            // one flat int32 doc-index array plus a uint32 score array,
+            // with offsets delimiting each query's slice: no per-result
+            // Python objects, names resolved lazily via doc_names()
+            py::array_t<int64_t> offsets(results.size() + 1);
+            py::array_t<int32_t> doc_indices(total);
+            py::array_t<uint32_t> scores(total);
+
+            int64_t* offsets_ptr = offsets.mutable_data();
+            int32_t* doc_ptr = doc_indices.mutable_data();
+            uint32_t* score_ptr = scores.mutable_data();
+
+            size_t pos = 0;
+            offsets_ptr[0] = 0;
+            for (size_t q = 0; q < results.size(); ++q) {
+                for (const auto& res : results[q]) {
+                    doc_ptr[pos] = doc_index[res.doc_name];
+                    score_ptr[pos] = res.score;
+                    ++pos;
+                }
+                offsets_ptr[q + 1] = pos;
+            }
+
+            return py::make_tuple(offsets, doc_indices, scores);
+        },
+        R"pbdoc(
+Search the index for a batch of queries at once.
+
+Releases the GIL while the C++ side hashes and scores the batch on its
+internal thread pool. Returns a tuple of NumPy arrays
+``(offsets, doc_indices, scores)``: query ``q`` matched the documents
+``doc_indices[offsets[q]:offsets[q+1]]`` with the corresponding
+``scores``; resolve indices to names via :meth:`doc_names`.
+        )pbdoc",
+        py::arg("queries"),
+        py::arg("threshold") = 0.0,
         py::arg("num_results") = 0);
 
     /**************************************************************************/
@@ -10,13 +10,22 @@
 #include <cobs/construction/classic_index.hpp>
 #include <cobs/construction/compact_index.hpp>
 #include <cobs/cortex_file.hpp>
+#include <cobs/file/shards_header.hpp>
 #include <cobs/query/classic_index/mmap_search_file.hpp>
+#include <cobs/query/classic_index/zstd_search_file.hpp>
 #include <cobs/query/classic_search.hpp>
 #include <cobs/query/compact_index/mmap_search_file.hpp>
 #include <cobs/settings.hpp>
+#include <cobs/util/bounded_queue.hpp>
 #include <cobs/util/calc_signature_size.hpp>
+#include <cobs/util/parallel_for.hpp>
+#include <cobs/util/trace.hpp>
+#include <cobs/util/zip_stream.hpp>
 #ifdef __linux__
+    #include <cobs/query/classic_index/direct_search_file.hpp>
+    #include <cobs/query/classic_index/uring_search_file.hpp>
     #include <cobs/query/compact_index/aio_search_file.hpp>
+    #include <cobs/query/compact_index/direct_search_file.hpp>
 #endif
 
 #include <tlx/cmdline_parser.hpp>
@@ -25,15 +34,23 @@
 #include <cmath>
 #include <map>
 #include <random>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
 /******************************************************************************/
 
 // some often repeated strings
 static const char* s_help_file_type =
     "\"list\" to read a file list, or "
-    "filter documents by file type (any, text, cortex, fasta, fastq, etc)";
+    "filter documents by file type (any, text, cortex, fasta, fastq, etc); "
+    "\"-\" and named pipes are read as one-pass FASTA/FASTQ streams";
 
 /******************************************************************************/
 // Document List and Dump
@@ -182,11 +199,23 @@ int classic_construct(int argc, char** argv) {
         "memory in bytes to use, default: " +
         tlx::format_iec_units(index_params.mem_bytes));
 
+    cp.add_bytes(
+        "stream-size", cobs::gopt_stream_size_estimate,
+        "assumed size of non-seekable stream inputs (stdin, named pipes), "
+        "default: " +
+        tlx::format_iec_units(cobs::gopt_stream_size_estimate));
+
     cp.add_unsigned(
         'h', "num-hashes", index_params.num_hashes,
         "number of hash functions, default: "
         + std::to_string(index_params.num_hashes));
 
+    bool double_hashing = false;
+    cp.add_flag(
+        "double-hashing", double_hashing,
+        "use double hashing h_i = h1 + i * h2 (v2 index format), "
+        "needing only two hash evaluations per term");
+
     cp.add_double(
         'f', "false-positive-rate", index_params.false_positive_rate,
         "false positive rate, default: "
@@ -197,11 +226,52 @@ int classic_construct(int argc, char** argv) {
         "term size (k-mer size), default: "
         + std::to_string(index_params.term_size));
 
+    cp.add_flag(
+        "estimate-cardinality", index_params.estimate_cardinality,
+        "size signatures from the estimated number of distinct k-mers "
+        "instead of file sizes, costs an extra pass over the input");
+
+    bool adaptive = false;
+    cp.add_flag(
+        "adaptive", adaptive,
+        "group documents of similar size and size each group's signatures "
+        "independently, writing one index per size class");
+
     bool no_canonicalize = false;
     cp.add_flag(
         "no-canonicalize", no_canonicalize,
         "don't canonicalize DNA k-mers, default: false");
 
+    bool no_dedup = false;
+    cp.add_flag(
+        "no-dedup", no_dedup,
+        "don't skip k-mers repeated within a document, default: false");
+
+    bool packed_hashing = false;
+    cp.add_flag(
+        "packed-hashing", packed_hashing,
+        "hash 2-bit packed canonical k-mers instead of their text form; "
+        "faster, but incompatible with text-hashed indexes");
+
+    size_t window_size = 1;
+    cp.add_size_t(
+        'w', "window-size", window_size,
+        "minimizer window size: index only the minimizer of every window "
+        "of this many consecutive k-mers, shrinking the index roughly "
+        "(w+1)/2-fold at a small sensitivity cost, default: 1 = all k-mers");
+
+    cp.add_size_t(
+        "partition-index", index_params.partition_index,
+        "distributed construction: number of this job's partition, "
+        "0 <= partition-index < partition-count");
+
+    cp.add_size_t(
+        "partition-count", index_params.partition_count,
+        "distributed construction: build only every partition-count-th "
+        "document batch; jobs with the same input and distinct partition "
+        "indexes build disjoint partial indexes, combined afterwards "
+        "with classic-merge, default: 1 = everything");
+
     cp.add_flag(
         'C', "clobber", index_params.clobber,
         "erase output directory if it exists");
@@ -214,10 +284,19 @@ int classic_construct(int argc, char** argv) {
         'T', "threads", index_params.num_threads,
         "number of threads to use, default: max cores");
 
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
+
     cp.add_flag(
         "keep-temporary", index_params.keep_temporary,
         "keep temporary files during construction");
 
+    cp.add_flag(
+        "direct-io", index_params.direct_io,
+        "write index files with O_DIRECT, bypassing the page cache");
+
     std::string tmp_path;
     cp.add_string(
         "tmp-path", tmp_path,
@@ -229,17 +308,348 @@ int classic_construct(int argc, char** argv) {
     cp.print_result(std::cerr);
 
     // bool to uint8_t
-    index_params.canonicalize = !no_canonicalize;
+    index_params.canonicalize =
+        packed_hashing ? 2 : uint8_t(!no_canonicalize);
+    index_params.hash_mode = double_hashing ? 1 : 0;
+    index_params.dedup = !no_dedup;
+    index_params.window_size = std::max<size_t>(window_size, 1);
+    index_params.partition_count =
+        std::max<size_t>(index_params.partition_count, 1);
+    if (index_params.partition_index >= index_params.partition_count) {
+        die("Error: partition-index must be smaller than partition-count");
+    }
 
     // read file list
     cobs::DocumentList filelist(input, cobs::StringToFileType(file_type));
     print_document_list(filelist, index_params.term_size);
 
-    cobs::classic_construct(filelist, out_file, tmp_path, index_params);
+    if (adaptive)
+        cobs::classic_construct_adaptive(
+            filelist, out_file, tmp_path, index_params);
+    else
+        cobs::classic_construct(filelist, out_file, tmp_path, index_params);
+
+    return 0;
+}
+
+int classic_append(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    cobs::ClassicIndexParameters index_params;
+
+    std::string in_file;
+    cp.add_param_string(
+        "index", in_file, "path to the existing .cobs_classic index file");
+
+    std::string input;
+    cp.add_param_string(
+        "input", input, "path to the new documents' directory or file");
+
+    std::string out_file;
+    cp.add_param_string(
+        "out_file", out_file,
+        "path to the output .cobs_classic index file, may equal <index> "
+        "to rewrite it in place");
+
+    std::string file_type = "any";
+    cp.add_string(
+        "file-type", file_type, s_help_file_type);
+
+    cp.add_bytes(
+        'm', "memory", index_params.mem_bytes,
+        "memory in bytes to use, default: " +
+        tlx::format_iec_units(index_params.mem_bytes));
+
+    bool no_dedup = false;
+    cp.add_flag(
+        "no-dedup", no_dedup,
+        "don't skip k-mers repeated within a document, default: false");
+
+    cp.add_flag(
+        'C', "clobber", index_params.clobber,
+        "erase output directory if it exists");
+
+    cp.add_flag(
+        "continue", index_params.continue_,
+        "continue in existing output directory");
+
+    cp.add_size_t(
+        'T', "threads", index_params.num_threads,
+        "number of threads to use, default: max cores");
+
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
+
+    cp.add_flag(
+        "keep-temporary", index_params.keep_temporary,
+        "keep temporary files during construction");
+
+    cp.add_flag(
+        "direct-io", index_params.direct_io,
+        "write index files with O_DIRECT, bypassing the page cache");
+
+    std::string tmp_path;
+    cp.add_string(
+        "tmp-path", tmp_path,
+        "directory for intermediate index files, default: out_file + \".tmp\")");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    index_params.dedup = !no_dedup;
+
+    // read file list; all other parameters are adopted from the index
+    auto h = cobs::deserialize_header<cobs::ClassicIndexHeader>(in_file);
+    cobs::DocumentList filelist(input, cobs::StringToFileType(file_type));
+    print_document_list(filelist, h.term_size_);
+
+    cobs::classic_append(filelist, in_file, out_file, tmp_path, index_params);
 
     return 0;
 }
 
+int classic_merge(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    cobs::ClassicIndexParameters index_params;
+
+    std::string manifest;
+    cp.add_param_string(
+        "manifest", manifest,
+        "manifest file listing one .cobs_classic part file per line, "
+        "blank lines and # comments are skipped");
+
+    std::string out_file;
+    cp.add_param_string(
+        "out_file", out_file, "path to the output .cobs_classic index file");
+
+    cp.add_bytes(
+        'm', "memory", index_params.mem_bytes,
+        "memory in bytes to use, default: " +
+        tlx::format_iec_units(index_params.mem_bytes));
+
+    cp.add_flag(
+        'C', "clobber", index_params.clobber,
+        "erase output directory if it exists");
+
+    cp.add_flag(
+        "continue", index_params.continue_,
+        "continue in existing output directory");
+
+    cp.add_size_t(
+        'T', "threads", index_params.num_threads,
+        "number of threads to use, default: max cores");
+
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
+
+    cp.add_flag(
+        "keep-temporary", index_params.keep_temporary,
+        "keep temporary files during construction");
+
+    cp.add_flag(
+        "direct-io", index_params.direct_io,
+        "write index files with O_DIRECT, bypassing the page cache");
+
+    std::string tmp_path;
+    cp.add_string(
+        "tmp-path", tmp_path,
+        "directory for intermediate index files, default: out_file + \".tmp\")");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    // read manifest: one part file per line
+    std::vector<cobs::fs::path> part_files;
+    std::ifstream mfs(manifest);
+    if (!mfs.good()) {
+        die("Error: could not open manifest file " << manifest);
+    }
+    std::string line;
+    while (std::getline(mfs, line)) {
+        line = tlx::trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        part_files.emplace_back(line);
+    }
+    if (part_files.empty()) {
+        die("Error: manifest file " << manifest << " lists no part files");
+    }
+
+    cobs::classic_merge(part_files, out_file, tmp_path, index_params);
+
+    return 0;
+}
+
+int classic_union(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    cobs::ClassicIndexParameters index_params;
+
+    std::vector<std::string> index_files;
+    cp.add_stringlist(
+        'i', "index", index_files,
+        "path to a .cobs_classic index file to include in the union, "
+        "give once per index");
+
+    std::string out_file;
+    cp.add_param_string(
+        "out_file", out_file, "path to the output .cobs_classic index file");
+
+    cp.add_bytes(
+        'm', "memory", index_params.mem_bytes,
+        "memory in bytes to use, default: " +
+        tlx::format_iec_units(index_params.mem_bytes));
+
+    cp.add_flag(
+        'C', "clobber", index_params.clobber,
+        "erase output directory if it exists");
+
+    cp.add_flag(
+        "continue", index_params.continue_,
+        "continue in existing output directory");
+
+    cp.add_size_t(
+        'T', "threads", index_params.num_threads,
+        "number of threads to use, default: max cores");
+
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
+
+    cp.add_flag(
+        "keep-temporary", index_params.keep_temporary,
+        "keep temporary files during construction");
+
+    cp.add_flag(
+        "direct-io", index_params.direct_io,
+        "write index files with O_DIRECT, bypassing the page cache");
+
+    std::string tmp_path;
+    cp.add_string(
+        "tmp-path", tmp_path,
+        "directory for intermediate index files, default: out_file + \".tmp\")");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    if (index_files.size() < 2) {
+        die("Error: classic-union needs at least two --index files");
+    }
+    std::vector<cobs::fs::path> part_files(
+        index_files.begin(), index_files.end());
+
+    // the union is a streaming column interleave of the complete indexes,
+    // no document is re-hashed; classic_merge() validates that all parts
+    // were built with the same parameters
+    cobs::classic_merge(part_files, out_file, tmp_path, index_params);
+
+    return 0;
+}
+
+int classic_compress(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::string in_file;
+    cp.add_param_string(
+        "index", in_file, "path to the raw .cobs_classic index file");
+
+    std::string out_file;
+    cp.add_param_string(
+        "out_file", out_file,
+        "path to the output compressed .cobs_classic index file");
+
+    uint64_t block_size = 256 * 1024;
+    cp.add_bytes(
+        'b', "block-size", block_size,
+        "uncompressed bytes per row block, default: " +
+        tlx::format_iec_units(block_size));
+
+    unsigned compression_level = 3;
+    cp.add_unsigned(
+        'l', "level", compression_level,
+        "zstd compression level, default: "
+        + std::to_string(compression_level));
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    cobs::classic_compress(in_file, out_file, block_size, compression_level);
+
+    return 0;
+}
+
+int classic_sparsify(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::string in_file;
+    cp.add_param_string(
+        "index", in_file, "path to the raw .cobs_classic index file");
+
+    std::string out_file;
+    cp.add_param_string(
+        "out_file", out_file,
+        "path to the output sparse-encoded .cobs_classic index file");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    cobs::classic_sparsify(in_file, out_file);
+
+    return 0;
+}
+
+int make_shards(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::string out_file;
+    cp.add_param_string(
+        "out_file", out_file,
+        "path to the output .cobs_shards manifest file");
+
+    std::vector<std::string> index_files;
+    cp.add_param_stringlist(
+        "indices", index_files,
+        "member index files (.cobs_classic or .cobs_compact)");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    if (!tlx::ends_with(out_file, cobs::ShardsHeader::file_extension)) {
+        die("Error: shard manifest file must end with "
+            << cobs::ShardsHeader::file_extension);
+    }
+
+    std::vector<cobs::fs::path> members(
+        index_files.begin(), index_files.end());
+    cobs::ShardsHeader sh = cobs::ShardsHeader::scan(members);
+    cobs::serialize_header(out_file, sh);
+
+    std::cerr << "wrote " << out_file << " with " << sh.shards_.size()
+              << " shards and " << sh.num_documents()
+              << " total documents" << std::endl;
+
+    return 0;
+}
+
+
 int classic_construct_random(int argc, char** argv) {
     tlx::CmdlineParser cp;
 
@@ -272,6 +682,17 @@ int classic_construct_random(int argc, char** argv) {
     size_t seed = std::random_device { } ();
     cp.add_size_t("seed", seed, "random seed");
 
+    cp.add_size_t(
+        'T', "threads", cobs::gopt_threads,
+        "number of threads to use for bit setting, default: max cores");
+    cp.add_flag(
+        "pin-threads", cobs::gopt_pin_threads,
+        "pin pool worker threads to CPU cores, one core per worker");
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
+
     if (!cp.sort().process(argc, argv))
         return -1;
 
@@ -285,7 +706,8 @@ int classic_construct_random(int argc, char** argv) {
               << std::endl;
 
     cobs::classic_construct_random(
-        out_file, signature_size, num_documents, document_size, num_hashes, seed);
+        out_file, signature_size, num_documents, document_size, num_hashes,
+        seed, cobs::gopt_threads);
 
     return 0;
 }
@@ -315,11 +737,23 @@ int compact_construct(int argc, char** argv) {
         "memory in bytes to use, default: " +
         tlx::format_iec_units(index_params.mem_bytes));
 
+    cp.add_bytes(
+        "stream-size", cobs::gopt_stream_size_estimate,
+        "assumed size of non-seekable stream inputs (stdin, named pipes), "
+        "default: " +
+        tlx::format_iec_units(cobs::gopt_stream_size_estimate));
+
     cp.add_unsigned(
         'h', "num-hashes", index_params.num_hashes,
         "number of hash functions, default: "
         + std::to_string(index_params.num_hashes));
 
+    bool double_hashing = false;
+    cp.add_flag(
+        "double-hashing", double_hashing,
+        "use double hashing h_i = h1 + i * h2 (v2 index format), "
+        "needing only two hash evaluations per term");
+
     cp.add_double(
         'f', "false-positive-rate", index_params.false_positive_rate,
         "false positive rate, default: "
@@ -335,11 +769,34 @@ int compact_construct(int argc, char** argv) {
         "the page size of the compact the index, "
         "default: sqrt(#documents)");
 
+    cp.add_flag(
+        "align-pages", index_params.aligned_pages,
+        "pad the payload so subindex pages never straddle OS memory "
+        "pages, enables hugepage-backed mappings for large indexes");
+
     bool no_canonicalize = false;
     cp.add_flag(
         "no-canonicalize", no_canonicalize,
         "don't canonicalize DNA k-mers, default: false");
 
+    bool no_dedup = false;
+    cp.add_flag(
+        "no-dedup", no_dedup,
+        "don't skip k-mers repeated within a document, default: false");
+
+    bool packed_hashing = false;
+    cp.add_flag(
+        "packed-hashing", packed_hashing,
+        "hash 2-bit packed canonical k-mers instead of their text form; "
+        "faster, but incompatible with text-hashed indexes");
+
+    size_t window_size = 1;
+    cp.add_size_t(
+        'w', "window-size", window_size,
+        "minimizer window size: index only the minimizer of every window "
+        "of this many consecutive k-mers, shrinking the index roughly "
+        "(w+1)/2-fold at a small sensitivity cost, default: 1 = all k-mers");
+
     cp.add_flag(
         'C', "clobber", index_params.clobber,
         "erase output directory if it exists");
@@ -352,10 +809,19 @@ int compact_construct(int argc, char** argv) {
         'T', "threads", index_params.num_threads,
         "number of threads to use, default: max cores");
 
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
+
     cp.add_flag(
         "keep-temporary", index_params.keep_temporary,
         "keep temporary files during construction");
 
+    cp.add_flag(
+        "direct-io", index_params.direct_io,
+        "write index files with O_DIRECT, bypassing the page cache");
+
     std::string tmp_path;
     cp.add_string(
         "tmp-path", tmp_path,
@@ -367,107 +833,790 @@ int compact_construct(int argc, char** argv) {
     cp.print_result(std::cerr);
 
     // bool to uint8_t
-    index_params.canonicalize = !no_canonicalize;
+    index_params.canonicalize =
+        packed_hashing ? 2 : uint8_t(!no_canonicalize);
+    index_params.hash_mode = double_hashing ? 1 : 0;
+    index_params.dedup = !no_dedup;
+    index_params.window_size = std::max<size_t>(window_size, 1);
 
     // read file list
     cobs::DocumentList filelist(input, cobs::StringToFileType(file_type));
     print_document_list(filelist, index_params.term_size);
 
-    cobs::compact_construct(filelist, out_file, tmp_path, index_params);
+    cobs::compact_construct(filelist, out_file, tmp_path, index_params);
+
+    return 0;
+}
+
+int compact_construct_combine(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::string in_dir;
+    cp.add_param_string(
+        "in-dir", in_dir, "path to the input directory");
+
+    std::string out_file;
+    cp.add_param_string(
+        "out-file", out_file, "path to the output file");
+
+    unsigned page_size = 8192;
+    cp.add_unsigned(
+        'p', "page-size", page_size,
+        "the page size of the compact the index, "
+        "default: 8192");
+
+    bool direct_io = false;
+    cp.add_flag(
+        "direct-io", direct_io,
+        "write index files with O_DIRECT, bypassing the page cache");
+
+    bool align_pages = false;
+    cp.add_flag(
+        "align-pages", align_pages,
+        "pad the payload so subindex pages never straddle OS memory "
+        "pages, enables hugepage-backed mappings for large indexes");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    cobs::compact_combine_into_compact(
+        in_dir, out_file, page_size,
+        cobs::get_memory_size(80), /* keep_temporary */ false, direct_io,
+        cobs::gopt_threads, align_pages);
+
+    return 0;
+}
+
+/******************************************************************************/
+
+/*!
+ * Buffered bulk writer for query results. Formats into a large reusable
+ * buffer with locale-free integer formatting and hands full blocks to a
+ * single write(2) each; printing millions of result lines through
+ * iostreams costs more than the search itself. Besides the classic
+ * layout it can emit a flat TSV (one "comment<TAB>doc<TAB>score" line
+ * per result) or a little-endian binary stream (per query: uint32
+ * result count, uint16 comment length + bytes; per result: uint16 doc
+ * name length + bytes, uint32 score).
+ */
+class ResultWriter
+{
+public:
+    enum Format { FORMAT_DEFAULT, FORMAT_TSV, FORMAT_BINARY };
+
+    static Format parse_format(const std::string& name) {
+        if (name.empty() || name == "default")
+            return FORMAT_DEFAULT;
+        if (name == "tsv")
+            return FORMAT_TSV;
+        if (name == "binary")
+            return FORMAT_BINARY;
+        die("unknown output format \"" << name << "\"");
+    }
+
+    explicit ResultWriter(Format format, int fd = STDOUT_FILENO)
+        : format_(format), fd_(fd) {
+        buffer_.reserve(flush_size_ + 4096);
+    }
+
+    ~ResultWriter() { flush(); }
+
+    //! append one query's results, flushing full blocks along the way
+    void write_query(const std::string& comment,
+                     const std::vector<cobs::SearchResult>& result) {
+        if (format_ == FORMAT_DEFAULT) {
+            if (!comment.empty()) {
+                append(comment.data(), comment.size());
+                append_char('\t');
+                append_uint(result.size());
+                append_char('\n');
+            }
+            for (const auto& res : result) {
+                append(res.doc_name, strlen(res.doc_name));
+                append_char('\t');
+                append_uint(res.score);
+                append_char('\n');
+                maybe_flush();
+            }
+        }
+        else if (format_ == FORMAT_TSV) {
+            const std::string& c = comment.empty() ? star_ : comment;
+            for (const auto& res : result) {
+                append(c.data(), c.size());
+                append_char('\t');
+                append(res.doc_name, strlen(res.doc_name));
+                append_char('\t');
+                append_uint(res.score);
+                append_char('\n');
+                maybe_flush();
+            }
+        }
+        else {
+            append_pod<uint32_t>(result.size());
+            append_pod<uint16_t>(comment.size());
+            append(comment.data(), comment.size());
+            for (const auto& res : result) {
+                uint16_t len = strlen(res.doc_name);
+                append_pod<uint16_t>(len);
+                append(res.doc_name, len);
+                append_pod<uint32_t>(res.score);
+                maybe_flush();
+            }
+        }
+        maybe_flush();
+    }
+
+    //! write out the remaining buffered block
+    void flush() {
+        size_t pos = 0;
+        while (pos < buffer_.size()) {
+            ssize_t r = write(fd_, buffer_.data() + pos,
+                              buffer_.size() - pos);
+            if (r <= 0)
+                die("ResultWriter: write failed: " << strerror(errno));
+            pos += r;
+        }
+        buffer_.clear();
+    }
+
+private:
+    static const size_t flush_size_ = 1024 * 1024;
+
+    void append(const char* data, size_t size) {
+        buffer_.append(data, size);
+    }
+
+    void append_char(char c) { buffer_ += c; }
+
+    void append_uint(uint64_t v) {
+        char digits[20];
+        size_t i = sizeof(digits);
+        do {
+            digits[--i] = '0' + v % 10;
+            v /= 10;
+        } while (v != 0);
+        buffer_.append(digits + i, sizeof(digits) - i);
+    }
+
+    template <typename T>
+    void append_pod(T v) {
+        buffer_.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+
+    void maybe_flush() {
+        if (buffer_.size() >= flush_size_)
+            flush();
+    }
+
+    Format format_;
+    int fd_;
+    std::string buffer_;
+    std::string star_ = "*";
+};
+
+static inline
+void process_query(
+    cobs::Search& s, double threshold, unsigned num_results,
+    const std::string& query_line, const std::string& query_file,
+    ResultWriter::Format format = ResultWriter::FORMAT_DEFAULT)
+{
+    std::vector<cobs::SearchResult> result;
+    ResultWriter writer(format);
+
+    if (!query_line.empty()) {
+        s.search(query_line, result, threshold, num_results);
+        writer.write_query(std::string(), result);
+    }
+    else if (!query_file.empty()) {
+        std::ifstream qf(query_file);
+        std::string line, query, comment;
+
+        while (std::getline(qf, line)) {
+            if (line.empty())
+                continue;
+
+            if (line[0] == '>' || line[0] == ';') {
+                if (!query.empty()) {
+                    // perform query
+                    s.search(query, result, threshold, num_results);
+                    writer.write_query(comment, result);
+                }
+
+                // clear and copy query comment
+                line[0] = '*';
+                query.clear();
+                comment = line;
+                continue;
+            }
+            else {
+                query += line;
+            }
+        }
+
+        if (!query.empty()) {
+            // perform query
+            s.search(query, result, threshold, num_results);
+            writer.write_query(comment, result);
+        }
+    }
+    else {
+        die("Pass a verbatim query or a query file.");
+    }
+
+    writer.flush();
+    if (cobs::gopt_timing_json)
+        s.timer().print_json("search", std::cerr);
+    else
+        s.timer().print("search");
+}
+
+//! open each index path with the search file backend selected by the
+//! global flags, shared by the query and serve subtools
+static std::vector<std::shared_ptr<cobs::IndexSearchFile> > open_indices(
+    const std::vector<std::string>& index_files,
+    const cobs::MMapPolicy& mmap_policy, uint64_t page_cache_bytes)
+{
+    // expand shard manifests into their member files
+    std::vector<std::string> paths;
+    for (auto& path : index_files)
+    {
+        if (cobs::file_has_header<cobs::ShardsHeader>(path)) {
+            cobs::ShardsHeader sh =
+                cobs::deserialize_header<cobs::ShardsHeader>(path);
+            cobs::fs::path dir = cobs::fs::path(path).parent_path();
+            for (const auto& s : sh.shards_) {
+                cobs::fs::path member = s.path_;
+                if (member.is_relative() && !dir.empty())
+                    member = dir / member;
+                paths.push_back(member.string());
+            }
+        }
+        else {
+            paths.push_back(path);
+        }
+    }
+
+    auto open_one =
+        [&](const std::string& path)
+        -> std::shared_ptr<cobs::IndexSearchFile> {
+            if (cobs::file_has_header<cobs::ClassicIndexHeader>(path)) {
+                // block-compressed indexes have their own backend
+                cobs::ClassicIndexHeader h =
+                    cobs::deserialize_header<cobs::ClassicIndexHeader>(path);
+                if (h.block_rows_ != 0) {
+                    return std::make_shared<
+                        cobs::ClassicIndexZstdSearchFile>(path);
+                }
+                // sparse-encoded rows are decoded by the mmap backend only
+                if (h.sparse_rows_ != 0) {
+                    return std::make_shared<
+                        cobs::ClassicIndexMMapSearchFile>(path, mmap_policy);
+                }
+#ifdef __linux__
+                if (cobs::gopt_use_o_direct) {
+                    return std::make_shared<
+                        cobs::ClassicIndexDirectSearchFile>(path);
+                }
+                if (cobs::gopt_use_io_uring) {
+                    return std::make_shared<
+                        cobs::ClassicIndexUringSearchFile>(path);
+                }
+#endif
+                return std::make_shared<
+                    cobs::ClassicIndexMMapSearchFile>(path, mmap_policy);
+            }
+            else if (cobs::file_has_header<cobs::CompactIndexHeader>(path)) {
+#ifdef __linux__
+                if (cobs::gopt_use_o_direct) {
+                    return std::make_shared<
+                        cobs::CompactIndexDirectSearchFile>(path);
+                }
+#endif
+                return std::make_shared<cobs::CompactIndexMMapSearchFile>(
+                    path, mmap_policy, page_cache_bytes);
+            }
+            die("Could not open index path \"" << path << "\"");
+        };
+
+    // open and validate the index files in parallel, the serial header
+    // reads dominate startup with many shards
+    std::vector<std::shared_ptr<cobs::IndexSearchFile> > indices(paths.size());
+    cobs::parallel_for(
+        0, paths.size(), cobs::gopt_threads,
+        [&](size_t i) { indices[i] = open_one(paths[i]); });
+
+    return indices;
+}
+
+
+/*!
+ * Streaming query mode for FASTQ/FASTA read files: a parse thread
+ * decompresses and splits the input into batches of reads on a bounded
+ * queue, and scoring workers consume them with search_batch(), so
+ * decompression, k-mer hashing and row scoring of different reads run
+ * concurrently instead of strictly interleaved. Output stays in input
+ * order: each finished batch is formatted and flushed as soon as all of
+ * its predecessors are out.
+ */
+static void process_query_streaming(
+    cobs::Search& s, double threshold, unsigned num_results,
+    const std::string& query_file, size_t min_query_size)
+{
+    //! reads handed from the parse stage to the scoring workers
+    struct ReadBatch {
+        size_t id;
+        std::vector<std::string> comments, queries;
+    };
+
+    static const size_t batch_size = 256;
+
+    // a few scoring workers suffice: each one drives the shared thread
+    // pool through search_batch(), the extra workers only overlap the
+    // hashing of one batch with the scoring of another
+    size_t num_workers = std::min<size_t>(
+        4, std::max<size_t>(1, cobs::gopt_threads));
+
+    cobs::BoundedQueue<ReadBatch> parse_queue(4 * num_workers);
+
+    std::mutex output_mutex;
+    std::map<size_t, std::string> pending_output;
+    size_t next_output = 0;
+
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < num_workers; ++w) {
+        workers.emplace_back(
+            [&]() {
+                ReadBatch batch;
+                std::vector<std::vector<cobs::SearchResult> > results;
+                while (parse_queue.pop(batch)) {
+                    s.search_batch(batch.queries, results,
+                                   threshold, num_results);
+
+                    std::string text;
+                    for (size_t q = 0; q < batch.queries.size(); ++q) {
+                        text += batch.comments[q] + '\t'
+                                + std::to_string(results[q].size()) + '\n';
+                        for (const auto& res : results[q]) {
+                            text += res.doc_name;
+                            text += '\t';
+                            text += std::to_string(res.score);
+                            text += '\n';
+                        }
+                    }
+
+                    std::unique_lock<std::mutex> lock(output_mutex);
+                    pending_output[batch.id] = std::move(text);
+                    while (!pending_output.empty()
+                           && pending_output.begin()->first == next_output) {
+                        std::cout << pending_output.begin()->second;
+                        pending_output.erase(pending_output.begin());
+                        ++next_output;
+                    }
+                }
+            });
+    }
+
+    bool gzip = tlx::ends_with(query_file, ".gz");
+    std::string base =
+        gzip ? query_file.substr(0, query_file.size() - 3) : query_file;
+    bool fastq = tlx::ends_with(base, ".fq") || tlx::ends_with(base, ".fastq");
+
+    ReadBatch batch;
+    batch.id = 0;
+
+    auto emit_read =
+        [&](std::string&& comment, std::string&& query) {
+            if (query.size() < min_query_size) {
+                // too short for the largest term size: pad to the minimum
+                // with separator characters, which contribute no valid
+                // k-mers, so the read reports zero matches instead of
+                // failing the whole stream
+                query.resize(min_query_size, ':');
+            }
+            batch.comments.emplace_back(std::move(comment));
+            batch.queries.emplace_back(std::move(query));
+            if (batch.queries.size() >= batch_size) {
+                size_t id = batch.id;
+                parse_queue.push(std::move(batch));
+                batch = ReadBatch();
+                batch.id = id + 1;
+            }
+        };
+
+    auto parse =
+        [&](std::istream& is) {
+            std::string line, comment, query;
+            if (fastq) {
+                size_t line_num = 0;
+                while (std::getline(is, line)) {
+                    if (line_num % 4 == 0) {
+                        if (line.empty() || line[0] != '@')
+                            die("FASTQ: line " << line_num
+                                               << " does not start with @");
+                        line[0] = '*';
+                        comment = line;
+                    }
+                    else if (line_num % 4 == 1) {
+                        emit_read(std::move(comment), std::move(line));
+                    }
+                    ++line_num;
+                }
+            }
+            else {
+                while (std::getline(is, line)) {
+                    if (line.empty())
+                        continue;
+                    if (line[0] == '>' || line[0] == ';') {
+                        if (!query.empty())
+                            emit_read(std::move(comment), std::move(query));
+                        line[0] = '*';
+                        comment = line;
+                        query.clear();
+                    }
+                    else {
+                        query += line;
+                    }
+                }
+                if (!query.empty())
+                    emit_read(std::move(comment), std::move(query));
+            }
+        };
+
+    std::ifstream ifs(query_file);
+    die_unless(ifs.good());
+    if (gzip) {
+        cobs::zip_istream zis(ifs);
+        parse(zis);
+    }
+    else {
+        parse(ifs);
+    }
+
+    if (!batch.queries.empty())
+        parse_queue.push(std::move(batch));
+    parse_queue.close();
+
+    for (std::thread& t : workers)
+        t.join();
+
+    if (cobs::gopt_timing_json)
+        s.timer().print_json("search", std::cerr);
+    else
+        s.timer().print("search");
+}
+
+/******************************************************************************/
+// Query Server
+
+/*
+ * Wire protocol of "cobs serve": every message in both directions is one
+ * frame, a little-endian uint32_t payload length followed by the payload
+ * text. A request payload is "<threshold> <num_results>\n<query>", a
+ * response payload is "<num_results>\n" followed by one "<doc>\t<score>"
+ * line per result, or "-1\n<error message>" on failure. A connection
+ * carries any number of request/response pairs.
+ */
+
+static bool read_full(int fd, void* data, size_t size) {
+    uint8_t* p = reinterpret_cast<uint8_t*>(data);
+    while (size != 0) {
+        ssize_t r = read(fd, p, size);
+        if (r <= 0)
+            return false;
+        p += r, size -= r;
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void* data, size_t size) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    while (size != 0) {
+        ssize_t r = write(fd, p, size);
+        if (r <= 0)
+            return false;
+        p += r, size -= r;
+    }
+    return true;
+}
+
+static bool read_frame(int fd, std::string& payload) {
+    uint32_t length;
+    if (!read_full(fd, &length, sizeof(length)))
+        return false;
+    payload.resize(length);
+    return read_full(fd, &payload[0], length);
+}
+
+static bool write_frame(int fd, const std::string& payload) {
+    uint32_t length = payload.size();
+    return write_full(fd, &length, sizeof(length))
+           && write_full(fd, payload.data(), payload.size());
+}
+
+//! addresses containing a slash are unix socket paths, otherwise host:port
+static bool is_unix_address(const std::string& address) {
+    return address.find('/') != std::string::npos;
+}
+
+static int listen_socket(const std::string& address) {
+    int fd;
+    if (is_unix_address(address)) {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(addr.sun_path))
+            die("unix socket path too long: " << address);
+        memcpy(addr.sun_path, address.c_str(), address.size());
+
+        unlink(address.c_str());
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 ||
+            bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+            die("could not bind unix socket " << address
+                                              << ": " << strerror(errno));
+    }
+    else {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos)
+            die("address must be a unix socket path or host:port");
+        std::string host = address.substr(0, colon);
+        std::string port = address.substr(colon + 1);
+
+        addrinfo hints, * info;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &info) != 0)
+            die("could not resolve " << address);
+
+        fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (fd < 0 ||
+            bind(fd, info->ai_addr, info->ai_addrlen) != 0)
+            die("could not bind " << address << ": " << strerror(errno));
+        freeaddrinfo(info);
+    }
+
+    if (listen(fd, 64) != 0)
+        die("listen failed: " << strerror(errno));
+    return fd;
+}
+
+static int connect_socket(const std::string& address) {
+    int fd;
+    if (is_unix_address(address)) {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(addr.sun_path))
+            die("unix socket path too long: " << address);
+        memcpy(addr.sun_path, address.c_str(), address.size());
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 ||
+            connect(fd, reinterpret_cast<sockaddr*>(&addr),
+                    sizeof(addr)) != 0)
+            die("could not connect to " << address
+                                        << ": " << strerror(errno));
+    }
+    else {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos)
+            die("address must be a unix socket path or host:port");
+        std::string host = address.substr(0, colon);
+        std::string port = address.substr(colon + 1);
+
+        addrinfo hints, * info;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &info) != 0)
+            die("could not resolve " << address);
+
+        fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        if (fd < 0 ||
+            connect(fd, info->ai_addr, info->ai_addrlen) != 0)
+            die("could not connect to " << address
+                                        << ": " << strerror(errno));
+        freeaddrinfo(info);
+    }
+    return fd;
+}
+
+//! client mode of the query subtool: one request to a cobs serve instance
+static int query_server(const std::string& address, double threshold,
+                        unsigned num_results, const std::string& query) {
+    int fd = connect_socket(address);
+
+    std::string request =
+        tlx::ssprintf("%g %u\n", threshold, num_results) + query;
+    std::string response;
+    if (!write_frame(fd, request) || !read_frame(fd, response))
+        die("server connection lost");
+    close(fd);
+
+    size_t newline = response.find('\n');
+    if (response.compare(0, newline, "-1") == 0)
+        die("server error: " << response.substr(newline + 1));
+
+    std::cout << response;
+    return 0;
+}
+
+//! serve one client connection until it closes; search() is re-entrant,
+//! so connections are handled on concurrent threads
+static void serve_connection(
+    cobs::ClassicSearch& s,
+    const std::vector<std::shared_ptr<cobs::IndexSearchFile> >& indices,
+    int fd)
+{
+    uint32_t max_term_size = 0;
+    for (const auto& index : indices)
+        max_term_size = std::max(max_term_size, index->term_size());
+
+    std::string request;
+    while (read_frame(fd, request)) {
+        double threshold = 0.8;
+        unsigned num_results = 0;
+        std::string query;
+
+        size_t newline = request.find('\n');
+        if (newline != std::string::npos) {
+            sscanf(request.c_str(), "%lf %u", &threshold, &num_results);
+            query = request.substr(newline + 1);
+        }
 
-    return 0;
+        std::string response;
+        if (query.size() < max_term_size) {
+            response = "-1\nquery too short, needs to be at least "
+                       + std::to_string(max_term_size) + " characters long";
+        }
+        else {
+            std::vector<cobs::SearchResult> result;
+            s.search(query, result, threshold, num_results);
+            response = std::to_string(result.size()) + '\n';
+            for (const auto& res : result) {
+                response += res.doc_name;
+                response += '\t';
+                response += std::to_string(res.score);
+                response += '\n';
+            }
+        }
+        if (!write_frame(fd, response))
+            break;
+    }
+    close(fd);
 }
 
-int compact_construct_combine(int argc, char** argv) {
+int serve(int argc, char** argv) {
     tlx::CmdlineParser cp;
 
-    std::string in_dir;
-    cp.add_param_string(
-        "in-dir", in_dir, "path to the input directory");
+    std::vector<std::string> index_files;
+    cp.add_stringlist(
+        'i', "index", index_files, "path to index file(s)");
 
-    std::string out_file;
+    std::string listen_address;
     cp.add_param_string(
-        "out-file", out_file, "path to the output file");
+        "address", listen_address,
+        "unix socket path or host:port to listen on");
 
-    unsigned page_size = 8192;
-    cp.add_unsigned(
-        'p', "page-size", page_size,
-        "the page size of the compact the index, "
-        "default: 8192");
+    cp.add_flag(
+        "load-complete", cobs::gopt_load_complete_index,
+        "load complete index into RAM instead of mmap paging");
 
-    if (!cp.sort().process(argc, argv))
-        return -1;
+    cobs::MMapPolicy mmap_policy;
+    cp.add_flag(
+        "mmap-hugepages", mmap_policy.hugepages,
+        "advise MADV_HUGEPAGE on the index mapping for TLB relief");
 
-    cp.print_result(std::cerr);
+    cp.add_flag(
+        "mmap-prefetch", mmap_policy.prefetch,
+        "warm the index in the background via MADV_WILLNEED after open");
 
-    cobs::compact_combine_into_compact(in_dir, out_file, page_size);
+    cp.add_bytes(
+        "mmap-window-budget", mmap_policy.window_budget_bytes,
+        "byte budget for the windowed mmap pager: count accesses per "
+        "index window and drop cold windows with MADV_DONTNEED, for "
+        "indexes larger than RAM, default: kernel paging");
 
-    return 0;
-}
+    cp.add_bytes(
+        "mmap-window-size", mmap_policy.window_size_bytes,
+        "window granularity of the mmap pager, default: 64 MiB");
 
-/******************************************************************************/
+    uint64_t page_cache_bytes = 0;
+    cp.add_bytes(
+        "page-cache", page_cache_bytes,
+        "byte budget for an LRU cache of hot compact index row pages, "
+        "default: disabled");
 
-static inline
-void process_query(
-    cobs::Search& s, double threshold, unsigned num_results,
-    const std::string& query_line, const std::string& query_file)
-{
-    std::vector<cobs::SearchResult> result;
+    cp.add_size_t(
+        "result-cache", cobs::gopt_result_cache_size,
+        "number of query results to keep in an LRU cache keyed by the "
+        "query's k-mer content, default: disabled");
 
-    if (!query_line.empty()) {
-        s.search(query_line, result, threshold, num_results);
+    cp.add_flag(
+        "early-exit", cobs::gopt_early_exit,
+        "stop scoring document blocks that can no longer reach the "
+        "threshold, best for selective thresholds");
 
-        for (const auto& res : result) {
-            std::cout << res.doc_name << '\t' << res.score << '\n';
-        }
-    }
-    else if (!query_file.empty()) {
-        std::ifstream qf(query_file);
-        std::string line, query, comment;
+    cp.add_flag(
+        "calibrate", cobs::gopt_calibrate_scores,
+        "correct scores by each document's expected Bloom false positive "
+        "count, using the bit densities stored in the index");
+    cp.add_flag(
+        "timing-json", cobs::gopt_timing_json,
+        "print phase timings as a JSON object instead of the TIMER line");
+    cp.add_flag(
+        "perf", cobs::gopt_perf_counters,
+        "sample hardware performance counters per timer phase "
+        "(needs a build with COBS_HAVE_PERF_EVENTS)");
 
-        while (std::getline(qf, line)) {
-            if (line.empty())
-                continue;
+    cp.add_flag(
+        "gpu", cobs::gopt_use_gpu,
+        "score gathered rows on the CUDA backend "
+        "(needs a build with COBS_USE_CUDA)");
 
-            if (line[0] == '>' || line[0] == ';') {
-                if (!query.empty()) {
-                    // perform query
-                    s.search(query, result, threshold, num_results);
-                    std::cout << comment << '\t' << result.size() << '\n';
+    cp.add_size_t(
+        'T', "threads", cobs::gopt_threads,
+        "number of threads to use, default: max cores");
+    cp.add_flag(
+        "pin-threads", cobs::gopt_pin_threads,
+        "pin pool worker threads to CPU cores, one core per worker");
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
 
-                    for (const auto& res : result) {
-                        std::cout << res.doc_name << '\t' << res.score << '\n';
-                    }
-                }
+    if (!cp.sort().process(argc, argv))
+        return -1;
 
-                // clear and copy query comment
-                line[0] = '*';
-                query.clear();
-                comment = line;
-                continue;
-            }
-            else {
-                query += line;
-            }
-        }
+    // the index is opened (and optionally loaded or prefetched) once here;
+    // every request served afterwards skips open, header deserialization,
+    // and cold page faults
+    std::vector<std::shared_ptr<cobs::IndexSearchFile> > indices =
+        open_indices(index_files, mmap_policy, page_cache_bytes);
+    cobs::ClassicSearch s(indices);
 
-        if (!query.empty()) {
-            // perform query
-            s.search(query, result, threshold, num_results);
-            std::cout << comment << '\t' << result.size() << '\n';
+    int lfd = listen_socket(listen_address);
+    std::cerr << "cobs serve: listening on " << listen_address << std::endl;
 
-            for (const auto& res : result) {
-                std::cout << res.doc_name << '\t' << res.score << '\n';
-            }
-        }
-    }
-    else {
-        die("Pass a verbatim query or a query file.");
+    while (true) {
+        int fd = accept(lfd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        std::thread(
+            [&s, &indices, fd]() {
+                serve_connection(s, indices, fd);
+            }).detach();
     }
-
-    s.timer().print("search");
 }
 
+/******************************************************************************/
+
 int query(int argc, char** argv) {
     tlx::CmdlineParser cp;
 
@@ -497,31 +1646,127 @@ int query(int argc, char** argv) {
         "load-complete", cobs::gopt_load_complete_index,
         "load complete index into RAM for batch queries");
 
+    cp.add_flag(
+        "io-uring", cobs::gopt_use_io_uring,
+        "read classic index rows via io_uring instead of mmap");
+
+    cp.add_flag(
+        "o-direct", cobs::gopt_use_o_direct,
+        "read index rows with O_DIRECT, bypassing the page cache "
+        "for one-off cold queries");
+
+    cp.add_flag(
+        "numa", cobs::gopt_numa_aware,
+        "pin query workers to NUMA nodes and keep their score "
+        "segments node-local");
+
+    cobs::MMapPolicy mmap_policy;
+    cp.add_flag(
+        "mmap-hugepages", mmap_policy.hugepages,
+        "advise MADV_HUGEPAGE on the index mapping for TLB relief");
+
+    cp.add_flag(
+        "mmap-prefetch", mmap_policy.prefetch,
+        "warm the index in the background via MADV_WILLNEED after open");
+
+    cp.add_bytes(
+        "mmap-window-budget", mmap_policy.window_budget_bytes,
+        "byte budget for the windowed mmap pager: count accesses per "
+        "index window and drop cold windows with MADV_DONTNEED, for "
+        "indexes larger than RAM, default: kernel paging");
+
+    cp.add_bytes(
+        "mmap-window-size", mmap_policy.window_size_bytes,
+        "window granularity of the mmap pager, default: 64 MiB");
+
+    uint64_t page_cache_bytes = 0;
+    cp.add_bytes(
+        "page-cache", page_cache_bytes,
+        "byte budget for an LRU cache of hot compact index row pages, "
+        "default: disabled");
+
+    cp.add_size_t(
+        "result-cache", cobs::gopt_result_cache_size,
+        "number of query results to keep in an LRU cache keyed by the "
+        "query's k-mer content, default: disabled");
+
+    cp.add_flag(
+        "early-exit", cobs::gopt_early_exit,
+        "stop scoring document blocks that can no longer reach the "
+        "threshold, best for selective thresholds");
+
+    cp.add_flag(
+        "calibrate", cobs::gopt_calibrate_scores,
+        "correct scores by each document's expected Bloom false positive "
+        "count, using the bit densities stored in the index");
+    cp.add_flag(
+        "timing-json", cobs::gopt_timing_json,
+        "print phase timings as a JSON object instead of the TIMER line");
+    cp.add_flag(
+        "perf", cobs::gopt_perf_counters,
+        "sample hardware performance counters per timer phase "
+        "(needs a build with COBS_HAVE_PERF_EVENTS)");
+
+    cp.add_flag(
+        "gpu", cobs::gopt_use_gpu,
+        "score gathered rows on the CUDA backend "
+        "(needs a build with COBS_USE_CUDA)");
+
     cp.add_size_t(
         'T', "threads", cobs::gopt_threads,
         "number of threads to use, default: max cores");
+    cp.add_flag(
+        "pin-threads", cobs::gopt_pin_threads,
+        "pin pool worker threads to CPU cores, one core per worker");
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
+
+    std::string output_format;
+    cp.add_string(
+        'F', "format", output_format,
+        "output format: default, tsv, or binary; all use the buffered "
+        "bulk writer");
+
+    bool streaming = false;
+    cp.add_flag(
+        "streaming", streaming,
+        "stream a FASTQ/FASTA --file through a parse/hash/score pipeline "
+        "instead of querying reads one after another");
+
+    std::string server;
+    cp.add_string(
+        's', "server", server,
+        "query a running \"cobs serve\" instance at this address "
+        "(unix socket path or host:port) instead of opening an index");
 
     if (!cp.sort().process(argc, argv))
         return -1;
 
-    std::vector<std::shared_ptr<cobs::IndexSearchFile> > indices;
-
-    for (auto& path : index_files)
-    {
-        if (cobs::file_has_header<cobs::ClassicIndexHeader>(path)) {
-            indices.push_back(
-                std::make_shared<cobs::ClassicIndexMMapSearchFile>(path));
-        }
-        else if (cobs::file_has_header<cobs::CompactIndexHeader>(path)) {
-            indices.push_back(
-                std::make_shared<cobs::CompactIndexMMapSearchFile>(path));
-        }
-        else
-            die("Could not open index path \"" << path << "\"");
+    if (!server.empty()) {
+        if (query.empty())
+            die("--server mode needs a verbatim query");
+        return query_server(server, threshold, num_results, query);
     }
 
+    std::vector<std::shared_ptr<cobs::IndexSearchFile> > indices =
+        open_indices(index_files, mmap_policy, page_cache_bytes);
     cobs::ClassicSearch s(indices);
-    process_query(s, threshold, num_results, query, query_file);
+
+    if (streaming) {
+        if (query_file.empty())
+            die("--streaming needs a query --file");
+        uint32_t max_term_size = 0;
+        for (const auto& index : indices)
+            max_term_size = std::max(max_term_size, index->term_size());
+        process_query_streaming(
+            s, threshold, num_results, query_file, max_term_size);
+    }
+    else {
+        process_query(s, threshold, num_results, query, query_file,
+                      ResultWriter::parse_format(output_format));
+    }
 
     return 0;
 }
@@ -547,21 +1792,158 @@ int print_parameters(int argc, char** argv) {
         'n', "num-elements", num_elements,
         "number of elements to be inserted into the index");
 
+    uint64_t num_documents = 0;
+    cp.add_bytes(
+        'd', "num-documents", num_documents,
+        "number of documents in the collection; enables the planner "
+        "which estimates index size, construction I/O and query cost");
+
+    uint64_t avg_doc_kmers = 0;
+    cp.add_bytes(
+        "avg-doc-kmers", avg_doc_kmers,
+        "average number of distinct k-mers per document, "
+        "default: num-elements / num-documents");
+
+    uint64_t max_doc_kmers = 0;
+    cp.add_bytes(
+        "max-doc-kmers", max_doc_kmers,
+        "number of distinct k-mers in the largest document, which "
+        "determines the signature size, default: avg-doc-kmers");
+
+    unsigned term_size = 31;
+    cp.add_unsigned(
+        'k', "term-size", term_size,
+        "term size (k-mer size), default: 31");
+
+    uint64_t query_length = 10000;
+    cp.add_bytes(
+        'q', "query-length", query_length,
+        "target query length in bases for the per-query cost "
+        "estimates, default: 10000");
+
+    uint64_t page_size = 0;
+    cp.add_bytes(
+        "page-size", page_size,
+        "documents per page; also estimate a compact index with "
+        "per-page signature sizes");
+
+    uint64_t mem_bandwidth = 8 * 1024 * 1024 * 1024llu;
+    cp.add_bytes(
+        "mem-bandwidth", mem_bandwidth,
+        "memory gather bandwidth in bytes/s for the memory-resident "
+        "latency estimate, measure with benchmark-query on a small "
+        "index, default: 8Gi");
+
+    uint64_t disk_bandwidth = 500 * 1024 * 1024llu;
+    cp.add_bytes(
+        "disk-bandwidth", disk_bandwidth,
+        "storage read bandwidth in bytes/s for the cold latency "
+        "estimate, default: 500Mi");
+
     if (!cp.sort().process(argc, argv))
         return -1;
 
-    if (num_elements == 0) {
-        double signature_size_ratio =
-            cobs::calc_signature_size_ratio(num_hashes, false_positive_rate);
-        std::cout << signature_size_ratio << '\n';
+    if (num_documents == 0) {
+        if (num_elements == 0) {
+            double signature_size_ratio =
+                cobs::calc_signature_size_ratio(num_hashes, false_positive_rate);
+            std::cout << signature_size_ratio << '\n';
+        }
+        else {
+            uint64_t signature_size =
+                cobs::calc_signature_size(num_elements, num_hashes, false_positive_rate);
+            std::cout << "signature_size = " << signature_size << '\n';
+            std::cout << "signature_bytes = " << signature_size / 8
+                      << " = " << tlx::format_iec_units(signature_size / 8)
+                      << '\n';
+        }
+
+        return 0;
     }
-    else {
-        uint64_t signature_size =
-            cobs::calc_signature_size(num_elements, num_hashes, false_positive_rate);
-        std::cout << "signature_size = " << signature_size << '\n';
-        std::cout << "signature_bytes = " << signature_size / 8
-                  << " = " << tlx::format_iec_units(signature_size / 8)
+
+    /*
+     * planner mode: predict index size, construction I/O and query cost
+     * analytically from the collection shape, so num_hashes, the false
+     * positive rate and page_size can be chosen without trial builds.
+     */
+
+    if (avg_doc_kmers == 0 && num_elements != 0)
+        avg_doc_kmers = num_elements / num_documents;
+    if (avg_doc_kmers == 0)
+        die("print-parameters: planner needs --avg-doc-kmers "
+            "or --num-elements");
+    if (max_doc_kmers == 0)
+        max_doc_kmers = avg_doc_kmers;
+
+    // the signature must hold the largest document at the target fpr
+    uint64_t signature_size = cobs::calc_signature_size(
+        max_doc_kmers, num_hashes, false_positive_rate);
+    uint64_t row_size = (num_documents + 7) / 8;
+    uint64_t index_bytes = signature_size * row_size;
+
+    std::cout << "signature_size = " << signature_size << '\n';
+    std::cout << "row_size = " << row_size
+              << " = " << tlx::format_iec_units(row_size) << '\n';
+    std::cout << "index_bytes = " << index_bytes
+              << " = " << tlx::format_iec_units(index_bytes) << '\n';
+
+    // construction streams the k-mer docs once, writes the batch
+    // indices, and reads them back while writing the combined index
+    uint64_t doc_bytes = num_documents * avg_doc_kmers * 8;
+    uint64_t construction_io = doc_bytes + 3 * index_bytes;
+    std::cout << "construction_read_bytes = " << doc_bytes + index_bytes
+              << " = " << tlx::format_iec_units(doc_bytes + index_bytes)
+              << '\n';
+    std::cout << "construction_write_bytes = " << 2 * index_bytes
+              << " = " << tlx::format_iec_units(2 * index_bytes) << '\n';
+    std::cout << "construction_io_bytes = " << construction_io
+              << " = " << tlx::format_iec_units(construction_io) << '\n';
+
+    // per-query cost: one row gather per hash of each query term
+    die_unless(query_length >= term_size);
+    uint64_t num_terms = query_length - term_size + 1;
+    uint64_t rows_gathered = num_terms * num_hashes;
+    uint64_t query_bytes = rows_gathered * row_size;
+    std::cout << "query_terms = " << num_terms << '\n';
+    std::cout << "query_bytes_gathered = " << query_bytes
+              << " = " << tlx::format_iec_units(query_bytes) << '\n';
+    std::cout << "query_expected_fp_terms_per_doc = "
+              << num_terms * false_positive_rate << '\n';
+
+    // memory-resident queries stream the gathered rows at memory
+    // bandwidth; cold queries fault whole pages per random row access
+    double warm_ms = 1e3 * query_bytes / mem_bandwidth;
+    uint64_t cold_bytes =
+        rows_gathered * (row_size / 4096 + 1) * 4096;
+    double cold_ms = 1e3 * cold_bytes / disk_bandwidth;
+    std::cout << "query_latency_resident_ms = " << warm_ms << '\n';
+    std::cout << "query_bytes_cold = " << cold_bytes
+              << " = " << tlx::format_iec_units(cold_bytes) << '\n';
+    std::cout << "query_latency_cold_ms = " << cold_ms << '\n';
+
+    if (page_size != 0) {
+        // compact index: each page of page_size documents gets its own
+        // signature sized for its largest member; assuming documents
+        // are sorted by size, page maxima average out near the overall
+        // average, with only the last page near the global maximum
+        uint64_t num_pages = (num_documents + page_size - 1) / page_size;
+        uint64_t page_row = (page_size + 7) / 8;
+        uint64_t avg_signature_size = cobs::calc_signature_size(
+            avg_doc_kmers, num_hashes, false_positive_rate);
+        uint64_t compact_bytes =
+            (num_pages - 1) * avg_signature_size * page_row
+            + signature_size * page_row;
+        double ratio = (double)compact_bytes / index_bytes;
+        std::cout << "compact_pages = " << num_pages << '\n';
+        std::cout << "compact_index_bytes = " << compact_bytes
+                  << " = " << tlx::format_iec_units(compact_bytes)
                   << '\n';
+        std::cout << "compact_query_bytes_gathered = "
+                  << (uint64_t)(query_bytes * ratio)
+                  << " = " << tlx::format_iec_units(
+            (uint64_t)(query_bytes * ratio)) << '\n';
+        std::cout << "compact_query_latency_resident_ms = "
+                  << warm_ms * ratio << '\n';
     }
 
     return 0;
@@ -731,6 +2113,205 @@ int benchmark_fpr(int argc, char** argv) {
 
 /******************************************************************************/
 
+int benchmark_query(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::vector<std::string> index_files;
+    cp.add_param_stringlist(
+        "index", index_files, "path to index file(s)");
+
+    std::string query_file;
+    cp.add_string(
+        'f', "file", query_file,
+        "file with one query sequence per line (FASTA headers and "
+        "comments are skipped); default: random queries");
+
+    unsigned num_kmers = 1000;
+    cp.add_unsigned(
+        'k', "num-kmers", num_kmers,
+        "number of kmers of each random query, "
+        "default: " + std::to_string(num_kmers));
+
+    unsigned num_queries = 1000;
+    cp.add_unsigned(
+        'q', "queries", num_queries,
+        "number of timed queries to run, "
+        "default: " + std::to_string(num_queries));
+
+    unsigned num_warmup = 100;
+    cp.add_unsigned(
+        'w', "warmup", num_warmup,
+        "number of untimed warmup queries to run, "
+        "default: " + std::to_string(num_warmup));
+
+    unsigned concurrency = 1;
+    cp.add_unsigned(
+        'C', "concurrency", concurrency,
+        "number of client threads issuing queries, default: 1");
+
+    double threshold = 0.0;
+    cp.add_double(
+        't', "threshold", threshold,
+        "threshold in percentage of terms in query matching, default: 0.0");
+
+    unsigned num_results = 0;
+    cp.add_unsigned(
+        'l', "limit", num_results,
+        "number of results to return, default: all");
+
+    cp.add_size_t(
+        'T', "threads", cobs::gopt_threads,
+        "number of threads to use, default: max cores");
+    cp.add_flag(
+        "pin-threads", cobs::gopt_pin_threads,
+        "pin pool worker threads to CPU cores, one core per worker");
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
+
+    bool json = false;
+    cp.add_flag(
+        'j', "json", json,
+        "print the report as one JSON object for regression tracking");
+
+    size_t seed = std::random_device { } ();
+    cp.add_size_t("seed", seed, "random seed");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    // assemble the workload: queries from the file, or random sequences
+    std::vector<std::string> queries;
+    if (!query_file.empty()) {
+        std::ifstream is(query_file);
+        die_unless(is.good());
+        std::string line;
+        while (std::getline(is, line)) {
+            if (line.empty() || line[0] == '>' ||
+                line[0] == ';' || line[0] == '#')
+                continue;
+            queries.push_back(line);
+        }
+        if (queries.empty())
+            die("benchmark-query: no queries in " << query_file);
+        if (queries.size() > num_queries)
+            queries.resize(num_queries);
+    }
+    else {
+        std::mt19937 rng(seed);
+        for (size_t i = 0; i < num_queries; i++) {
+            queries.push_back(
+                cobs::random_sequence_rng(num_kmers + 30, rng));
+        }
+    }
+
+    std::vector<std::shared_ptr<cobs::IndexSearchFile> > indices =
+        open_indices(index_files, cobs::MMapPolicy(),
+                     /* page_cache_bytes */ 0);
+    cobs::ClassicSearch s(indices);
+
+    // untimed warmup round-robin over the workload
+    std::vector<cobs::SearchResult> result;
+    for (size_t i = 0; i < num_warmup; i++) {
+        s.search(queries[i % queries.size()], result,
+                 threshold, num_results);
+    }
+    s.timer().reset();
+    for (const auto& index : indices)
+        index->bytes_gathered_ = 0;
+
+    // timed phase: client threads pull queries from a shared counter and
+    // record per-query latency
+    std::vector<double> latencies(queries.size());
+    std::atomic<size_t> next_query { 0 };
+    auto wall_begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (size_t c = 0; c < std::max(1u, concurrency); ++c) {
+        clients.emplace_back([&]() {
+            std::vector<cobs::SearchResult> client_result;
+            for ( ; ; ) {
+                size_t i = next_query.fetch_add(1);
+                if (i >= queries.size())
+                    break;
+                auto begin = std::chrono::steady_clock::now();
+                s.search(queries[i], client_result,
+                         threshold, num_results);
+                latencies[i] = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - begin).count();
+            }
+        });
+    }
+    for (std::thread& c : clients)
+        c.join();
+    double wall = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall_begin).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile =
+        [&](double p) {
+            return latencies[size_t(p * (latencies.size() - 1) + 0.5)];
+        };
+    uint64_t bytes_gathered = 0;
+    for (const auto& index : indices)
+        bytes_gathered += index->bytes_gathered_.load();
+    double qps = queries.size() / wall;
+
+    if (json) {
+        // strip the timer object's newline so it embeds as one member
+        std::ostringstream timer_json;
+        s.timer().print_json("search", timer_json);
+        std::string timer_str = timer_json.str();
+        while (!timer_str.empty() && timer_str.back() == '\n')
+            timer_str.pop_back();
+
+        std::ostringstream os;
+        std::streamsize precision = os.precision(9);
+        os << "{\"benchmark\":\"query\""
+           << ",\"index\":\"" << index_files.front() << "\""
+           << ",\"queries\":" << queries.size()
+           << ",\"warmup\":" << num_warmup
+           << ",\"concurrency\":" << std::max(1u, concurrency)
+           << ",\"threads\":" << cobs::gopt_threads
+           << ",\"wall_s\":" << wall
+           << ",\"qps\":" << qps
+           << ",\"p50_ms\":" << percentile(0.50) * 1e3
+           << ",\"p95_ms\":" << percentile(0.95) * 1e3
+           << ",\"p99_ms\":" << percentile(0.99) * 1e3
+           << ",\"bytes_gathered\":" << bytes_gathered
+           << ",\"timer\":" << timer_str
+           << "}";
+        os.precision(precision);
+        std::cout << os.str() << std::endl;
+    }
+    else {
+        cobs::Timer t = s.timer();
+        std::cout << "RESULT"
+                  << " name=benchmark_query"
+                  << " index=" << index_files.front()
+                  << " queries=" << queries.size()
+                  << " warmup=" << num_warmup
+                  << " concurrency=" << std::max(1u, concurrency)
+                  << " threads=" << cobs::gopt_threads
+                  << " wall=" << wall
+                  << " qps=" << qps
+                  << " p50_ms=" << percentile(0.50) * 1e3
+                  << " p95_ms=" << percentile(0.95) * 1e3
+                  << " p99_ms=" << percentile(0.99) * 1e3
+                  << " bytes_gathered=" << bytes_gathered
+                  << " t_hashes=" << t.get("hashes")
+                  << " t_io=" << t.get("io")
+                  << " t_and=" << t.get("and+add rows")
+                  << " t_add=" << t.get("add rows")
+                  << " t_sort=" << t.get("sort results")
+                  << std::endl;
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
+
 int generate_queries(int argc, char** argv) {
     tlx::CmdlineParser cp;
 
@@ -746,6 +2327,13 @@ int generate_queries(int argc, char** argv) {
     cp.add_size_t(
         'T', "threads", cobs::gopt_threads,
         "number of threads to use, default: max cores");
+    cp.add_flag(
+        "pin-threads", cobs::gopt_pin_threads,
+        "pin pool worker threads to CPU cores, one core per worker");
+    cp.add_string(
+        "trace", cobs::gopt_trace_file,
+        "write a chrome://tracing JSON timeline of all timer scopes to "
+        "this file (needs a build with COBS_USE_TRACING)");
 
     unsigned term_size = 31;
     cp.add_unsigned(
@@ -980,10 +2568,34 @@ struct SubTool subtools[] = {
         "classic-construct", &classic_construct, true,
         "constructs a classic index from the documents in <in_dir>"
     },
+    {
+        "classic-append", &classic_append, true,
+        "appends new documents to an existing classic index"
+    },
+    {
+        "classic-merge", &classic_merge, true,
+        "merges classic index parts listed in a manifest into one index"
+    },
+    {
+        "classic-union", &classic_union, true,
+        "unions complete classic indexes into one searchable index"
+    },
+    {
+        "classic-compress", &classic_compress, true,
+        "rewrites a classic index with zstd-compressed row blocks"
+    },
+    {
+        "classic-sparsify", &classic_sparsify, true,
+        "rewrites a classic index with the hybrid sparse row encoding"
+    },
     {
         "classic-construct-random", &classic_construct_random, true,
         "constructs a classic index with random content"
     },
+    {
+        "make-shards", &make_shards, true,
+        "writes a .cobs_shards manifest opening indexes as one logical index"
+    },
     {
         "compact-construct", &compact_construct, true,
         "creates the folders used for further construction"
@@ -996,9 +2608,13 @@ struct SubTool subtools[] = {
         "query", &query, true,
         "query an index"
     },
+    {
+        "serve", &serve, true,
+        "answer queries over a socket with a warm index"
+    },
     {
         "print-parameters", &print_parameters, true,
-        "calculates index parameters"
+        "calculates index parameters and estimates index and query costs"
     },
     {
         "print-kmers", &print_kmers, true,
@@ -1008,6 +2624,10 @@ struct SubTool subtools[] = {
         "benchmark-fpr", &benchmark_fpr, true,
         "run benchmark and false positive measurement"
     },
+    {
+        "benchmark-query", &benchmark_query, true,
+        "measure end-to-end query latency percentiles and throughput"
+    },
     {
         "generate-queries", &generate_queries, true,
         "select queries randomly from documents"
@@ -1068,7 +2688,9 @@ int main(int argc, char** argv) {
             snprintf(progsub, sizeof(progsub), "%s %s", argv[0], argv[1]);
             argv[1] = progsub;
             try {
-                return subtools[i].func(argc - 1, argv + 1);
+                int result = subtools[i].func(argc - 1, argv + 1);
+                cobs::trace_write();
+                return result;
             }
             catch (std::exception& e) {
                 std::cerr << "EXCEPTION: " << e.what() << std::endl;
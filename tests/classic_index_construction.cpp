@@ -8,6 +8,7 @@
 
 #include "test_util.hpp"
 #include <cobs/query/classic_index/mmap_search_file.hpp>
+#include <cobs/query/classic_index/zstd_search_file.hpp>
 #include <cobs/util/calc_signature_size.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
@@ -92,6 +93,323 @@ TEST_F(classic_index_construction, deserialization) {
     }
 }
 
+TEST_F(classic_index_construction, adaptive_size_classes) {
+    using cobs::pad_index;
+    // generate documents of two very different sizes
+    std::string query = cobs::random_sequence(10000, 1);
+    auto small_docs = generate_documents_all(
+        query, /* num_documents */ 4, /* num_terms */ 100);
+    generate_test_case(small_docs, /* prefix */ "small_", input_dir);
+    auto large_docs = generate_documents_all(
+        query, /* num_documents */ 4, /* num_terms */ 8000);
+    generate_test_case(large_docs, /* prefix */ "large_", input_dir);
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+
+    cobs::classic_construct_adaptive(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+
+    // the size gap must yield two class indexes with different signature
+    // sizes, the small one smaller than the large one
+    fs::path small_index = base_dir / "index_00.cobs_classic";
+    fs::path large_index = base_dir / "index_01.cobs_classic";
+    ASSERT_TRUE(fs::exists(small_index));
+    ASSERT_TRUE(fs::exists(large_index));
+
+    auto h0 = cobs::deserialize_header<cobs::ClassicIndexHeader>(small_index);
+    auto h1 = cobs::deserialize_header<cobs::ClassicIndexHeader>(large_index);
+    ASSERT_EQ(h0.file_names_.size(), 4u);
+    ASSERT_EQ(h1.file_names_.size(), 4u);
+    ASSERT_LT(h0.signature_size_, h1.signature_size_);
+
+    // querying both indexes together finds every document
+    cobs::ClassicSearch s_base(
+        { std::make_shared<cobs::ClassicIndexMMapSearchFile>(small_index),
+          std::make_shared<cobs::ClassicIndexMMapSearchFile>(large_index) });
+
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    ASSERT_EQ(small_docs.size() + large_docs.size(), result.size());
+}
+
+TEST_F(classic_index_construction, append) {
+    // construct a base index from an initial document set
+    std::string query = cobs::random_sequence(10000, 1);
+    auto base_docs = generate_documents_all(
+        query, /* num_documents */ 9, /* num_terms */ 1000);
+    generate_test_case(base_docs, /* prefix */ "base_", input_dir);
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+
+    // append a second document set built from another sequence
+    std::string query2 = cobs::random_sequence(10000, 2);
+    auto new_docs = generate_documents_all(
+        query2, /* num_documents */ 7, /* num_terms */ 1000);
+    fs::path new_input = base_dir / "input_new";
+    generate_test_case(new_docs, /* prefix */ "new_", new_input);
+
+    fs::path appended = base_dir / "appended.cobs_classic";
+    cobs::ClassicIndexParameters append_params;
+    cobs::classic_append(
+        cobs::DocumentList(new_input), index_file, appended,
+        base_dir / "tmp_append", append_params);
+
+    // the appended index holds both sets with unchanged parameters
+    auto h0 = cobs::deserialize_header<cobs::ClassicIndexHeader>(index_file);
+    auto h1 = cobs::deserialize_header<cobs::ClassicIndexHeader>(appended);
+    ASSERT_EQ(h1.file_names_.size(), base_docs.size() + new_docs.size());
+    ASSERT_EQ(h0.signature_size_, h1.signature_size_);
+    ASSERT_EQ(h0.num_hashes_, h1.num_hashes_);
+
+    // documents of both sets must be findable by their source sequence
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(appended));
+    std::vector<cobs::SearchResult> result;
+
+    s_base.search(query, result);
+    ASSERT_EQ(base_docs.size() + new_docs.size(), result.size());
+    bool found = false;
+    for (auto& r : result) {
+        if (std::string(r.doc_name) == "base_document_00") {
+            ASSERT_GE(r.score, base_docs[0].data().size());
+            found = true;
+        }
+    }
+    ASSERT_TRUE(found);
+
+    s_base.search(query2, result);
+    found = false;
+    for (auto& r : result) {
+        if (std::string(r.doc_name) == "new_document_00") {
+            ASSERT_GE(r.score, new_docs[0].data().size());
+            found = true;
+        }
+    }
+    ASSERT_TRUE(found);
+}
+
+TEST_F(classic_index_construction, partitioned_merge) {
+    // construct partial indexes as two distributed jobs over the same
+    // document list would, then merge them
+    std::string query = cobs::random_sequence(10000, 1);
+    auto documents = generate_documents_all(
+        query, /* num_documents */ 24, /* num_terms */ 1000);
+    generate_test_case(documents, input_dir.string());
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.num_threads = 1;
+    // small memory forces several batches, so both partitions get work
+    index_params.mem_bytes = 2000;
+    index_params.partition_count = 2;
+
+    std::vector<fs::path> part_files = {
+        base_dir / "part_0.cobs_classic",
+        base_dir / "part_1.cobs_classic"
+    };
+    for (size_t p = 0; p < 2; ++p) {
+        index_params.partition_index = p;
+        cobs::classic_construct(
+            cobs::DocumentList(input_dir), part_files[p],
+            base_dir / ("tmp_part_" + std::to_string(p)), index_params);
+    }
+
+    // the partitions are disjoint and cover all documents
+    auto hp0 = cobs::deserialize_header<cobs::ClassicIndexHeader>(
+        part_files[0]);
+    auto hp1 = cobs::deserialize_header<cobs::ClassicIndexHeader>(
+        part_files[1]);
+    ASSERT_EQ(hp0.file_names_.size() + hp1.file_names_.size(),
+              documents.size());
+    ASSERT_EQ(hp0.signature_size_, hp1.signature_size_);
+
+    cobs::ClassicIndexParameters merge_params;
+    cobs::classic_merge(
+        part_files, index_file, base_dir / "tmp_merge", merge_params);
+
+    auto h = cobs::deserialize_header<cobs::ClassicIndexHeader>(index_file);
+    ASSERT_EQ(h.file_names_.size(), documents.size());
+    ASSERT_EQ(h.signature_size_, hp0.signature_size_);
+
+    // document_00 contains every query term and must score fully,
+    // whichever partition it was built in
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_file));
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    ASSERT_EQ(documents.size(), result.size());
+    bool found = false;
+    for (auto& r : result) {
+        if (std::string(r.doc_name) == "document_00") {
+            ASSERT_GE(r.score, documents[0].data().size());
+            found = true;
+        }
+    }
+    ASSERT_TRUE(found);
+}
+
+TEST_F(classic_index_construction, doc_densities) {
+    // generate and construct classic index
+    std::string query = cobs::random_sequence(10000, 1);
+    auto documents = generate_documents_all(query, /* num_documents */ 33);
+    generate_test_case(documents, input_dir.string());
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.3;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+
+    // the stored densities must match a manual count of the payload
+    cobs::ClassicIndexHeader h;
+    std::vector<uint8_t> data;
+    h.read_file(index_file, data);
+    ASSERT_EQ(h.doc_densities_.size(), h.file_names_.size());
+
+    std::vector<uint64_t> ones(h.row_bits());
+    for (size_t p = 0; p < data.size(); ++p) {
+        for (size_t k = 0; k < 8; ++k) {
+            if (data[p] & (uint8_t(1) << k))
+                ++ones[8 * (p % h.row_size()) + k];
+        }
+    }
+    for (size_t j = 0; j < ones.size(); ++j) {
+        ASSERT_DOUBLE_EQ(h.doc_densities_[j],
+                         static_cast<double>(ones[j]) / h.signature_size_);
+        ASSERT_GT(h.doc_densities_[j], 0.0);
+    }
+
+    // calibrated scores never exceed the raw counts and document_0, which
+    // contains every query term, keeps the top rank
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_file));
+    std::vector<cobs::SearchResult> raw, cal;
+    s_base.search(query, raw);
+    cobs::gopt_calibrate_scores = true;
+    s_base.search(query, cal);
+    cobs::gopt_calibrate_scores = false;
+
+    std::map<std::string, uint32_t> raw_scores;
+    for (auto& r : raw)
+        raw_scores[r.doc_name] = r.score;
+    ASSERT_EQ(cal.size(), raw.size());
+    for (auto& r : cal) {
+        ASSERT_LE(r.score, raw_scores.at(r.doc_name));
+    }
+    ASSERT_EQ(std::string(cal.front().doc_name),
+              "document_" + cobs::pad_index(0));
+}
+
+TEST_F(classic_index_construction, sparsify) {
+    // generate and construct classic index
+    std::string query = cobs::random_sequence(10000, 1);
+    auto documents = generate_documents_all(query, /* num_documents */ 33);
+    generate_test_case(documents, input_dir.string());
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+
+    // rewrite with the hybrid sparse row encoding
+    fs::path sp_file = base_dir / "index_sparse.cobs_classic";
+    cobs::classic_sparsify(index_file, sp_file);
+
+    cobs::ClassicIndexHeader h =
+        cobs::deserialize_header<cobs::ClassicIndexHeader>(sp_file);
+    die_unequal(unsigned(h.sparse_rows_), 1u);
+
+    // query results through the sparse encoding match the raw index
+    auto raw_idx =
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_file);
+    auto sp_idx =
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(sp_file);
+    cobs::ClassicSearch s_raw(raw_idx), s_sp(sp_idx);
+
+    std::vector<cobs::SearchResult> result_raw, result_sp;
+    for (size_t i = 0; i < 100; i += 10) {
+        s_raw.search(query.substr(i, 500), result_raw);
+        s_sp.search(query.substr(i, 500), result_sp);
+        ASSERT_EQ(result_raw.size(), result_sp.size());
+        for (size_t r = 0; r < result_raw.size(); ++r) {
+            ASSERT_EQ(result_raw[r].doc_name, result_sp[r].doc_name);
+            ASSERT_EQ(result_raw[r].score, result_sp[r].score);
+        }
+    }
+}
+
+#if defined(COBS_HAVE_ZSTD)
+TEST_F(classic_index_construction, compress) {
+    // generate and construct classic index
+    std::string query = cobs::random_sequence(10000, 1);
+    auto documents = generate_documents_all(query, /* num_documents */ 33);
+    generate_test_case(documents, input_dir.string());
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+
+    // rewrite with compressed row blocks
+    fs::path zst_file = base_dir / "index_zstd.cobs_classic";
+    cobs::classic_compress(index_file, zst_file, /* block_size */ 4096);
+
+    cobs::ClassicIndexHeader h =
+        cobs::deserialize_header<cobs::ClassicIndexHeader>(zst_file);
+    die_unless(h.block_rows_ != 0);
+
+    // both backends must gather identical rows
+    auto raw_idx =
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_file);
+    auto zst_idx =
+        std::make_shared<cobs::ClassicIndexZstdSearchFile>(zst_file);
+
+    cobs::IndexSearchFile& raw_ref = *raw_idx;
+    cobs::IndexSearchFile& zst_ref = *zst_idx;
+
+    size_t row_size = h.row_size();
+    std::mt19937 rng(1234);
+    for (size_t iter = 0; iter < 20; ++iter) {
+        std::vector<size_t> hashes(32);
+        for (auto& hv : hashes)
+            hv = rng();
+        std::vector<uint8_t> rows_raw(hashes.size() * row_size);
+        std::vector<uint8_t> rows_zst(hashes.size() * row_size);
+        raw_ref.read_from_disk(hashes, rows_raw.data(), 0, row_size,
+                               row_size);
+        zst_ref.read_from_disk(hashes, rows_zst.data(), 0, row_size,
+                               row_size);
+        ASSERT_EQ(rows_raw, rows_zst);
+    }
+
+    // query results through the compressed backend match the raw index
+    cobs::ClassicSearch s_raw(raw_idx), s_zst(zst_idx);
+    std::vector<cobs::SearchResult> result_raw, result_zst;
+    for (size_t i = 0; i < 100; i += 10) {
+        s_raw.search(query.substr(i, 500), result_raw);
+        s_zst.search(query.substr(i, 500), result_zst);
+        ASSERT_EQ(result_raw.size(), result_zst.size());
+        for (size_t r = 0; r < result_raw.size(); ++r) {
+            ASSERT_EQ(result_raw[r].doc_name, result_zst[r].doc_name);
+            ASSERT_EQ(result_raw[r].score, result_zst[r].score);
+        }
+    }
+}
+#endif // defined(COBS_HAVE_ZSTD)
+
 TEST_F(classic_index_construction, combine) {
     using cobs::pad_index;
     fs::create_directories(index_dir);
@@ -7,10 +7,15 @@
  ******************************************************************************/
 
 #include "test_util.hpp"
+#include <cobs/file/shards_header.hpp>
 #include <cobs/query/classic_index/mmap_search_file.hpp>
 #include <cobs/util/calc_signature_size.hpp>
+#include <cobs/util/file.hpp>
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <random>
 
 namespace fs = cobs::fs;
 
@@ -110,6 +115,331 @@ TEST_F(classic_index_query, one_included_large_batch) {
     }
 }
 
+TEST_F(classic_index_query, one_included_double_hashing) {
+    // generate
+    auto documents = generate_documents_one(query, /* num_documents */ 2000);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index with v2 double hashing and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+    index_params.hash_mode = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    // execute query and check results
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    ASSERT_EQ(documents.size(), result.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+        ASSERT_EQ(result[i].score, 1);
+    }
+}
+
+TEST_F(classic_index_query, all_included_packed_hashing) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index hashing 2-bit packed k-mers and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 2;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    // execute query and check results
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    ASSERT_EQ(documents.size(), result.size());
+    for (auto& r : result) {
+        std::string doc = r.doc_name;
+        int index = std::stoi(doc.substr(doc.size() - 2));
+        ASSERT_GE(r.score, documents[index].data().size());
+    }
+}
+
+TEST_F(classic_index_query, all_included_minimizer_window) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct a minimizer-subsampled classic index and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+    index_params.window_size = 8;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+
+    // the window must be recorded in the header so queries subsample too
+    auto h = cobs::deserialize_header<cobs::ClassicIndexHeader>(index_path);
+    ASSERT_EQ(h.window_size_, 8u);
+
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    // execute query and check results: document 00 contains every query
+    // term, so each of the query's selected minimizers must hit it, and
+    // one minimizer covers at most window_size consecutive windows
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    ASSERT_EQ(documents.size(), result.size());
+    size_t num_windows = query.size() - 31 + 1 - 8 + 1;
+    for (auto& r : result) {
+        std::string doc = r.doc_name;
+        int index = std::stoi(doc.substr(doc.size() - 2));
+        if (index == 0) {
+            ASSERT_GE(r.score, num_windows / 8);
+        }
+    }
+}
+
+TEST_F(classic_index_query, all_included_memory_resident) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index, load it into RAM, and use the zero-copy
+    // scoring path
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+
+    cobs::gopt_load_complete_index = true;
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    // execute query and check results
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    cobs::gopt_load_complete_index = false;
+
+    ASSERT_EQ(documents.size(), result.size());
+    for (auto& r : result) {
+        std::string doc = r.doc_name;
+        int index = std::stoi(doc.substr(doc.size() - 2));
+        ASSERT_GE(r.score, documents[index].data().size());
+    }
+}
+
+TEST_F(classic_index_query, all_included_windowed_pager) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index and query through the windowed mmap pager
+    // with a tiny budget, so cold windows are evicted during the search
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+
+    cobs::MMapPolicy policy;
+    policy.window_size_bytes = 4096;
+    policy.window_budget_bytes = 8 * 4096;
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(
+            index_path, policy));
+
+    // execute query and check results
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    ASSERT_EQ(documents.size(), result.size());
+    for (auto& r : result) {
+        std::string doc = r.doc_name;
+        int index = std::stoi(doc.substr(doc.size() - 2));
+        ASSERT_GE(r.score, documents[index].data().size());
+    }
+}
+
+TEST_F(classic_index_query, subset_query) {
+    // generate
+    auto documents = generate_documents_one(query, /* num_documents */ 2000);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    // reference scores of the whole collection
+    std::vector<cobs::SearchResult> full;
+    s_base.search(query, full);
+    std::map<std::string, uint32_t> full_scores;
+    for (auto& r : full)
+        full_scores[r.doc_name] = r.score;
+
+    // a scattered subset, shuffled and with one duplicate id
+    std::vector<uint32_t> ids;
+    for (uint32_t d = 3; d < documents.size(); d += 17)
+        ids.push_back(d);
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(1));
+    ids.push_back(ids.front());
+
+    std::vector<cobs::SearchResult> result;
+    s_base.search_subset(query, ids, result);
+    ASSERT_EQ(result.size(), ids.size() - 1);
+    for (size_t i = 0; i < result.size(); ++i) {
+        ASSERT_EQ(full_scores.at(result[i].doc_name), result[i].score);
+        if (i != 0) {
+            ASSERT_GE(result[i - 1].score, result[i].score);
+        }
+    }
+}
+
+TEST_F(classic_index_query, duplicate_kmer_query) {
+    // generate
+    auto documents = generate_documents_one(query, /* num_documents */ 100);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    // a homopolymer query: all ten terms are the same canonical k-mer, so
+    // the deduplicated term must be weighted with multiplicity ten and each
+    // score is all-or-nothing
+    std::string homopolymer(31 + 9, 'A');
+    std::vector<cobs::SearchResult> result;
+    s_base.search(homopolymer, result);
+    ASSERT_EQ(documents.size(), result.size());
+    for (auto& r : result) {
+        ASSERT_TRUE(r.score == 0 || r.score == 10);
+    }
+}
+
+TEST_F(classic_index_query, chunked_matches_wide_kernels) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    // the query exceeds 255 terms, so the default search takes the
+    // chunked 8-bit path; disabling the 8-bit kernels forces the 16-bit
+    // path, and both must produce identical scores
+    std::vector<cobs::SearchResult> result_chunked, result_wide;
+    s_base.search(query, result_chunked);
+
+    cobs::classic_search_disable_8bit = true;
+    s_base.search(query, result_wide);
+    cobs::classic_search_disable_8bit = false;
+
+    ASSERT_EQ(result_wide.size(), result_chunked.size());
+    for (size_t i = 0; i < result_wide.size(); ++i) {
+        ASSERT_STREQ(result_wide[i].doc_name, result_chunked[i].doc_name);
+        ASSERT_EQ(result_wide[i].score, result_chunked[i].score);
+    }
+}
+
+TEST_F(classic_index_query, search_batch) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    // batch of overlapping queries sharing many canonical k-mers
+    std::vector<std::string> queries;
+    queries.push_back(query.substr(0, 1000));
+    queries.push_back(query.substr(500, 1000));
+    queries.push_back(query.substr(0, 1000));
+    queries.push_back(cobs::random_sequence(200, 3));
+
+    std::vector<std::vector<cobs::SearchResult> > batch_results;
+    s_base.search_batch(queries, batch_results);
+    ASSERT_EQ(queries.size(), batch_results.size());
+
+    // batch results must match per-query searches exactly
+    for (size_t q = 0; q < queries.size(); ++q) {
+        std::vector<cobs::SearchResult> result;
+        s_base.search(queries[q], result);
+        ASSERT_EQ(result.size(), batch_results[q].size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            ASSERT_STREQ(result[i].doc_name, batch_results[q][i].doc_name);
+            ASSERT_EQ(result[i].score, batch_results[q][i].score);
+        }
+    }
+}
+
+TEST_F(classic_index_query, top_k_results) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    // full ranking and bounded top-k must agree on the leading results
+    std::vector<cobs::SearchResult> full_result, top_result;
+    s_base.search(query, full_result);
+    s_base.search(query, top_result, /* threshold */ 0.0,
+                  /* num_results */ 5);
+    ASSERT_EQ(top_result.size(), 5u);
+    for (size_t i = 0; i < top_result.size(); ++i) {
+        ASSERT_STREQ(full_result[i].doc_name, top_result[i].doc_name);
+        ASSERT_EQ(full_result[i].score, top_result[i].score);
+    }
+}
+
 TEST_F(classic_index_query, false_positive) {
     // generate
     auto documents = generate_documents_all(query);
@@ -196,4 +526,54 @@ TEST_F(classic_index_query, one_included_large_batch_multi_index) {
     }
 }
 
+TEST_F(classic_index_query, shards_manifest) {
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    // generate two shard indexes
+    auto documents1 = generate_documents_one(query, /* documents */ 33);
+    generate_test_case(documents1, input1_dir.string());
+
+    cobs::classic_construct(
+        cobs::DocumentList(input1_dir), index1_path, tmp_path, index_params);
+
+    auto documents2 = generate_documents_one(query, /* documents */ 44);
+    generate_test_case(documents2, input2_dir.string());
+
+    cobs::classic_construct(
+        cobs::DocumentList(input2_dir), index2_path, tmp_path, index_params);
+
+    // write a manifest with members relative to the manifest directory
+    fs::path manifest_path = base_dir / "index.cobs_shards";
+    cobs::ShardsHeader sh =
+        cobs::ShardsHeader::scan({ index1_path, index2_path });
+    ASSERT_EQ(2u, sh.shards_.size());
+    ASSERT_EQ(33u + 44u, sh.num_documents());
+    for (auto& s : sh.shards_)
+        s.path_ = fs::path(s.path_).filename().string();
+    cobs::serialize_header(manifest_path, sh);
+
+    // opening the manifest matches explicitly opened members
+    cobs::ClassicSearch s_manifest(manifest_path.string());
+    ASSERT_EQ(2u, s_manifest.index_files().size());
+
+    cobs::ClassicSearch s_explicit(
+        std::vector<std::shared_ptr<cobs::IndexSearchFile> >{
+            std::make_shared<cobs::ClassicIndexMMapSearchFile>(index1_path),
+            std::make_shared<cobs::ClassicIndexMMapSearchFile>(index2_path)
+        });
+
+    std::vector<cobs::SearchResult> result1, result2;
+    s_manifest.search(query, result1);
+    s_explicit.search(query, result2);
+    ASSERT_EQ(result2.size(), result1.size());
+    for (size_t i = 0; i < result1.size(); ++i) {
+        ASSERT_EQ(std::string(result2[i].doc_name),
+                  std::string(result1[i].doc_name));
+        ASSERT_EQ(result2[i].score, result1[i].score);
+    }
+}
+
 /******************************************************************************/
@@ -57,6 +57,54 @@ TEST_F(compact_index_construction, padding) {
     ASSERT_EQ(sp.curr_pos % index_params.page_size, 0U);
 }
 
+TEST_F(compact_index_construction, aligned_pages) {
+    // generate
+    auto documents = generate_documents_all(query, /* num_documents */ 200);
+    generate_test_case(documents, input_dir.string());
+
+    // construct compact index padded to OS page multiples
+    cobs::CompactIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.page_size = 16;
+    index_params.aligned_pages = true;
+
+    cobs::compact_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+
+    // payload and every subindex start on an OS page boundary
+    std::ifstream ifs;
+    cobs::CompactIndexHeader h =
+        cobs::deserialize_header<cobs::CompactIndexHeader>(ifs, index_file);
+    ASSERT_EQ(h.payload_alignment_, cobs::get_page_size());
+    cobs::StreamPos sp = cobs::get_stream_pos(ifs);
+    ASSERT_EQ(sp.curr_pos % cobs::get_page_size(), 0U);
+    for (size_t i = 0; i < h.parameters_.size(); i++) {
+        ASSERT_EQ(h.padded_subindex_size(i) % cobs::get_page_size(), 0U);
+    }
+
+    // query results match an unpadded index of the same documents
+    fs::path plain_file = base_dir / "index_plain.cobs_compact";
+    index_params.aligned_pages = false;
+    cobs::compact_construct(
+        cobs::DocumentList(input_dir), plain_file, tmp_path, index_params);
+
+    cobs::ClassicSearch s_aligned(
+        std::make_shared<cobs::CompactIndexMMapSearchFile>(index_file));
+    cobs::ClassicSearch s_plain(
+        std::make_shared<cobs::CompactIndexMMapSearchFile>(plain_file));
+
+    std::vector<cobs::SearchResult> result_aligned, result_plain;
+    s_aligned.search(query, result_aligned);
+    s_plain.search(query, result_plain);
+    ASSERT_EQ(result_plain.size(), result_aligned.size());
+    for (size_t i = 0; i < result_aligned.size(); i++) {
+        ASSERT_EQ(std::string(result_plain[i].doc_name),
+                  std::string(result_aligned[i].doc_name));
+        ASSERT_EQ(result_plain[i].score, result_aligned[i].score);
+    }
+}
+
 TEST_F(compact_index_construction, deserialization) {
     // generate
     auto documents = generate_documents_all(query);
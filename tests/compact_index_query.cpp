@@ -58,6 +58,62 @@ TEST_F(compact_index_query, all_included_mmap_small) {
         cobs::classic_search_disable_16bit = true;
         cobs::classic_search_disable_32bit = true;
         cobs::classic_search_disable_sse2 = true;
+        cobs::classic_search_disable_avx2 = true;
+        cobs::classic_search_disable_avx512 = true;
+
+        std::vector<cobs::SearchResult> result;
+        s_base.search(query, result);
+        ASSERT_EQ(documents.size(), result.size());
+        for (auto& r : result) {
+            std::string doc_name = r.doc_name;
+            int index = std::stoi(doc_name.substr(doc_name.size() - 2));
+            ASSERT_GE(r.score, documents[index].data().size());
+        }
+    }
+    {
+        // 8-bit SSE
+        cobs::classic_search_disable_8bit = false;
+        cobs::classic_search_disable_16bit = true;
+        cobs::classic_search_disable_32bit = true;
+        cobs::classic_search_disable_sse2 = false;
+        cobs::classic_search_disable_avx2 = true;
+        cobs::classic_search_disable_avx512 = true;
+
+        std::vector<cobs::SearchResult> result;
+        s_base.search(query, result);
+        ASSERT_EQ(documents.size(), result.size());
+        for (auto& r : result) {
+            std::string doc_name = r.doc_name;
+            int index = std::stoi(doc_name.substr(doc_name.size() - 2));
+            ASSERT_GE(r.score, documents[index].data().size());
+        }
+    }
+    {
+        // 8-bit AVX2 (falls back if unsupported)
+        cobs::classic_search_disable_8bit = false;
+        cobs::classic_search_disable_16bit = true;
+        cobs::classic_search_disable_32bit = true;
+        cobs::classic_search_disable_sse2 = false;
+        cobs::classic_search_disable_avx2 = false;
+        cobs::classic_search_disable_avx512 = true;
+
+        std::vector<cobs::SearchResult> result;
+        s_base.search(query, result);
+        ASSERT_EQ(documents.size(), result.size());
+        for (auto& r : result) {
+            std::string doc_name = r.doc_name;
+            int index = std::stoi(doc_name.substr(doc_name.size() - 2));
+            ASSERT_GE(r.score, documents[index].data().size());
+        }
+    }
+    {
+        // 8-bit AVX-512 (falls back if unsupported)
+        cobs::classic_search_disable_8bit = false;
+        cobs::classic_search_disable_16bit = true;
+        cobs::classic_search_disable_32bit = true;
+        cobs::classic_search_disable_sse2 = false;
+        cobs::classic_search_disable_avx2 = false;
+        cobs::classic_search_disable_avx512 = false;
 
         std::vector<cobs::SearchResult> result;
         s_base.search(query, result);
@@ -94,6 +150,8 @@ TEST_F(compact_index_query, all_included_mmap) {
         cobs::classic_search_disable_16bit = false;
         cobs::classic_search_disable_32bit = true;
         cobs::classic_search_disable_sse2 = true;
+        cobs::classic_search_disable_avx2 = true;
+        cobs::classic_search_disable_avx512 = true;
 
         std::vector<cobs::SearchResult> result;
         s_base.search(query, result);
@@ -110,6 +168,8 @@ TEST_F(compact_index_query, all_included_mmap) {
         cobs::classic_search_disable_16bit = false;
         cobs::classic_search_disable_32bit = true;
         cobs::classic_search_disable_sse2 = false;
+        cobs::classic_search_disable_avx2 = true;
+        cobs::classic_search_disable_avx512 = true;
 
         std::vector<cobs::SearchResult> result;
         s_base.search(query, result);
@@ -126,6 +186,8 @@ TEST_F(compact_index_query, all_included_mmap) {
         cobs::classic_search_disable_16bit = true;
         cobs::classic_search_disable_32bit = false;
         cobs::classic_search_disable_sse2 = true;
+        cobs::classic_search_disable_avx2 = true;
+        cobs::classic_search_disable_avx512 = true;
 
         std::vector<cobs::SearchResult> result;
         s_base.search(query, result);
@@ -142,6 +204,80 @@ TEST_F(compact_index_query, all_included_mmap) {
         cobs::classic_search_disable_16bit = true;
         cobs::classic_search_disable_32bit = false;
         cobs::classic_search_disable_sse2 = false;
+        cobs::classic_search_disable_avx2 = true;
+        cobs::classic_search_disable_avx512 = true;
+
+        std::vector<cobs::SearchResult> result;
+        s_base.search(query, result);
+        ASSERT_EQ(documents.size(), result.size());
+        for (auto& r : result) {
+            std::string doc_name = r.doc_name;
+            int index = std::stoi(doc_name.substr(doc_name.size() - 2));
+            ASSERT_GE(r.score, documents[index].data().size());
+        }
+    }
+    {
+        // 16-bit AVX2 (falls back if unsupported)
+        cobs::classic_search_disable_8bit = true;
+        cobs::classic_search_disable_16bit = false;
+        cobs::classic_search_disable_32bit = true;
+        cobs::classic_search_disable_sse2 = false;
+        cobs::classic_search_disable_avx2 = false;
+        cobs::classic_search_disable_avx512 = true;
+
+        std::vector<cobs::SearchResult> result;
+        s_base.search(query, result);
+        ASSERT_EQ(documents.size(), result.size());
+        for (auto& r : result) {
+            std::string doc_name = r.doc_name;
+            int index = std::stoi(doc_name.substr(doc_name.size() - 2));
+            ASSERT_GE(r.score, documents[index].data().size());
+        }
+    }
+    {
+        // 16-bit AVX-512 (falls back if unsupported)
+        cobs::classic_search_disable_8bit = true;
+        cobs::classic_search_disable_16bit = false;
+        cobs::classic_search_disable_32bit = true;
+        cobs::classic_search_disable_sse2 = false;
+        cobs::classic_search_disable_avx2 = false;
+        cobs::classic_search_disable_avx512 = false;
+
+        std::vector<cobs::SearchResult> result;
+        s_base.search(query, result);
+        ASSERT_EQ(documents.size(), result.size());
+        for (auto& r : result) {
+            std::string doc_name = r.doc_name;
+            int index = std::stoi(doc_name.substr(doc_name.size() - 2));
+            ASSERT_GE(r.score, documents[index].data().size());
+        }
+    }
+    {
+        // 32-bit AVX2 (falls back if unsupported)
+        cobs::classic_search_disable_8bit = true;
+        cobs::classic_search_disable_16bit = true;
+        cobs::classic_search_disable_32bit = false;
+        cobs::classic_search_disable_sse2 = false;
+        cobs::classic_search_disable_avx2 = false;
+        cobs::classic_search_disable_avx512 = true;
+
+        std::vector<cobs::SearchResult> result;
+        s_base.search(query, result);
+        ASSERT_EQ(documents.size(), result.size());
+        for (auto& r : result) {
+            std::string doc_name = r.doc_name;
+            int index = std::stoi(doc_name.substr(doc_name.size() - 2));
+            ASSERT_GE(r.score, documents[index].data().size());
+        }
+    }
+    {
+        // 32-bit AVX-512 (falls back if unsupported)
+        cobs::classic_search_disable_8bit = true;
+        cobs::classic_search_disable_16bit = true;
+        cobs::classic_search_disable_32bit = false;
+        cobs::classic_search_disable_sse2 = false;
+        cobs::classic_search_disable_avx2 = false;
+        cobs::classic_search_disable_avx512 = false;
 
         std::vector<cobs::SearchResult> result;
         s_base.search(query, result);
@@ -180,6 +316,36 @@ TEST_F(compact_index_query, one_included_mmap) {
     }
 }
 
+TEST_F(compact_index_query, one_included_mmap_page_cache) {
+    // generate
+    auto documents = generate_documents_one(query, /* num_documents */ 2000);
+    generate_test_case(documents, input_dir.string());
+
+    // construct compact index and mmap query with the row page cache
+    cobs::CompactIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.page_size = 2;
+    index_params.canonicalize = 1;
+
+    cobs::compact_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::CompactIndexMMapSearchFile>(
+            index_file, cobs::MMapPolicy(),
+            /* page_cache_bytes */ 1024 * 1024));
+
+    // execute the query twice, the second run hits the cache
+    for (size_t run = 0; run < 2; ++run) {
+        std::vector<cobs::SearchResult> result;
+        s_base.search(query, result);
+        ASSERT_EQ(documents.size(), result.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            ASSERT_EQ(result[i].score, 1);
+        }
+    }
+}
+
 TEST_F(compact_index_query, false_positive_mmap) {
     // generate
     auto documents = generate_documents_all(query);
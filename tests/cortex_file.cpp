@@ -51,6 +51,36 @@ TEST(cortex, process_kmers) {
     }
 }
 
+TEST(cortex, process_ranges) {
+    cobs::CortexFile ctx(in_cortex);
+
+    // process all kmers
+    std::vector<std::string> kmer_list;
+    ctx.process_terms(
+        31,
+        [&](const tlx::string_view& v) {
+            kmer_list.emplace_back(v.to_string());
+        });
+
+    // process in ranges of uneven size, results must concatenate to the
+    // full list
+    std::vector<std::string> ranged_list;
+    size_t begin = 0;
+    while (begin < kmer_list.size()) {
+        size_t end = std::min(begin + 777, kmer_list.size());
+        ctx.process_terms(
+            31, begin, end, /* color */ 0,
+            [&](const tlx::string_view& v) {
+                ranged_list.emplace_back(v.to_string());
+            });
+        begin = end;
+    }
+
+    die_unequal(kmer_list.size(), ranged_list.size());
+    for (size_t i = 0; i < kmer_list.size(); ++i)
+        ASSERT_EQ(kmer_list[i], ranged_list[i]);
+}
+
 TEST(cortex, sample1) {
     std::string line;
 
@@ -60,6 +60,25 @@ TEST(file, classic_index_header) {
     ASSERT_EQ(file_names, h_in.file_names_);
 }
 
+TEST(file, classic_index_header_padding) {
+    std::stringstream buffer;
+
+    // write classic index header
+    cobs::ClassicIndexHeader h_out;
+    h_out.term_size_ = 31;
+    h_out.canonicalize_ = 1;
+    h_out.signature_size_ = 321;
+    h_out.num_hashes_ = 21;
+    h_out.file_names_ = { "n1", "n2", "n3", "n4" };
+    h_out.serialize(buffer);
+
+    // read classic index header, the payload must start page-aligned
+    cobs::ClassicIndexHeader h_in;
+    h_in.deserialize(buffer);
+    cobs::StreamPos sp = cobs::get_stream_pos(buffer);
+    ASSERT_EQ(sp.curr_pos % cobs::header_page_alignment, 0U);
+}
+
 TEST(file, classic_index) {
     std::stringstream buffer;
 
@@ -24,6 +24,33 @@ TEST(text, process_txt1) {
     die_unequal(text.size() - 30, count);
 }
 
+TEST(text, process_chunked) {
+    // generate a document spanning many read chunks and compare the
+    // emitted terms against windows of the in-memory string
+    fs::path path = "data/text_chunked.tmp.txt";
+    std::string data;
+    std::srand(12345);
+    for (size_t i = 0; i < 100 * 1000 + 37; ++i)
+        data += "ACGT"[std::rand() % 4];
+    std::ofstream os(path);
+    os << data;
+    os.close();
+
+    cobs::TextFile text(path.string());
+    text.chunk_size_ = 4096;
+
+    size_t index = 0;
+    text.process_terms(
+        31,
+        [&](const tlx::string_view& v) {
+            ASSERT_EQ(data.substr(index, 31), v.to_string());
+            ++index;
+        });
+    die_unequal(data.size() - 30, index);
+
+    fs::remove(path);
+}
+
 TEST(text, document_list) {
     cobs::DocumentList doc_list(in_dir);
 
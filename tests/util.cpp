@@ -8,9 +8,15 @@
  ******************************************************************************/
 
 #include <cobs/util/misc.hpp>
+#include <cobs/util/parallel_for.hpp>
 #include <cobs/util/query.hpp>
+#include <cobs/util/timer.hpp>
 #include <gtest/gtest.h>
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
 #include <stdint.h>
+#include <vector>
 
 void is_aligned(void* ptr, size_t alignment) {
     ASSERT_EQ((uintptr_t)ptr % alignment, 0);
@@ -59,4 +65,64 @@ TEST(util, kmer_canonicalize) {
               "AAAAAAAAAAAAAAA\0TTTTTTTTTTTTTTT", false);
 }
 
+TEST(util, parallel_for_covers_range) {
+    // every index of a fine-grained range is run exactly once
+    std::vector<std::atomic<uint32_t> > hits(10000);
+    cobs::parallel_for(
+        100, hits.size(), 8,
+        [&](size_t i) { ++hits[i]; });
+    for (size_t i = 0; i < hits.size(); ++i) {
+        ASSERT_EQ(hits[i].load(), i >= 100 ? 1u : 0u);
+    }
+}
+
+TEST(util, parallel_for_nested) {
+    // inner parallel_for calls inside a parallel loop must not deadlock,
+    // the pattern classic_combine uses when merging index batches
+    std::atomic<uint64_t> sum(0);
+    cobs::parallel_for(
+        0, 16, 4,
+        [&](size_t i) {
+            cobs::parallel_for(
+                0, 64, 4,
+                [&](size_t j) { sum += i * 64 + j; });
+        });
+    ASSERT_EQ(sum.load(), 1024u * 1023u / 2);
+}
+
+TEST(util, timer_concurrent_merge) {
+    // worker threads merge their phase timers into a shared one without
+    // losing durations or call counts, and the JSON export carries both
+    cobs::Timer shared;
+    cobs::parallel_for(
+        0, 64, 8,
+        [&](size_t) {
+            cobs::Timer thr;
+            thr.active("io");
+            thr.active("add rows");
+            thr.stop();
+            shared += thr;
+        });
+    ASSERT_GT(shared.get("io"), 0.0);
+    ASSERT_GT(shared.get("add rows"), 0.0);
+
+    std::ostringstream json;
+    shared.print_json("test", json);
+    ASSERT_NE(json.str().find("\"name\":\"io\""), std::string::npos);
+    ASSERT_NE(json.str().find("\"count\":"), std::string::npos);
+    ASSERT_NE(json.str().find("\"threads\":[{"), std::string::npos);
+}
+
+TEST(util, parallel_for_exception) {
+    // an exception thrown by the functor reaches the caller
+    ASSERT_THROW(
+        cobs::parallel_for(
+            0, 1000, 4,
+            [&](size_t i) {
+                if (i == 666)
+                    throw std::runtime_error("parallel");
+            }),
+        std::runtime_error);
+}
+
 /******************************************************************************/